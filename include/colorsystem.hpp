@@ -11,13 +11,35 @@
 #include <algorithm>
 #include <array>
 #include <assert.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <limits>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 
 #include <math.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <vector>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define COLORSYSTEM_MMAP 1
+#endif
+
+#if !defined(COLORSYSTEM_NO_SIMD) && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64))
+#include <immintrin.h>
+#endif
+
 namespace ColorSystem
 {
 namespace util
@@ -46,1313 +68,6213 @@ namespace util
 
 static const float PI = 3.14159265358979323846f;
 
-class Vector3
-{
-  public:
-    typedef std::array<float, 3> vec3;
-    vec3                         v_;
-    constexpr Vector3(const float a, const float b, const float c) : v_({a, b, c}) { ; }
-    constexpr float        operator[](const int &i) const { return v_[i]; }
-    constexpr float        x() const { return v_[0]; }
-    constexpr float        y() const { return v_[1]; }
-    constexpr float        z() const { return v_[2]; }
-    constexpr auto         size() const { return v_.size(); }
-    auto                   begin() const { return v_.begin(); }
-    auto                   end() const { return v_.end(); }
-    constexpr float        dot(const Vector3 &a) const { return v_[0] * a[0] + v_[1] * a[1] + v_[2] * a[2]; }
-    static constexpr float dot(const Vector3 &a, const Vector3 &b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
-};
-
-class Matrix3
+// SIMD kernels. x86 builds pick the widest instruction set at runtime,
+// everything else (or COLORSYSTEM_NO_SIMD) falls back to plain loops.
+#if !defined(COLORSYSTEM_NO_SIMD) && (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define COLORSYSTEM_SIMD_X86 1
+#define COLORSYSTEM_TARGET(isa) __attribute__((target(isa)))
+#elif !defined(COLORSYSTEM_NO_SIMD) && defined(_MSC_VER) && defined(_M_X64) && defined(__AVX__)
+#define COLORSYSTEM_SIMD_X86 1
+#define COLORSYSTEM_TARGET(isa)
+#endif
+
+namespace SIMD
 {
-  public:
-    typedef std::array<float, 9> matrix;
-    matrix                       m_;
+    typedef enum
+    {
+        SCALAR,
+        SSE41,
+        AVX2, // with FMA
+        AVX512
+    } ISA;
 
-  private:
-    static constexpr int M(const int x, const int y) { return x + y * 3; }
-    static constexpr int I(const int y, const int x) { return ((x - 1) + (y - 1) * 3); }
+    namespace Detail
+    {
+        static ISA detect(void)
+        {
+#if defined(COLORSYSTEM_SIMD_X86) && defined(__GNUC__)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f"))
+                return AVX512;
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+                return AVX2;
+            if (__builtin_cpu_supports("sse4.1"))
+                return SSE41;
+#elif defined(COLORSYSTEM_SIMD_X86)
+            // msvc: no per-function targets, so only what the compiler was told to emit.
+#if defined(__AVX512F__)
+            return AVX512;
+#elif defined(__AVX2__)
+            return AVX2;
+#else
+            return SSE41;
+#endif
+#endif
+            return SCALAR;
+        }
+        inline ISA &current(void)
+        {
+            static ISA isa = detect();
+            return isa;
+        }
+    } // namespace Detail
 
-  public:
-    constexpr Matrix3(const float &a00, const float &a01, const float &a02, const float &a10, const float &a11,
-        const float &a12, const float &a20, const float &a21, const float &a22)
-        : m_({a00, a01, a02, a10, a11, a12, a20, a21, a22})
+    // widest instruction set this machine can run.
+    inline ISA supported(void)
     {
-        ;
+        static const ISA isa = Detail::detect();
+        return isa;
     }
-    constexpr Matrix3(void) : m_({1.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 1.f}) { ; }
-    static constexpr Matrix3 fromArray(const float *p)
+    // instruction set the kernels use. lower it to compare against the scalar path.
+    inline ISA  isa(void) { return Detail::current(); }
+    inline void setISA(const ISA i) { Detail::current() = (i < supported()) ? i : supported(); }
+
+    namespace Detail
     {
-        return Matrix3(p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7], p[8]);
-    }
-    static constexpr Matrix3 diag(const Vector3 &v) { return Matrix3(v[0], 0, 0, 0, v[1], 0, 0, 0, v[2]); }
+        // m is a row major 3x3 matrix, same as Matrix3::m_.
+        static void applyPlanarScalar(const float *m, const float *r, const float *g, const float *b, float *x,
+            float *y, float *z, const size_t count)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                const float p = r[i];
+                const float q = g[i];
+                const float s = b[i];
+                x[i]          = m[0] * p + m[1] * q + m[2] * s;
+                y[i]          = m[3] * p + m[4] * q + m[5] * s;
+                z[i]          = m[6] * p + m[7] * q + m[8] * s;
+            }
+        }
+        static void applyInterleavedScalar(const float *m, const float *src, float *dst, const size_t count,
+            const size_t srcStride, const size_t dstStride)
+        {
+            for (size_t i = 0; i < count; i++, src += srcStride, dst += dstStride)
+            {
+                const float p = src[0];
+                const float q = src[1];
+                const float s = src[2];
+                dst[0]        = m[0] * p + m[1] * q + m[2] * s;
+                dst[1]        = m[3] * p + m[4] * q + m[5] * s;
+                dst[2]        = m[6] * p + m[7] * q + m[8] * s;
+            }
+        }
 
-    constexpr float operator[](const int &i) const { return m_[i]; }
+#if defined(COLORSYSTEM_SIMD_X86)
+        // each kernel handles the largest multiple of its width and returns how many pixels it did.
+        COLORSYSTEM_TARGET("sse4.1")
+        static size_t applyPlanarSSE41(const float *m, const float *r, const float *g, const float *b, float *x,
+            float *y, float *z, const size_t count)
+        {
+            const __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+            const __m128 m3 = _mm_set1_ps(m[3]), m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]);
+            const __m128 m6 = _mm_set1_ps(m[6]), m7 = _mm_set1_ps(m[7]), m8 = _mm_set1_ps(m[8]);
+            size_t       i = 0;
+            for (; i + 4 <= count; i += 4)
+            {
+                const __m128 p = _mm_loadu_ps(r + i);
+                const __m128 q = _mm_loadu_ps(g + i);
+                const __m128 s = _mm_loadu_ps(b + i);
+                _mm_storeu_ps(x + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, p), _mm_mul_ps(m1, q)), _mm_mul_ps(m2, s)));
+                _mm_storeu_ps(y + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m3, p), _mm_mul_ps(m4, q)), _mm_mul_ps(m5, s)));
+                _mm_storeu_ps(z + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m6, p), _mm_mul_ps(m7, q)), _mm_mul_ps(m8, s)));
+            }
+            return i;
+        }
+        COLORSYSTEM_TARGET("avx2,fma")
+        static size_t applyPlanarAVX2(const float *m, const float *r, const float *g, const float *b, float *x,
+            float *y, float *z, const size_t count)
+        {
+            const __m256 m0 = _mm256_set1_ps(m[0]), m1 = _mm256_set1_ps(m[1]), m2 = _mm256_set1_ps(m[2]);
+            const __m256 m3 = _mm256_set1_ps(m[3]), m4 = _mm256_set1_ps(m[4]), m5 = _mm256_set1_ps(m[5]);
+            const __m256 m6 = _mm256_set1_ps(m[6]), m7 = _mm256_set1_ps(m[7]), m8 = _mm256_set1_ps(m[8]);
+            size_t       i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                const __m256 p = _mm256_loadu_ps(r + i);
+                const __m256 q = _mm256_loadu_ps(g + i);
+                const __m256 s = _mm256_loadu_ps(b + i);
+                _mm256_storeu_ps(x + i, _mm256_fmadd_ps(m2, s, _mm256_fmadd_ps(m1, q, _mm256_mul_ps(m0, p))));
+                _mm256_storeu_ps(y + i, _mm256_fmadd_ps(m5, s, _mm256_fmadd_ps(m4, q, _mm256_mul_ps(m3, p))));
+                _mm256_storeu_ps(z + i, _mm256_fmadd_ps(m8, s, _mm256_fmadd_ps(m7, q, _mm256_mul_ps(m6, p))));
+            }
+            return i;
+        }
+        COLORSYSTEM_TARGET("avx512f")
+        static size_t applyPlanarAVX512(const float *m, const float *r, const float *g, const float *b, float *x,
+            float *y, float *z, const size_t count)
+        {
+            const __m512 m0 = _mm512_set1_ps(m[0]), m1 = _mm512_set1_ps(m[1]), m2 = _mm512_set1_ps(m[2]);
+            const __m512 m3 = _mm512_set1_ps(m[3]), m4 = _mm512_set1_ps(m[4]), m5 = _mm512_set1_ps(m[5]);
+            const __m512 m6 = _mm512_set1_ps(m[6]), m7 = _mm512_set1_ps(m[7]), m8 = _mm512_set1_ps(m[8]);
+            size_t       i = 0;
+            for (; i + 16 <= count; i += 16)
+            {
+                const __m512 p = _mm512_loadu_ps(r + i);
+                const __m512 q = _mm512_loadu_ps(g + i);
+                const __m512 s = _mm512_loadu_ps(b + i);
+                _mm512_storeu_ps(x + i, _mm512_fmadd_ps(m2, s, _mm512_fmadd_ps(m1, q, _mm512_mul_ps(m0, p))));
+                _mm512_storeu_ps(y + i, _mm512_fmadd_ps(m5, s, _mm512_fmadd_ps(m4, q, _mm512_mul_ps(m3, p))));
+                _mm512_storeu_ps(z + i, _mm512_fmadd_ps(m8, s, _mm512_fmadd_ps(m7, q, _mm512_mul_ps(m6, p))));
+            }
+            return i;
+        }
 
-    constexpr Vector3        row(const int i) const { return Vector3(m_[M(0, i)], m_[M(1, i)], m_[M(2, i)]); }
-    constexpr Vector3        col(const int i) const { return Vector3(m_[M(i, 0)], m_[M(i, 1)], m_[M(i, 2)]); }
-    static constexpr Matrix3 transpose(const Matrix3 &a)
-    {
-        return Matrix3(
-            a[M(0, 0)], a[M(0, 1)], a[M(0, 2)], a[M(1, 0)], a[M(1, 1)], a[M(1, 2)], a[M(2, 0)], a[M(2, 1)], a[M(2, 2)]);
-    }
-    constexpr Matrix3 transpose(void) const { return transpose(*this); }
+        // RGB (3 floats per pixel) and RGBA (4) are transposed to planar and back with shuffles, 4 pixels per
+        // 128 bit lane: a group of 4 pixels is 3 or 4 vectors of 4 floats, the wider kernels put consecutive groups
+        // in consecutive lanes so the shuffles are the same in every lane. an RGBA destination keeps its alpha.
+        COLORSYSTEM_TARGET("sse4.1")
+        static inline void toPlanar3(
+            const __m128 v0, const __m128 v1, const __m128 v2, __m128 &p, __m128 &q, __m128 &s)
+        {
+            // v0 = r0 g0 b0 r1, v1 = g1 b1 r2 g2, v2 = b2 r3 g3 b3
+            const __m128 rg23 = _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(2, 1, 3, 2));
+            const __m128 gb01 = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(1, 0, 2, 1));
+            p                 = _mm_shuffle_ps(v0, rg23, _MM_SHUFFLE(2, 0, 3, 0));
+            q                 = _mm_shuffle_ps(gb01, rg23, _MM_SHUFFLE(3, 1, 2, 0));
+            s                 = _mm_shuffle_ps(gb01, v2, _MM_SHUFFLE(3, 0, 3, 1));
+        }
+        COLORSYSTEM_TARGET("sse4.1")
+        static inline void fromPlanar3(
+            const __m128 x, const __m128 y, const __m128 z, __m128 &o0, __m128 &o1, __m128 &o2)
+        {
+            const __m128 a = _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0)); // x0 x2 y0 y2
+            const __m128 b = _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 1, 3, 1)); // y1 y3 z1 z3
+            const __m128 c = _mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 1, 2, 0)); // z0 z2 x1 x3
+            o0             = _mm_shuffle_ps(a, c, _MM_SHUFFLE(2, 0, 2, 0));
+            o1             = _mm_shuffle_ps(b, a, _MM_SHUFFLE(3, 1, 2, 0));
+            o2             = _mm_shuffle_ps(c, b, _MM_SHUFFLE(3, 1, 3, 1));
+        }
+        COLORSYSTEM_TARGET("sse4.1")
+        static inline void toPlanar4(const __m128 v0, const __m128 v1, const __m128 v2, const __m128 v3, __m128 &p,
+            __m128 &q, __m128 &s, __m128 &a)
+        {
+            const __m128 t0 = _mm_unpacklo_ps(v0, v1); // r0 r1 g0 g1
+            const __m128 t1 = _mm_unpacklo_ps(v2, v3);
+            const __m128 t2 = _mm_unpackhi_ps(v0, v1); // b0 b1 a0 a1
+            const __m128 t3 = _mm_unpackhi_ps(v2, v3);
+            p               = _mm_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+            q               = _mm_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+            s               = _mm_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+            a               = _mm_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        }
+        COLORSYSTEM_TARGET("sse4.1")
+        static inline void fromPlanar4(const __m128 x, const __m128 y, const __m128 z, const __m128 a, __m128 &o0,
+            __m128 &o1, __m128 &o2, __m128 &o3)
+        {
+            const __m128 t0 = _mm_unpacklo_ps(x, y); // x0 y0 x1 y1
+            const __m128 t1 = _mm_unpacklo_ps(z, a); // z0 a0 z1 a1
+            const __m128 t2 = _mm_unpackhi_ps(x, y);
+            const __m128 t3 = _mm_unpackhi_ps(z, a);
+            o0              = _mm_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+            o1              = _mm_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+            o2              = _mm_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+            o3              = _mm_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        }
+        COLORSYSTEM_TARGET("avx2,fma")
+        static inline void toPlanar3(
+            const __m256 v0, const __m256 v1, const __m256 v2, __m256 &p, __m256 &q, __m256 &s)
+        {
+            const __m256 rg23 = _mm256_shuffle_ps(v1, v2, _MM_SHUFFLE(2, 1, 3, 2));
+            const __m256 gb01 = _mm256_shuffle_ps(v0, v1, _MM_SHUFFLE(1, 0, 2, 1));
+            p                 = _mm256_shuffle_ps(v0, rg23, _MM_SHUFFLE(2, 0, 3, 0));
+            q                 = _mm256_shuffle_ps(gb01, rg23, _MM_SHUFFLE(3, 1, 2, 0));
+            s                 = _mm256_shuffle_ps(gb01, v2, _MM_SHUFFLE(3, 0, 3, 1));
+        }
+        COLORSYSTEM_TARGET("avx2,fma")
+        static inline void fromPlanar3(
+            const __m256 x, const __m256 y, const __m256 z, __m256 &o0, __m256 &o1, __m256 &o2)
+        {
+            const __m256 a = _mm256_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));
+            const __m256 b = _mm256_shuffle_ps(y, z, _MM_SHUFFLE(3, 1, 3, 1));
+            const __m256 c = _mm256_shuffle_ps(z, x, _MM_SHUFFLE(3, 1, 2, 0));
+            o0             = _mm256_shuffle_ps(a, c, _MM_SHUFFLE(2, 0, 2, 0));
+            o1             = _mm256_shuffle_ps(b, a, _MM_SHUFFLE(3, 1, 2, 0));
+            o2             = _mm256_shuffle_ps(c, b, _MM_SHUFFLE(3, 1, 3, 1));
+        }
+        COLORSYSTEM_TARGET("avx2,fma")
+        static inline void toPlanar4(const __m256 v0, const __m256 v1, const __m256 v2, const __m256 v3, __m256 &p,
+            __m256 &q, __m256 &s, __m256 &a)
+        {
+            const __m256 t0 = _mm256_unpacklo_ps(v0, v1);
+            const __m256 t1 = _mm256_unpacklo_ps(v2, v3);
+            const __m256 t2 = _mm256_unpackhi_ps(v0, v1);
+            const __m256 t3 = _mm256_unpackhi_ps(v2, v3);
+            p               = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+            q               = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+            s               = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+            a               = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        }
+        COLORSYSTEM_TARGET("avx2,fma")
+        static inline void fromPlanar4(const __m256 x, const __m256 y, const __m256 z, const __m256 a, __m256 &o0,
+            __m256 &o1, __m256 &o2, __m256 &o3)
+        {
+            const __m256 t0 = _mm256_unpacklo_ps(x, y);
+            const __m256 t1 = _mm256_unpacklo_ps(z, a);
+            const __m256 t2 = _mm256_unpackhi_ps(x, y);
+            const __m256 t3 = _mm256_unpackhi_ps(z, a);
+            o0              = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+            o1              = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+            o2              = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+            o3              = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        }
+        // the maskz forms, GCC builds the plain AVX-512 shuffles on an undefined vector and warns about it.
+        COLORSYSTEM_TARGET("avx512f")
+        static inline void toPlanar3(
+            const __m512 v0, const __m512 v1, const __m512 v2, __m512 &p, __m512 &q, __m512 &s)
+        {
+            const __m512 rg23 = _mm512_maskz_shuffle_ps(0xffff, v1, v2, _MM_SHUFFLE(2, 1, 3, 2));
+            const __m512 gb01 = _mm512_maskz_shuffle_ps(0xffff, v0, v1, _MM_SHUFFLE(1, 0, 2, 1));
+            p                 = _mm512_maskz_shuffle_ps(0xffff, v0, rg23, _MM_SHUFFLE(2, 0, 3, 0));
+            q                 = _mm512_maskz_shuffle_ps(0xffff, gb01, rg23, _MM_SHUFFLE(3, 1, 2, 0));
+            s                 = _mm512_maskz_shuffle_ps(0xffff, gb01, v2, _MM_SHUFFLE(3, 0, 3, 1));
+        }
+        COLORSYSTEM_TARGET("avx512f")
+        static inline void fromPlanar3(
+            const __m512 x, const __m512 y, const __m512 z, __m512 &o0, __m512 &o1, __m512 &o2)
+        {
+            const __m512 a = _mm512_maskz_shuffle_ps(0xffff, x, y, _MM_SHUFFLE(2, 0, 2, 0));
+            const __m512 b = _mm512_maskz_shuffle_ps(0xffff, y, z, _MM_SHUFFLE(3, 1, 3, 1));
+            const __m512 c = _mm512_maskz_shuffle_ps(0xffff, z, x, _MM_SHUFFLE(3, 1, 2, 0));
+            o0             = _mm512_maskz_shuffle_ps(0xffff, a, c, _MM_SHUFFLE(2, 0, 2, 0));
+            o1             = _mm512_maskz_shuffle_ps(0xffff, b, a, _MM_SHUFFLE(3, 1, 2, 0));
+            o2             = _mm512_maskz_shuffle_ps(0xffff, c, b, _MM_SHUFFLE(3, 1, 3, 1));
+        }
+        COLORSYSTEM_TARGET("avx512f")
+        static inline void toPlanar4(const __m512 v0, const __m512 v1, const __m512 v2, const __m512 v3, __m512 &p,
+            __m512 &q, __m512 &s, __m512 &a)
+        {
+            const __m512 t0 = _mm512_maskz_unpacklo_ps(0xffff, v0, v1);
+            const __m512 t1 = _mm512_maskz_unpacklo_ps(0xffff, v2, v3);
+            const __m512 t2 = _mm512_maskz_unpackhi_ps(0xffff, v0, v1);
+            const __m512 t3 = _mm512_maskz_unpackhi_ps(0xffff, v2, v3);
+            p               = _mm512_maskz_shuffle_ps(0xffff, t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+            q               = _mm512_maskz_shuffle_ps(0xffff, t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+            s               = _mm512_maskz_shuffle_ps(0xffff, t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+            a               = _mm512_maskz_shuffle_ps(0xffff, t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        }
+        COLORSYSTEM_TARGET("avx512f")
+        static inline void fromPlanar4(const __m512 x, const __m512 y, const __m512 z, const __m512 a, __m512 &o0,
+            __m512 &o1, __m512 &o2, __m512 &o3)
+        {
+            const __m512 t0 = _mm512_maskz_unpacklo_ps(0xffff, x, y);
+            const __m512 t1 = _mm512_maskz_unpacklo_ps(0xffff, z, a);
+            const __m512 t2 = _mm512_maskz_unpackhi_ps(0xffff, x, y);
+            const __m512 t3 = _mm512_maskz_unpackhi_ps(0xffff, z, a);
+            o0              = _mm512_maskz_shuffle_ps(0xffff, t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+            o1              = _mm512_maskz_shuffle_ps(0xffff, t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+            o2              = _mm512_maskz_shuffle_ps(0xffff, t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+            o3              = _mm512_maskz_shuffle_ps(0xffff, t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        }
 
-    static constexpr Matrix3 mul(const Matrix3 &a, const Matrix3 &b)
-    {
-        return Matrix3(a[M(0, 0)] * b[M(0, 0)] + a[M(1, 0)] * b[M(0, 1)] + a[M(2, 0)] * b[M(0, 2)],
-            a[M(0, 0)] * b[M(1, 0)] + a[M(1, 0)] * b[M(1, 1)] + a[M(2, 0)] * b[M(1, 2)],
-            a[M(0, 0)] * b[M(2, 0)] + a[M(1, 0)] * b[M(2, 1)] + a[M(2, 0)] * b[M(2, 2)],
+        // vector j of each group, groups are 4 * stride floats apart.
+        COLORSYSTEM_TARGET("avx2,fma")
+        static inline __m256 loadGroups(const float *p, const size_t step)
+        {
+            return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p)), _mm_loadu_ps(p + step), 1);
+        }
+        COLORSYSTEM_TARGET("avx2,fma")
+        static inline void storeGroups(float *p, const size_t step, const __m256 v)
+        {
+            _mm_storeu_ps(p, _mm256_castps256_ps128(v));
+            _mm_storeu_ps(p + step, _mm256_extractf128_ps(v, 1));
+        }
+        COLORSYSTEM_TARGET("avx512f")
+        static inline __m512 loadGroups4(const float *p, const size_t step)
+        {
+            const __m512 lo = _mm512_insertf32x4(_mm512_castps128_ps512(_mm_loadu_ps(p)), _mm_loadu_ps(p + step), 1);
+            const __m512 hi = _mm512_insertf32x4(lo, _mm_loadu_ps(p + step * 2), 2);
+            return _mm512_insertf32x4(hi, _mm_loadu_ps(p + step * 3), 3);
+        }
+        COLORSYSTEM_TARGET("avx512f")
+        static inline void storeGroups4(float *p, const size_t step, const __m512 v)
+        {
+            _mm_storeu_ps(p, _mm512_maskz_extractf32x4_ps(0xf, v, 0));
+            _mm_storeu_ps(p + step, _mm512_maskz_extractf32x4_ps(0xf, v, 1));
+            _mm_storeu_ps(p + step * 2, _mm512_maskz_extractf32x4_ps(0xf, v, 2));
+            _mm_storeu_ps(p + step * 3, _mm512_maskz_extractf32x4_ps(0xf, v, 3));
+        }
 
-            a[M(0, 1)] * b[M(0, 0)] + a[M(1, 1)] * b[M(0, 1)] + a[M(2, 1)] * b[M(0, 2)],
-            a[M(0, 1)] * b[M(1, 0)] + a[M(1, 1)] * b[M(1, 1)] + a[M(2, 1)] * b[M(1, 2)],
-            a[M(0, 1)] * b[M(2, 0)] + a[M(1, 1)] * b[M(2, 1)] + a[M(2, 1)] * b[M(2, 2)],
+        template <size_t SRC, size_t DST>
+        COLORSYSTEM_TARGET("sse4.1")
+        static size_t applyRGBSSE41(const float *m, const float *src, float *dst, const size_t count)
+        {
+            const __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+            const __m128 m3 = _mm_set1_ps(m[3]), m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]);
+            const __m128 m6 = _mm_set1_ps(m[6]), m7 = _mm_set1_ps(m[7]), m8 = _mm_set1_ps(m[8]);
+            size_t       i = 0;
+            for (; i + 4 <= count; i += 4)
+            {
+                const float *s = src + i * SRC;
+                float       *d = dst + i * DST;
+                __m128       p, q, r, a;
+                if (SRC == 3)
+                    toPlanar3(_mm_loadu_ps(s), _mm_loadu_ps(s + 4), _mm_loadu_ps(s + 8), p, q, r);
+                else
+                    toPlanar4(_mm_loadu_ps(s), _mm_loadu_ps(s + 4), _mm_loadu_ps(s + 8), _mm_loadu_ps(s + 12), p, q, r,
+                        a);
+                const __m128 x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, p), _mm_mul_ps(m1, q)), _mm_mul_ps(m2, r));
+                const __m128 y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m3, p), _mm_mul_ps(m4, q)), _mm_mul_ps(m5, r));
+                const __m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m6, p), _mm_mul_ps(m7, q)), _mm_mul_ps(m8, r));
+                __m128       o0, o1, o2, o3;
+                if (DST == 3)
+                {
+                    fromPlanar3(x, y, z, o0, o1, o2);
+                }
+                else
+                {
+                    toPlanar4(_mm_loadu_ps(d), _mm_loadu_ps(d + 4), _mm_loadu_ps(d + 8), _mm_loadu_ps(d + 12), p, q, r,
+                        a);
+                    fromPlanar4(x, y, z, a, o0, o1, o2, o3);
+                    _mm_storeu_ps(d + 12, o3);
+                }
+                _mm_storeu_ps(d, o0);
+                _mm_storeu_ps(d + 4, o1);
+                _mm_storeu_ps(d + 8, o2);
+            }
+            return i;
+        }
+        template <size_t SRC, size_t DST>
+        COLORSYSTEM_TARGET("avx2,fma")
+        static size_t applyRGBAVX2(const float *m, const float *src, float *dst, const size_t count)
+        {
+            const __m256 m0 = _mm256_set1_ps(m[0]), m1 = _mm256_set1_ps(m[1]), m2 = _mm256_set1_ps(m[2]);
+            const __m256 m3 = _mm256_set1_ps(m[3]), m4 = _mm256_set1_ps(m[4]), m5 = _mm256_set1_ps(m[5]);
+            const __m256 m6 = _mm256_set1_ps(m[6]), m7 = _mm256_set1_ps(m[7]), m8 = _mm256_set1_ps(m[8]);
+            const size_t ss = SRC * 4, ds = DST * 4; // floats per group of 4 pixels
+            size_t       i  = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                const float *s = src + i * SRC;
+                float       *d = dst + i * DST;
+                __m256       p, q, r, a;
+                if (SRC == 3)
+                    toPlanar3(loadGroups(s, ss), loadGroups(s + 4, ss), loadGroups(s + 8, ss), p, q, r);
+                else
+                    toPlanar4(loadGroups(s, ss), loadGroups(s + 4, ss), loadGroups(s + 8, ss), loadGroups(s + 12, ss),
+                        p, q, r, a);
+                const __m256 x = _mm256_fmadd_ps(m2, r, _mm256_fmadd_ps(m1, q, _mm256_mul_ps(m0, p)));
+                const __m256 y = _mm256_fmadd_ps(m5, r, _mm256_fmadd_ps(m4, q, _mm256_mul_ps(m3, p)));
+                const __m256 z = _mm256_fmadd_ps(m8, r, _mm256_fmadd_ps(m7, q, _mm256_mul_ps(m6, p)));
+                __m256       o0, o1, o2, o3;
+                if (DST == 3)
+                {
+                    fromPlanar3(x, y, z, o0, o1, o2);
+                }
+                else
+                {
+                    toPlanar4(loadGroups(d, ds), loadGroups(d + 4, ds), loadGroups(d + 8, ds), loadGroups(d + 12, ds),
+                        p, q, r, a);
+                    fromPlanar4(x, y, z, a, o0, o1, o2, o3);
+                    storeGroups(d + 12, ds, o3);
+                }
+                storeGroups(d, ds, o0);
+                storeGroups(d + 4, ds, o1);
+                storeGroups(d + 8, ds, o2);
+            }
+            return i;
+        }
+        template <size_t SRC, size_t DST>
+        COLORSYSTEM_TARGET("avx512f")
+        static size_t applyRGBAVX512(const float *m, const float *src, float *dst, const size_t count)
+        {
+            const __m512 m0 = _mm512_set1_ps(m[0]), m1 = _mm512_set1_ps(m[1]), m2 = _mm512_set1_ps(m[2]);
+            const __m512 m3 = _mm512_set1_ps(m[3]), m4 = _mm512_set1_ps(m[4]), m5 = _mm512_set1_ps(m[5]);
+            const __m512 m6 = _mm512_set1_ps(m[6]), m7 = _mm512_set1_ps(m[7]), m8 = _mm512_set1_ps(m[8]);
+            const size_t ss = SRC * 4, ds = DST * 4;
+            size_t       i  = 0;
+            for (; i + 16 <= count; i += 16)
+            {
+                const float *s = src + i * SRC;
+                float       *d = dst + i * DST;
+                __m512       p, q, r, a;
+                if (SRC == 3)
+                    toPlanar3(loadGroups4(s, ss), loadGroups4(s + 4, ss), loadGroups4(s + 8, ss), p, q, r);
+                else
+                    toPlanar4(loadGroups4(s, ss), loadGroups4(s + 4, ss), loadGroups4(s + 8, ss),
+                        loadGroups4(s + 12, ss), p, q, r, a);
+                const __m512 x = _mm512_fmadd_ps(m2, r, _mm512_fmadd_ps(m1, q, _mm512_mul_ps(m0, p)));
+                const __m512 y = _mm512_fmadd_ps(m5, r, _mm512_fmadd_ps(m4, q, _mm512_mul_ps(m3, p)));
+                const __m512 z = _mm512_fmadd_ps(m8, r, _mm512_fmadd_ps(m7, q, _mm512_mul_ps(m6, p)));
+                __m512       o0, o1, o2, o3;
+                if (DST == 3)
+                {
+                    fromPlanar3(x, y, z, o0, o1, o2);
+                }
+                else
+                {
+                    toPlanar4(loadGroups4(d, ds), loadGroups4(d + 4, ds), loadGroups4(d + 8, ds),
+                        loadGroups4(d + 12, ds), p, q, r, a);
+                    fromPlanar4(x, y, z, a, o0, o1, o2, o3);
+                    storeGroups4(d + 12, ds, o3);
+                }
+                storeGroups4(d, ds, o0);
+                storeGroups4(d + 4, ds, o1);
+                storeGroups4(d + 8, ds, o2);
+            }
+            return i;
+        }
+        // 3 or 4 floats per pixel on either side (not both 4, see the RGBA kernels).
+        static size_t applyRGB(const ISA level, const float *m, const float *src, float *dst, const size_t count,
+            const size_t srcStride, const size_t dstStride)
+        {
+            const int shape = (srcStride == 3 ? 0 : 2) + (dstStride == 3 ? 0 : 1); // 3->3, 3->4, 4->3
+            switch (level)
+            {
+            case AVX512:
+                // 3->4 reads the destination alpha back through 4 inserts per vector, AVX2 does that faster.
+                return (shape == 0) ? applyRGBAVX512<3, 3>(m, src, dst, count)
+                                    : (shape == 1) ? applyRGBAVX2<3, 4>(m, src, dst, count)
+                                                   : applyRGBAVX512<4, 3>(m, src, dst, count);
+            case AVX2:
+                return (shape == 0) ? applyRGBAVX2<3, 3>(m, src, dst, count)
+                                    : (shape == 1) ? applyRGBAVX2<3, 4>(m, src, dst, count)
+                                                   : applyRGBAVX2<4, 3>(m, src, dst, count);
+            case SSE41:
+                return (shape == 0) ? applyRGBSSE41<3, 3>(m, src, dst, count)
+                                    : (shape == 1) ? applyRGBSSE41<3, 4>(m, src, dst, count)
+                                                   : applyRGBSSE41<4, 3>(m, src, dst, count);
+            case SCALAR:
+            default:
+                return 0;
+            }
+        }
 
-            a[M(0, 2)] * b[M(0, 0)] + a[M(1, 2)] * b[M(0, 1)] + a[M(2, 2)] * b[M(0, 2)],
-            a[M(0, 2)] * b[M(1, 0)] + a[M(1, 2)] * b[M(1, 1)] + a[M(2, 2)] * b[M(1, 2)],
-            a[M(0, 2)] * b[M(2, 0)] + a[M(1, 2)] * b[M(2, 1)] + a[M(2, 2)] * b[M(2, 2)]);
-    }
-    constexpr Matrix3 mul(const Matrix3 &b) const { return mul(*this, b); }
+        // RGBA: one pixel per 128bit lane, alpha of dst is kept.
+        COLORSYSTEM_TARGET("sse4.1")
+        static size_t applyRGBASSE41(const float *m, const float *src, float *dst, const size_t count)
+        {
+            const __m128 c0 = _mm_setr_ps(m[0], m[3], m[6], 0.f);
+            const __m128 c1 = _mm_setr_ps(m[1], m[4], m[7], 0.f);
+            const __m128 c2 = _mm_setr_ps(m[2], m[5], m[8], 0.f);
+            for (size_t i = 0; i < count; i++)
+            {
+                const __m128 p = _mm_loadu_ps(src + i * 4);
+                const __m128 o = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_shuffle_ps(p, p, 0x00)),
+                                                _mm_mul_ps(c1, _mm_shuffle_ps(p, p, 0x55))),
+                    _mm_mul_ps(c2, _mm_shuffle_ps(p, p, 0xAA)));
+                _mm_storeu_ps(dst + i * 4, _mm_blend_ps(o, _mm_loadu_ps(dst + i * 4), 0x8));
+            }
+            return count;
+        }
+        COLORSYSTEM_TARGET("avx2,fma")
+        static size_t applyRGBAAVX2(const float *m, const float *src, float *dst, const size_t count)
+        {
+            const __m256 c0 = _mm256_setr_ps(m[0], m[3], m[6], 0.f, m[0], m[3], m[6], 0.f);
+            const __m256 c1 = _mm256_setr_ps(m[1], m[4], m[7], 0.f, m[1], m[4], m[7], 0.f);
+            const __m256 c2 = _mm256_setr_ps(m[2], m[5], m[8], 0.f, m[2], m[5], m[8], 0.f);
+            size_t       i  = 0;
+            for (; i + 2 <= count; i += 2)
+            {
+                const __m256 p = _mm256_loadu_ps(src + i * 4);
+                const __m256 o = _mm256_fmadd_ps(c2, _mm256_permute_ps(p, 0xAA),
+                    _mm256_fmadd_ps(c1, _mm256_permute_ps(p, 0x55), _mm256_mul_ps(c0, _mm256_permute_ps(p, 0x00))));
+                _mm256_storeu_ps(dst + i * 4, _mm256_blend_ps(o, _mm256_loadu_ps(dst + i * 4), 0x88));
+            }
+            return i;
+        }
+        COLORSYSTEM_TARGET("avx512f")
+        static size_t applyRGBAAVX512(const float *m, const float *src, float *dst, const size_t count)
+        {
+            const __m512 c0 = _mm512_setr_ps(
+                m[0], m[3], m[6], 0.f, m[0], m[3], m[6], 0.f, m[0], m[3], m[6], 0.f, m[0], m[3], m[6], 0.f);
+            const __m512 c1 = _mm512_setr_ps(
+                m[1], m[4], m[7], 0.f, m[1], m[4], m[7], 0.f, m[1], m[4], m[7], 0.f, m[1], m[4], m[7], 0.f);
+            const __m512 c2 = _mm512_setr_ps(
+                m[2], m[5], m[8], 0.f, m[2], m[5], m[8], 0.f, m[2], m[5], m[8], 0.f, m[2], m[5], m[8], 0.f);
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4)
+            {
+                const __m512 p = _mm512_loadu_ps(src + i * 4);
+                const __m512 o = _mm512_fmadd_ps(c2, _mm512_maskz_permute_ps(0xffff, p, 0xAA),
+                    _mm512_fmadd_ps(c1, _mm512_maskz_permute_ps(0xffff, p, 0x55),
+                        _mm512_mul_ps(c0, _mm512_maskz_permute_ps(0xffff, p, 0x00))));
+                _mm512_storeu_ps(dst + i * 4, _mm512_mask_blend_ps(0x8888, o, _mm512_loadu_ps(dst + i * 4)));
+            }
+            return i;
+        }
+#endif
 
-    static constexpr Vector3 apply(const Matrix3 &m, const Vector3 &v)
-    {
-        return Vector3(m[M(0, 0)] * v[0] + m[M(1, 0)] * v[1] + m[M(2, 0)] * v[2],
-            m[M(0, 1)] * v[0] + m[M(1, 1)] * v[1] + m[M(2, 1)] * v[2],
-            m[M(0, 2)] * v[0] + m[M(1, 2)] * v[1] + m[M(2, 2)] * v[2]);
-    }
-    constexpr Vector3 apply(const Vector3 &v) const { return apply(*this, v); }
+        // spectral integration: out[k] = dot(s, w_k) for the three weight rows wx, wy, wz of 'taps' floats.
+        static void integrateScalar(const float *wx, const float *wy, const float *wz, const size_t taps,
+            const float *s, const size_t count, const size_t sStride, float *out, const size_t oStride)
+        {
+            for (size_t i = 0; i < count; i++, s += sStride, out += oStride)
+            {
+                float x = 0.f, y = 0.f, z = 0.f;
+                for (size_t t = 0; t < taps; t++)
+                {
+                    x += s[t] * wx[t];
+                    y += s[t] * wy[t];
+                    z += s[t] * wz[t];
+                }
+                out[0] = x;
+                out[1] = y;
+                out[2] = z;
+            }
+        }
+
+#if defined(COLORSYSTEM_SIMD_X86)
+        // two spectra per step so every weight load feeds two accumulators. taps left over by the vector width are
+        // summed in scalar, spectra left over by the pair are for integrateScalar.
+        COLORSYSTEM_TARGET("sse4.1")
+        static float hsumSSE41(const __m128 v)
+        {
+            const __m128 h = _mm_add_ps(v, _mm_movehl_ps(v, v));
+            return _mm_cvtss_f32(_mm_add_ss(h, _mm_shuffle_ps(h, h, 1)));
+        }
+        COLORSYSTEM_TARGET("sse4.1")
+        static size_t integrateSSE41(const float *wx, const float *wy, const float *wz, const size_t taps,
+            const float *s, const size_t count, const size_t sStride, float *out, const size_t oStride)
+        {
+            const size_t body = taps & ~size_t(3);
+            size_t       i    = 0;
+            for (; i + 2 <= count; i += 2)
+            {
+                const float *s0 = s + i * sStride;
+                const float *s1 = s0 + sStride;
+                __m128       x0 = _mm_setzero_ps(), y0 = _mm_setzero_ps(), z0 = _mm_setzero_ps();
+                __m128       x1 = _mm_setzero_ps(), y1 = _mm_setzero_ps(), z1 = _mm_setzero_ps();
+                for (size_t t = 0; t < body; t += 4)
+                {
+                    const __m128 a = _mm_loadu_ps(wx + t), b = _mm_loadu_ps(wy + t), c = _mm_loadu_ps(wz + t);
+                    const __m128 p = _mm_loadu_ps(s0 + t), q = _mm_loadu_ps(s1 + t);
+                    x0             = _mm_add_ps(x0, _mm_mul_ps(p, a));
+                    y0             = _mm_add_ps(y0, _mm_mul_ps(p, b));
+                    z0             = _mm_add_ps(z0, _mm_mul_ps(p, c));
+                    x1             = _mm_add_ps(x1, _mm_mul_ps(q, a));
+                    y1             = _mm_add_ps(y1, _mm_mul_ps(q, b));
+                    z1             = _mm_add_ps(z1, _mm_mul_ps(q, c));
+                }
+                float *o0 = out + i * oStride;
+                float *o1 = o0 + oStride;
+                o0[0] = hsumSSE41(x0), o0[1] = hsumSSE41(y0), o0[2] = hsumSSE41(z0);
+                o1[0] = hsumSSE41(x1), o1[1] = hsumSSE41(y1), o1[2] = hsumSSE41(z1);
+                for (size_t t = body; t < taps; t++)
+                {
+                    o0[0] += s0[t] * wx[t], o0[1] += s0[t] * wy[t], o0[2] += s0[t] * wz[t];
+                    o1[0] += s1[t] * wx[t], o1[1] += s1[t] * wy[t], o1[2] += s1[t] * wz[t];
+                }
+            }
+            return i;
+        }
+        COLORSYSTEM_TARGET("avx2,fma")
+        static float hsumAVX2(const __m256 v)
+        {
+            const __m128 r = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+            const __m128 h = _mm_add_ps(r, _mm_movehl_ps(r, r));
+            return _mm_cvtss_f32(_mm_add_ss(h, _mm_shuffle_ps(h, h, 1)));
+        }
+        COLORSYSTEM_TARGET("avx2,fma")
+        static size_t integrateAVX2(const float *wx, const float *wy, const float *wz, const size_t taps,
+            const float *s, const size_t count, const size_t sStride, float *out, const size_t oStride)
+        {
+            const size_t body = taps & ~size_t(7);
+            size_t       i    = 0;
+            for (; i + 2 <= count; i += 2)
+            {
+                const float *s0 = s + i * sStride;
+                const float *s1 = s0 + sStride;
+                __m256       x0 = _mm256_setzero_ps(), y0 = _mm256_setzero_ps(), z0 = _mm256_setzero_ps();
+                __m256       x1 = _mm256_setzero_ps(), y1 = _mm256_setzero_ps(), z1 = _mm256_setzero_ps();
+                for (size_t t = 0; t < body; t += 8)
+                {
+                    const __m256 a = _mm256_loadu_ps(wx + t), b = _mm256_loadu_ps(wy + t), c = _mm256_loadu_ps(wz + t);
+                    const __m256 p = _mm256_loadu_ps(s0 + t), q = _mm256_loadu_ps(s1 + t);
+                    x0             = _mm256_fmadd_ps(p, a, x0);
+                    y0             = _mm256_fmadd_ps(p, b, y0);
+                    z0             = _mm256_fmadd_ps(p, c, z0);
+                    x1             = _mm256_fmadd_ps(q, a, x1);
+                    y1             = _mm256_fmadd_ps(q, b, y1);
+                    z1             = _mm256_fmadd_ps(q, c, z1);
+                }
+                float *o0 = out + i * oStride;
+                float *o1 = o0 + oStride;
+                o0[0] = hsumAVX2(x0), o0[1] = hsumAVX2(y0), o0[2] = hsumAVX2(z0);
+                o1[0] = hsumAVX2(x1), o1[1] = hsumAVX2(y1), o1[2] = hsumAVX2(z1);
+                for (size_t t = body; t < taps; t++)
+                {
+                    o0[0] += s0[t] * wx[t], o0[1] += s0[t] * wy[t], o0[2] += s0[t] * wz[t];
+                    o1[0] += s1[t] * wx[t], o1[1] += s1[t] * wy[t], o1[2] += s1[t] * wz[t];
+                }
+            }
+            return i;
+        }
+        // halves through the maskz extract: _mm512_reduce_add_ps and _mm512_castps512_ps256 are built on an
+        // undefined vector in GCC, which warns in every file including this header.
+        COLORSYSTEM_TARGET("avx512f")
+        static float hsumAVX512(const __m512 v)
+        {
+            const __m512d d = _mm512_castps_pd(v);
+            const __m256  h = _mm256_add_ps(_mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xff, d, 0)),
+                _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xff, d, 1)));
+            return hsumSSE41(_mm_add_ps(_mm256_castps256_ps128(h), _mm256_extractf128_ps(h, 1)));
+        }
+        COLORSYSTEM_TARGET("avx512f")
+        static size_t integrateAVX512(const float *wx, const float *wy, const float *wz, const size_t taps,
+            const float *s, const size_t count, const size_t sStride, float *out, const size_t oStride)
+        {
+            const size_t body = taps & ~size_t(15);
+            size_t       i    = 0;
+            for (; i + 2 <= count; i += 2)
+            {
+                const float *s0 = s + i * sStride;
+                const float *s1 = s0 + sStride;
+                __m512       x0 = _mm512_setzero_ps(), y0 = _mm512_setzero_ps(), z0 = _mm512_setzero_ps();
+                __m512       x1 = _mm512_setzero_ps(), y1 = _mm512_setzero_ps(), z1 = _mm512_setzero_ps();
+                for (size_t t = 0; t < body; t += 16)
+                {
+                    const __m512 a = _mm512_loadu_ps(wx + t), b = _mm512_loadu_ps(wy + t), c = _mm512_loadu_ps(wz + t);
+                    const __m512 p = _mm512_loadu_ps(s0 + t), q = _mm512_loadu_ps(s1 + t);
+                    x0             = _mm512_fmadd_ps(p, a, x0);
+                    y0             = _mm512_fmadd_ps(p, b, y0);
+                    z0             = _mm512_fmadd_ps(p, c, z0);
+                    x1             = _mm512_fmadd_ps(q, a, x1);
+                    y1             = _mm512_fmadd_ps(q, b, y1);
+                    z1             = _mm512_fmadd_ps(q, c, z1);
+                }
+                float *o0 = out + i * oStride;
+                float *o1 = o0 + oStride;
+                o0[0] = hsumAVX512(x0), o0[1] = hsumAVX512(y0), o0[2] = hsumAVX512(z0);
+                o1[0] = hsumAVX512(x1), o1[1] = hsumAVX512(y1), o1[2] = hsumAVX512(z1);
+                for (size_t t = body; t < taps; t++)
+                {
+                    o0[0] += s0[t] * wx[t], o0[1] += s0[t] * wy[t], o0[2] += s0[t] * wz[t];
+                    o1[0] += s1[t] * wx[t], o1[1] += s1[t] * wy[t], o1[2] += s1[t] * wz[t];
+                }
+            }
+            return i;
+        }
+#endif
+    } // namespace Detail
 
-    static constexpr float det(const Matrix3 &m)
-    {
-        return m[I(1, 1)] * m[I(2, 2)] * m[I(3, 3)] + m[I(2, 1)] * m[I(3, 2)] * m[I(1, 3)] +
-               m[I(3, 1)] * m[I(1, 2)] * m[I(2, 3)] - m[I(1, 1)] * m[I(3, 2)] * m[I(2, 3)] -
-               m[I(3, 1)] * m[I(2, 2)] * m[I(1, 3)] - m[I(2, 1)] * m[I(1, 2)] * m[I(3, 3)];
-    }
-    constexpr float det(void) const { return det(*this); }
 
-    static constexpr Matrix3 mul(const Matrix3 &m, const float &a)
+    // planar buffers: r,g,b in, x,y,z out. output planes may alias the input planes.
+    static void applyMatrixPlanar(const float *m, const float *r, const float *g, const float *b, float *x, float *y,
+        float *z, const size_t count)
     {
-        return Matrix3(m[0] * a, m[1] * a, m[2] * a, m[3] * a, m[4] * a, m[5] * a, m[6] * a, m[7] * a, m[8] * a);
+        size_t done = 0;
+#if defined(COLORSYSTEM_SIMD_X86)
+        switch (isa())
+        {
+        case AVX512:
+            done = Detail::applyPlanarAVX512(m, r, g, b, x, y, z, count);
+            break;
+        case AVX2:
+            done = Detail::applyPlanarAVX2(m, r, g, b, x, y, z, count);
+            break;
+        case SSE41:
+            done = Detail::applyPlanarSSE41(m, r, g, b, x, y, z, count);
+            break;
+        case SCALAR:
+        default:
+            break;
+        }
+#endif
+        Detail::applyPlanarScalar(m, r + done, g + done, b + done, x + done, y + done, z + done, count - done);
     }
-    constexpr Matrix3        mul(const float a) const { return mul(*this, a); }
-    static constexpr Matrix3 div(const Matrix3 &m, const float &a) { return mul(m, 1.f / a); }
-    constexpr Matrix3        div(const float a) const { return div(*this, a); }
 
-    static constexpr Matrix3 add(const Matrix3 &a, const Matrix3 &b)
+    // interleaved buffers, strides in floats. 3 and 4 floats per pixel (in any combination) have their own kernels.
+    static void applyMatrixInterleaved(const float *m, const float *src, float *dst, const size_t count,
+        const size_t srcStride, const size_t dstStride)
     {
-        return Matrix3(a[0] + b[0], a[1] + b[1], a[2] + b[2], a[3] + b[3], a[4] + b[4], a[5] + b[5], a[6] + b[6],
-            a[7] + b[7], a[8] + b[8]);
+        size_t done = 0;
+#if defined(COLORSYSTEM_SIMD_X86)
+        const ISA level = isa();
+        if ((srcStride == 3 || srcStride == 4) && (dstStride == 3 || dstStride == 4) && srcStride + dstStride < 8)
+        {
+            done = Detail::applyRGB(level, m, src, dst, count, srcStride, dstStride);
+        }
+        else if (srcStride == 4 && dstStride == 4)
+        {
+            switch (level)
+            {
+            case AVX512:
+                done = Detail::applyRGBAAVX512(m, src, dst, count);
+                break;
+            case AVX2:
+                done = Detail::applyRGBAAVX2(m, src, dst, count);
+                break;
+            case SSE41:
+                done = Detail::applyRGBASSE41(m, src, dst, count);
+                break;
+            case SCALAR:
+            default:
+                break;
+            }
+        }
+#endif
+        Detail::applyInterleavedScalar(m, src + done * srcStride, dst + done * dstStride, count - done, srcStride,
+            dstStride);
     }
-    constexpr Matrix3 add(const Matrix3 &b) const { return add(*this, b); }
 
-    static constexpr Matrix3 invert(const Matrix3 &a)
+    // count spectra of 'taps' samples, sStride floats apart, against the weight rows wx, wy, wz.
+    // 3 sums per spectrum are written oStride floats apart.
+    static void integrate(const float *wx, const float *wy, const float *wz, const size_t taps, const float *s,
+        const size_t count, const size_t sStride, float *out, const size_t oStride)
     {
-        return mul(Matrix3((a.m_[I(2, 2)] * a.m_[I(3, 3)] - a.m_[I(2, 3)] * a.m_[I(3, 2)]),
-                       (a.m_[I(1, 3)] * a.m_[I(3, 2)] - a.m_[I(1, 2)] * a.m_[I(3, 3)]),
-                       (a.m_[I(1, 2)] * a.m_[I(2, 3)] - a.m_[I(1, 3)] * a.m_[I(2, 2)]),
-                       (a.m_[I(2, 3)] * a.m_[I(3, 1)] - a.m_[I(2, 1)] * a.m_[I(3, 3)]),
-                       (a.m_[I(1, 1)] * a.m_[I(3, 3)] - a.m_[I(1, 3)] * a.m_[I(3, 1)]),
-                       (a.m_[I(1, 3)] * a.m_[I(2, 1)] - a.m_[I(1, 1)] * a.m_[I(2, 3)]),
-                       (a.m_[I(2, 1)] * a.m_[I(3, 2)] - a.m_[I(2, 2)] * a.m_[I(3, 1)]),
-                       (a.m_[I(1, 2)] * a.m_[I(3, 1)] - a.m_[I(1, 1)] * a.m_[I(3, 2)]),
-                       (a.m_[I(1, 1)] * a.m_[I(2, 2)] - a.m_[I(1, 2)] * a.m_[I(2, 1)])),
-            1.f / det(a));
+        size_t done = 0;
+#if defined(COLORSYSTEM_SIMD_X86)
+        switch (isa())
+        {
+        case AVX512:
+            done = Detail::integrateAVX512(wx, wy, wz, taps, s, count, sStride, out, oStride);
+            break;
+        case AVX2:
+            done = Detail::integrateAVX2(wx, wy, wz, taps, s, count, sStride, out, oStride);
+            break;
+        case SSE41:
+            done = Detail::integrateSSE41(wx, wy, wz, taps, s, count, sStride, out, oStride);
+            break;
+        case SCALAR:
+        default:
+            break;
+        }
+#endif
+        Detail::integrateScalar(
+            wx, wy, wz, taps, s + done * sStride, count - done, sStride, out + done * oStride, oStride);
     }
-    constexpr Matrix3 invert(void) const { return invert(*this); }
-    constexpr auto    size() const { return m_.size(); }
-    auto              begin() const { return m_.begin(); }
-    auto              end() const { return m_.end(); }
-};
-
-class Tristimulus
-{
-  public:
-    Vector3 v_;
-
-    constexpr Tristimulus(const float &a, const float &b, const float &c) : v_(a, b, c) { ; }
-    constexpr Tristimulus() : v_(0, 0, 0) { ; }
-    constexpr Tristimulus(const Vector3 &v) : v_(v) { ; }
-    constexpr Tristimulus(const float &v) : v_(v, v, v) { ; }
+} // namespace SIMD
 
-    constexpr float operator[](const int &i) const { return v_[i]; }
-    constexpr auto  size() const { return v_.size(); }
-    auto            begin() const { return v_.begin(); }
-    auto            end() const { return v_.end(); }
+// 4 lane float pack used by the approximated curves. SSE2 is always there on x86-64, so no dispatch is needed;
+// other targets get a plain array which the compiler is free to vectorize.
+#if !defined(COLORSYSTEM_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#define COLORSYSTEM_SIMD_SSE2 1
+#endif
 
-    constexpr const Vector3 &vec3(void) const { return v_; }
-    constexpr float          a() const { return v_[0]; }
-    constexpr float          b() const { return v_[1]; }
-    constexpr float          c() const { return v_[2]; }
+namespace SIMD
+{
+    class float4
+    {
+      public:
+#if defined(COLORSYSTEM_SIMD_SSE2)
+        __m128 v_;
+        float4(const __m128 &v) : v_(v) { ; }
+        float4(const float f = 0.f) : v_(_mm_set1_ps(f)) { ; }
+        static float4 load(const float *p) { return float4(_mm_loadu_ps(p)); }
+        void          store(float *p) const { _mm_storeu_ps(p, v_); }
+#else
+        float v_[4];
+        float4(const float f = 0.f) : v_{f, f, f, f} { ; }
+        static float4 load(const float *p)
+        {
+            float4 r;
+            memcpy(r.v_, p, sizeof(r.v_));
+            return r;
+        }
+        void store(float *p) const { memcpy(p, v_, sizeof(v_)); }
+#endif
+        static constexpr int size(void) { return 4; }
+        float                operator[](const int i) const
+        {
+            float t[4];
+            store(t);
+            return t[i];
+        }
+    };
 
-    static constexpr Tristimulus scale(const Tristimulus &t, const float &s)
+    // lane helpers. the float and double overloads let the same template run one value at a time.
+    // the float transcendentals (pow, log, exp, sin, ...) follow Math::DEFAULT and come after FastMath.
+    static constexpr float select(const bool m, const float a, const float b) { return m ? a : b; }
+    static constexpr float min(const float a, const float b) { return (a < b) ? a : b; }
+    static constexpr float max(const float a, const float b) { return (a > b) ? a : b; }
+    static inline float    sqrt(const float a) { return sqrtf(a); }
+    static inline float    floor(const float a) { return floorf(a); }
+    static inline float    abs(const float a) { return fabsf(a); }
+    static constexpr double select(const bool m, const double a, const double b) { return m ? a : b; }
+    static constexpr double min(const double a, const double b) { return (a < b) ? a : b; }
+    static constexpr double max(const double a, const double b) { return (a > b) ? a : b; }
+    static inline double    sqrt(const double a) { return ::sqrt(a); }
+    static inline double    floor(const double a) { return ::floor(a); }
+    static inline double    pow(const double a, const double b) { return ::pow(a, b); }
+    static inline double    cbrt(const double a) { return ::cbrt(a); }
+    static inline double    abs(const double a) { return ::fabs(a); }
+    static inline double    log(const double a) { return ::log(a); }
+    static inline double    log10(const double a) { return ::log10(a); }
+    static inline double    exp(const double a) { return ::exp(a); }
+    static inline double    sin(const double a) { return ::sin(a); }
+    static inline double    cos(const double a) { return ::cos(a); }
+    static inline double    atan2(const double y, const double x) { return ::atan2(y, x); }
+
+#if defined(COLORSYSTEM_SIMD_SSE2)
+    static inline float4 operator+(const float4 &a, const float4 &b) { return _mm_add_ps(a.v_, b.v_); }
+    static inline float4 operator-(const float4 &a, const float4 &b) { return _mm_sub_ps(a.v_, b.v_); }
+    static inline float4 operator*(const float4 &a, const float4 &b) { return _mm_mul_ps(a.v_, b.v_); }
+    static inline float4 operator/(const float4 &a, const float4 &b) { return _mm_div_ps(a.v_, b.v_); }
+    static inline float4 operator-(const float4 &a) { return _mm_xor_ps(a.v_, _mm_set1_ps(-0.f)); }
+    // comparisons give lane masks, to be consumed by select().
+    static inline float4 operator<(const float4 &a, const float4 &b) { return _mm_cmplt_ps(a.v_, b.v_); }
+    static inline float4 operator<=(const float4 &a, const float4 &b) { return _mm_cmple_ps(a.v_, b.v_); }
+    static inline float4 operator>(const float4 &a, const float4 &b) { return _mm_cmpgt_ps(a.v_, b.v_); }
+    static inline float4 operator>=(const float4 &a, const float4 &b) { return _mm_cmpge_ps(a.v_, b.v_); }
+    static inline float4 operator==(const float4 &a, const float4 &b) { return _mm_cmpeq_ps(a.v_, b.v_); }
+    static inline float4 operator&&(const float4 &a, const float4 &b) { return _mm_and_ps(a.v_, b.v_); }
+    static inline float4 operator||(const float4 &a, const float4 &b) { return _mm_or_ps(a.v_, b.v_); }
+    static inline float4 select(const float4 &m, const float4 &a, const float4 &b)
+    {
+        return _mm_or_ps(_mm_and_ps(m.v_, a.v_), _mm_andnot_ps(m.v_, b.v_));
+    }
+    static inline float4 min(const float4 &a, const float4 &b) { return _mm_min_ps(a.v_, b.v_); }
+    static inline float4 max(const float4 &a, const float4 &b) { return _mm_max_ps(a.v_, b.v_); }
+    static inline float4 sqrt(const float4 &a) { return _mm_sqrt_ps(a.v_); }
+    static inline float4 floor(const float4 &a) // |a| < 2^31
+    {
+        const float4 t(_mm_cvtepi32_ps(_mm_cvttps_epi32(a.v_)));
+        return t - float4(_mm_and_ps((t > a).v_, _mm_set1_ps(1.f)));
+    }
+#else
+    namespace Detail
     {
-        return Tristimulus(t[0] * s, t[1] * s, t[2] * s);
+        template <typename F>
+        static inline float4 lanes(const float4 &a, const float4 &b, const F &f)
+        {
+            float4 r;
+            for (int i = 0; i < 4; i++)
+                r.v_[i] = f(a.v_[i], b.v_[i]);
+            return r;
+        }
+        static inline float mask(const bool m)
+        {
+            const uint32_t u = m ? 0xffffffffu : 0u;
+            float          f;
+            memcpy(&f, &u, sizeof(f));
+            return f;
+        }
+        static inline bool isSet(const float m)
+        {
+            uint32_t u;
+            memcpy(&u, &m, sizeof(u));
+            return u != 0;
+        }
+    } // namespace Detail
+    static inline float4 operator+(const float4 &a, const float4 &b)
+    {
+        return Detail::lanes(a, b, [](float x, float y) { return x + y; });
     }
-    constexpr Tristimulus scale(const float &s) const { return scale(*this, s); }
-    constexpr Tristimulus operator*(const float &s) const { return scale(s); }
-    constexpr Tristimulus operator/(const float &s) const { return scale(1.f / s); }
-
-    // apply color transform matrix
-    static constexpr Tristimulus apply(const Tristimulus &t, const Matrix3 &m)
+    static inline float4 operator-(const float4 &a, const float4 &b)
     {
-        return Tristimulus(m.apply(t.vec3()));
+        return Detail::lanes(a, b, [](float x, float y) { return x - y; });
     }
-    constexpr Tristimulus apply(const Matrix3 &m) const { return apply(*this, m); }
-
-    static constexpr Tristimulus add(const Tristimulus &a, const Tristimulus &b)
+    static inline float4 operator*(const float4 &a, const float4 &b)
     {
-        return Tristimulus(a[0] + b[0], a[1] + b[1], a[2] + b[2]);
-    }
-    constexpr const Tristimulus add(const Tristimulus &b) const { return add(*this, b); }
-    constexpr const Tristimulus operator+(const Tristimulus &b) const { return add(*this, b); }
-    // per-element re-lighting
-    static constexpr Tristimulus mul(const Tristimulus &a, const Tristimulus &b)
-    {
-        return Tristimulus(a[0] * b[0], a[1] * b[1], a[2] * b[2]);
+        return Detail::lanes(a, b, [](float x, float y) { return x * y; });
     }
-    constexpr const Tristimulus mul(const Tristimulus &b) const { return mul(*this, b); }
-    constexpr const Tristimulus operator*(const Tristimulus &b) const { return mul(*this, b); }
-    static constexpr float      dot(const Tristimulus &a, const Tristimulus &b)
+    static inline float4 operator/(const float4 &a, const float4 &b)
     {
-        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+        return Detail::lanes(a, b, [](float x, float y) { return x / y; });
     }
-    constexpr float              dot(const Tristimulus &b) const { return dot(*this, b); }
-    static constexpr const float mini(const float &a, const float &b) { return (a < b) ? a : b; }
-    static constexpr const float maxi(const float &a, const float &b) { return (a > b) ? a : b; }
-    static constexpr Tristimulus min(const Tristimulus &a, const Tristimulus &b)
+    static inline float4 operator-(const float4 &a) { return float4(0.f) - a; }
+    static inline float4 operator<(const float4 &a, const float4 &b)
     {
-        return Tristimulus(mini(a[0], b[0]), mini(a[1], b[1]), mini(a[2], b[2]));
+        return Detail::lanes(a, b, [](float x, float y) { return Detail::mask(x < y); });
     }
-    static constexpr Tristimulus max(const Tristimulus &a, const Tristimulus &b)
+    static inline float4 operator<=(const float4 &a, const float4 &b)
     {
-        return Tristimulus(maxi(a[0], b[0]), maxi(a[1], b[1]), maxi(a[2], b[2]));
+        return Detail::lanes(a, b, [](float x, float y) { return Detail::mask(x <= y); });
     }
-    constexpr Tristimulus min(const Tristimulus &a) const { return min(*this, a); }
-    constexpr Tristimulus max(const Tristimulus &a) const { return max(*this, a); }
-
-    constexpr float min3(void) const { return mini(mini(a(), b()), c()); }
-    constexpr float max3(void) const { return maxi(maxi(a(), b()), c()); }
-
-    constexpr Tristimulus clip(const float &l, const float &h) const
+    static inline float4 operator>(const float4 &a, const float4 &b) { return b < a; }
+    static inline float4 operator>=(const float4 &a, const float4 &b) { return b <= a; }
+    static inline float4 operator==(const float4 &a, const float4 &b)
     {
-        return max(min(*this, Tristimulus(h)), Tristimulus(l));
+        return Detail::lanes(a, b, [](float x, float y) { return Detail::mask(x == y); });
     }
-    static constexpr Tristimulus clip(const Tristimulus &t, const float &l, const float &h) { return t.clip(l, h); }
-    constexpr Tristimulus        positive() const { return max(*this, Tristimulus(0.f)); }
-    static constexpr Tristimulus positive(const Tristimulus &t) { return t.positive(); }
-    constexpr bool               isNegative(const float &a) const { return (a < 0.f); }
-    constexpr bool         hasNegative() const { return isNegative(v_[0]) || isNegative(v_[1]) || isNegative(v_[2]); }
-    static constexpr bool  hasNegative(const Tristimulus &t) { return t.hasNegative(); }
-    static constexpr float abs_f(const float f) { return (f < 0.f) ? -f : f; }
-
-    static constexpr float z_from_xy(const float &x, const float &y) { return 1 - x - y; }
-    static constexpr float X_from_Yxy(const float &Y, const float &x, const float &y)
+    static inline float4 operator&&(const float4 &a, const float4 &b)
     {
-        return (abs_f(y) < 1e-8f) ? 0.f : x * Y / y;
+        return Detail::lanes(
+            a, b, [](float x, float y) { return Detail::mask(Detail::isSet(x) && Detail::isSet(y)); });
     }
-    static constexpr float Y_from_Yxy(const float &Y, const float &x, const float &y)
+    static inline float4 operator||(const float4 &a, const float4 &b)
     {
-        (void)x;
-        (void)y;
-        return Y;
+        return Detail::lanes(
+            a, b, [](float x, float y) { return Detail::mask(Detail::isSet(x) || Detail::isSet(y)); });
     }
-    static constexpr float Z_from_Yxy(const float &Y, const float &x, const float &y)
+    static inline float4 select(const float4 &m, const float4 &a, const float4 &b)
     {
-        return (abs_f(y) < 1e-8f) ? 0.f : z_from_xy(x, y) * Y / y;
+        float4 r;
+        for (int i = 0; i < 4; i++)
+            r.v_[i] = Detail::isSet(m.v_[i]) ? a.v_[i] : b.v_[i];
+        return r;
     }
-    static constexpr float Y_from_XYZ(const float &x, const float &y, const float &z)
+    static inline float4 min(const float4 &a, const float4 &b)
     {
-        (void)x;
-        (void)z;
-        return y;
+        return Detail::lanes(a, b, [](float x, float y) { return (x < y) ? x : y; });
     }
-    static constexpr float x_from_XYZ(const float &x, const float &y, const float &z)
+    static inline float4 max(const float4 &a, const float4 &b)
     {
-        return (abs_f(x + y + z) < 1e-8f) ? 0.3127f : x / (x + y + z);
+        return Detail::lanes(a, b, [](float x, float y) { return (x > y) ? x : y; });
     }
-    static constexpr float y_from_XYZ(const float &x, const float &y, const float &z)
+    static inline float4 sqrt(const float4 &a)
     {
-        return (abs_f(x + y + z) < 1e-8f) ? 0.3290f : y / (x + y + z);
+        return Detail::lanes(a, a, [](float x, float) { return sqrtf(x); });
     }
-    static constexpr Tristimulus fromYxy(const float &Y, const float &x, const float &y)
+    static inline float4 floor(const float4 &a)
     {
-        return Tristimulus(X_from_Yxy(Y, x, y), Y_from_Yxy(Y, x, y), Z_from_Yxy(Y, x, y));
+        return Detail::lanes(a, a, [](float x, float) { return floorf(x); });
     }
-    static constexpr Tristimulus toYxy(const float &X, const float &Y, const float &Z)
+#endif
+
+    // runs f over count floats, 4 at a time. the tail goes through a padded pack so every value
+    // sees exactly the same arithmetic. src and dst may be the same buffer.
+    template <typename F>
+    static void transform(const float *src, float *dst, const size_t count, const F &f)
     {
-        return Tristimulus(Y_from_XYZ(X, Y, Z), x_from_XYZ(X, Y, Z), y_from_XYZ(X, Y, Z));
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            f(float4::load(src + i)).store(dst + i);
+        }
+        if (i < count)
+        {
+            float t[4] = {0.f, 0.f, 0.f, 0.f};
+            memcpy(t, src + i, (count - i) * sizeof(float));
+            f(float4::load(t)).store(t);
+            memcpy(dst + i, t, (count - i) * sizeof(float));
+        }
     }
-    static constexpr Tristimulus fromYxy(const Tristimulus &Yxy) { return fromYxy(Yxy[0], Yxy[1], Yxy[2]); }
-    static constexpr Tristimulus toYxy(const Tristimulus &XYZ) { return toYxy(XYZ[0], XYZ[1], XYZ[2]); }
-    //
-    constexpr Tristimulus fromYxy(void) const { return fromYxy(*this); }
-    constexpr Tristimulus toYxy(void) const { return toYxy(*this); }
-    // support u'v'
-    //  u = 4x / (-2x + 12y + 3)
-    //  v = 6y / (-2x + 12y + 3)
-    //  x = 3u / (2u - 8v + 4)
-    //  y = 2v / (2u - 8v + 4)
-    //  u' = 4x / (-2x + 12y + 3)    [ = u ]
-    //  v' = 9y / (-2x + 12y + 3)    [ = 1.5v ]
-    //  x = 9u' / (6u' - 16v' + 12)
-    //  y = 4v' / (6u' - 16v' + 12)
-    static constexpr float u_from_xy(const float &x, const float &y) { return 4.f * x / (-2.f * x + 12.f * y + 3.f); }
-    static constexpr float v_from_xy(const float &x, const float &y) { return 6.f * y / (-2.f * x + 12.f * y + 3.f); }
-    static constexpr float x_from_uv(const float &u, const float &v) { return 3.f * u / (2.f * u - 8.f * v + 4.f); }
-    static constexpr float y_from_uv(const float &u, const float &v) { return 2.f * v / (2.f * u - 8.f * v + 4.f); }
-    static constexpr Tristimulus YxyToYuv(const Tristimulus &Yxy)
+} // namespace SIMD
+
+// polynomial approximations of the libm functions, for float and SIMD::float4.
+// errors measured over the ranges the OTF curves use:
+//   log2 : absolute error < 2e-7 (normal floats)
+//   exp2 : relative error < 1e-7, input clamped to [-126,127]
+//   pow  : relative error < 1e-7 + 2e-7 * |y|, returns 0 for x <= 0 (denormals are treated as 0)
+//   cbrt : relative error < 2.5e-7, odd, returns 0 for |x| below FLT_MIN
+//   sin, cos : absolute error < 2e-7 for |x| < 1000
+//   atan2 : absolute error < 3e-7 radians, atan2(0, 0) is 0
+namespace FastMath
+{
+    namespace Detail
     {
-        return Tristimulus(Yxy[0], u_from_xy(Yxy[1], Yxy[2]), v_from_xy(Yxy[1], Yxy[2]));
-    }
-    static constexpr Tristimulus YuvToYxy(const Tristimulus &Yuv)
+        static inline float bitsToFloat(const uint32_t u)
+        {
+            float f;
+            memcpy(&f, &u, sizeof(f));
+            return f;
+        }
+        static inline uint32_t floatToBits(const float f)
+        {
+            uint32_t u;
+            memcpy(&u, &f, sizeof(u));
+            return u;
+        }
+        // ln(m) for m in [sqrt(.5),sqrt(2)) by atanh series, t is (m-1)/(m+1), |t| < 0.172.
+        template <typename T>
+        static inline T lnSeries(const T &t)
+        {
+            const T t2 = t * t;
+            return t * (2.f + t2 * (0.666666667f + t2 * (0.4f + t2 * (0.285714286f + t2 * 0.222222222f))));
+        }
+        // 2^f for f in [-0.5,0.5], taylor series of exp(f*ln2).
+        template <typename T>
+        static inline T exp2Poly(const T &f)
+        {
+            const T y = f * 0.693147181f;
+            const T p = 0.00138888889f + y * 0.000198412698f;
+            return 1.f +
+                   y * (1.f + y * (0.5f + y * (0.166666667f + y * (0.0416666667f + y * (0.00833333333f + y * p)))));
+        }
+        // sin and cos on [-pi/4,pi/4], coefficients from cephes sinf/cosf.
+        template <typename T>
+        static inline T sinPoly(const T &r)
+        {
+            const T z = r * r;
+            return r + r * z * (-1.6666654611e-1f + z * (8.3321608736e-3f + z * -1.9515295891e-4f));
+        }
+        template <typename T>
+        static inline T cosPoly(const T &r)
+        {
+            const T z = r * r;
+            return 1.f - 0.5f * z +
+                   z * z * (4.166664568298827e-2f + z * (-1.388731625493765e-3f + z * 2.443315711809948e-5f));
+        }
+        // atan on [0,1], reduced to [-tan(pi/8),tan(pi/8)] as in cephes atanf.
+        template <typename T>
+        static inline T atanUnit(const T &t)
+        {
+            const auto big = t > T(0.414213562f);
+            const T    x   = SIMD::select(big, (t - 1.f) / (t + 1.f), t);
+            const T    z   = x * x;
+            const T    p   = ((8.05374449538e-2f * z - 1.38776856032e-1f) * z + 1.99777106478e-1f) * z;
+            return SIMD::select(big, T(0.785398163f), T(0.f)) + x + (p - 3.33329491539e-1f) * z * x;
+        }
+        // one Halley step towards cbrt(x), triples the correct bits.
+        template <typename T>
+        static inline T cbrtHalley(const T &x, const T &y)
+        {
+            const T y3 = y * y * y;
+            return y * (y3 + x + x) / (y3 + y3 + x);
+        }
+    } // namespace Detail
+
+    static inline float log2(const float x)
     {
-        return Tristimulus(Yuv[0], x_from_uv(Yuv[1], Yuv[2]), y_from_uv(Yuv[1], Yuv[2]));
+        const uint32_t bits = Detail::floatToBits(x);
+        float          e    = (float)((int)((bits >> 23) & 0xff) - 127);
+        float          m    = Detail::bitsToFloat((bits & 0x7fffff) | 0x3f800000); // [1,2)
+        if (m > 1.41421356f)
+        {
+            m *= 0.5f;
+            e += 1.f;
+        }
+        return e + Detail::lnSeries((m - 1.f) / (m + 1.f)) * 1.44269504f;
     }
-    static constexpr Tristimulus toYuv(const Tristimulus &XYZ) { return YxyToYuv(toYxy(XYZ)); }
-    static constexpr Tristimulus toYuv(const float &X, const float &Y, const float &Z)
+    static inline float exp2(const float x)
     {
-        return toYuv(Tristimulus(X, Y, Z));
+        const float c = SIMD::min(SIMD::max(x, -126.f), 127.f);
+        const int   n = (int)((c < 0.f) ? c - 0.5f : c + 0.5f);
+        return Detail::exp2Poly(c - (float)n) * Detail::bitsToFloat((uint32_t)(n + 127) << 23);
     }
-    static constexpr Tristimulus fromYuv(const Tristimulus &Yuv) { return fromYxy(YuvToYxy(Yuv)); }
-    static constexpr Tristimulus fromYuv(const float &X, const float &Y, const float &Z)
+    // exponent bits divided by 3 give a seed within 4%, two Halley steps take it to float precision.
+    static inline float cbrt(const float x)
     {
-        return fromYuv(Tristimulus(X, Y, Z));
+        const uint32_t bits = Detail::floatToBits(x);
+        const float    a    = Detail::bitsToFloat(bits & 0x7fffffff);
+        const float    y    = Detail::bitsToFloat((bits & 0x7fffffff) / 3 + 0x2a508c2d);
+        const float    r    = Detail::cbrtHalley(a, Detail::cbrtHalley(a, y));
+        return (a < std::numeric_limits<float>::min())
+                   ? 0.f
+                   : Detail::bitsToFloat(Detail::floatToBits(r) | (bits & 0x80000000));
     }
-    constexpr Tristimulus toYuv(void) const { return toYuv(*this); }
-    constexpr Tristimulus fromYuv(void) const { return fromYuv(*this); }
 
-    // uv only used in CCT.
-    static constexpr float blackbody_x_approx(const float &T)
+#if defined(COLORSYSTEM_SIMD_SSE2)
+    static inline SIMD::float4 log2(const SIMD::float4 &x)
     {
-        return (float)(0.811973208 +
-                       T * (-0.00016747 + T * (0.00000000331067 +
-                                                  T * (0.00000000000690001 +
-                                                          T * (-1.39671E-15 + T * (1.11951E-19 + T * -3.31672E-24))))));
+        const __m128i      bits = _mm_castps_si128(x.v_);
+        const SIMD::float4 e(_mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127))));
+        const SIMD::float4 m0(_mm_castsi128_ps(
+            _mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x7fffff)), _mm_set1_epi32(0x3f800000))));
+        const SIMD::float4 hi = m0 > SIMD::float4(1.41421356f);
+        const SIMD::float4 m  = SIMD::select(hi, m0 * 0.5f, m0);
+        const SIMD::float4 ei = e + SIMD::float4(_mm_and_ps(hi.v_, _mm_set1_ps(1.f)));
+        return ei + Detail::lnSeries((m - 1.f) / (m + 1.f)) * 1.44269504f;
     }
-    static constexpr float blackbody_y_approx(const float &T)
+    static inline SIMD::float4 exp2(const SIMD::float4 &x)
     {
-        return (float)(0.136977825 +
-                       T * (0.000317653 + T * (-0.000000127946 +
-                                                  T * (0.0000000000222415 + T * (-1.81438E-15 + T * 5.67564E-20)))));
+        const SIMD::float4 c = SIMD::min(SIMD::max(x, SIMD::float4(-126.f)), SIMD::float4(127.f));
+        const __m128i      n = _mm_cvtps_epi32(c.v_); // round to nearest
+        const SIMD::float4 f = c - SIMD::float4(_mm_cvtepi32_ps(n));
+        return Detail::exp2Poly(f) *
+               SIMD::float4(_mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23)));
     }
-    // XYZ from Color Temperature with Y.
-    // cubic spline approx https://en.wikipedia.org/wiki/Planckian_locus#Approximation
-    static constexpr Tristimulus fromPlanckianLocus(const float &T, const float &Y = 1.f)
+    static inline SIMD::float4 cbrt(const SIMD::float4 &x)
     {
-        const float x =
-            (T < 4000.f) ? ((-0.2661239e9f / (T * T * T)) - (0.2343580e6f / (T * T)) + (0.8776956e3f / T) + 0.179910f)
-                         : ((-3.0258469e9f / (T * T * T)) + (2.1070379e6f / (T * T)) + (0.2226347e3f / T) + 0.240390f);
-        const float y =
-            (T < 2222.f)
-                ? ((-1.1063814f * x * x * x) - (1.34811020f * x * x) + (2.18555832f * x) - 0.20219683f)
-                : ((T < 4000.f) ? ((-1.1063814f * x * x * x - 1.34811020f * x * x + 2.18555832f * x - 0.20219683f))
-                                : ((3.0817580f * x * x * x - 5.87338670f * x * x + 3.75112997f * x - 0.37001483f)));
-        return Tristimulus(Y, x, y).fromYxy();
+        // no integer divide in SSE, bits / 3 goes through float. the seed only needs the top bits.
+        const __m128       sign = _mm_set1_ps(-0.f);
+        const SIMD::float4 a(_mm_andnot_ps(sign, x.v_));
+        const __m128i      third =
+            _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_castps_si128(a.v_)), _mm_set1_ps(1.f / 3.f)));
+        const SIMD::float4 y(_mm_castsi128_ps(_mm_add_epi32(third, _mm_set1_epi32(0x2a508c2d))));
+        const SIMD::float4 r = Detail::cbrtHalley(a, Detail::cbrtHalley(a, y));
+        return SIMD::select(a < SIMD::float4(std::numeric_limits<float>::min()), SIMD::float4(0.f),
+            SIMD::float4(_mm_or_ps(r.v_, _mm_and_ps(sign, x.v_))));
     }
-    static constexpr Tristimulus fromCT(const float &T, const float Y = 1.f)
+#else
+    static inline SIMD::float4 log2(const SIMD::float4 &x)
     {
-        return Tristimulus(Y, blackbody_x_approx(T), blackbody_y_approx(T)).fromYxy();
+        SIMD::float4 r;
+        for (int i = 0; i < 4; i++)
+            r.v_[i] = log2(x.v_[i]);
+        return r;
     }
-    static constexpr float CCT_x_approx(const float &T, const float &dUV)
+    static inline SIMD::float4 exp2(const SIMD::float4 &x)
     {
-        const float x1 = blackbody_x_approx(T);
-        const float y1 = blackbody_y_approx(T);
-        const float u1 = u_from_xy(x1, y1);
-        const float v1 = v_from_xy(x1, y1);
-        const float x2 = blackbody_x_approx(T - 1.f);
-        const float y2 = blackbody_y_approx(T - 1.f);
-        const float u2 = u_from_xy(x2, y2);
-        const float v2 = v_from_xy(x2, y2);
-        const float du = u2 - u1;
-        const float dv = v2 - v1;
-        const float l  = util::sqrtf(du * du + dv * dv);
-        return x_from_uv(u1 - dUV * du / l, v1 + dUV * dv / l);
+        SIMD::float4 r;
+        for (int i = 0; i < 4; i++)
+            r.v_[i] = exp2(x.v_[i]);
+        return r;
     }
-    static constexpr float CCT_y_approx(const float &T, const float &dUV)
+    static inline SIMD::float4 cbrt(const SIMD::float4 &x)
     {
-        const float x1 = blackbody_x_approx(T);
-        const float y1 = blackbody_y_approx(T);
-        const float u1 = u_from_xy(x1, y1);
-        const float v1 = v_from_xy(x1, y1);
-        const float x2 = blackbody_x_approx(T - 1.f);
-        const float y2 = blackbody_y_approx(T - 1.f);
-        const float u2 = u_from_xy(x2, y2);
-        const float v2 = v_from_xy(x2, y2);
-        const float du = u2 - u1;
-        const float dv = v2 - v1;
-        const float l  = util::sqrtf(du * du + dv * dv);
-        return y_from_uv(u1 - dUV * du / l, v1 + dUV * dv / l);
+        SIMD::float4 r;
+        for (int i = 0; i < 4; i++)
+            r.v_[i] = cbrt(x.v_[i]);
+        return r;
     }
-    static constexpr Tristimulus fromCCT(const float &T, const float &dUV, const float Y = 1.f)
+#endif
+
+    template <typename T>
+    static inline T pow(const T &x, const T &y)
     {
-        return Tristimulus(Y, CCT_x_approx(T, dUV), CCT_y_approx(T, dUV)).fromYuv();
+        return SIMD::select(x < T(std::numeric_limits<float>::min()), T(0.f), exp2(y * log2(x)));
     }
-
-    // Lab
-    static constexpr float CIELAB_curve(const float &f)
+    template <typename T>
+    static inline T log(const T &x)
     {
-        const float threshold = 216.f / 24389.0f;
-        const float K         = 24389.0f / 27.0f;
-        return (f > 1.f) ? 1.f : ((f > threshold) ? powf(f, 1.f / 3.f) : ((K * f + 16.f) / 116.f));
+        return log2(x) * 0.693147181f;
     }
-    static constexpr float CIELAB_decurve(const float &f)
+    template <typename T>
+    static inline T log10(const T &x)
     {
-        const float K = (3.f / 29.f) * (3.f / 29.f) * (3.f / 29.f);
-        return (f > 1.f) ? 1.f : ((f > 6.f / 29.f) ? powf(f, 3.f) : (116.f * f - 16.f) * K);
+        return log2(x) * 0.301029996f;
     }
-    static constexpr Tristimulus toCIELAB(const Tristimulus &t, const Tristimulus &white)
+    template <typename T>
+    static inline T exp(const T &x)
     {
-        const float x0 = white[0];
-        const float y0 = white[1];
-        const float z0 = white[2];
-        const float x1 = CIELAB_curve(t[0] / x0);
-        const float y1 = CIELAB_curve(t[1] / y0);
-        const float z1 = CIELAB_curve(t[2] / z0);
-        return Tristimulus(116.f * y1 - 16.f, 500.f * (x1 - y1), 200.f * (y1 - z1));
+        return exp2(x * 1.44269504f);
     }
-    static constexpr Tristimulus fromCIELAB(const Tristimulus &t, const Tristimulus &white)
+    template <typename T>
+    static inline T pow10(const T &x)
     {
-        const float x0 = white[0];
-        const float y0 = white[1];
-        const float z0 = white[2];
-        const float fy = (t[0] + 16.f) / 116.f;
-        const float fx = fy + (t[1] / 500.f);
-        const float fz = fy - (t[2] / 200.f);
-        return Tristimulus(CIELAB_decurve(fx) * x0, CIELAB_decurve(fy) * y0, CIELAB_decurve(fz) * z0);
+        return exp2(x * 3.32192809f);
     }
-    constexpr Tristimulus toCIELAB(const Tristimulus &white) const { return toCIELAB(*this, white); }
-    constexpr Tristimulus fromCIELAB(const Tristimulus &white) const { return fromCIELAB(*this, white); }
-    // CIELAB uses D50 by default.
-    constexpr Tristimulus toCIELAB(void) const { return toCIELAB(*this, Tristimulus(0.9642f, 1.0f, 0.8249f)); }
-    constexpr Tristimulus fromCIELAB(void) const { return fromCIELAB(*this, Tristimulus(0.9642f, 1.0f, 0.8249f)); }
-    // HSV
-    static constexpr float mod360(const float &r)
+    // sin and cos reduce by the quadrant q = round(x / (pi/2)), pi/2 split in two parts so q * pi/2 stays exact.
+    template <typename T>
+    static inline T sin(const T &x)
     {
-        return (r < 0.f) ? mod360(r + 360.f) : ((r > 360.f) ? mod360(r - 360.f) : r);
+        const T q = SIMD::floor(x * 0.636619772f + 0.5f);
+        const T r = (x - q * 1.5703125f) - q * 4.838267949e-4f;
+        const T m = q - 4.f * SIMD::floor(q * 0.25f); // 0-3
+        const T v = SIMD::select(m == T(0.f) || m == T(2.f), Detail::sinPoly(r), Detail::cosPoly(r));
+        return SIMD::select(m >= T(2.f), -v, v);
     }
-    static Tristimulus toHSV_atan(const Tristimulus &t)
+    template <typename T>
+    static inline T cos(const T &x)
     {
-        const float max = maxi(maxi(t[0], t[1]), t[2]);
-        const float min = mini(mini(t[0], t[1]), t[2]);
-        return Tristimulus(mod360((180.f / PI) * atan2f(sqrtf(3.f) * (t[1] - t[2]), 2.f * t[0] - t[1] - t[2])),
-            (max == 0.f) ? 0.f : (max - min) / max, max);
+        const T q = SIMD::floor(x * 0.636619772f + 0.5f);
+        const T r = (x - q * 1.5703125f) - q * 4.838267949e-4f;
+        const T m = q - 4.f * SIMD::floor(q * 0.25f);
+        const T v = SIMD::select(m == T(0.f) || m == T(2.f), Detail::cosPoly(r), Detail::sinPoly(r));
+        return SIMD::select(m == T(1.f) || m == T(2.f), -v, v);
     }
-    Tristimulus                  toHSV_atan(void) const { return toHSV_atan(*this); }
-    static constexpr Tristimulus toHSV(const Tristimulus &t)
+    template <typename T>
+    static inline T atan2(const T &y, const T &x)
     {
-        const float max = maxi(maxi(t[0], t[1]), t[2]);
-        const float min = mini(mini(t[0], t[1]), t[2]);
-        const float d   = max - min;
-        return Tristimulus(
-            mod360(((max == min) ? 0.f
-                                 : ((max == t[0]) ? (60.f * (t[1] - t[2]) / d)
-                                                  : ((max == t[1]) ? (60.f * (t[2] - t[0]) / d + 120.f)
-                                                                   : (60.f * (t[0] - t[1]) / d + 240.f))))),
-            (max == 0.f) ? 0.f : d / max, max);
+        const T ax = SIMD::max(x, -x);
+        const T ay = SIMD::max(y, -y);
+        const T hi = SIMD::max(ax, ay);
+        const T a  = Detail::atanUnit(SIMD::min(ax, ay) / SIMD::select(hi == T(0.f), T(1.f), hi));
+        const T b  = SIMD::select(ay > ax, 1.570796327f - a, a);
+        const T c  = SIMD::select(x < T(0.f), 3.141592654f - b, b);
+        return SIMD::select(y < T(0.f), -c, c);
     }
+} // namespace FastMath
 
-    static constexpr Tristimulus fromHSV(const Tristimulus &t)
+// math backend for the curves and color formulas. EXACT is libm, FAST the FastMath approximations above. measured
+// against EXACT, FAST stays within 1e-4 on every OTF curve, CIELAB and HSV component and Delta metric here (most
+// far below, see the batch OTF functions for the curves), which is fine for previews; final renders keep EXACT.
+// the per-value float paths (OTF::toScreen(type, Tristimulus), CIELAB, HSV, ICtCp, Delta, ...) use Math::DEFAULT:
+// EXACT, or FAST when built with COLORSYSTEM_FAST_MATH. SIMD::float4 packs are always FAST. the batch paths (OTF
+// curves, Pipeline, bulk CIELAB, ICtCp and Delta) take the backend per call and default to FAST; their EXACT is
+// libm one pixel at a time, in double where there is no per-curve backend.
+namespace Math
+{
+    typedef enum
+    {
+        EXACT,
+        FAST
+    } BACKEND;
+
+#if defined(COLORSYSTEM_FAST_MATH)
+    static constexpr BACKEND DEFAULT = FAST;
+#else
+    static constexpr BACKEND DEFAULT = EXACT;
+#endif
+
+    // libm, lane by lane for packs.
+    struct Exact
+    {
+        static float pow(const float x, const float y) { return powf(x, y); }
+        static float log(const float x) { return logf(x); }
+        static float log10(const float x) { return log10f(x); }
+        static float exp(const float x) { return expf(x); }
+        static float pow10(const float x) { return powf(10.f, x); }
+        static float cbrt(const float x) { return cbrtf(x); }
+        static float sin(const float x) { return sinf(x); }
+        static float cos(const float x) { return cosf(x); }
+        static float atan2(const float y, const float x) { return atan2f(y, x); }
+
+        template <typename F>
+        static SIMD::float4 lanes(const SIMD::float4 &x, const F &f)
+        {
+            float v[4];
+            x.store(v);
+            for (int i = 0; i < 4; i++)
+                v[i] = f(v[i]);
+            return SIMD::float4::load(v);
+        }
+        static SIMD::float4 pow(const SIMD::float4 &x, const SIMD::float4 &y)
+        {
+            float v[4], e[4];
+            x.store(v);
+            y.store(e);
+            for (int i = 0; i < 4; i++)
+                v[i] = powf(v[i], e[i]);
+            return SIMD::float4::load(v);
+        }
+        static SIMD::float4 log(const SIMD::float4 &x) { return lanes(x, logf); }
+        static SIMD::float4 log10(const SIMD::float4 &x) { return lanes(x, log10f); }
+        static SIMD::float4 exp(const SIMD::float4 &x) { return lanes(x, expf); }
+        static SIMD::float4 pow10(const SIMD::float4 &x)
+        {
+            return lanes(x, [](const float v) { return powf(10.f, v); });
+        }
+        static SIMD::float4 cbrt(const SIMD::float4 &x) { return lanes(x, cbrtf); }
+        static SIMD::float4 sin(const SIMD::float4 &x) { return lanes(x, sinf); }
+        static SIMD::float4 cos(const SIMD::float4 &x) { return lanes(x, cosf); }
+        static SIMD::float4 atan2(const SIMD::float4 &y, const SIMD::float4 &x)
+        {
+            float v[4], u[4];
+            y.store(v);
+            x.store(u);
+            for (int i = 0; i < 4; i++)
+                v[i] = atan2f(v[i], u[i]);
+            return SIMD::float4::load(v);
+        }
+    };
+    struct Fast
     {
-        const float h = mod360(t[0]);
-        const int   d = (int)(h / 60.f);
-        const int   i = d % 6;
-        const float r = (h / 60.f) - d;
+        template <typename T>
+        static T pow(const T &x, const T &y)
+        {
+            return FastMath::pow(x, y);
+        }
+        template <typename T>
+        static T log(const T &x)
+        {
+            return FastMath::log(x);
+        }
+        template <typename T>
+        static T log10(const T &x)
+        {
+            return FastMath::log10(x);
+        }
+        template <typename T>
+        static T exp(const T &x)
+        {
+            return FastMath::exp(x);
+        }
+        template <typename T>
+        static T pow10(const T &x)
+        {
+            return FastMath::pow10(x);
+        }
+        template <typename T>
+        static T cbrt(const T &x)
+        {
+            return FastMath::cbrt(x);
+        }
+        template <typename T>
+        static T sin(const T &x)
+        {
+            return FastMath::sin(x);
+        }
+        template <typename T>
+        static T cos(const T &x)
+        {
+            return FastMath::cos(x);
+        }
+        template <typename T>
+        static T atan2(const T &y, const T &x)
+        {
+            return FastMath::atan2(y, x);
+        }
+    };
 
-        const float s = t[1];
-        const float v = t[2];
-        const float m = v * (1.0f - s);
-        const float n = v * (1.0f - s * r);
-        const float p = v * (1.0f - s * (1.0f - r));
+    template <BACKEND B>
+    struct Backend
+    {
+        typedef Exact type;
+    };
+    template <>
+    struct Backend<FAST>
+    {
+        typedef Fast type;
+    };
+    typedef Backend<DEFAULT>::type Default;
+} // namespace Math
 
-        return (i == 0) ? Tristimulus(v, p, m)
-                        : ((i == 1) ? Tristimulus(n, v, m)
-                                    : ((i == 2) ? Tristimulus(m, v, p)
-                                                : ((i == 3) ? Tristimulus(m, n, v)
-                                                            : ((i == 4) ? Tristimulus(p, m, v)
-                                                                        : ((i == 5) ? Tristimulus(v, m, n)
-                                                                                    : Tristimulus(0, 0, 0))))));
+namespace SIMD
+{
+    static inline float pow(const float a, const float b) { return Math::Default::pow(a, b); }
+    static inline float log(const float a) { return Math::Default::log(a); }
+    static inline float log10(const float a) { return Math::Default::log10(a); }
+    static inline float exp(const float a) { return Math::Default::exp(a); }
+    static inline float pow10(const float a) { return Math::Default::pow10(a); }
+    static inline float cbrt(const float a) { return Math::Default::cbrt(a); }
+    static inline float sin(const float a) { return Math::Default::sin(a); }
+    static inline float cos(const float a) { return Math::Default::cos(a); }
+    static inline float atan2(const float y, const float x) { return Math::Default::atan2(y, x); }
+
+    // packs stay on the FastMath polynomials whatever Math::DEFAULT is: lane-wise libm would throw away the SIMD
+    // speedup of every batch path built on them. those take Math::EXACT per call instead, see toCIELAB below.
+    static inline float4 pow(const float4 &a, const float4 &b) { return FastMath::pow(a, b); }
+    static inline float4 cbrt(const float4 &a) { return FastMath::cbrt(a); }
+    static inline float4 abs(const float4 &a) { return max(a, -a); }
+    static inline float4 log(const float4 &a) { return FastMath::log(a); }
+    static inline float4 log10(const float4 &a) { return FastMath::log10(a); }
+    static inline float4 exp(const float4 &a) { return FastMath::exp(a); }
+    static inline float4 pow10(const float4 &a) { return FastMath::pow10(a); }
+    static inline float4 sin(const float4 &a) { return FastMath::sin(a); }
+    static inline float4 cos(const float4 &a) { return FastMath::cos(a); }
+    static inline float4 atan2(const float4 &y, const float4 &x) { return FastMath::atan2(y, x); }
+} // namespace SIMD
+
+// half floats (IEEE binary16) for HDR intermediates at half the memory traffic. half is only storage: pixels are
+// widened to float in blocks, converted with the float code and narrowed again. conversions round to nearest even,
+// keep infinities and NaN and are exact for denormals. the bulk ones use F16C on AVX2 machines (setISA below AVX2
+// forces the portable code), both give the same bits.
+class half
+{
+  public:
+    uint16_t bits_;
+    half() : bits_(0) { ; }
+    explicit half(const float f);
+    explicit operator float(void) const;
+    static half fromBits(const uint16_t b)
+    {
+        half h;
+        h.bits_ = b;
+        return h;
     }
-
-    constexpr Tristimulus toHSV(void) const { return toHSV(*this); }
-    constexpr Tristimulus fromHSV(void) const { return fromHSV(*this); }
 };
 
-class Gamut
+namespace Half
 {
-  public:
-    const char *name_;
-    Matrix3     toXYZ_;
-    Matrix3     fromXYZ_;
+    static inline float toFloat(const uint16_t h)
+    {
+        const uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+        const uint32_t e    = (h >> 10) & 0x1f;
+        const uint32_t m    = h & 0x3ff;
+        float          f;
+        if (e == 0)
+        {
+            f = (float)m * (1.f / 16777216.f); // 2^-24, denormal or zero
+            return FastMath::Detail::bitsToFloat(FastMath::Detail::floatToBits(f) | sign);
+        }
+        if (e == 0x1f) // NaN comes back quiet, as F16C does
+            return FastMath::Detail::bitsToFloat(sign | 0x7f800000 | (m << 13) | (m ? 0x400000 : 0));
+        return FastMath::Detail::bitsToFloat(sign | ((e + 112) << 23) | (m << 13));
+    }
+    static inline uint16_t fromFloat(const float f)
+    {
+        const uint32_t bits = FastMath::Detail::floatToBits(f);
+        const uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+        const uint32_t a    = bits & 0x7fffffff;
+        if (a > 0x7f800000) // NaN comes out quiet with the top of its payload, as F16C does
+            return sign | 0x7e00 | ((a >> 13) & 0x3ff);
+        if (a == 0x7f800000)
+            return sign | 0x7c00;
+        if (a >= 0x477ff000) // rounds past 65504
+            return sign | 0x7c00;
+        if (a < 0x38800000) // below 2^-14: denormal, the float add does the rounding
+        {
+            const float d = FastMath::Detail::bitsToFloat(a) + 0.5f;
+            return sign | (uint16_t)(FastMath::Detail::floatToBits(d) - 0x3f000000);
+        }
+        const uint32_t r = a + 0xfff + ((a >> 13) & 1) - (112u << 23);
+        return sign | (uint16_t)(r >> 13);
+    }
 
-    static constexpr Matrix3 primMat(
-        const float &xR, const float &yR, const float &xG, const float &yG, const float &xB, const float &yB)
+    namespace Detail
     {
-        return Matrix3(xR, xG, xB, yR, yG, yB, Tristimulus::z_from_xy(xR, yR), Tristimulus::z_from_xy(xG, yG),
-            Tristimulus::z_from_xy(xB, yB));
+        static void toFloatScalar(const uint16_t *src, float *dst, const size_t count)
+        {
+            for (size_t i = 0; i < count; i++)
+                dst[i] = toFloat(src[i]);
+        }
+        static void fromFloatScalar(const float *src, uint16_t *dst, const size_t count)
+        {
+            for (size_t i = 0; i < count; i++)
+                dst[i] = fromFloat(src[i]);
+        }
+#if defined(COLORSYSTEM_SIMD_X86)
+        static bool f16c(void)
+        {
+#if defined(__GNUC__)
+            static const bool has = (__builtin_cpu_init(), __builtin_cpu_supports("f16c") != 0);
+            return has && SIMD::isa() >= SIMD::AVX2;
+#else
+            return SIMD::isa() >= SIMD::AVX2;
+#endif
+        }
+        COLORSYSTEM_TARGET("avx2,f16c")
+        static size_t toFloatF16C(const uint16_t *src, float *dst, const size_t count)
+        {
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8)
+                _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(src + i))));
+            return i;
+        }
+        COLORSYSTEM_TARGET("avx2,f16c")
+        static size_t fromFloatF16C(const float *src, uint16_t *dst, const size_t count)
+        {
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8)
+                _mm_storeu_si128(
+                    (__m128i *)(dst + i), _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+            return i;
+        }
+#endif
+    } // namespace Detail
+
+    // count values, so interleaved and planar buffers are the same to these.
+    static void toFloat(const uint16_t *src, float *dst, const size_t count)
+    {
+        size_t done = 0;
+#if defined(COLORSYSTEM_SIMD_X86)
+        if (Detail::f16c())
+            done = Detail::toFloatF16C(src, dst, count);
+#endif
+        Detail::toFloatScalar(src + done, dst + done, count - done);
     }
-    static constexpr Matrix3 diag(const Vector3 &v) { return Matrix3(v[0], 0, 0, 0, v[1], 0, 0, 0, v[2]); }
-    static constexpr Matrix3 mulDiag(const Matrix3 &m, const Vector3 &v) { return m.mul(diag(m.invert().apply(v))); }
-    static constexpr Matrix3 fromPrimaries(const float &xR, const float &yR, const float &xG, const float &yG,
-        const float &xB, const float &yB, const float &xW, const float &yW)
+    static void fromFloat(const float *src, uint16_t *dst, const size_t count)
     {
-        return mulDiag(primMat(xR, yR, xG, yG, xB, yB), Tristimulus::fromYxy(1.f, xW, yW).vec3());
+        size_t done = 0;
+#if defined(COLORSYSTEM_SIMD_X86)
+        if (Detail::f16c())
+            done = Detail::fromFloatF16C(src, dst, count);
+#endif
+        Detail::fromFloatScalar(src + done, dst + done, count - done);
     }
-    constexpr Gamut(const char *name, const Matrix3 &fromXYZ) : name_(name), toXYZ_(fromXYZ.invert()), fromXYZ_(fromXYZ)
+    static void toFloat(const half *src, float *dst, const size_t count)
     {
-        ;
+        toFloat(&src->bits_, dst, count);
     }
-    constexpr Gamut(const char *name, const float &xR, const float &yR, const float &xG, const float &yG,
-        const float &xB, const float &yB, const float &xW, const float &yW)
-        : name_(name),
-          toXYZ_(fromPrimaries(xR, yR, xG, yG, xB, yB, xW, yW)),
-          fromXYZ_(fromPrimaries(xR, yR, xG, yG, xB, yB, xW, yW).invert())
+    static void fromFloat(const float *src, half *dst, const size_t count) { fromFloat(src, &dst->bits_, count); }
+
+    // runs f(const float *src, float *dst, n) over interleaved half pixels in blocks, strides in halves. the dst block
+    // is widened first when it has channels beyond RGB, so whatever f leaves alone (alpha) comes back unchanged.
+    // src and dst may be the same buffer.
+    template <typename F>
+    static void transform(const half *src, half *dst, const size_t count, const size_t srcStride,
+        const size_t dstStride, const F &f)
+    {
+        const size_t       BLOCK = 256;
+        std::vector<float> a(BLOCK * srcStride), b(BLOCK * dstStride);
+        for (size_t base = 0; base < count; base += BLOCK)
+        {
+            const size_t n = std::min(BLOCK, count - base);
+            toFloat(src + base * srcStride, a.data(), n * srcStride);
+            if (dstStride > 3)
+                toFloat(dst + base * dstStride, b.data(), n * dstStride);
+            f(a.data(), b.data(), n);
+            fromFloat(b.data(), dst + base * dstStride, n * dstStride);
+        }
+    }
+} // namespace Half
+
+static_assert(sizeof(half) == 2, "half buffers are read as arrays of uint16_t");
+inline half::half(const float f) : bits_(Half::fromFloat(f)) { ; }
+inline half::operator float(void) const { return Half::toFloat(bits_); }
+
+// the core types are templates over their scalar S: float for the usual path, double for offline solver or
+// calibration work, SIMD::float4 to run one formula over 4 colors at once. Vector3, Matrix3, Tristimulus and Gamut
+// are the float versions. branches on values go through SIMD::select/min/max so they hold for packs too.
+template <typename S>
+class Vector3T
+{
+  public:
+    typedef std::array<S, 3> vec3;
+    vec3                     v_;
+    constexpr Vector3T(const S a, const S b, const S c) : v_({a, b, c}) { ; }
+    template <typename U>
+    constexpr explicit Vector3T(const Vector3T<U> &v) : v_({S(v[0]), S(v[1]), S(v[2])})
     {
         ;
     }
-    const char *name(void) const { return name_; }
+    constexpr S        operator[](const int &i) const { return v_[i]; }
+    constexpr S        x() const { return v_[0]; }
+    constexpr S        y() const { return v_[1]; }
+    constexpr S        z() const { return v_[2]; }
+    constexpr auto     size() const { return v_.size(); }
+    auto               begin() const { return v_.begin(); }
+    auto               end() const { return v_.end(); }
+    constexpr S        dot(const Vector3T &a) const { return v_[0] * a[0] + v_[1] * a[1] + v_[2] * a[2]; }
+    static constexpr S dot(const Vector3T &a, const Vector3T &b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+};
+typedef Vector3T<float> Vector3;
 
-    constexpr Matrix3     toXYZ(void) const { return toXYZ_; }
-    constexpr Matrix3     fromXYZ(void) const { return fromXYZ_; }
-    constexpr Tristimulus toXYZ(const Tristimulus &tri) const { return Tristimulus(toXYZ_.apply(tri.vec3())); }
-    constexpr Tristimulus fromXYZ(const Tristimulus &tri) const { return Tristimulus(fromXYZ_.apply(tri.vec3())); }
+template <typename S>
+class Matrix3T
+{
+  public:
+    typedef Matrix3T           Matrix3;
+    typedef Vector3T<S>        Vector3;
+    typedef std::array<S, 9>   matrix;
+    matrix                     m_;
 
-    constexpr Vector3 primaryVector(void) const
+  private:
+    static constexpr int M(const int x, const int y) { return x + y * 3; }
+    static constexpr int I(const int y, const int x) { return ((x - 1) + (y - 1) * 3); }
+
+  public:
+    constexpr Matrix3T(const S &a00, const S &a01, const S &a02, const S &a10, const S &a11, const S &a12,
+        const S &a20, const S &a21, const S &a22)
+        : m_({a00, a01, a02, a10, a11, a12, a20, a21, a22})
     {
-        return Vector3(
-            toXYZ_[0] + toXYZ_[3] + toXYZ_[6], toXYZ_[1] + toXYZ_[4] + toXYZ_[7], toXYZ_[2] + toXYZ_[5] + toXYZ_[8]);
+        ;
     }
-    constexpr Matrix3 primaryMatrix(void) const
+    constexpr Matrix3T(void) : m_({S(1.f), S(0.f), S(0.f), S(0.f), S(1.f), S(0.f), S(0.f), S(0.f), S(1.f)}) { ; }
+    template <typename U>
+    constexpr explicit Matrix3T(const Matrix3T<U> &m)
+        : m_({S(m[0]), S(m[1]), S(m[2]), S(m[3]), S(m[4]), S(m[5]), S(m[6]), S(m[7]), S(m[8])})
     {
-        const Vector3 t(primaryVector());
-        return Matrix3(toXYZ_[0] / t[0], toXYZ_[1] / t[1], toXYZ_[2] / t[2], toXYZ_[3] / t[0], toXYZ_[4] / t[1],
-            toXYZ_[5] / t[2], toXYZ_[6] / t[0], toXYZ_[7] / t[1], toXYZ_[8] / t[2]);
+        ;
     }
-    constexpr Tristimulus primaryWhite() const { return Tristimulus(primaryMatrix().apply(primaryVector())); }
-    constexpr Tristimulus primaryRed() const
+    static constexpr Matrix3 fromArray(const S *p)
     {
-        const Matrix3 n(primaryMatrix());
-        return Tristimulus(n[0], n[3], n[6]);
+        return Matrix3(p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7], p[8]);
     }
-    constexpr Tristimulus primaryGreen() const
+    static constexpr Matrix3 diag(const Vector3 &v) { return Matrix3(v[0], 0, 0, 0, v[1], 0, 0, 0, v[2]); }
+
+    constexpr S operator[](const int &i) const { return m_[i]; }
+
+    constexpr Vector3        row(const int i) const { return Vector3(m_[M(0, i)], m_[M(1, i)], m_[M(2, i)]); }
+    constexpr Vector3        col(const int i) const { return Vector3(m_[M(i, 0)], m_[M(i, 1)], m_[M(i, 2)]); }
+    static constexpr Matrix3 transpose(const Matrix3 &a)
     {
-        const Matrix3 n(primaryMatrix());
-        return Tristimulus(n[1], n[4], n[7]);
+        return Matrix3(
+            a[M(0, 0)], a[M(0, 1)], a[M(0, 2)], a[M(1, 0)], a[M(1, 1)], a[M(1, 2)], a[M(2, 0)], a[M(2, 1)], a[M(2, 2)]);
     }
-    constexpr Tristimulus primaryBlue() const
+    constexpr Matrix3 transpose(void) const { return transpose(*this); }
+
+    static constexpr Matrix3 mul(const Matrix3 &a, const Matrix3 &b)
     {
-        const Matrix3 n(primaryMatrix());
-        return Tristimulus(n[2], n[5], n[8]);
+        return Matrix3(a[M(0, 0)] * b[M(0, 0)] + a[M(1, 0)] * b[M(0, 1)] + a[M(2, 0)] * b[M(0, 2)],
+            a[M(0, 0)] * b[M(1, 0)] + a[M(1, 0)] * b[M(1, 1)] + a[M(2, 0)] * b[M(1, 2)],
+            a[M(0, 0)] * b[M(2, 0)] + a[M(1, 0)] * b[M(2, 1)] + a[M(2, 0)] * b[M(2, 2)],
+
+            a[M(0, 1)] * b[M(0, 0)] + a[M(1, 1)] * b[M(0, 1)] + a[M(2, 1)] * b[M(0, 2)],
+            a[M(0, 1)] * b[M(1, 0)] + a[M(1, 1)] * b[M(1, 1)] + a[M(2, 1)] * b[M(1, 2)],
+            a[M(0, 1)] * b[M(2, 0)] + a[M(1, 1)] * b[M(2, 1)] + a[M(2, 1)] * b[M(2, 2)],
+
+            a[M(0, 2)] * b[M(0, 0)] + a[M(1, 2)] * b[M(0, 1)] + a[M(2, 2)] * b[M(0, 2)],
+            a[M(0, 2)] * b[M(1, 0)] + a[M(1, 2)] * b[M(1, 1)] + a[M(2, 2)] * b[M(1, 2)],
+            a[M(0, 2)] * b[M(2, 0)] + a[M(1, 2)] * b[M(2, 1)] + a[M(2, 2)] * b[M(2, 2)]);
+    }
+    constexpr Matrix3 mul(const Matrix3 &b) const { return mul(*this, b); }
+
+    static constexpr Vector3 apply(const Matrix3 &m, const Vector3 &v)
+    {
+        return Vector3(m[M(0, 0)] * v[0] + m[M(1, 0)] * v[1] + m[M(2, 0)] * v[2],
+            m[M(0, 1)] * v[0] + m[M(1, 1)] * v[1] + m[M(2, 1)] * v[2],
+            m[M(0, 2)] * v[0] + m[M(1, 2)] * v[1] + m[M(2, 2)] * v[2]);
+    }
+    constexpr Vector3 apply(const Vector3 &v) const { return apply(*this, v); }
+
+    // apply to interleaved pixels. strides are in floats (3:RGB, 4:RGBA), src and dst may be the same buffer.
+    // channels beyond the first 3 are left untouched.
+    static void apply(const Matrix3 &m, const float *src, float *dst, const size_t count, const size_t srcStride = 3,
+        const size_t dstStride = 3)
+    {
+        SIMD::applyMatrixInterleaved(m.m_.data(), src, dst, count, srcStride, dstStride);
+    }
+    void apply(const float *src, float *dst, const size_t count, const size_t srcStride = 3,
+        const size_t dstStride = 3) const
+    {
+        apply(*this, src, dst, count, srcStride, dstStride);
+    }
+    // half pixels, strides in halves.
+    void apply(const half *src, half *dst, const size_t count, const size_t srcStride = 3,
+        const size_t dstStride = 3) const
+    {
+        Half::transform(src, dst, count, srcStride, dstStride,
+            [&](const float *a, float *b, const size_t n) { apply(*this, a, b, n, srcStride, dstStride); });
+    }
+    // apply to a whole frame. row pitches are in floats, so padded rows are fine.
+    static void applyImage(const Matrix3 &m, const float *src, float *dst, const size_t width, const size_t height,
+        const size_t srcPitch, const size_t dstPitch, const size_t srcStride = 3, const size_t dstStride = 3)
+    {
+        if (srcPitch == width * srcStride && dstPitch == width * dstStride)
+        {
+            apply(m, src, dst, width * height, srcStride, dstStride); // contiguous, do it in one run.
+            return;
+        }
+        for (size_t y = 0; y < height; y++)
+        {
+            apply(m, src + y * srcPitch, dst + y * dstPitch, width, srcStride, dstStride);
+        }
+    }
+    void applyImage(const float *src, float *dst, const size_t width, const size_t height, const size_t srcPitch,
+        const size_t dstPitch, const size_t srcStride = 3, const size_t dstStride = 3) const
+    {
+        applyImage(*this, src, dst, width, height, srcPitch, dstPitch, srcStride, dstStride);
+    }
+    // apply to planar pixels (separate R,G,B planes). output planes may be the input planes.
+    static void applyPlanar(const Matrix3 &m, const float *r, const float *g, const float *b, float *x, float *y,
+        float *z, const size_t count)
+    {
+        SIMD::applyMatrixPlanar(m.m_.data(), r, g, b, x, y, z, count);
+    }
+    void applyPlanar(
+        const float *r, const float *g, const float *b, float *x, float *y, float *z, const size_t count) const
+    {
+        applyPlanar(*this, r, g, b, x, y, z, count);
     }
+
+    static constexpr S det(const Matrix3 &m)
+    {
+        return m[I(1, 1)] * m[I(2, 2)] * m[I(3, 3)] + m[I(2, 1)] * m[I(3, 2)] * m[I(1, 3)] +
+               m[I(3, 1)] * m[I(1, 2)] * m[I(2, 3)] - m[I(1, 1)] * m[I(3, 2)] * m[I(2, 3)] -
+               m[I(3, 1)] * m[I(2, 2)] * m[I(1, 3)] - m[I(2, 1)] * m[I(1, 2)] * m[I(3, 3)];
+    }
+    constexpr S det(void) const { return det(*this); }
+
+    static constexpr Matrix3 mul(const Matrix3 &m, const S &a)
+    {
+        return Matrix3(m[0] * a, m[1] * a, m[2] * a, m[3] * a, m[4] * a, m[5] * a, m[6] * a, m[7] * a, m[8] * a);
+    }
+    constexpr Matrix3        mul(const S a) const { return mul(*this, a); }
+    static constexpr Matrix3 div(const Matrix3 &m, const S &a) { return mul(m, 1.f / a); }
+    constexpr Matrix3        div(const S a) const { return div(*this, a); }
+
+    static constexpr Matrix3 add(const Matrix3 &a, const Matrix3 &b)
+    {
+        return Matrix3(a[0] + b[0], a[1] + b[1], a[2] + b[2], a[3] + b[3], a[4] + b[4], a[5] + b[5], a[6] + b[6],
+            a[7] + b[7], a[8] + b[8]);
+    }
+    constexpr Matrix3 add(const Matrix3 &b) const { return add(*this, b); }
+
+    static constexpr Matrix3 invert(const Matrix3 &a)
+    {
+        return mul(Matrix3((a.m_[I(2, 2)] * a.m_[I(3, 3)] - a.m_[I(2, 3)] * a.m_[I(3, 2)]),
+                       (a.m_[I(1, 3)] * a.m_[I(3, 2)] - a.m_[I(1, 2)] * a.m_[I(3, 3)]),
+                       (a.m_[I(1, 2)] * a.m_[I(2, 3)] - a.m_[I(1, 3)] * a.m_[I(2, 2)]),
+                       (a.m_[I(2, 3)] * a.m_[I(3, 1)] - a.m_[I(2, 1)] * a.m_[I(3, 3)]),
+                       (a.m_[I(1, 1)] * a.m_[I(3, 3)] - a.m_[I(1, 3)] * a.m_[I(3, 1)]),
+                       (a.m_[I(1, 3)] * a.m_[I(2, 1)] - a.m_[I(1, 1)] * a.m_[I(2, 3)]),
+                       (a.m_[I(2, 1)] * a.m_[I(3, 2)] - a.m_[I(2, 2)] * a.m_[I(3, 1)]),
+                       (a.m_[I(1, 2)] * a.m_[I(3, 1)] - a.m_[I(1, 1)] * a.m_[I(3, 2)]),
+                       (a.m_[I(1, 1)] * a.m_[I(2, 2)] - a.m_[I(1, 2)] * a.m_[I(2, 1)])),
+            1.f / det(a));
+    }
+    constexpr Matrix3 invert(void) const { return invert(*this); }
+    constexpr auto    size() const { return m_.size(); }
+    auto              begin() const { return m_.begin(); }
+    auto              end() const { return m_.end(); }
 };
-class OTF
+typedef Matrix3T<float> Matrix3;
+
+template <typename S>
+class TristimulusT
 {
   public:
-    typedef enum
-    {
-        LINEAR,
-        GAMMA, // simplest gamma
-        SRGB,
-        BT709,
-        ST2084,
-        SLOG2,
-        HLG // Hybrid-log-gamma
-    } TYPE;
+    typedef TristimulusT Tristimulus;
+    typedef Matrix3T<S>  Matrix3;
+    typedef Vector3T<S>  Vector3;
 
-    static float       gamma(const float &v, const float &g) { return powf(v, 1.f / g); }
-    static float       degamma(const float &v, const float &g) { return powf(v, g); }
-    static const float ST2084_to_Y(const float &pixel) // pixel should be 0-1
+    Vector3 v_;
+
+    constexpr TristimulusT(const S &a, const S &b, const S &c) : v_(a, b, c) { ; }
+    constexpr TristimulusT() : v_(S(0.f), S(0.f), S(0.f)) { ; }
+    constexpr TristimulusT(const Vector3 &v) : v_(v) { ; }
+    constexpr TristimulusT(const S &v) : v_(v, v, v) { ; }
+    template <typename U>
+    constexpr explicit TristimulusT(const TristimulusT<U> &t) : v_(S(t[0]), S(t[1]), S(t[2]))
     {
-        const float pq_m1 = 0.1593017578125f; // ( 2610.0 / 4096.0 ) / 4.0;
-        const float pq_m2 = 78.84375f;        // ( 2523.0 / 4096.0 ) * 128.0;
-        const float pq_c1 = 0.8359375f;       // 3424.0 / 4096.0 or pq_c3 - pq_c2 + 1.0;
-        const float pq_c2 = 18.8515625f;      // ( 2413.0 / 4096.0 ) * 32.0;
-        const float pq_c3 = 18.6875f;         // ( 2392.0 / 4096.0 ) * 32.0;
-        const float pq_C  = 100.0f;
+        ;
+    }
 
-        // Note that this does NOT handle any of the signal range
-        // considerations from 2084 - this assumes full range (0 - 1)
-        float Np = powf(pixel, 1.0f / pq_m2);
-        float L  = Np - pq_c1;
-        if (L < 0.0)
-            L = 0.0;
-        L = L / (pq_c2 - pq_c3 * Np);
-        L = powf(L, 1.0f / pq_m1);
-        return L * pq_C; // returns 0-100, 1=100cd/m^2
+    constexpr S    operator[](const int &i) const { return v_[i]; }
+    constexpr auto size() const { return v_.size(); }
+    auto           begin() const { return v_.begin(); }
+    auto           end() const { return v_.end(); }
+
+    constexpr const Vector3 &vec3(void) const { return v_; }
+    constexpr S              a() const { return v_[0]; }
+    constexpr S              b() const { return v_[1]; }
+    constexpr S              c() const { return v_[2]; }
+
+    static constexpr Tristimulus scale(const Tristimulus &t, const S &s)
+    {
+        return Tristimulus(t[0] * s, t[1] * s, t[2] * s);
     }
+    constexpr Tristimulus scale(const S &s) const { return scale(*this, s); }
+    constexpr Tristimulus operator*(const S &s) const { return scale(s); }
+    constexpr Tristimulus operator/(const S &s) const { return scale(1.f / s); }
 
-    static const float Y_to_ST2084(const float &C) // C should be 0-100, 1=100cd/m^2
+    // apply color transform matrix
+    static constexpr Tristimulus apply(const Tristimulus &t, const Matrix3 &m)
     {
-        if (C <= 0.f)
-            return 0.f;
-        if (C >= 100.f)
-            return 1.f;
-        const float pq_m1 = 0.1593017578125f; // ( 2610.0 / 4096.0 ) / 4.0;
-        const float pq_m2 = 78.84375f;        // ( 2523.0 / 4096.0 ) * 128.0;
-        const float pq_c1 = 0.8359375f;       // 3424.0 / 4096.0 or pq_c3 - pq_c2 + 1.0;
-        const float pq_c2 = 18.8515625f;      // ( 2413.0 / 4096.0 ) * 32.0;
-        const float pq_c3 = 18.6875f;         // ( 2392.0 / 4096.0 ) * 32.0;
-        const float pq_C  = 100.0f;
+        return Tristimulus(m.apply(t.vec3()));
+    }
+    constexpr Tristimulus apply(const Matrix3 &m) const { return apply(*this, m); }
 
-        // Note that this does NOT handle any of the signal range
-        // considerations from 2084 - this returns full range (0 - 1)
-        float L  = C / pq_C;
-        float Lm = powf(L, pq_m1);
-        float N  = (pq_c1 + pq_c2 * Lm) / (1.0f + pq_c3 * Lm);
-        N        = powf(N, pq_m2);
-        return N;
+    static constexpr Tristimulus add(const Tristimulus &a, const Tristimulus &b)
+    {
+        return Tristimulus(a[0] + b[0], a[1] + b[1], a[2] + b[2]);
     }
-    static const float Y_to_sRGB(const float &C) // returns signal, 0-1, input 0-1
+    constexpr const Tristimulus add(const Tristimulus &b) const { return add(*this, b); }
+    constexpr const Tristimulus operator+(const Tristimulus &b) const { return add(*this, b); }
+    // per-element re-lighting
+    static constexpr Tristimulus mul(const Tristimulus &a, const Tristimulus &b)
     {
-        return (C < 0.f)
-                   ? 0.f
-                   : ((C > 1.f) ? 1.f : ((C < 0.0031308f) ? C * 12.92f : (1.055f * powf(C, 1.0f / 2.4f) - 0.055f)));
+        return Tristimulus(a[0] * b[0], a[1] * b[1], a[2] * b[2]);
     }
-    static const float sRGB_to_Y(const float &C) // returns 0-1, 1=100 nits
+    constexpr const Tristimulus mul(const Tristimulus &b) const { return mul(*this, b); }
+    constexpr const Tristimulus operator*(const Tristimulus &b) const { return mul(*this, b); }
+    static constexpr S          dot(const Tristimulus &a, const Tristimulus &b)
     {
-        return (C < 0.f) ? 0.f : ((C > 1.f) ? 1.f : ((C < 0.04045f) ? C / 12.92f : powf((C + 0.055f) / 1.055f, 2.4f)));
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
     }
-    static const float Y_to_BT709(const float &C) // returns signal, 0-1, input 0-1
+    constexpr S                  dot(const Tristimulus &b) const { return dot(*this, b); }
+    static constexpr S           mini(const S &a, const S &b) { return SIMD::min(a, b); }
+    static constexpr S           maxi(const S &a, const S &b) { return SIMD::max(a, b); }
+    static constexpr Tristimulus min(const Tristimulus &a, const Tristimulus &b)
     {
-        return (C < 0.f) ? 0.f : ((C > 1.f) ? 1.f : ((C < 0.018f) ? C * 4.50f : (1.099f * powf(C, 0.45f) - 0.099f)));
+        return Tristimulus(mini(a[0], b[0]), mini(a[1], b[1]), mini(a[2], b[2]));
     }
-    static const float BT709_to_Y(const float &C) // returns nits, 0-100[cd/m^2]
+    static constexpr Tristimulus max(const Tristimulus &a, const Tristimulus &b)
     {
-        return (C < 0.f) ? 0.f
-                         : ((C > 1.f) ? 1.f : ((C < 0.081f) ? C / 4.50f : powf((C + 0.099f) / 1.099f, 1.f / 0.45f)));
+        return Tristimulus(maxi(a[0], b[0]), maxi(a[1], b[1]), maxi(a[2], b[2]));
     }
+    constexpr Tristimulus min(const Tristimulus &a) const { return min(*this, a); }
+    constexpr Tristimulus max(const Tristimulus &a) const { return max(*this, a); }
 
-    static const float Y_to_HLG(const float &C)
+    constexpr S min3(void) const { return mini(mini(a(), b()), c()); }
+    constexpr S max3(void) const { return maxi(maxi(a(), b()), c()); }
+
+    constexpr Tristimulus clip(const S &l, const S &h) const
     {
-        const float a = 0.17883277f;
-        const float b = 0.28466892f;
-        const float c = 0.55991073f;
-        return (C < 0.f) ? 0.f : ((C < 1.f) ? (0.5f * sqrtf(C)) : (a * logf(C - b) + c));
+        return max(min(*this, Tristimulus(h)), Tristimulus(l));
     }
+    static constexpr Tristimulus clip(const Tristimulus &t, const S &l, const S &h) { return t.clip(l, h); }
+    constexpr Tristimulus        positive() const { return max(*this, Tristimulus(S(0.f))); }
+    static constexpr Tristimulus positive(const Tristimulus &t) { return t.positive(); }
+    // bool for scalars, a lane mask for packs.
+    constexpr auto        isNegative(const S &a) const { return a < S(0.f); }
+    constexpr auto        hasNegative() const { return isNegative(v_[0]) || isNegative(v_[1]) || isNegative(v_[2]); }
+    static constexpr auto hasNegative(const Tristimulus &t) { return t.hasNegative(); }
+    static constexpr S    abs_f(const S f) { return SIMD::max(f, -f); }
 
-    static const float HLG_to_Y(const float &C)
+    // the divisions are guarded rather than branched around, so a pack never divides by zero either.
+    static constexpr S z_from_xy(const S &x, const S &y) { return S(1.f) - x - y; }
+    static constexpr S X_from_Yxy(const S &Y, const S &x, const S &y)
     {
-        const float a = 0.17883277f;
-        const float b = 0.28466892f;
-        const float c = 0.55991073f;
-        return (C < 0.f) ? 0.f : ((C <= 0.5f) ? (4.f * C * C) : exp((C - c) / a) + b);
+        const auto zero = abs_f(y) < S(1e-8f);
+        return SIMD::select(zero, S(0.f), x * Y / SIMD::select(zero, S(1.f), y));
     }
-
-    static const float CV_to_IRE_SLog2(const float &cv)
+    static constexpr S Y_from_Yxy(const S &Y, const S &x, const S &y)
     {
-        const float BLACK = 64.f / 1024.f;
-        const float WV    = 876.f / 1024.f; // 940-64
-        return (cv - BLACK) / WV;
+        (void)x;
+        (void)y;
+        return Y;
     }
-    static const float IRE_to_CV_SLog2(const float &ire)
+    static constexpr S Z_from_Yxy(const S &Y, const S &x, const S &y)
     {
-        const float BLACK = 64.f / 1024.f;
-        const float WV    = 876.f / 1024.f; // 940-64
-        return (ire * WV) + BLACK;
+        const auto zero = abs_f(y) < S(1e-8f);
+        return SIMD::select(zero, S(0.f), z_from_xy(x, y) * Y / SIMD::select(zero, S(1.f), y));
     }
-    static const float Y_to_SLog2(const float &x) // returns signal, 0-1, input 0-1
+    static constexpr S Y_from_XYZ(const S &x, const S &y, const S &z)
     {
-        const float y = (x < 0.f) ? x * 3.53881278538813f + 0.030001222851889303f
-                                  : (0.432699f * log10f(155.0f * x / 219.0f + 0.037584f) + 0.616596f) + 0.03f;
-        return IRE_to_CV_SLog2(y);
+        (void)x;
+        (void)z;
+        return y;
     }
-    static const float SLog2_to_Y(const float &C) // returns 0-1, 1=100cd/m^2
+    static constexpr S x_from_XYZ(const S &x, const S &y, const S &z)
     {
-        const float x = CV_to_IRE_SLog2(C);
-        const float y = (x >= 0.030001222851889303f)
-                            ? 219.0f * (powf(10.0f, ((x - 0.616596f - 0.03f) / 0.432699f)) - 0.037584f) / 155.0f
-                            : (x - 0.030001222851889303f) / 3.53881278538813f;
-        return (y > 0.f) ? y : 0.f;
+        const auto zero = abs_f(x + y + z) < S(1e-8f);
+        return SIMD::select(zero, S(0.3127), x / SIMD::select(zero, S(1.f), x + y + z));
     }
-    static const Tristimulus toScreen(TYPE type, const Tristimulus &scene, const float g = 1.f)
+    static constexpr S y_from_XYZ(const S &x, const S &y, const S &z)
     {
-        switch (type)
-        {
-        case GAMMA:
-        {
-            return Tristimulus(gamma(scene[0], g), gamma(scene[1], g), gamma(scene[2], g));
-        }
-        break;
-        case SRGB:
-        {
-            return Tristimulus(Y_to_sRGB(scene[0]), Y_to_sRGB(scene[1]), Y_to_sRGB(scene[2]));
-        }
-        break;
-        case BT709:
-        {
-            return Tristimulus(Y_to_BT709(scene[0]), Y_to_BT709(scene[1]), Y_to_BT709(scene[2]));
-        }
-        break;
-        case ST2084:
-        {
-            return Tristimulus(Y_to_ST2084(scene[0]), Y_to_ST2084(scene[1]), Y_to_ST2084(scene[2]));
-        }
-        break;
-        case SLOG2:
-        {
-            return Tristimulus(Y_to_SLog2(scene[0]), Y_to_SLog2(scene[1]), Y_to_SLog2(scene[2]));
-        }
-        break;
-        case HLG:
-        {
-            return Tristimulus(Y_to_HLG(scene[0]), Y_to_HLG(scene[1]), Y_to_HLG(scene[2]));
-        }
-        case LINEAR:
-        default:
-            return scene;
-        }
+        const auto zero = abs_f(x + y + z) < S(1e-8f);
+        return SIMD::select(zero, S(0.3290), y / SIMD::select(zero, S(1.f), x + y + z));
     }
-    static const Tristimulus toScene(TYPE type, const Tristimulus &screen, const float g = 1.f)
+    static constexpr Tristimulus fromYxy(const S &Y, const S &x, const S &y)
     {
-        switch (type)
-        {
-        case GAMMA:
-        {
-            return Tristimulus(degamma(screen[0], g), degamma(screen[1], g), degamma(screen[2], g));
-        }
-        break;
+        return Tristimulus(X_from_Yxy(Y, x, y), Y_from_Yxy(Y, x, y), Z_from_Yxy(Y, x, y));
+    }
+    static constexpr Tristimulus toYxy(const S &X, const S &Y, const S &Z)
+    {
+        return Tristimulus(Y_from_XYZ(X, Y, Z), x_from_XYZ(X, Y, Z), y_from_XYZ(X, Y, Z));
+    }
+    static constexpr Tristimulus fromYxy(const Tristimulus &Yxy) { return fromYxy(Yxy[0], Yxy[1], Yxy[2]); }
+    static constexpr Tristimulus toYxy(const Tristimulus &XYZ) { return toYxy(XYZ[0], XYZ[1], XYZ[2]); }
+    //
+    constexpr Tristimulus fromYxy(void) const { return fromYxy(*this); }
+    constexpr Tristimulus toYxy(void) const { return toYxy(*this); }
+    // support u'v'
+    //  u = 4x / (-2x + 12y + 3)
+    //  v = 6y / (-2x + 12y + 3)
+    //  x = 3u / (2u - 8v + 4)
+    //  y = 2v / (2u - 8v + 4)
+    //  u' = 4x / (-2x + 12y + 3)    [ = u ]
+    //  v' = 9y / (-2x + 12y + 3)    [ = 1.5v ]
+    //  x = 9u' / (6u' - 16v' + 12)
+    //  y = 4v' / (6u' - 16v' + 12)
+    static constexpr S u_from_xy(const S &x, const S &y) { return 4.f * x / (-2.f * x + 12.f * y + 3.f); }
+    static constexpr S v_from_xy(const S &x, const S &y) { return 6.f * y / (-2.f * x + 12.f * y + 3.f); }
+    static constexpr S x_from_uv(const S &u, const S &v) { return 3.f * u / (2.f * u - 8.f * v + 4.f); }
+    static constexpr S y_from_uv(const S &u, const S &v) { return 2.f * v / (2.f * u - 8.f * v + 4.f); }
+    static constexpr Tristimulus YxyToYuv(const Tristimulus &Yxy)
+    {
+        return Tristimulus(Yxy[0], u_from_xy(Yxy[1], Yxy[2]), v_from_xy(Yxy[1], Yxy[2]));
+    }
+    static constexpr Tristimulus YuvToYxy(const Tristimulus &Yuv)
+    {
+        return Tristimulus(Yuv[0], x_from_uv(Yuv[1], Yuv[2]), y_from_uv(Yuv[1], Yuv[2]));
+    }
+    static constexpr Tristimulus toYuv(const Tristimulus &XYZ) { return YxyToYuv(toYxy(XYZ)); }
+    static constexpr Tristimulus toYuv(const S &X, const S &Y, const S &Z)
+    {
+        return toYuv(Tristimulus(X, Y, Z));
+    }
+    static constexpr Tristimulus fromYuv(const Tristimulus &Yuv) { return fromYxy(YuvToYxy(Yuv)); }
+    static constexpr Tristimulus fromYuv(const S &X, const S &Y, const S &Z)
+    {
+        return fromYuv(Tristimulus(X, Y, Z));
+    }
+    constexpr Tristimulus toYuv(void) const { return toYuv(*this); }
+    constexpr Tristimulus fromYuv(void) const { return fromYuv(*this); }
+
+    // uv only used in CCT.
+    static constexpr float blackbody_x_approx(const float &T)
+    {
+        return (float)(0.811973208 +
+                       T * (-0.00016747 + T * (0.00000000331067 +
+                                                  T * (0.00000000000690001 +
+                                                          T * (-1.39671E-15 + T * (1.11951E-19 + T * -3.31672E-24))))));
+    }
+    static constexpr float blackbody_y_approx(const float &T)
+    {
+        return (float)(0.136977825 +
+                       T * (0.000317653 + T * (-0.000000127946 +
+                                                  T * (0.0000000000222415 + T * (-1.81438E-15 + T * 5.67564E-20)))));
+    }
+    // XYZ from Color Temperature with Y.
+    // cubic spline approx https://en.wikipedia.org/wiki/Planckian_locus#Approximation
+    static constexpr Tristimulus fromPlanckianLocus(const float &T, const float &Y = 1.f)
+    {
+        const float x =
+            (T < 4000.f) ? ((-0.2661239e9f / (T * T * T)) - (0.2343580e6f / (T * T)) + (0.8776956e3f / T) + 0.179910f)
+                         : ((-3.0258469e9f / (T * T * T)) + (2.1070379e6f / (T * T)) + (0.2226347e3f / T) + 0.240390f);
+        const float y =
+            (T < 2222.f)
+                ? ((-1.1063814f * x * x * x) - (1.34811020f * x * x) + (2.18555832f * x) - 0.20219683f)
+                : ((T < 4000.f) ? ((-1.1063814f * x * x * x - 1.34811020f * x * x + 2.18555832f * x - 0.20219683f))
+                                : ((3.0817580f * x * x * x - 5.87338670f * x * x + 3.75112997f * x - 0.37001483f)));
+        return Tristimulus(Y, x, y).fromYxy();
+    }
+    static constexpr Tristimulus fromCT(const float &T, const float Y = 1.f)
+    {
+        return Tristimulus(Y, blackbody_x_approx(T), blackbody_y_approx(T)).fromYxy();
+    }
+    static constexpr float CCT_x_approx(const float &T, const float &dUV)
+    {
+        const float x1 = blackbody_x_approx(T);
+        const float y1 = blackbody_y_approx(T);
+        const float u1 = u_from_xy(x1, y1);
+        const float v1 = v_from_xy(x1, y1);
+        const float x2 = blackbody_x_approx(T - 1.f);
+        const float y2 = blackbody_y_approx(T - 1.f);
+        const float u2 = u_from_xy(x2, y2);
+        const float v2 = v_from_xy(x2, y2);
+        const float du = u2 - u1;
+        const float dv = v2 - v1;
+        const float l  = util::sqrtf(du * du + dv * dv);
+        return x_from_uv(u1 - dUV * du / l, v1 + dUV * dv / l);
+    }
+    static constexpr float CCT_y_approx(const float &T, const float &dUV)
+    {
+        const float x1 = blackbody_x_approx(T);
+        const float y1 = blackbody_y_approx(T);
+        const float u1 = u_from_xy(x1, y1);
+        const float v1 = v_from_xy(x1, y1);
+        const float x2 = blackbody_x_approx(T - 1.f);
+        const float y2 = blackbody_y_approx(T - 1.f);
+        const float u2 = u_from_xy(x2, y2);
+        const float v2 = v_from_xy(x2, y2);
+        const float du = u2 - u1;
+        const float dv = v2 - v1;
+        const float l  = util::sqrtf(du * du + dv * dv);
+        return y_from_uv(u1 - dUV * du / l, v1 + dUV * dv / l);
+    }
+    static constexpr Tristimulus fromCCT(const float &T, const float &dUV, const float Y = 1.f)
+    {
+        return Tristimulus(Y, CCT_x_approx(T, dUV), CCT_y_approx(T, dUV)).fromYuv();
+    }
+
+    // Lab
+    static constexpr S CIELAB_curve(const S &f)
+    {
+        // the constants go through S from double, so the double path gets them at full precision
+        const S threshold = S(216. / 24389.);
+        const S K         = S(24389. / 27.);
+        return SIMD::select(f > S(1.f), S(1.f), SIMD::select(f > threshold, SIMD::cbrt(f), (K * f + 16.f) / 116.f));
+    }
+    static constexpr S CIELAB_decurve(const S &f)
+    {
+        const S K = S((3. / 29.) * (3. / 29.) * (3. / 29.));
+        return SIMD::select(f > S(1.f), S(1.f), SIMD::select(f > S(6. / 29.), f * f * f, (116.f * f - 16.f) * K));
+    }
+    static constexpr Tristimulus toCIELAB(const Tristimulus &t, const Tristimulus &white)
+    {
+        const S x0 = white[0];
+        const S y0 = white[1];
+        const S z0 = white[2];
+        const S x1 = CIELAB_curve(t[0] / x0);
+        const S y1 = CIELAB_curve(t[1] / y0);
+        const S z1 = CIELAB_curve(t[2] / z0);
+        return Tristimulus(116.f * y1 - 16.f, 500.f * (x1 - y1), 200.f * (y1 - z1));
+    }
+    static constexpr Tristimulus fromCIELAB(const Tristimulus &t, const Tristimulus &white)
+    {
+        const S x0 = white[0];
+        const S y0 = white[1];
+        const S z0 = white[2];
+        const S fy = (t[0] + 16.f) / 116.f;
+        const S fx = fy + (t[1] / 500.f);
+        const S fz = fy - (t[2] / 200.f);
+        return Tristimulus(CIELAB_decurve(fx) * x0, CIELAB_decurve(fy) * y0, CIELAB_decurve(fz) * z0);
+    }
+    constexpr Tristimulus toCIELAB(const Tristimulus &white) const { return toCIELAB(*this, white); }
+    constexpr Tristimulus fromCIELAB(const Tristimulus &white) const { return fromCIELAB(*this, white); }
+    // CIELAB uses D50 by default.
+    constexpr Tristimulus toCIELAB(void) const { return toCIELAB(*this, Tristimulus(S(0.9642), S(1.), S(0.8249))); }
+    constexpr Tristimulus fromCIELAB(void) const
+    {
+        return fromCIELAB(*this, Tristimulus(S(0.9642), S(1.), S(0.8249)));
+    }
+    // bulk versions over interleaved pixels. Math::FAST runs 4 at a time through SIMD::float4 and FastMath::cbrt:
+    // L*a*b* stay within 2e-4 of the per-pixel float path (which uses cbrtf), the round trip within 2e-6 * |XYZ|.
+    // Math::EXACT runs the same formula one pixel at a time in double.
+    static void toCIELAB(const float *src, float *dst, const size_t count,
+        const Tristimulus &white = Tristimulus(0.9642f, 1.0f, 0.8249f), const size_t srcStride = 3,
+        const size_t dstStride = 3, const Math::BACKEND math = Math::FAST)
+    {
+        if (math == Math::EXACT)
+        {
+            const TristimulusT<double> w(white);
+            exact(src, dst, count, srcStride, dstStride, [&w](const TristimulusT<double> &t) { return t.toCIELAB(w); });
+            return;
+        }
+        const TristimulusT<SIMD::float4> w(white);
+        batch(src, dst, count, srcStride, dstStride,
+            [&w](const TristimulusT<SIMD::float4> &t) { return t.toCIELAB(w); });
+    }
+    static void fromCIELAB(const float *src, float *dst, const size_t count,
+        const Tristimulus &white = Tristimulus(0.9642f, 1.0f, 0.8249f), const size_t srcStride = 3,
+        const size_t dstStride = 3, const Math::BACKEND math = Math::FAST)
+    {
+        if (math == Math::EXACT)
+        {
+            const TristimulusT<double> w(white);
+            exact(src, dst, count, srcStride, dstStride,
+                [&w](const TristimulusT<double> &t) { return t.fromCIELAB(w); });
+            return;
+        }
+        const TristimulusT<SIMD::float4> w(white);
+        batch(src, dst, count, srcStride, dstStride,
+            [&w](const TristimulusT<SIMD::float4> &t) { return t.fromCIELAB(w); });
+    }
+    // HSV
+    // [0, 360). tiny negative angles round r + 360 up to 360, which wraps to 0 like the angle itself.
+    static constexpr S mod360(const S &r)
+    {
+        const S m = r - 360.f * SIMD::floor(r / 360.f);
+        return SIMD::select(m >= S(360.f), S(0.f), m);
+    }
+    // hue from the angle in the chroma plane instead of the hexagon sectors of toHSV.
+    static Tristimulus toHSV_atan(const Tristimulus &t)
+    {
+        const S max = maxi(maxi(t[0], t[1]), t[2]);
+        const S min = mini(mini(t[0], t[1]), t[2]);
+        const S h   = SIMD::atan2(SIMD::sqrt(S(3.f)) * (t[1] - t[2]), 2.f * t[0] - t[1] - t[2]);
+        return Tristimulus(mod360(S(180. / 3.14159265358979323846) * h),
+            SIMD::select(max == S(0.f), S(0.f), (max - min) / SIMD::select(max == S(0.f), S(1.f), max)), max);
+    }
+    Tristimulus                  toHSV_atan(void) const { return toHSV_atan(*this); }
+    static constexpr Tristimulus toHSV(const Tristimulus &t)
+    {
+        const S max = maxi(maxi(t[0], t[1]), t[2]);
+        const S min = mini(mini(t[0], t[1]), t[2]);
+        const S d   = max - min;
+        const S dd  = SIMD::select(d == S(0.f), S(1.f), d);
+        const S h   = SIMD::select(max == t[0], 60.f * (t[1] - t[2]) / dd,
+            SIMD::select(max == t[1], 60.f * (t[2] - t[0]) / dd + 120.f, 60.f * (t[0] - t[1]) / dd + 240.f));
+        return Tristimulus(mod360(SIMD::select(d == S(0.f), S(0.f), h)),
+            SIMD::select(max == S(0.f), S(0.f), d / SIMD::select(max == S(0.f), S(1.f), max)), max);
+    }
+
+    static constexpr Tristimulus fromHSV(const Tristimulus &t)
+    {
+        const S h = mod360(t[0]) / 60.f;
+        const S i = SIMD::min(SIMD::floor(h), S(5.f)); // sector, 0-5 even where h / 60 rounds up to 6
+        const S r = h - i;
+
+        const S s = t[1];
+        const S v = t[2];
+        const S m = v * (1.0f - s);
+        const S n = v * (1.0f - s * r);
+        const S p = v * (1.0f - s * (1.0f - r));
+
+        // sector  0 1 2 3 4 5
+        //      R  v n m m p v
+        //      G  p v v n m m
+        //      B  m m p v v n
+        return Tristimulus(
+            SIMD::select(i == S(0.f) || i == S(5.f), v, SIMD::select(i == S(1.f), n, SIMD::select(i == S(4.f), p, m))),
+            SIMD::select(i == S(1.f) || i == S(2.f), v, SIMD::select(i == S(0.f), p, SIMD::select(i == S(3.f), n, m))),
+            SIMD::select(i == S(3.f) || i == S(4.f), v, SIMD::select(i == S(2.f), p, SIMD::select(i == S(5.f), n, m))));
+    }
+
+    constexpr Tristimulus toHSV(void) const { return toHSV(*this); }
+    constexpr Tristimulus fromHSV(void) const { return fromHSV(*this); }
+
+    // gathers n <= 4 interleaved pixels into a pack, missing lanes are zero.
+    static TristimulusT<SIMD::float4> load4(const float *src, const size_t n, const size_t stride)
+    {
+        float p[3][4] = {};
+        for (size_t j = 0; j < n; j++)
+        {
+            p[0][j] = src[j * stride + 0];
+            p[1][j] = src[j * stride + 1];
+            p[2][j] = src[j * stride + 2];
+        }
+        return TristimulusT<SIMD::float4>(
+            SIMD::float4::load(p[0]), SIMD::float4::load(p[1]), SIMD::float4::load(p[2]));
+    }
+    static void store4(const TristimulusT<SIMD::float4> &t, float *dst, const size_t n, const size_t stride)
+    {
+        float p[3][4];
+        t[0].store(p[0]);
+        t[1].store(p[1]);
+        t[2].store(p[2]);
+        for (size_t j = 0; j < n; j++)
+        {
+            dst[j * stride + 0] = p[0][j];
+            dst[j * stride + 1] = p[1][j];
+            dst[j * stride + 2] = p[2][j];
+        }
+    }
+
+    // one pixel widened to double and back, for the Math::EXACT side of the bulk functions.
+    static TristimulusT<double> loadDouble(const float *p) { return TristimulusT<double>(p[0], p[1], p[2]); }
+    static void                 storeDouble(const TristimulusT<double> &t, float *p)
+    {
+        p[0] = (float)t[0];
+        p[1] = (float)t[1];
+        p[2] = (float)t[2];
+    }
+
+  private:
+    // runs f over 4 pixels at a time. src may equal dst.
+    template <typename F>
+    static void batch(const float *src, float *dst, const size_t count, const size_t srcStride, const size_t dstStride,
+        const F &f)
+    {
+        for (size_t i = 0; i < count; i += 4)
+        {
+            const size_t n = std::min<size_t>(4, count - i);
+            store4(f(load4(src + i * srcStride, n, srcStride)), dst + i * dstStride, n, dstStride);
+        }
+    }
+    // runs f one pixel at a time in double, libm whatever Math::DEFAULT is. src may equal dst.
+    template <typename F>
+    static void exact(const float *src, float *dst, const size_t count, const size_t srcStride, const size_t dstStride,
+        const F &f)
+    {
+        for (size_t i = 0; i < count; i++)
+            storeDouble(f(loadDouble(src + i * srcStride)), dst + i * dstStride);
+    }
+};
+typedef TristimulusT<float> Tristimulus;
+
+template <typename S>
+class GamutT
+{
+  public:
+    typedef Vector3T<S>     Vector3;
+    typedef Matrix3T<S>     Matrix3;
+    typedef TristimulusT<S> Tristimulus;
+
+    const char *name_;
+    Matrix3     toXYZ_;
+    Matrix3     fromXYZ_;
+
+    static constexpr Matrix3 primMat(const S &xR, const S &yR, const S &xG, const S &yG, const S &xB, const S &yB)
+    {
+        return Matrix3(xR, xG, xB, yR, yG, yB, Tristimulus::z_from_xy(xR, yR), Tristimulus::z_from_xy(xG, yG),
+            Tristimulus::z_from_xy(xB, yB));
+    }
+    static constexpr Matrix3 diag(const Vector3 &v) { return Matrix3(v[0], 0, 0, 0, v[1], 0, 0, 0, v[2]); }
+    static constexpr Matrix3 mulDiag(const Matrix3 &m, const Vector3 &v) { return m.mul(diag(m.invert().apply(v))); }
+    static constexpr Matrix3 fromPrimaries(const S &xR, const S &yR, const S &xG, const S &yG,
+        const S &xB, const S &yB, const S &xW, const S &yW)
+    {
+        return mulDiag(primMat(xR, yR, xG, yG, xB, yB), Tristimulus::fromYxy(1.f, xW, yW).vec3());
+    }
+    constexpr GamutT(const char *name, const Matrix3 &fromXYZ)
+        : name_(name), toXYZ_(fromXYZ.invert()), fromXYZ_(fromXYZ)
+    {
+        ;
+    }
+    constexpr GamutT(const char *name, const S &xR, const S &yR, const S &xG, const S &yG, const S &xB, const S &yB,
+        const S &xW, const S &yW)
+        : name_(name),
+          toXYZ_(fromPrimaries(xR, yR, xG, yG, xB, yB, xW, yW)),
+          fromXYZ_(fromPrimaries(xR, yR, xG, yG, xB, yB, xW, yW).invert())
+    {
+        ;
+    }
+    template <typename U>
+    constexpr explicit GamutT(const GamutT<U> &g) : name_(g.name_), toXYZ_(g.toXYZ_), fromXYZ_(g.fromXYZ_)
+    {
+        ;
+    }
+    const char *name(void) const { return name_; }
+
+    constexpr Matrix3     toXYZ(void) const { return toXYZ_; }
+    constexpr Matrix3     fromXYZ(void) const { return fromXYZ_; }
+    constexpr Tristimulus toXYZ(const Tristimulus &tri) const { return Tristimulus(toXYZ_.apply(tri.vec3())); }
+    constexpr Tristimulus fromXYZ(const Tristimulus &tri) const { return Tristimulus(fromXYZ_.apply(tri.vec3())); }
+    // bulk versions over interleaved pixels, see Matrix3::apply.
+    void toXYZ(const float *src, float *dst, const size_t count, const size_t srcStride = 3,
+        const size_t dstStride = 3) const
+    {
+        toXYZ_.apply(src, dst, count, srcStride, dstStride);
+    }
+    void fromXYZ(const float *src, float *dst, const size_t count, const size_t srcStride = 3,
+        const size_t dstStride = 3) const
+    {
+        fromXYZ_.apply(src, dst, count, srcStride, dstStride);
+    }
+    void toXYZ(const half *src, half *dst, const size_t count, const size_t srcStride = 3,
+        const size_t dstStride = 3) const
+    {
+        toXYZ_.apply(src, dst, count, srcStride, dstStride);
+    }
+    void fromXYZ(const half *src, half *dst, const size_t count, const size_t srcStride = 3,
+        const size_t dstStride = 3) const
+    {
+        fromXYZ_.apply(src, dst, count, srcStride, dstStride);
+    }
+
+    constexpr Vector3 primaryVector(void) const
+    {
+        return Vector3(
+            toXYZ_[0] + toXYZ_[3] + toXYZ_[6], toXYZ_[1] + toXYZ_[4] + toXYZ_[7], toXYZ_[2] + toXYZ_[5] + toXYZ_[8]);
+    }
+    constexpr Matrix3 primaryMatrix(void) const
+    {
+        const Vector3 t(primaryVector());
+        return Matrix3(toXYZ_[0] / t[0], toXYZ_[1] / t[1], toXYZ_[2] / t[2], toXYZ_[3] / t[0], toXYZ_[4] / t[1],
+            toXYZ_[5] / t[2], toXYZ_[6] / t[0], toXYZ_[7] / t[1], toXYZ_[8] / t[2]);
+    }
+    constexpr Tristimulus primaryWhite() const { return Tristimulus(primaryMatrix().apply(primaryVector())); }
+    constexpr Tristimulus primaryRed() const
+    {
+        const Matrix3 n(primaryMatrix());
+        return Tristimulus(n[0], n[3], n[6]);
+    }
+    constexpr Tristimulus primaryGreen() const
+    {
+        const Matrix3 n(primaryMatrix());
+        return Tristimulus(n[1], n[4], n[7]);
+    }
+    constexpr Tristimulus primaryBlue() const
+    {
+        const Matrix3 n(primaryMatrix());
+        return Tristimulus(n[2], n[5], n[8]);
+    }
+};
+typedef GamutT<float> Gamut;
+
+// N colors held as three planes, the structure-of-arrays companion of Tristimulus for batched work over frame
+// buffers. operations walk the planes one SIMD::float4 at a time through TristimulusT, so every formula is the one
+// the scalar path uses. pixels come in and go out with load/store over interleaved or planar buffers.
+template <size_t N = 8>
+class TristimulusBlock
+{
+  public:
+    static_assert(N > 0 && N % 4 == 0, "lane count must be a multiple of 4");
+    typedef SIMD::float4        Pack;
+    typedef TristimulusT<Pack>  TristimulusPack;
+    typedef Matrix3T<Pack>      Matrix3Pack;
+    typedef TristimulusBlock<N> Block;
+    enum
+    {
+        LANES = N,
+        PACKS = N / 4,
+    };
+
+    alignas(64) float p_[3][N];
+
+    TristimulusBlock() { fill(Tristimulus()); }
+    explicit TristimulusBlock(const Tristimulus &t) { fill(t); }
+
+    void fill(const Tristimulus &t)
+    {
+        for (size_t i = 0; i < N; i++)
+        {
+            set(i, t);
+        }
+    }
+    Tristimulus operator[](const size_t i) const { return Tristimulus(p_[0][i], p_[1][i], p_[2][i]); }
+    void        set(const size_t i, const Tristimulus &t)
+    {
+        p_[0][i] = t[0];
+        p_[1][i] = t[1];
+        p_[2][i] = t[2];
+    }
+    float *      plane(const int c) { return p_[c]; }
+    const float *plane(const int c) const { return p_[c]; }
+
+    TristimulusPack pack(const size_t i) const
+    {
+        return TristimulusPack(Pack::load(p_[0] + i * 4), Pack::load(p_[1] + i * 4), Pack::load(p_[2] + i * 4));
+    }
+    void setPack(const size_t i, const TristimulusPack &t)
+    {
+        t[0].store(p_[0] + i * 4);
+        t[1].store(p_[1] + i * 4);
+        t[2].store(p_[2] + i * 4);
+    }
+
+    // interleaved pixels, stride in floats. lanes past count are zero so they stay harmless in every operation.
+    static Block load(const float *src, const size_t count = N, const size_t stride = 3)
+    {
+        assert(count <= N);
+        Block b;
+        for (size_t i = 0; i < count; i++)
+        {
+            b.set(i, Tristimulus(src[i * stride + 0], src[i * stride + 1], src[i * stride + 2]));
+        }
+        return b;
+    }
+    void store(float *dst, const size_t count = N, const size_t stride = 3) const
+    {
+        assert(count <= N);
+        for (size_t i = 0; i < count; i++)
+        {
+            dst[i * stride + 0] = p_[0][i];
+            dst[i * stride + 1] = p_[1][i];
+            dst[i * stride + 2] = p_[2][i];
+        }
+    }
+    static Block loadPlanar(const float *a, const float *b, const float *c, const size_t count = N)
+    {
+        assert(count <= N);
+        Block r;
+        memcpy(r.p_[0], a, count * sizeof(float));
+        memcpy(r.p_[1], b, count * sizeof(float));
+        memcpy(r.p_[2], c, count * sizeof(float));
+        return r;
+    }
+    void storePlanar(float *a, float *b, float *c, const size_t count = N) const
+    {
+        assert(count <= N);
+        memcpy(a, p_[0], count * sizeof(float));
+        memcpy(b, p_[1], count * sizeof(float));
+        memcpy(c, p_[2], count * sizeof(float));
+    }
+
+    // runs f(TristimulusPack) -> TristimulusPack over every pack.
+    template <typename F>
+    Block map(const F &f) const
+    {
+        Block r;
+        for (size_t i = 0; i < PACKS; i++)
+        {
+            r.setPack(i, f(pack(i)));
+        }
+        return r;
+    }
+    template <typename F>
+    Block map(const Block &b, const F &f) const
+    {
+        Block r;
+        for (size_t i = 0; i < PACKS; i++)
+        {
+            r.setPack(i, f(pack(i), b.pack(i)));
+        }
+        return r;
+    }
+
+    Block apply(const Matrix3 &m) const
+    {
+        const Matrix3Pack mp(m);
+        return map([&mp](const TristimulusPack &t) { return t.apply(mp); });
+    }
+    Block scale(const float s) const { return map([s](const TristimulusPack &t) { return t.scale(Pack(s)); }); }
+    Block operator*(const float s) const { return scale(s); }
+    Block add(const Block &b) const
+    {
+        return map(b, [](const TristimulusPack &x, const TristimulusPack &y) { return x.add(y); });
+    }
+    Block operator+(const Block &b) const { return add(b); }
+    Block mul(const Block &b) const
+    {
+        return map(b, [](const TristimulusPack &x, const TristimulusPack &y) { return x.mul(y); });
+    }
+    Block operator*(const Block &b) const { return mul(b); }
+    Block min(const Block &b) const
+    {
+        return map(b, [](const TristimulusPack &x, const TristimulusPack &y) { return x.min(y); });
+    }
+    Block max(const Block &b) const
+    {
+        return map(b, [](const TristimulusPack &x, const TristimulusPack &y) { return x.max(y); });
+    }
+    Block clip(const float l, const float h) const
+    {
+        return map([l, h](const TristimulusPack &t) { return t.clip(Pack(l), Pack(h)); });
+    }
+    Block positive(void) const { return map([](const TristimulusPack &t) { return t.positive(); }); }
+
+    Block toYxy(void) const { return map([](const TristimulusPack &t) { return t.toYxy(); }); }
+    Block fromYxy(void) const { return map([](const TristimulusPack &t) { return t.fromYxy(); }); }
+    Block toYuv(void) const { return map([](const TristimulusPack &t) { return t.toYuv(); }); }
+    Block fromYuv(void) const { return map([](const TristimulusPack &t) { return t.fromYuv(); }); }
+    Block toCIELAB(const Tristimulus &white = Tristimulus(0.9642f, 1.0f, 0.8249f)) const
+    {
+        const TristimulusPack w(white);
+        return map([&w](const TristimulusPack &t) { return t.toCIELAB(w); });
+    }
+    Block fromCIELAB(const Tristimulus &white = Tristimulus(0.9642f, 1.0f, 0.8249f)) const
+    {
+        const TristimulusPack w(white);
+        return map([&w](const TristimulusPack &t) { return t.fromCIELAB(w); });
+    }
+    Block toHSV(void) const { return map([](const TristimulusPack &t) { return t.toHSV(); }); }
+    Block fromHSV(void) const { return map([](const TristimulusPack &t) { return t.fromHSV(); }); }
+};
+
+class OTF
+{
+  public:
+    typedef enum
+    {
+        LINEAR,
+        GAMMA, // simplest gamma
+        SRGB,
+        BT709,
+        ST2084,
+        SLOG2,
+        HLG // Hybrid-log-gamma
+    } TYPE;
+
+    static float       gamma(const float &v, const float &g) { return SIMD::pow(v, 1.f / g); }
+    static float       degamma(const float &v, const float &g) { return SIMD::pow(v, g); }
+    static const float ST2084_to_Y(const float &pixel) // pixel should be 0-1
+    {
+        const float pq_m1 = 0.1593017578125f; // ( 2610.0 / 4096.0 ) / 4.0;
+        const float pq_m2 = 78.84375f;        // ( 2523.0 / 4096.0 ) * 128.0;
+        const float pq_c1 = 0.8359375f;       // 3424.0 / 4096.0 or pq_c3 - pq_c2 + 1.0;
+        const float pq_c2 = 18.8515625f;      // ( 2413.0 / 4096.0 ) * 32.0;
+        const float pq_c3 = 18.6875f;         // ( 2392.0 / 4096.0 ) * 32.0;
+        const float pq_C  = 100.0f;
+
+        // Note that this does NOT handle any of the signal range
+        // considerations from 2084 - this assumes full range (0 - 1)
+        float Np = SIMD::pow(pixel, 1.0f / pq_m2);
+        float L  = Np - pq_c1;
+        if (L < 0.0)
+            L = 0.0;
+        L = L / (pq_c2 - pq_c3 * Np);
+        L = SIMD::pow(L, 1.0f / pq_m1);
+        return L * pq_C; // returns 0-100, 1=100cd/m^2
+    }
+
+    static const float Y_to_ST2084(const float &C) // C should be 0-100, 1=100cd/m^2
+    {
+        if (C <= 0.f)
+            return 0.f;
+        if (C >= 100.f)
+            return 1.f;
+        const float pq_m1 = 0.1593017578125f; // ( 2610.0 / 4096.0 ) / 4.0;
+        const float pq_m2 = 78.84375f;        // ( 2523.0 / 4096.0 ) * 128.0;
+        const float pq_c1 = 0.8359375f;       // 3424.0 / 4096.0 or pq_c3 - pq_c2 + 1.0;
+        const float pq_c2 = 18.8515625f;      // ( 2413.0 / 4096.0 ) * 32.0;
+        const float pq_c3 = 18.6875f;         // ( 2392.0 / 4096.0 ) * 32.0;
+        const float pq_C  = 100.0f;
+
+        // Note that this does NOT handle any of the signal range
+        // considerations from 2084 - this returns full range (0 - 1)
+        float L  = C / pq_C;
+        float Lm = SIMD::pow(L, pq_m1);
+        float N  = (pq_c1 + pq_c2 * Lm) / (1.0f + pq_c3 * Lm);
+        N        = SIMD::pow(N, pq_m2);
+        return N;
+    }
+    static const float Y_to_sRGB(const float &C) // returns signal, 0-1, input 0-1
+    {
+        const float s = (C < 0.0031308f) ? C * 12.92f : (1.055f * SIMD::pow(C, 1.0f / 2.4f) - 0.055f);
+        return (C < 0.f) ? 0.f : ((C > 1.f) ? 1.f : s);
+    }
+    static const float sRGB_to_Y(const float &C) // returns 0-1, 1=100 nits
+    {
+        return (C < 0.f) ? 0.f
+                         : ((C > 1.f) ? 1.f : ((C < 0.04045f) ? C / 12.92f : SIMD::pow((C + 0.055f) / 1.055f, 2.4f)));
+    }
+    static const float Y_to_BT709(const float &C) // returns signal, 0-1, input 0-1
+    {
+        return (C < 0.f) ? 0.f
+                         : ((C > 1.f) ? 1.f : ((C < 0.018f) ? C * 4.50f : (1.099f * SIMD::pow(C, 0.45f) - 0.099f)));
+    }
+    static const float BT709_to_Y(const float &C) // returns nits, 0-100[cd/m^2]
+    {
+        return (C < 0.f) ? 0.f
+                         : ((C > 1.f) ? 1.f
+                                      : ((C < 0.081f) ? C / 4.50f : SIMD::pow((C + 0.099f) / 1.099f, 1.f / 0.45f)));
+    }
+
+    static const float Y_to_HLG(const float &C)
+    {
+        const float a = 0.17883277f;
+        const float b = 0.28466892f;
+        const float c = 0.55991073f;
+        return (C < 0.f) ? 0.f : ((C < 1.f) ? (0.5f * sqrtf(C)) : (a * SIMD::log(C - b) + c));
+    }
+
+    static const float HLG_to_Y(const float &C)
+    {
+        const float a = 0.17883277f;
+        const float b = 0.28466892f;
+        const float c = 0.55991073f;
+        return (C < 0.f) ? 0.f : ((C <= 0.5f) ? (4.f * C * C) : SIMD::exp((C - c) / a) + b);
+    }
+
+    static const float CV_to_IRE_SLog2(const float &cv)
+    {
+        const float BLACK = 64.f / 1024.f;
+        const float WV    = 876.f / 1024.f; // 940-64
+        return (cv - BLACK) / WV;
+    }
+    static const float IRE_to_CV_SLog2(const float &ire)
+    {
+        const float BLACK = 64.f / 1024.f;
+        const float WV    = 876.f / 1024.f; // 940-64
+        return (ire * WV) + BLACK;
+    }
+    static const float Y_to_SLog2(const float &x) // returns signal, 0-1, input 0-1
+    {
+        const float y = (x < 0.f) ? x * 3.53881278538813f + 0.030001222851889303f
+                                  : (0.432699f * SIMD::log10(155.0f * x / 219.0f + 0.037584f) + 0.616596f) + 0.03f;
+        return IRE_to_CV_SLog2(y);
+    }
+    static const float SLog2_to_Y(const float &C) // returns 0-1, 1=100cd/m^2
+    {
+        const float x = CV_to_IRE_SLog2(C);
+        const float y = (x >= 0.030001222851889303f)
+                            ? 219.0f * (SIMD::pow10((x - 0.616596f - 0.03f) / 0.432699f) - 0.037584f) / 155.0f
+                            : (x - 0.030001222851889303f) / 3.53881278538813f;
+        return (y > 0.f) ? y : 0.f;
+    }
+    static const Tristimulus toScreen(TYPE type, const Tristimulus &scene, const float g = 1.f)
+    {
+        switch (type)
+        {
+        case GAMMA:
+        {
+            return Tristimulus(gamma(scene[0], g), gamma(scene[1], g), gamma(scene[2], g));
+        }
+        break;
+        case SRGB:
+        {
+            return Tristimulus(Y_to_sRGB(scene[0]), Y_to_sRGB(scene[1]), Y_to_sRGB(scene[2]));
+        }
+        break;
+        case BT709:
+        {
+            return Tristimulus(Y_to_BT709(scene[0]), Y_to_BT709(scene[1]), Y_to_BT709(scene[2]));
+        }
+        break;
+        case ST2084:
+        {
+            return Tristimulus(Y_to_ST2084(scene[0]), Y_to_ST2084(scene[1]), Y_to_ST2084(scene[2]));
+        }
+        break;
+        case SLOG2:
+        {
+            return Tristimulus(Y_to_SLog2(scene[0]), Y_to_SLog2(scene[1]), Y_to_SLog2(scene[2]));
+        }
+        break;
+        case HLG:
+        {
+            return Tristimulus(Y_to_HLG(scene[0]), Y_to_HLG(scene[1]), Y_to_HLG(scene[2]));
+        }
+        case LINEAR:
+        default:
+            return scene;
+        }
+    }
+    static const Tristimulus toScene(TYPE type, const Tristimulus &screen, const float g = 1.f)
+    {
+        switch (type)
+        {
+        case GAMMA:
+        {
+            return Tristimulus(degamma(screen[0], g), degamma(screen[1], g), degamma(screen[2], g));
+        }
+        break;
+        case SRGB:
+        {
+            return Tristimulus(sRGB_to_Y(screen[0]), sRGB_to_Y(screen[1]), sRGB_to_Y(screen[2]));
+        }
+        break;
+        case BT709:
+        {
+            return Tristimulus(BT709_to_Y(screen[0]), BT709_to_Y(screen[1]), BT709_to_Y(screen[2]));
+        }
+        break;
+        case ST2084:
+        {
+            return Tristimulus(ST2084_to_Y(screen[0]), ST2084_to_Y(screen[1]), ST2084_to_Y(screen[2]));
+        }
+        case SLOG2:
+        {
+            return Tristimulus(SLog2_to_Y(screen[0]), SLog2_to_Y(screen[1]), SLog2_to_Y(screen[2]));
+        }
+        case HLG:
+        {
+            return Tristimulus(HLG_to_Y(screen[0]), HLG_to_Y(screen[1]), HLG_to_Y(screen[2]));
+        }
+        break;
+        case LINEAR:
+        default:
+            return screen;
+        }
+    }
+
+    // curves for the batch conversions below. T is float or SIMD::float4, M is the math backend (Math::Exact or
+    // Math::Fast). same clamps and segments as the per-value functions above.
+    template <typename M>
+    struct Curves
+    {
+        template <typename T>
+        static T gamma(const T &v, const float g)
+        {
+            return M::pow(v, T(1.f / g));
+        }
+        template <typename T>
+        static T degamma(const T &v, const float g)
+        {
+            return M::pow(v, T(g));
+        }
+        template <typename T>
+        static T ST2084_to_Y(const T &pixel)
+        {
+            const T Np = M::pow(pixel, T(1.0f / 78.84375f));
+            const T L  = SIMD::max(Np - 0.8359375f, T(0.f)) / (18.8515625f - 18.6875f * Np);
+            return M::pow(L, T(1.0f / 0.1593017578125f)) * 100.f;
+        }
+        template <typename T>
+        static T Y_to_ST2084(const T &C)
+        {
+            const T Lm = M::pow(C / 100.f, T(0.1593017578125f));
+            const T N  = M::pow((0.8359375f + 18.8515625f * Lm) / (1.0f + 18.6875f * Lm), T(78.84375f));
+            return SIMD::select(C <= 0.f, T(0.f), SIMD::select(C >= 100.f, T(1.f), N));
+        }
+        template <typename T>
+        static T Y_to_sRGB(const T &C)
+        {
+            const T s = SIMD::select(C < 0.0031308f, C * 12.92f, 1.055f * M::pow(C, T(1.0f / 2.4f)) - 0.055f);
+            return SIMD::select(C < 0.f, T(0.f), SIMD::select(C > 1.f, T(1.f), s));
+        }
+        template <typename T>
+        static T sRGB_to_Y(const T &C)
+        {
+            const T y = SIMD::select(C < 0.04045f, C / 12.92f, M::pow((C + 0.055f) / 1.055f, T(2.4f)));
+            return SIMD::select(C < 0.f, T(0.f), SIMD::select(C > 1.f, T(1.f), y));
+        }
+        template <typename T>
+        static T Y_to_BT709(const T &C)
+        {
+            const T s = SIMD::select(C < 0.018f, C * 4.50f, 1.099f * M::pow(C, T(0.45f)) - 0.099f);
+            return SIMD::select(C < 0.f, T(0.f), SIMD::select(C > 1.f, T(1.f), s));
+        }
+        template <typename T>
+        static T BT709_to_Y(const T &C)
+        {
+            const T y = SIMD::select(C < 0.081f, C / 4.50f, M::pow((C + 0.099f) / 1.099f, T(1.f / 0.45f)));
+            return SIMD::select(C < 0.f, T(0.f), SIMD::select(C > 1.f, T(1.f), y));
+        }
+        template <typename T>
+        static T Y_to_HLG(const T &C)
+        {
+            const T s =
+                SIMD::select(C < 1.f, 0.5f * SIMD::sqrt(SIMD::max(C, T(0.f))),
+                    0.17883277f * M::log(C - 0.28466892f) + 0.55991073f);
+            return SIMD::select(C < 0.f, T(0.f), s);
+        }
+        template <typename T>
+        static T HLG_to_Y(const T &C)
+        {
+            const T y =
+                SIMD::select(C <= 0.5f, 4.f * C * C, M::exp((C - 0.55991073f) / 0.17883277f) + 0.28466892f);
+            return SIMD::select(C < 0.f, T(0.f), y);
+        }
+        template <typename T>
+        static T Y_to_SLog2(const T &x)
+        {
+            const T y = SIMD::select(x < 0.f, x * 3.53881278538813f + 0.030001222851889303f,
+                (0.432699f * M::log10(155.0f * x / 219.0f + 0.037584f) + 0.616596f) + 0.03f);
+            return (y * (876.f / 1024.f)) + (64.f / 1024.f);
+        }
+        template <typename T>
+        static T SLog2_to_Y(const T &C)
+        {
+            const T x = (C - (64.f / 1024.f)) / (876.f / 1024.f);
+            const T y = SIMD::select(x >= 0.030001222851889303f,
+                219.0f * (M::pow10((x - 0.616596f - 0.03f) / 0.432699f) - 0.037584f) / 155.0f,
+                (x - 0.030001222851889303f) / 3.53881278538813f);
+            return SIMD::max(y, T(0.f));
+        }
+        // curve picked at compile time. the switch folds away, GAMMA needs an exponent and is not available here.
+        template <TYPE type, typename T>
+        static T toScreen(const T &v)
+        {
+            static_assert(type != GAMMA, "GAMMA takes a runtime exponent, use gamma()");
+            switch (type)
+            {
+            case SRGB:
+                return Y_to_sRGB(v);
+            case BT709:
+                return Y_to_BT709(v);
+            case ST2084:
+                return Y_to_ST2084(v);
+            case SLOG2:
+                return Y_to_SLog2(v);
+            case HLG:
+                return Y_to_HLG(v);
+            case LINEAR:
+            default:
+                return v;
+            }
+        }
+        template <TYPE type, typename T>
+        static T toScene(const T &v)
+        {
+            static_assert(type != GAMMA, "GAMMA takes a runtime exponent, use degamma()");
+            switch (type)
+            {
+            case SRGB:
+                return sRGB_to_Y(v);
+            case BT709:
+                return BT709_to_Y(v);
+            case ST2084:
+                return ST2084_to_Y(v);
+            case SLOG2:
+                return SLog2_to_Y(v);
+            case HLG:
+                return HLG_to_Y(v);
+            case LINEAR:
+            default:
+                return v;
+            }
+        }
+    };
+    // approximated curves, what the batch functions run for Math::FAST.
+    typedef Curves<Math::Fast> Approx;
+
+    // batch versions, the curve is picked once for the whole buffer. count is the number of values
+    // (3 per RGB pixel), so planar planes work as well. src and dst may be the same buffer.
+    // worst errors against the exact functions, sampled over each curve's input range:
+    //   SRGB, BT709 : 2e-7 absolute, both directions
+    //   ST2084      : 2e-5 absolute signal, 1e-4 relative linear. the curve amplifies float rounding near
+    //                 peak white (x^78.84, x^6.28), powf itself is only good to a few 1e-5 there.
+    //   HLG         : 2e-7 absolute signal, 3e-7 relative linear
+    //   SLOG2       : 2e-7 absolute signal, 4e-6 absolute linear
+    //   GAMMA       : 2e-6 relative for g=2.4. negative input gives 0 where powf gives NaN.
+    // math picks the backend, Math::EXACT runs the same curves through libm, one lane at a time.
+    static void toScreen(TYPE type, const float *src, float *dst, const size_t count, const float g = 1.f,
+        const Math::BACKEND math = Math::FAST)
+    {
+        if (math == Math::EXACT)
+            toScreen<Math::Exact>(type, src, dst, count, g);
+        else
+            toScreen<Math::Fast>(type, src, dst, count, g);
+    }
+    static void toScene(TYPE type, const float *src, float *dst, const size_t count, const float g = 1.f,
+        const Math::BACKEND math = Math::FAST)
+    {
+        if (math == Math::EXACT)
+            toScene<Math::Exact>(type, src, dst, count, g);
+        else
+            toScene<Math::Fast>(type, src, dst, count, g);
+    }
+    template <typename M>
+    static void toScreen(TYPE type, const float *src, float *dst, const size_t count, const float g)
+    {
+        switch (type)
+        {
+        case GAMMA:
+            SIMD::transform(src, dst, count, [g](const SIMD::float4 &v) { return Curves<M>::gamma(v, g); });
+            break;
+        case SRGB:
+            SIMD::transform(src, dst, count, [](const SIMD::float4 &v) { return Curves<M>::Y_to_sRGB(v); });
+            break;
+        case BT709:
+            SIMD::transform(src, dst, count, [](const SIMD::float4 &v) { return Curves<M>::Y_to_BT709(v); });
+            break;
+        case ST2084:
+            SIMD::transform(src, dst, count, [](const SIMD::float4 &v) { return Curves<M>::Y_to_ST2084(v); });
+            break;
+        case SLOG2:
+            SIMD::transform(src, dst, count, [](const SIMD::float4 &v) { return Curves<M>::Y_to_SLog2(v); });
+            break;
+        case HLG:
+            SIMD::transform(src, dst, count, [](const SIMD::float4 &v) { return Curves<M>::Y_to_HLG(v); });
+            break;
+        case LINEAR:
+        default:
+            if (src != dst)
+                memmove(dst, src, count * sizeof(float));
+            break;
+        }
+    }
+    template <typename M>
+    static void toScene(TYPE type, const float *src, float *dst, const size_t count, const float g)
+    {
+        switch (type)
+        {
+        case GAMMA:
+            SIMD::transform(src, dst, count, [g](const SIMD::float4 &v) { return Curves<M>::degamma(v, g); });
+            break;
         case SRGB:
+            SIMD::transform(src, dst, count, [](const SIMD::float4 &v) { return Curves<M>::sRGB_to_Y(v); });
+            break;
+        case BT709:
+            SIMD::transform(src, dst, count, [](const SIMD::float4 &v) { return Curves<M>::BT709_to_Y(v); });
+            break;
+        case ST2084:
+            SIMD::transform(src, dst, count, [](const SIMD::float4 &v) { return Curves<M>::ST2084_to_Y(v); });
+            break;
+        case SLOG2:
+            SIMD::transform(src, dst, count, [](const SIMD::float4 &v) { return Curves<M>::SLog2_to_Y(v); });
+            break;
+        case HLG:
+            SIMD::transform(src, dst, count, [](const SIMD::float4 &v) { return Curves<M>::HLG_to_Y(v); });
+            break;
+        case LINEAR:
+        default:
+            if (src != dst)
+                memmove(dst, src, count * sizeof(float));
+            break;
+        }
+    }
+    static void toScreen(TYPE type, const half *src, half *dst, const size_t count, const float g = 1.f,
+        const Math::BACKEND math = Math::FAST)
+    {
+        Half::transform(src, dst, count, 1, 1,
+            [type, g, math](const float *a, float *b, const size_t n) { toScreen(type, a, b, n, g, math); });
+    }
+    static void toScene(TYPE type, const half *src, half *dst, const size_t count, const float g = 1.f,
+        const Math::BACKEND math = Math::FAST)
+    {
+        Half::transform(src, dst, count, 1, 1,
+            [type, g, math](const float *a, float *b, const size_t n) { toScene(type, a, b, n, g, math); });
+    }
+};
+
+// 1D lookup table, size samples evenly spread over [lo,hi].
+// float input is interpolated (clamped to the range), integer input indexes the table directly, so a table
+// of 2^bits entries over [0,1] reproduces the exact curve at every code value of that bit depth.
+class LUT1D
+{
+  public:
+    typedef enum
+    {
+        LINEAR,
+        CUBIC // Catmull-Rom
+    } INTERPOLATION;
+
+    std::vector<float> table_;
+    float              lo_;
+    float              hi_;
+    float              scale_; // samples per unit
+    INTERPOLATION      interpolation_;
+
+    LUT1D() : lo_(0.f), hi_(1.f), scale_(0.f), interpolation_(LINEAR) { ; }
+    template <typename F>
+    LUT1D(const F &f, const size_t size, const float lo = 0.f, const float hi = 1.f,
+        const INTERPOLATION interpolation = LINEAR)
+        : table_(size), lo_(lo), hi_(hi), scale_((float)(size - 1) / (hi - lo)), interpolation_(interpolation)
+    {
+        assert(size >= 2);
+        for (size_t i = 0; i < size; i++)
+        {
+            table_[i] = f(lo + (hi - lo) * (float)i / (float)(size - 1));
+        }
+    }
+
+    // from samples already evenly spread over [lo,hi].
+    LUT1D(std::vector<float> table, const float lo, const float hi, const INTERPOLATION interpolation = LINEAR)
+        : table_(std::move(table)),
+          lo_(lo),
+          hi_(hi),
+          scale_((float)(table_.size() - 1) / (hi - lo)),
+          interpolation_(interpolation)
+    {
+        assert(table_.size() >= 2);
+    }
+
+    // largest scene value the encoding curves reach signal 1.0 at, used as default encode range.
+    static float sceneRange(OTF::TYPE type)
+    {
+        switch (type)
+        {
+        case OTF::ST2084:
+            return 100.f; // 10000 nits
+        case OTF::HLG:
+            return 12.f;
+        case OTF::SLOG2:
+            return 15.f; // ~0.996 signal
+        default:
+            return 1.f;
+        }
+    }
+    // decode table, signal [0,1] to scene. use size = 1<<bits for direct indexing of code values.
+    static LUT1D toScene(
+        OTF::TYPE type, const size_t size = 4096, const float g = 1.f, const INTERPOLATION interpolation = LINEAR)
+    {
+        return LUT1D([type, g](const float v) { return OTF::toScene(type, Tristimulus(v), g)[0]; }, size, 0.f, 1.f,
+            interpolation);
+    }
+    // encode table, scene [0,hi] to signal. hi <= 0 picks sceneRange(type).
+    // the table is uniform in scene light, so steep curves like ST2084 want a big table or a shaper.
+    static LUT1D toScreen(OTF::TYPE type, const size_t size = 4096, const float hi = 0.f, const float g = 1.f,
+        const INTERPOLATION interpolation = LINEAR)
+    {
+        return LUT1D([type, g](const float v) { return OTF::toScreen(type, Tristimulus(v), g)[0]; }, size, 0.f,
+            (hi > 0.f) ? hi : sceneRange(type), interpolation);
+    }
+
+    size_t size(void) const { return table_.size(); }
+    float  lo(void) const { return lo_; }
+    float  hi(void) const { return hi_; }
+
+    // direct lookup by index (integer code value), clamped to the table.
+    float operator[](const size_t i) const { return table_[(i < table_.size()) ? i : table_.size() - 1]; }
+
+    float linear(const float x) const
+    {
+        const float  p    = (x - lo_) * scale_;
+        const size_t last = table_.size() - 1;
+        if (!(p > 0.f)) // NaN goes here too
+            return table_[0];
+        if (p >= (float)last)
+            return table_[last];
+        const size_t i = (size_t)p;
+        const float  f = p - (float)i;
+        return table_[i] + (table_[i + 1] - table_[i]) * f;
+    }
+    float cubic(const float x) const
+    {
+        const float  p    = (x - lo_) * scale_;
+        const size_t last = table_.size() - 1;
+        if (!(p > 0.f))
+            return table_[0];
+        if (p >= (float)last)
+            return table_[last];
+        const size_t i  = (size_t)p;
+        const float  f  = p - (float)i;
+        const float  p1 = table_[i];
+        const float  p2 = table_[i + 1];
+        const float  p0 = (i > 0) ? table_[i - 1] : 2.f * p1 - p2; // extrapolate at both ends
+        const float  p3 = (i + 2 <= last) ? table_[i + 2] : 2.f * p2 - p1;
+        return p1 + 0.5f * f * (p2 - p0 + f * (2.f * p0 - 5.f * p1 + 4.f * p2 - p3 + f * (3.f * (p1 - p2) + p3 - p0)));
+    }
+    float operator()(const float x) const { return (interpolation_ == CUBIC) ? cubic(x) : linear(x); }
+
+    // batch lookups, src and dst may be the same buffer for float.
+    void apply(const float *src, float *dst, const size_t count) const
+    {
+        if (interpolation_ == CUBIC)
+        {
+            for (size_t i = 0; i < count; i++)
+                dst[i] = cubic(src[i]);
+        }
+        else
+        {
+            for (size_t i = 0; i < count; i++)
+                dst[i] = linear(src[i]);
+        }
+    }
+    void apply(const uint16_t *src, float *dst, const size_t count) const
+    {
+        for (size_t i = 0; i < count; i++)
+            dst[i] = (*this)[src[i]];
+    }
+    void apply(const uint8_t *src, float *dst, const size_t count) const
+    {
+        for (size_t i = 0; i < count; i++)
+            dst[i] = (*this)[src[i]];
+    }
+};
+
+// 3D lookup table baked from any Tristimulus -> Tristimulus function, e.g. a whole
+// decode -> gamut -> adaptation -> encode chain, so playback is a few loads and multiply-adds per pixel.
+// nodes are stored as 4 floats (rgb + pad) with r running fastest, one node is one SIMD load.
+// a shaper curve can encode the input before the lattice is indexed, so linear HDR input (ST2084: 0-100)
+// gets its lattice points where the eye needs them. LINEAR keeps the lattice uniform over [0,1].
+class LUT3D
+{
+  public:
+    typedef enum
+    {
+        TRILINEAR,
+        TETRAHEDRAL
+    } INTERPOLATION;
+
+    std::vector<float> lattice_;
+    size_t             size_;
+    OTF::TYPE          shaper_;
+    INTERPOLATION      interpolation_;
+
+    LUT3D() : size_(0), shaper_(OTF::LINEAR), interpolation_(TETRAHEDRAL) { ; }
+    template <typename F>
+    LUT3D(const F &f, const size_t size = 33, const OTF::TYPE shaper = OTF::LINEAR,
+        const INTERPOLATION interpolation = TETRAHEDRAL)
+        : lattice_(size * size * size * 4), size_(size), shaper_(shaper), interpolation_(interpolation)
+    {
+        assert(size >= 2);
+        const float step = 1.f / (float)(size - 1);
+        for (size_t b = 0; b < size; b++)
+        {
+            for (size_t g = 0; g < size; g++)
+            {
+                for (size_t r = 0; r < size; r++)
+                {
+                    const Tristimulus in =
+                        OTF::toScene(shaper, Tristimulus((float)r * step, (float)g * step, (float)b * step));
+                    const Tristimulus out = f(in);
+                    float *           p   = &lattice_[index(r, g, b) * 4];
+                    p[0]                  = out[0];
+                    p[1]                  = out[1];
+                    p[2]                  = out[2];
+                    p[3]                  = 0.f;
+                }
+            }
+        }
+    }
+
+    size_t size(void) const { return size_; }
+    size_t index(const size_t r, const size_t g, const size_t b) const { return r + size_ * (g + size_ * b); }
+    Tristimulus node(const size_t r, const size_t g, const size_t b) const
+    {
+        const float *p = &lattice_[index(r, g, b) * 4];
+        return Tristimulus(p[0], p[1], p[2]);
+    }
+
+    // lookups on already shaped input, u in [0,1]^3 (clamped).
+    Tristimulus trilinear(const float ur, const float ug, const float ub) const
+    {
+        size_t    i[3];
+        float     f[3];
+        locate(ur, ug, ub, i, f);
+        const size_t      dr = 4, dg = size_ * 4, db = size_ * size_ * 4;
+        const float *     p  = &lattice_[index(i[0], i[1], i[2]) * 4];
+        const SIMD::float4 c000 = SIMD::float4::load(p), c100 = SIMD::float4::load(p + dr);
+        const SIMD::float4 c010 = SIMD::float4::load(p + dg), c110 = SIMD::float4::load(p + dr + dg);
+        const SIMD::float4 c001 = SIMD::float4::load(p + db), c101 = SIMD::float4::load(p + dr + db);
+        const SIMD::float4 c011 = SIMD::float4::load(p + dg + db), c111 = SIMD::float4::load(p + dr + dg + db);
+        const SIMD::float4 fr(f[0]), fg(f[1]), fb(f[2]);
+        const SIMD::float4 c00 = c000 + (c100 - c000) * fr;
+        const SIMD::float4 c10 = c010 + (c110 - c010) * fr;
+        const SIMD::float4 c01 = c001 + (c101 - c001) * fr;
+        const SIMD::float4 c11 = c011 + (c111 - c011) * fr;
+        const SIMD::float4 c0  = c00 + (c10 - c00) * fg;
+        const SIMD::float4 c1  = c01 + (c11 - c01) * fg;
+        return toTristimulus(c0 + (c1 - c0) * fb);
+    }
+    Tristimulus tetrahedral(const float ur, const float ug, const float ub) const
+    {
+        size_t i[3];
+        float  f[3];
+        locate(ur, ug, ub, i, f);
+        const size_t       dr = 4, dg = size_ * 4, db = size_ * size_ * 4;
+        const float *      p  = &lattice_[index(i[0], i[1], i[2]) * 4];
+        const float        fr = f[0], fg = f[1], fb = f[2];
+        const SIMD::float4 c000 = SIMD::float4::load(p);
+        const SIMD::float4 c111 = SIMD::float4::load(p + dr + dg + db);
+        // walk c000 -> c111 through the two corners of the tetrahedron holding the point.
+        size_t o1, o2;
+        float  w0, w1, w2;
+        if (fr > fg)
+        {
+            if (fg > fb)
+            {
+                o1 = dr, o2 = dr + dg, w0 = fr, w1 = fg, w2 = fb; // r > g > b
+            }
+            else if (fr > fb)
+            {
+                o1 = dr, o2 = dr + db, w0 = fr, w1 = fb, w2 = fg; // r > b > g
+            }
+            else
+            {
+                o1 = db, o2 = dr + db, w0 = fb, w1 = fr, w2 = fg; // b > r > g
+            }
+        }
+        else
+        {
+            if (fb > fg)
+            {
+                o1 = db, o2 = dg + db, w0 = fb, w1 = fg, w2 = fr; // b > g > r
+            }
+            else if (fb > fr)
+            {
+                o1 = dg, o2 = dg + db, w0 = fg, w1 = fb, w2 = fr; // g > b > r
+            }
+            else
+            {
+                o1 = dg, o2 = dr + dg, w0 = fg, w1 = fr, w2 = fb; // g > r > b
+            }
+        }
+        const SIMD::float4 c1 = SIMD::float4::load(p + o1);
+        const SIMD::float4 c2 = SIMD::float4::load(p + o2);
+        return toTristimulus(c000 + (c1 - c000) * SIMD::float4(w0) + (c2 - c1) * SIMD::float4(w1) +
+                             (c111 - c2) * SIMD::float4(w2));
+    }
+
+    // full lookup: shaper, then the selected interpolation.
+    Tristimulus apply(const Tristimulus &t) const
+    {
+        const Tristimulus u = OTF::toScreen(shaper_, t);
+        return (interpolation_ == TRILINEAR) ? trilinear(u[0], u[1], u[2]) : tetrahedral(u[0], u[1], u[2]);
+    }
+    // interleaved pixels, strides in floats. src and dst may be the same buffer.
+    // the shaper runs on blocks through the batch OTF curves, on Math::DEFAULT like the per value apply.
+    void apply(const float *src, float *dst, const size_t count, const size_t srcStride = 3,
+        const size_t dstStride = 3) const
+    {
+        const size_t BLOCK = 256;
+        float        u[BLOCK * 3];
+        for (size_t base = 0; base < count; base += BLOCK)
+        {
+            const size_t n = (count - base < BLOCK) ? count - base : BLOCK;
+            for (size_t i = 0; i < n; i++)
+            {
+                const float *s = src + (base + i) * srcStride;
+                u[i * 3 + 0]   = s[0];
+                u[i * 3 + 1]   = s[1];
+                u[i * 3 + 2]   = s[2];
+            }
+            OTF::toScreen(shaper_, u, u, n * 3, 1.f, Math::DEFAULT);
+            for (size_t i = 0; i < n; i++)
+            {
+                const Tristimulus t = (interpolation_ == TRILINEAR) ? trilinear(u[i * 3], u[i * 3 + 1], u[i * 3 + 2])
+                                                                    : tetrahedral(u[i * 3], u[i * 3 + 1], u[i * 3 + 2]);
+                float *d = dst + (base + i) * dstStride;
+                d[0]     = t[0];
+                d[1]     = t[1];
+                d[2]     = t[2];
+            }
+        }
+    }
+
+  private:
+    void locate(const float ur, const float ug, const float ub, size_t *i, float *f) const
+    {
+        const float  u[3] = {ur, ug, ub};
+        const size_t last = size_ - 1;
+        for (int c = 0; c < 3; c++)
+        {
+            const float p = (u[c] > 0.f) ? ((u[c] < 1.f) ? u[c] * (float)last : (float)last) : 0.f;
+            const size_t k = (size_t)p;
+            i[c]           = (k < last) ? k : last - 1;
+            f[c]           = p - (float)i[c];
+        }
+    }
+    static Tristimulus toTristimulus(const SIMD::float4 &v)
+    {
+        float t[4];
+        v.store(t);
+        return Tristimulus(t[0], t[1], t[2]);
+    }
+};
+
+// packed pixel formats read into and written from float pixels, so callers do not need their own
+// normalize/quantize loops. integers are in native byte order, 10 and 12 bit formats sit in the low bits of 16 bit
+// words, RGB10A2 has R in the low bits of a 32 bit word. V210 is 4:2:2 Y'CbCr, 6 pixels in 16 bytes: it unpacks to
+// (Y', Cb, Cr) per pixel with Cb, Cr centered on 0 and the chroma of a pair shared, and packs the average of a pair.
+// FULL maps 0..2^n-1 to 0..1, NARROW maps 16..235 (chroma 16..240) scaled to the bit depth and packs no further
+// out than 1..254, leaving the SDI timing codes alone. alpha is always full, RGBA16F ignores range and quantization.
+// formats whose pixels are as wide as the float stride run as one stream, 8 and 16 bit through SSE2 and half float
+// through Half::toFloat/fromFloat.
+class PixelFormat
+{
+  public:
+    typedef enum
+    {
+        RGB8,
+        RGBA8,
+        RGB10,
+        RGB12,
+        RGB16,
+        RGBA16,
+        RGB10A2,
+        V210,
+        RGBA16F
+    } TYPE;
+    typedef enum
+    {
+        FULL,
+        NARROW
+    } RANGE;
+    typedef enum
+    {
+        ROUND,
+        DITHER // triangular noise of +-1 code value before rounding, fixed pattern so output is reproducible
+    } QUANTIZE;
+
+    TYPE     type_;
+    RANGE    range_;
+    QUANTIZE quantize_;
+
+    PixelFormat(const TYPE type = RGB8, const RANGE range = FULL, const QUANTIZE quantize = ROUND)
+        : type_(type), range_(range), quantize_(quantize)
+    {
+        ;
+    }
+
+    size_t channels(void) const
+    {
+        switch (type_)
+        {
+        case RGBA8:
+        case RGBA16:
+        case RGB10A2:
+        case RGBA16F:
+            return 4;
+        default:
+            return 3;
+        }
+    }
+    int bits(void) const
+    {
+        switch (type_)
+        {
+        case RGB8:
+        case RGBA8:
+            return 8;
+        case RGB10:
+        case RGB10A2:
+        case V210:
+            return 10;
+        case RGB12:
+            return 12;
+        default:
+            return 16;
+        }
+    }
+    // size of count pixels. V210 rounds up to whole groups of 6.
+    size_t bytes(const size_t count) const
+    {
+        switch (type_)
+        {
+        case RGB8:
+            return count * 3;
+        case RGBA8:
+        case RGB10A2:
+            return count * 4;
+        case V210:
+            return (count + 5) / 6 * 16;
+        case RGBA16:
+        case RGBA16F:
+            return count * 8;
+        default:
+            return count * 6;
+        }
+    }
+
+    // code value = v * scale + offset per channel, luma/RGB first, then chroma, then alpha.
+    float scale(const size_t channel) const
+    {
+        const float k = (float)(1 << (bits() - 8));
+        if (channel == 3 || range_ == FULL)
+            return (float)((1 << ((channel == 3 && type_ == RGB10A2) ? 2 : bits())) - 1);
+        return ((type_ == V210 && channel > 0) ? 224.f : 219.f) * k;
+    }
+    float offset(const size_t channel) const
+    {
+        const float k = (float)(1 << (bits() - 8));
+        if (channel == 3)
+            return 0.f;
+        if (type_ == V210 && channel > 0)
+            return (range_ == FULL) ? (float)(1 << (bits() - 1)) : 128.f * k;
+        return (range_ == FULL) ? 0.f : 16.f * k;
+    }
+
+    // count pixels from src to dst, dstStride floats apart. alpha goes to dst[3] when the stride has room for it,
+    // formats without alpha leave dst[3] alone.
+    void unpack(const void *src, float *dst, const size_t count, const size_t dstStride = 3) const
+    {
+        const size_t ch = channels();
+        if (dstStride == ch && (type_ == RGB8 || type_ == RGBA8))
+            return Detail::unpackStream((const uint8_t *)src, dst, count * ch, gains(true), offsets(true), ch);
+        if (dstStride == ch && (type_ == RGB10 || type_ == RGB12 || type_ == RGB16 || type_ == RGBA16))
+            return Detail::unpackStream((const uint16_t *)src, dst, count * ch, gains(true), offsets(true), ch);
+        if (dstStride == ch && type_ == RGBA16F)
+            return Half::toFloat((const uint16_t *)src, dst, count * ch);
+        const std::array<float, 4> g = gains(true), o = offsets(true);
+        const size_t               n = std::min(ch, dstStride);
+        for (size_t i = 0; i < count; i++, dst += dstStride)
+        {
+            uint32_t c[4];
+            if (type_ == RGBA16F)
+            {
+                const uint16_t *s = (const uint16_t *)src + i * 4;
+                for (size_t k = 0; k < n; k++)
+                    dst[k] = Half::toFloat(s[k]);
+                continue;
+            }
+            load(src, i, c);
+            for (size_t k = 0; k < n; k++)
+                dst[k] = (float)c[k] * g[k] + o[k];
+        }
+    }
+    // raw code values of count pixels, channels() per pixel (3 for V210). not for RGBA16F.
+    void codes(const void *src, uint32_t *dst, const size_t count) const
+    {
+        assert(type_ != RGBA16F);
+        const size_t ch = channels();
+        if (type_ == RGB8 || type_ == RGBA8)
+            std::copy((const uint8_t *)src, (const uint8_t *)src + count * ch, dst);
+        else if (type_ == RGB10A2 || type_ == V210)
+            for (size_t i = 0; i < count; i++)
+                load(src, i, dst + i * ch);
+        else
+            std::copy((const uint16_t *)src, (const uint16_t *)src + count * ch, dst);
+    }
+    // count pixels from src, srcStride floats apart, to dst. alpha comes from src[3] when there is one, opaque
+    // otherwise. first is the index of src[0] in the image, it places the dither pattern so that pixels packed in
+    // pieces come out the same as packed in one go.
+    void pack(const float *src, void *dst, const size_t count, const size_t srcStride = 3, const size_t first = 0) const
+    {
+        const size_t ch = channels();
+        if (srcStride == ch && (type_ == RGB8 || type_ == RGBA8))
+            return Detail::packStream(src, (uint8_t *)dst, count * ch, gains(false), offsets(false), floors(),
+                limits(), dither(), first * ch, ch);
+        if (srcStride == ch && (type_ == RGB10 || type_ == RGB12 || type_ == RGB16 || type_ == RGBA16))
+            return Detail::packStream(src, (uint16_t *)dst, count * ch, gains(false), offsets(false), floors(),
+                limits(), dither(), first * ch, ch);
+        if (srcStride == ch && type_ == RGBA16F)
+            return Half::fromFloat(src, (uint16_t *)dst, count * ch);
+        if (type_ == V210)
+            return packV210(src, (uint32_t *)dst, count, srcStride, first);
+        const std::array<float, 4> g = gains(false), o = offsets(false), f = floors(), l = limits(), d = dither();
+        for (size_t i = 0; i < count; i++, src += srcStride)
+        {
+            const float v[4] = {src[0], src[1], src[2], (srcStride > 3) ? src[3] : 1.f};
+            if (type_ == RGBA16F)
+            {
+                uint16_t *p = (uint16_t *)dst + i * 4;
+                for (size_t k = 0; k < 4; k++)
+                    p[k] = Half::fromFloat(v[k]);
+                continue;
+            }
+            uint32_t c[4];
+            for (size_t k = 0; k < ch; k++)
+                c[k] = Detail::quantize(v[k], g[k], o[k], f[k], l[k], d[k], (first + i) * ch + k);
+            store(dst, i, c);
+        }
+    }
+
+    // pixels per block of the fused paths: whole V210 groups and whole SIMD packs.
+    static constexpr size_t BLOCK = 240;
+
+    struct Detail
+    {
+        // fixed triangular noise in (-1,1), indexed by element.
+        static const float *noise(void)
+        {
+            static const std::vector<float> table = [] {
+                std::vector<float> t(4096);
+                uint32_t           s = 0x9e3779b9u;
+                for (size_t i = 0; i < t.size(); i++)
+                {
+                    float u[2];
+                    for (int k = 0; k < 2; k++)
+                    {
+                        s ^= s << 13, s ^= s >> 17, s ^= s << 5;
+                        u[k] = (float)(s >> 8) * (1.f / 16777216.f);
+                    }
+                    t[i] = u[0] - u[1];
+                }
+                return t;
+            }();
+            return table.data();
+        }
+        static inline uint32_t quantize(const float v, const float g, const float o, const float f, const float l,
+            const float d, const size_t index)
+        {
+            const float c = v * g + o + d * noise()[index & 4095];
+            return (uint32_t)(SIMD::min(SIMD::max(c, f), l) + 0.5f); // NaN goes to the floor
+        }
+
+        // elements of an interleaved stream, lane k of the constants applies to element k mod 4. ch is 3 or 4, with
+        // 3 all four lanes hold the same value.
+        template <typename I>
+        static void unpackStream(const I *src, float *dst, const size_t count, const std::array<float, 4> &g,
+            const std::array<float, 4> &o, const size_t ch)
+        {
+            size_t i = 0;
+#if defined(COLORSYSTEM_SIMD_SSE2)
+            const __m128  gv = _mm_loadu_ps(g.data()), ov = _mm_loadu_ps(o.data());
+            const __m128i zero = _mm_setzero_si128();
+            const size_t  step = 16 / sizeof(I);
+            for (; i + step <= count; i += step)
+            {
+                const __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+                __m128i       w[4];
+                size_t        n = 2;
+                if (sizeof(I) == 1)
+                {
+                    const __m128i lo = _mm_unpacklo_epi8(v, zero), hi = _mm_unpackhi_epi8(v, zero);
+                    w[0] = _mm_unpacklo_epi16(lo, zero), w[1] = _mm_unpackhi_epi16(lo, zero);
+                    w[2] = _mm_unpacklo_epi16(hi, zero), w[3] = _mm_unpackhi_epi16(hi, zero);
+                    n    = 4;
+                }
+                else
+                {
+                    w[0] = _mm_unpacklo_epi16(v, zero), w[1] = _mm_unpackhi_epi16(v, zero);
+                }
+                for (size_t k = 0; k < n; k++)
+                    _mm_storeu_ps(dst + i + k * 4, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(w[k]), gv), ov));
+            }
+#endif
+            for (; i < count; i++)
+            {
+                const size_t k = (ch == 4) ? (i & 3) : 0;
+                dst[i]         = (float)src[i] * g[k] + o[k];
+            }
+        }
+        template <typename I>
+        static void packStream(const float *src, I *dst, const size_t count, const std::array<float, 4> &g,
+            const std::array<float, 4> &o, const std::array<float, 4> &f, const std::array<float, 4> &l,
+            const std::array<float, 4> &d, const size_t first, const size_t ch)
+        {
+            size_t i = 0;
+#if defined(COLORSYSTEM_SIMD_SSE2)
+            const __m128 gv = _mm_loadu_ps(g.data()), ov = _mm_loadu_ps(o.data()), fv = _mm_loadu_ps(f.data());
+            const __m128 lv = _mm_loadu_ps(l.data()), dv = _mm_loadu_ps(d.data());
+            const float *pattern = noise();
+            const size_t step    = 16 / sizeof(I);
+            for (; i + step <= count; i += step)
+            {
+                __m128i w[4];
+                for (size_t k = 0; k < step / 4; k++)
+                {
+                    const size_t e = i + k * 4;
+                    const size_t p = (first + e) & 4095; // first is a multiple of ch, so lanes stay on channels
+                    const __m128 n = (p <= 4092) ? _mm_loadu_ps(pattern + p)
+                                                 : _mm_setr_ps(pattern[p], pattern[(p + 1) & 4095],
+                                                       pattern[(p + 2) & 4095], pattern[(p + 3) & 4095]);
+                    const __m128 c =
+                        _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + e), gv), ov), _mm_mul_ps(dv, n));
+                    // max first so NaN becomes the floor like the scalar path
+                    w[k] = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(c, fv), lv), _mm_set1_ps(0.5f)));
+                }
+                if (sizeof(I) == 1)
+                {
+                    _mm_storeu_si128((__m128i *)(dst + i),
+                        _mm_packus_epi16(_mm_packs_epi32(w[0], w[1]), _mm_packs_epi32(w[2], w[3])));
+                }
+                else
+                {
+                    // no unsigned 32->16 pack in SSE2: bias into the signed range and back.
+                    const __m128i bias = _mm_set1_epi32(32768);
+                    const __m128i p    = _mm_packs_epi32(_mm_sub_epi32(w[0], bias), _mm_sub_epi32(w[1], bias));
+                    _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(p, _mm_set1_epi16((short)0x8000)));
+                }
+            }
+#endif
+            for (; i < count; i++)
+            {
+                const size_t k = (ch == 4) ? (i & 3) : 0;
+                dst[i]         = (I)quantize(src[i], g[k], o[k], f[k], l[k], d[k], first + i);
+            }
+        }
+    };
+
+  private:
+    // per channel constants, lane 3 is alpha. for 3 channel formats every lane is the color one, which is what
+    // the streams want.
+    std::array<float, 4> gains(const bool decode) const
+    {
+        std::array<float, 4> r;
+        for (size_t k = 0; k < 4; k++)
+        {
+            const size_t c = (channels() == 4) ? k : ((type_ == V210) ? std::min<size_t>(k, 2) : 0);
+            r[k]           = decode ? 1.f / scale(c) : scale(c);
+        }
+        return r;
+    }
+    std::array<float, 4> offsets(const bool decode) const
+    {
+        std::array<float, 4> r;
+        for (size_t k = 0; k < 4; k++)
+        {
+            const size_t c = (channels() == 4) ? k : ((type_ == V210) ? std::min<size_t>(k, 2) : 0);
+            r[k]           = decode ? -offset(c) / scale(c) : offset(c);
+        }
+        return r;
+    }
+    // code value range. narrow range colors keep off the codes SDI reserves for timing, 0-3 and 1020-1023 at 10
+    // bits (0 and 255 at 8), so they clamp to [1, 254] shifted up to the bit depth.
+    std::array<float, 4> floors(void) const
+    {
+        std::array<float, 4> r;
+        for (size_t k = 0; k < 4; k++)
+        {
+            const bool color = k < 3 || channels() == 3;
+            r[k]             = (color && range_ == NARROW) ? (float)(1u << (bits() - 8)) : 0.f;
+        }
+        return r;
+    }
+    std::array<float, 4> limits(void) const
+    {
+        std::array<float, 4> r;
+        for (size_t k = 0; k < 4; k++)
+        {
+            const bool color = k < 3 || channels() == 3;
+            r[k] = (float)((color && range_ == NARROW) ? (255u << (bits() - 8)) - 1 : (1u << bits()) - 1);
+        }
+        if (type_ == RGB10A2)
+            r[3] = 3.f;
+        return r;
+    }
+    std::array<float, 4> dither(void) const
+    {
+        std::array<float, 4> r;
+        for (size_t k = 0; k < 4; k++)
+            r[k] = (quantize_ == DITHER && (k < 3 || channels() == 3)) ? 1.f : 0.f;
+        return r;
+    }
+
+    void load(const void *src, const size_t i, uint32_t *c) const
+    {
+        switch (type_)
+        {
+        case RGB8:
+        case RGBA8:
+        {
+            const uint8_t *s = (const uint8_t *)src + i * channels();
+            for (size_t k = 0; k < channels(); k++)
+                c[k] = s[k];
+        }
+        break;
+        case RGB10A2:
+        {
+            const uint32_t w = ((const uint32_t *)src)[i];
+            c[0] = w & 0x3ff, c[1] = (w >> 10) & 0x3ff, c[2] = (w >> 20) & 0x3ff, c[3] = w >> 30;
+        }
+        break;
+        case V210:
+        {
+            // Cb0 Y0 Cr0 | Y1 Cb2 Y2 | Cr2 Y3 Cb4 | Y4 Cr4 Y5, low bits first.
+            static const uint8_t Y[6] = {1, 3, 5, 7, 9, 11}, CB[3] = {0, 4, 8}, CR[3] = {2, 6, 10};
+            const uint32_t *     w   = (const uint32_t *)src + (i / 6) * 4;
+            const size_t         j   = i % 6;
+            const auto get = [w](const size_t n) { return (w[n / 3] >> ((n % 3) * 10)) & 0x3ff; };
+            c[0] = get(Y[j]), c[1] = get(CB[j / 2]), c[2] = get(CR[j / 2]);
+        }
+        break;
+        default:
+        {
+            const uint16_t *s = (const uint16_t *)src + i * channels();
+            for (size_t k = 0; k < channels(); k++)
+                c[k] = s[k];
+        }
+        break;
+        }
+    }
+    void store(void *dst, const size_t i, const uint32_t *c) const
+    {
+        switch (type_)
+        {
+        case RGB8:
+        case RGBA8:
+        {
+            uint8_t *d = (uint8_t *)dst + i * channels();
+            for (size_t k = 0; k < channels(); k++)
+                d[k] = (uint8_t)c[k];
+        }
+        break;
+        case RGB10A2:
+            ((uint32_t *)dst)[i] = c[0] | (c[1] << 10) | (c[2] << 20) | (c[3] << 30);
+            break;
+        default:
+        {
+            uint16_t *d = (uint16_t *)dst + i * channels();
+            for (size_t k = 0; k < channels(); k++)
+                d[k] = (uint16_t)c[k];
+        }
+        break;
+        }
+    }
+    // a short last group repeats its last pixel.
+    void packV210(const float *src, uint32_t *dst, const size_t count, const size_t srcStride, const size_t first) const
+    {
+        const std::array<float, 4> g = gains(false), o = offsets(false), f = floors(), l = limits(), d = dither();
+        for (size_t base = 0; base < count; base += 6, dst += 4)
+        {
+            uint32_t y[6], cb[3], cr[3];
+            for (size_t j = 0; j < 6; j++)
+            {
+                const float *s = src + std::min(base + j, count - 1) * srcStride;
+                y[j]           = Detail::quantize(s[0], g[0], o[0], f[0], l[0], d[0], (first + base + j) * 3);
+            }
+            for (size_t j = 0; j < 3; j++)
+            {
+                const float *s0 = src + std::min(base + j * 2, count - 1) * srcStride;
+                const float *s1 = src + std::min(base + j * 2 + 1, count - 1) * srcStride;
+                const size_t e  = (first + base + j * 2) * 3;
+                cb[j] = Detail::quantize((s0[1] + s1[1]) * 0.5f, g[1], o[1], f[1], l[1], d[1], e + 1);
+                cr[j] = Detail::quantize((s0[2] + s1[2]) * 0.5f, g[2], o[2], f[2], l[2], d[2], e + 2);
+            }
+            dst[0] = cb[0] | (y[0] << 10) | (cr[0] << 20);
+            dst[1] = y[1] | (cb[1] << 10) | (y[2] << 20);
+            dst[2] = cr[1] | (y[3] << 10) | (cb[2] << 20);
+            dst[3] = y[4] | (cr[2] << 10) | (y[5] << 20);
+        }
+    }
+};
+
+// chain of conversion stages run in a single pass over the pixels.
+// stages are simplified at construction: LINEAR curves and identity matrices are dropped, adjacent
+// matrices are multiplied into one and adjacent clips are intersected.
+// the buffer path runs blocks of pixels through every stage while they sit in cache, with the batch
+// OTF curves (see OTF::toScreen(type, const float*, ...) for their errors) computed with the pipeline's math
+// backend: Math::FAST (the default) for previews, Math::EXACT for final renders. apply(Tristimulus) runs the same
+// curves on the same backend, so a single color matches the buffer path.
+class Pipeline
+{
+  public:
+    typedef enum
+    {
+        DECODE, // OTF::toScene
+        MATRIX,
+        ENCODE, // OTF::toScreen
+        CLIP
+    } STAGE;
+
+    class Stage
+    {
+      public:
+        STAGE     type_;
+        OTF::TYPE otf_;
+        float     gamma_;
+        Matrix3   matrix_;
+        float     lo_, hi_;
+
+        Stage(const STAGE type, const OTF::TYPE otf, const float g, const Matrix3 &m, const float lo, const float hi)
+            : type_(type), otf_(otf), gamma_(g), matrix_(m), lo_(lo), hi_(hi)
+        {
+            ;
+        }
+        bool isIdentity(void) const
+        {
+            switch (type_)
+            {
+            case DECODE:
+            case ENCODE:
+                return otf_ == OTF::LINEAR;
+            case MATRIX:
+            {
+                const Matrix3 I;
+                for (int i = 0; i < 9; i++)
+                {
+                    if (fabsf(matrix_[i] - I[i]) > 1e-6f)
+                        return false;
+                }
+                return true;
+            }
+            case CLIP:
+                return lo_ == -std::numeric_limits<float>::infinity() && hi_ == std::numeric_limits<float>::infinity();
+            }
+            return false;
+        }
+    };
+
+    static Stage decode(const OTF::TYPE type, const float g = 1.f)
+    {
+        return Stage(DECODE, type, g, Matrix3(), 0.f, 0.f);
+    }
+    static Stage encode(const OTF::TYPE type, const float g = 1.f)
+    {
+        return Stage(ENCODE, type, g, Matrix3(), 0.f, 0.f);
+    }
+    static Stage matrix(const Matrix3 &m) { return Stage(MATRIX, OTF::LINEAR, 1.f, m, 0.f, 0.f); }
+    static Stage clip(const float lo, const float hi) { return Stage(CLIP, OTF::LINEAR, 1.f, Matrix3(), lo, hi); }
+
+    std::vector<Stage> stages_;
+    Math::BACKEND      math_;
+
+    Pipeline() : math_(Math::FAST) { ; }
+    Pipeline(const std::vector<Stage> &stages, const Math::BACKEND math = Math::FAST) : math_(math)
+    {
+        for (const Stage &s : stages)
+        {
+            push(s);
+        }
+    }
+
+    const std::vector<Stage> &stages(void) const { return stages_; }
+    Math::BACKEND             math(void) const { return math_; }
+
+    Tristimulus apply(const Tristimulus &t) const
+    {
+        Tristimulus v = t;
+        for (const Stage &s : stages_)
+        {
+            float c[3] = {v[0], v[1], v[2]};
+            switch (s.type_)
+            {
+            case DECODE:
+                OTF::toScene(s.otf_, c, c, 3, s.gamma_, math_);
+                v = Tristimulus(c[0], c[1], c[2]);
+                break;
+            case MATRIX:
+                v = v.apply(s.matrix_);
+                break;
+            case ENCODE:
+                OTF::toScreen(s.otf_, c, c, 3, s.gamma_, math_);
+                v = Tristimulus(c[0], c[1], c[2]);
+                break;
+            case CLIP:
+                v = v.clip(s.lo_, s.hi_);
+                break;
+            }
+        }
+        return v;
+    }
+    Tristimulus operator()(const Tristimulus &t) const { return apply(t); } // so it can be baked into a LUT3D
+
+    // interleaved pixels, strides in floats. src and dst may be the same buffer, extra channels are not touched.
+    void apply(const float *src, float *dst, const size_t count, const size_t srcStride = 3,
+        const size_t dstStride = 3) const
+    {
+        run(0, src, dst, count, srcStride, dstStride);
+    }
+    // half pixels, strides in halves.
+    void apply(const half *src, half *dst, const size_t count, const size_t srcStride = 3,
+        const size_t dstStride = 3) const
+    {
+        Half::transform(src, dst, count, srcStride, dstStride,
+            [&](const float *a, float *b, const size_t n) { apply(a, b, n, srcStride, dstStride); });
+    }
+    // packed pixels in and out, see PixelFormat. each block is unpacked, run through the stages and packed while it
+    // sits in cache. alpha is carried when both formats have it and is opaque when only the output has one.
+    // when the first stage decodes integer RGB codes, it is a LUT1D indexed by code value instead: one entry per
+    // code of the input format, run once through the same batch curve and kept until the stage or format changes.
+    void apply(const PixelFormat &in, const void *src, const PixelFormat &out, void *dst, const size_t count) const
+    {
+        const size_t                             BLOCK = PixelFormat::BLOCK;
+        const size_t                             ic = in.channels(), oc = out.channels();
+        const std::shared_ptr<const DecodeTable> table = decodeTable(in);
+        const float                              alpha = 1.f / in.scale(3);
+        float                                    a[BLOCK * 4], b[BLOCK * 4];
+        uint32_t                                 c[BLOCK * 4];
+        for (size_t base = 0; base < count; base += BLOCK)
+        {
+            const size_t n = (count - base < BLOCK) ? count - base : BLOCK;
+            const void * s = (const uint8_t *)src + in.bytes(base);
+            if (table)
+            {
+                const float *  lut  = table->lut_.table_.data();
+                const uint32_t last = (uint32_t)table->lut_.size() - 1;
+                in.codes(s, c, n);
+                for (size_t i = 0; i < n; i++)
+                {
+                    const uint32_t *q = c + i * ic;
+                    float *         p = a + i * ic;
+                    p[0] = lut[std::min(q[0], last)], p[1] = lut[std::min(q[1], last)];
+                    p[2] = lut[std::min(q[2], last)];
+                    if (ic == 4)
+                        p[3] = (float)q[3] * alpha;
+                }
+                run(1, a, b, n, ic, oc);
+            }
+            else
+            {
+                in.unpack(s, a, n, ic);
+                run(0, a, b, n, ic, oc);
+            }
+            if (oc == 4)
+            {
+                for (size_t i = 0; i < n; i++)
+                    b[i * 4 + 3] = (ic == 4) ? a[i * 4 + 3] : 1.f;
+            }
+            out.pack(b, (uint8_t *)dst + out.bytes(base), n, oc, base);
+        }
+    }
+
+  private:
+    // decode stage of an integer input format, see apply(PixelFormat, ...).
+    struct DecodeTable
+    {
+        OTF::TYPE          otf_;
+        float              gamma_;
+        Math::BACKEND      math_;
+        PixelFormat::TYPE  type_;
+        PixelFormat::RANGE range_;
+        LUT1D              lut_;
+    };
+    mutable std::shared_ptr<const DecodeTable> table_; // loaded and swapped atomically, apply runs on many threads
+
+    std::shared_ptr<const DecodeTable> decodeTable(const PixelFormat &in) const
+    {
+        if (stages_.empty() || stages_[0].type_ != DECODE || in.type_ == PixelFormat::V210 ||
+            in.type_ == PixelFormat::RGBA16F)
+            return std::shared_ptr<const DecodeTable>();
+        const Stage &                      s = stages_[0];
+        std::shared_ptr<const DecodeTable> t = std::atomic_load(&table_);
+        if (t && t->otf_ == s.otf_ && t->gamma_ == s.gamma_ && t->math_ == math_ && t->type_ == in.type_ &&
+            t->range_ == in.range_)
+            return t;
+        // every code normalized like PixelFormat::unpack does it
+        const size_t       size = (size_t)1 << in.bits();
+        const float        g = 1.f / in.scale(0), o = -in.offset(0) / in.scale(0);
+        std::vector<float> v(size);
+        for (size_t c = 0; c < size; c++)
+            v[c] = (float)c * g + o;
+        OTF::toScene(s.otf_, v.data(), v.data(), size, s.gamma_, math_);
+        t = std::make_shared<const DecodeTable>(
+            DecodeTable{s.otf_, s.gamma_, math_, in.type_, in.range_, LUT1D(std::move(v), 0.f, (float)(size - 1))});
+        std::atomic_store(&table_, t);
+        return t;
+    }
+    // stages from 'first' on over interleaved pixels, strides in floats.
+    void run(const size_t first, const float *src, float *dst, const size_t count, const size_t srcStride,
+        const size_t dstStride) const
+    {
+        const size_t BLOCK = 256;
+        float        work[BLOCK * 3];
+        for (size_t base = 0; base < count; base += BLOCK)
+        {
+            const size_t n = (count - base < BLOCK) ? count - base : BLOCK;
+            for (size_t i = 0; i < n; i++)
+            {
+                const float *s = src + (base + i) * srcStride;
+                work[i * 3 + 0] = s[0];
+                work[i * 3 + 1] = s[1];
+                work[i * 3 + 2] = s[2];
+            }
+            for (size_t k = first; k < stages_.size(); k++)
+            {
+                const Stage &s = stages_[k];
+                switch (s.type_)
+                {
+                case DECODE:
+                    OTF::toScene(s.otf_, work, work, n * 3, s.gamma_, math_);
+                    break;
+                case MATRIX:
+                    s.matrix_.apply(work, work, n);
+                    break;
+                case ENCODE:
+                    OTF::toScreen(s.otf_, work, work, n * 3, s.gamma_, math_);
+                    break;
+                case CLIP:
+                    for (size_t i = 0; i < n * 3; i++)
+                        work[i] = (work[i] < s.lo_) ? s.lo_ : ((work[i] > s.hi_) ? s.hi_ : work[i]);
+                    break;
+                }
+            }
+            for (size_t i = 0; i < n; i++)
+            {
+                float *d = dst + (base + i) * dstStride;
+                d[0]     = work[i * 3 + 0];
+                d[1]     = work[i * 3 + 1];
+                d[2]     = work[i * 3 + 2];
+            }
+        }
+    }
+    void push(const Stage &s)
+    {
+        if (s.isIdentity())
+            return;
+        if (!stages_.empty() && stages_.back().type_ == s.type_)
+        {
+            Stage &last = stages_.back();
+            if (s.type_ == MATRIX)
+            {
+                last.matrix_ = s.matrix_.mul(last.matrix_); // last runs first
+                if (last.isIdentity())
+                    stages_.pop_back();
+                return;
+            }
+            if (s.type_ == CLIP)
+            {
+                // the first range clamped into the second, so disjoint ranges collapse onto the second one.
+                last.lo_ = (last.lo_ < s.lo_) ? s.lo_ : ((last.lo_ > s.hi_) ? s.hi_ : last.lo_);
+                last.hi_ = (last.hi_ < s.lo_) ? s.lo_ : ((last.hi_ > s.hi_) ? s.hi_ : last.hi_);
+                return;
+            }
+        }
+        stages_.push_back(s);
+    }
+};
+
+// 3x3 matrix in fixed point for the integer pipeline: coefficients are integers scaled by 2^shift, inputs and
+// outputs are 16 bit unsigned. shift is the largest (16 to 1) for which no row can overflow 32 bits. coefficients
+// are rounded to nearest and the rounding left in each row goes to its largest coefficient, so a row sums to the
+// rounded row sum of the float matrix and white stays white. all kernels compute the same bits:
+//   out = clamp((c0 * r + c1 * g + c2 * b + 2^(shift-1)) >> shift, 0, 65535)
+class FixedMatrix3
+{
+  public:
+    std::array<int32_t, 9> c_;
+    int                    shift_;
+
+    FixedMatrix3() : FixedMatrix3(Matrix3()) { ; }
+    explicit FixedMatrix3(const Matrix3 &m) : shift_(16)
+    {
+        // c_ always holds the coefficients of the kept shift. shift 1 is the floor, so 2^(shift-1) stays defined.
+        int64_t room = headroom(quantize(m));
+        while (room < 0 && shift_ > 1)
+        {
+            shift_--;
+            room = headroom(quantize(m));
+        }
+        assert(room >= 0); // row sums past ~16383 do not fit 32 bits at any shift
+    }
+
+    Matrix3 toMatrix3(void) const
+    {
+        const float k = 1.f / (float)(1 << shift_);
+        return Matrix3(
+            c_[0] * k, c_[1] * k, c_[2] * k, c_[3] * k, c_[4] * k, c_[5] * k, c_[6] * k, c_[7] * k, c_[8] * k);
+    }
+
+    // planar 16 bit values held in int32, x,y,z may be r,g,b.
+    void apply(const int32_t *r, const int32_t *g, const int32_t *b, int32_t *x, int32_t *y, int32_t *z,
+        const size_t count) const
+    {
+        size_t done = 0;
+#if defined(COLORSYSTEM_SIMD_X86)
+        switch (SIMD::isa())
+        {
+        case SIMD::AVX512:
+        case SIMD::AVX2:
+            done = applyAVX2(r, g, b, x, y, z, count);
+            break;
+        case SIMD::SSE41:
+            done = applySSE41(r, g, b, x, y, z, count);
+            break;
+        case SIMD::SCALAR:
+        default:
+            break;
+        }
+#endif
+        const int32_t half = 1 << (shift_ - 1);
+        for (size_t i = done; i < count; i++)
+        {
+            const int32_t p = r[i], q = g[i], s = b[i];
+            x[i]            = clamp((c_[0] * p + c_[1] * q + c_[2] * s + half) >> shift_);
+            y[i]            = clamp((c_[3] * p + c_[4] * q + c_[5] * s + half) >> shift_);
+            z[i]            = clamp((c_[6] * p + c_[7] * q + c_[8] * s + half) >> shift_);
+        }
+    }
+    // the same coefficients on non negative values of up to 31 bits, summed in 64 bits and clamped to [0, hi]:
+    //   out = clamp((c0 * r + c1 * g + c2 * b + 2^(shift-1)) >> shift, 0, hi)
+    // there is an AVX2 kernel only, SSE4.1 lacks the 64 bit compare.
+    void applyWide(const int32_t *r, const int32_t *g, const int32_t *b, int32_t *x, int32_t *y, int32_t *z,
+        const size_t count, const int32_t hi) const
+    {
+        size_t done = 0;
+#if defined(COLORSYSTEM_SIMD_X86)
+        if (SIMD::isa() >= SIMD::AVX2)
+            done = applyWideAVX2(r, g, b, x, y, z, count, hi);
+#endif
+        const int64_t half = (int64_t)1 << (shift_ - 1);
+        for (size_t i = done; i < count; i++)
+        {
+            const int64_t p = r[i], q = g[i], s = b[i];
+            x[i]            = clamp((c_[0] * p + c_[1] * q + c_[2] * s + half) >> shift_, hi);
+            y[i]            = clamp((c_[3] * p + c_[4] * q + c_[5] * s + half) >> shift_, hi);
+            z[i]            = clamp((c_[6] * p + c_[7] * q + c_[8] * s + half) >> shift_, hi);
+        }
+    }
+
+  private:
+    static int32_t clamp(const int32_t v) { return (v < 0) ? 0 : ((v > 65535) ? 65535 : v); }
+    static int32_t clamp(const int64_t v, const int32_t hi) { return (v < 0) ? 0 : ((v > hi) ? hi : (int32_t)v); }
+
+    // rounds m into c_ at shift_ and returns the largest row sum of |c|.
+    int64_t quantize(const Matrix3 &m)
+    {
+        int64_t worst = 0;
+        for (int row = 0; row < 3; row++)
+        {
+            double  sum   = 0.;
+            int32_t fixed = 0;
+            int     big   = row * 3;
+            for (int k = row * 3; k < row * 3 + 3; k++)
+            {
+                c_[k] = (int32_t)floor((double)m[k] * (double)(1 << shift_) + 0.5);
+                sum += (double)m[k];
+                fixed += c_[k];
+                big = (fabs(m[k]) > fabs(m[big])) ? k : big;
+            }
+            c_[big] += (int32_t)floor(sum * (double)(1 << shift_) + 0.5) - fixed;
+            worst = std::max<int64_t>(
+                worst, (int64_t)std::abs(c_[row * 3]) + std::abs(c_[row * 3 + 1]) + std::abs(c_[row * 3 + 2]));
+        }
+        return worst;
+    }
+    // room left in int32 for a full scale input through rows of that size, negative when it overflows.
+    int64_t headroom(const int64_t worst) const
+    {
+        return (int64_t)std::numeric_limits<int32_t>::max() - (worst * 65535 + (1 << (shift_ - 1)));
+    }
+
+#if defined(COLORSYSTEM_SIMD_X86)
+    COLORSYSTEM_TARGET("sse4.1")
+    size_t applySSE41(const int32_t *r, const int32_t *g, const int32_t *b, int32_t *x, int32_t *y, int32_t *z,
+        const size_t count) const
+    {
+        __m128i c[9];
+        for (int k = 0; k < 9; k++)
+            c[k] = _mm_set1_epi32(c_[k]);
+        const __m128i half = _mm_set1_epi32(1 << (shift_ - 1)), hi = _mm_set1_epi32(65535), lo = _mm_setzero_si128();
+        const __m128i sh   = _mm_cvtsi32_si128(shift_);
+        int32_t *     out[3] = {x, y, z};
+        size_t        i      = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m128i p = _mm_loadu_si128((const __m128i *)(r + i));
+            const __m128i q = _mm_loadu_si128((const __m128i *)(g + i));
+            const __m128i s = _mm_loadu_si128((const __m128i *)(b + i));
+            __m128i       o[3];
+            for (int k = 0; k < 3; k++)
+            {
+                const __m128i v = _mm_add_epi32(
+                    _mm_add_epi32(_mm_mullo_epi32(c[k * 3], p), _mm_mullo_epi32(c[k * 3 + 1], q)),
+                    _mm_add_epi32(_mm_mullo_epi32(c[k * 3 + 2], s), half));
+                o[k] = _mm_min_epi32(_mm_max_epi32(_mm_sra_epi32(v, sh), lo), hi);
+            }
+            for (int k = 0; k < 3; k++)
+                _mm_storeu_si128((__m128i *)(out[k] + i), o[k]);
+        }
+        return i;
+    }
+    COLORSYSTEM_TARGET("avx2")
+    size_t applyAVX2(const int32_t *r, const int32_t *g, const int32_t *b, int32_t *x, int32_t *y, int32_t *z,
+        const size_t count) const
+    {
+        __m256i c[9];
+        for (int k = 0; k < 9; k++)
+            c[k] = _mm256_set1_epi32(c_[k]);
+        const __m256i half = _mm256_set1_epi32(1 << (shift_ - 1)), hi = _mm256_set1_epi32(65535);
+        const __m256i lo   = _mm256_setzero_si256();
+        const __m128i sh   = _mm_cvtsi32_si128(shift_);
+        int32_t *     out[3] = {x, y, z};
+        size_t        i      = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const __m256i p = _mm256_loadu_si256((const __m256i *)(r + i));
+            const __m256i q = _mm256_loadu_si256((const __m256i *)(g + i));
+            const __m256i s = _mm256_loadu_si256((const __m256i *)(b + i));
+            __m256i       o[3];
+            for (int k = 0; k < 3; k++)
+            {
+                const __m256i v = _mm256_add_epi32(
+                    _mm256_add_epi32(_mm256_mullo_epi32(c[k * 3], p), _mm256_mullo_epi32(c[k * 3 + 1], q)),
+                    _mm256_add_epi32(_mm256_mullo_epi32(c[k * 3 + 2], s), half));
+                o[k] = _mm256_min_epi32(_mm256_max_epi32(_mm256_sra_epi32(v, sh), lo), hi);
+            }
+            for (int k = 0; k < 3; k++)
+                _mm256_storeu_si256((__m256i *)(out[k] + i), o[k]);
+        }
+        return i;
+    }
+    // 4 pixels in 64 bit lanes. _mm256_mul_epi32 takes the signed low halves, negative sums are zeroed before the
+    // logical shift, which then matches the arithmetic one of the scalar code.
+    COLORSYSTEM_TARGET("avx2")
+    size_t applyWideAVX2(const int32_t *r, const int32_t *g, const int32_t *b, int32_t *x, int32_t *y, int32_t *z,
+        const size_t count, const int32_t hi) const
+    {
+        __m256i c[9];
+        for (int k = 0; k < 9; k++)
+            c[k] = _mm256_set1_epi64x(c_[k]);
+        const __m256i half = _mm256_set1_epi64x((int64_t)1 << (shift_ - 1)), top = _mm256_set1_epi64x(hi);
+        const __m256i zero = _mm256_setzero_si256(), even = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+        const __m128i sh   = _mm_cvtsi32_si128(shift_);
+        int32_t *     out[3] = {x, y, z};
+        size_t        i      = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m256i p = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i *)(r + i)));
+            const __m256i q = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i *)(g + i)));
+            const __m256i s = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i *)(b + i)));
+            for (int k = 0; k < 3; k++)
+            {
+                __m256i v = _mm256_add_epi64(
+                    _mm256_add_epi64(_mm256_mul_epi32(c[k * 3], p), _mm256_mul_epi32(c[k * 3 + 1], q)),
+                    _mm256_add_epi64(_mm256_mul_epi32(c[k * 3 + 2], s), half));
+                v = _mm256_srl_epi64(_mm256_andnot_si256(_mm256_cmpgt_epi64(zero, v), v), sh);
+                v = _mm256_blendv_epi8(v, top, _mm256_cmpgt_epi64(v, top));
+                _mm_storeu_si128(
+                    (__m128i *)(out[k] + i), _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(v, even)));
+            }
+        }
+        return i;
+    }
+#endif
+};
+
+// integer code values in and out with no float at run time: a decode table from code value to linear light in
+// LINEAR_BITS bits, a FixedMatrix3 summed in 64 bits and an encode table from linear light to code value, e.g. 10 bit
+// narrow range Rec.709 to Rec.2020 PQ for a broadcast path. decoded light covers [0, LUT1D::sceneRange] of the input
+// curve, encoded light only up to the brightest value the matrix can produce from that, and the matrix carries the
+// ratio of the two. the encode table is indexed like a float, by the exponent and the top MANTISSA_BITS bits of the
+// linear value (values below 2^MANTISSA_BITS index it directly), so the steps stay 2^-MANTISSA_BITS relative down to
+// near black where ST2084 and HLG spend most of their codes. the arithmetic is integer only, so the output depends on
+// the tables alone: the tables are built from the exact curves and can be taken out and handed back to the table
+// constructor where the same bits are needed on every machine. against the exact float curves the output is within
+// one code value. the table lookups are scalar, the matrix runs on the SIMD kernels of FixedMatrix3.
+class FixedPipeline
+{
+  public:
+    static constexpr int    LINEAR_BITS   = 30;
+    static constexpr int    MANTISSA_BITS = 10;
+    static constexpr size_t ENCODE_SIZE   = (size_t)(LINEAR_BITS - MANTISSA_BITS + 1) << MANTISSA_BITS;
+
+    std::vector<uint32_t> decode_; // 2^inBits entries
+    std::vector<uint16_t> encode_; // ENCODE_SIZE entries
+    FixedMatrix3          matrix_;
+
+    FixedPipeline(const OTF::TYPE in, const Matrix3 &m, const OTF::TYPE out, const int inBits = 10,
+        const int outBits = 10, const PixelFormat::RANGE range = PixelFormat::NARROW)
+        : decode_((size_t)1 << inBits), encode_(ENCODE_SIZE), matrix_(scaled(m, in, out))
+    {
+        const double ki = (double)(1 << (inBits - 8)), ko = (double)(1 << (outBits - 8));
+        const double si = (range == PixelFormat::FULL) ? (double)((1 << inBits) - 1) : 219. * ki;
+        const double so = (range == PixelFormat::FULL) ? (double)((1 << outBits) - 1) : 219. * ko;
+        const double oi = (range == PixelFormat::FULL) ? 0. : 16. * ki;
+        const double oo = (range == PixelFormat::FULL) ? 0. : 16. * ko;
+        // narrow range codes stay in [1, 254] scaled to the bit depth like PixelFormat, off the SDI timing codes
+        const double lo   = (range == PixelFormat::FULL) ? 0. : ko;
+        const double top  = (range == PixelFormat::FULL) ? (double)((1 << outBits) - 1) : 255. * ko - 1.;
+        const double full = (double)FULL;
+        const float  hi = LUT1D::sceneRange(in), ho = outputRange(m, in, out);
+        for (size_t c = 0; c < decode_.size(); c++)
+        {
+            const float v = (float)(((double)c - oi) / si);
+            const float l = OTF::toScene(in, Tristimulus(std::min(std::max(v, 0.f), 1.f)))[0];
+            decode_[c]    = (uint32_t)std::min(std::max(floor((double)l / hi * full + 0.5), 0.), full);
+        }
+        const size_t mask = ((size_t)1 << MANTISSA_BITS) - 1;
+        for (size_t c = 0; c < encode_.size(); c++)
+        {
+            // the middle of the linear values landing on c
+            const int    e    = std::max((int)(c >> MANTISSA_BITS) - 1, 0);
+            const double base = (c <= mask) ? (double)c : ldexp((double)((c & mask) + mask + 1), e);
+            const double l    = (base + (ldexp(1., e) - 1.) * 0.5) / full * ho;
+            const float  v    = OTF::toScreen(out, Tristimulus((float)l))[0];
+            encode_[c]        = (uint16_t)std::min(std::max(floor((double)v * so + oo + 0.5), lo), top);
+        }
+    }
+    FixedPipeline(const std::vector<uint32_t> &decode, const FixedMatrix3 &matrix, const std::vector<uint16_t> &encode)
+        : decode_(decode), encode_(encode), matrix_(matrix)
+    {
+        assert(encode_.size() == ENCODE_SIZE);
+    }
+
+    // interleaved code values, strides in uint16_t. channels past RGB of dst are left alone, src and dst may be the
+    // same buffer. codes past the decode table clamp to its last entry.
+    void apply(const uint16_t *src, uint16_t *dst, const size_t count, const size_t srcStride = 3,
+        const size_t dstStride = 3) const
+    {
+        const size_t BLOCK = 256;
+        int32_t      r[BLOCK], g[BLOCK], b[BLOCK];
+        const size_t last = decode_.size() - 1;
+        for (size_t base = 0; base < count; base += BLOCK)
+        {
+            const size_t    n = std::min(BLOCK, count - base);
+            const uint16_t *s = src + base * srcStride;
+            for (size_t i = 0; i < n; i++, s += srcStride)
+            {
+                r[i] = (int32_t)decode_[std::min<size_t>(s[0], last)];
+                g[i] = (int32_t)decode_[std::min<size_t>(s[1], last)];
+                b[i] = (int32_t)decode_[std::min<size_t>(s[2], last)];
+            }
+            matrix_.applyWide(r, g, b, r, g, b, n, FULL);
+            uint16_t *d = dst + base * dstStride;
+            for (size_t i = 0; i < n; i++, d += dstStride)
+            {
+                d[0] = encode_[index((uint32_t)r[i])];
+                d[1] = encode_[index((uint32_t)g[i])];
+                d[2] = encode_[index((uint32_t)b[i])];
+            }
+        }
+    }
+
+  private:
+    static constexpr int32_t FULL = (1 << LINEAR_BITS) - 1;
+
+    // encode table slot of a linear value: the exponent above MANTISSA_BITS, then the mantissa bits below the top one.
+    static size_t index(const uint32_t l)
+    {
+        uint32_t v = l >> MANTISSA_BITS;
+        if (v == 0)
+            return l;
+        int e = 0;
+        for (int step = 16; step > 0; step >>= 1)
+        {
+            if (v >= (1u << step))
+            {
+                v >>= step;
+                e += step;
+            }
+        }
+        return ((size_t)(e + 1) << MANTISSA_BITS) + (l >> e) - ((size_t)1 << MANTISSA_BITS);
+    }
+    // the encode side only needs to reach the brightest value the matrix can make from the input range.
+    static float outputRange(const Matrix3 &m, const OTF::TYPE in, const OTF::TYPE out)
+    {
+        float peak = 0.f;
+        for (int row = 0; row < 3; row++)
+        {
+            peak = std::max(peak, std::max(m[row * 3], 0.f) + std::max(m[row * 3 + 1], 0.f) +
+                                      std::max(m[row * 3 + 2], 0.f));
+        }
+        return std::min(LUT1D::sceneRange(in) * peak, LUT1D::sceneRange(out));
+    }
+    static Matrix3 scaled(const Matrix3 &m, const OTF::TYPE in, const OTF::TYPE out)
+    {
+        const float k = LUT1D::sceneRange(in) / outputRange(m, in, out);
+        return Matrix3::diag(Vector3(k, k, k)).mul(m);
+    }
+};
+
+namespace Parallel
+{
+// work-stealing pool. every worker owns a deque: it pops its own work from the back and steals from the front of
+// the others when it runs dry. tasks submitted from a worker go to its own deque, others are dealt round-robin.
+class ThreadPool
+{
+  public:
+    typedef std::function<void(void)> Task;
+
+    explicit ThreadPool(size_t threads = 0) // 0 : one per hardware thread
+        : stop_(false), pending_(0), next_(0)
+    {
+        if (threads == 0)
+        {
+            threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+        }
+        for (size_t i = 0; i < threads; i++)
+        {
+            queues_.emplace_back(new Queue);
+        }
+        for (size_t i = 0; i < threads; i++)
+        {
+            workers_.emplace_back([this, i] { run(i); });
+        }
+    }
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (std::thread &t : workers_)
+        {
+            t.join();
+        }
+    }
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    size_t size(void) const { return workers_.size(); }
+
+    void submit(Task task)
+    {
+        const size_t self = index();
+        const size_t q    = (self < queues_.size()) ? self : next_++ % queues_.size();
+        {
+            std::lock_guard<std::mutex> lock(queues_[q]->mutex_);
+            queues_[q]->tasks_.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_++;
+        }
+        cv_.notify_one();
+    }
+    // runs one queued task on the calling thread. false when there was nothing to do.
+    bool runPending(void)
+    {
+        Task task;
+        if (!take(index(), task))
+            return false;
+        task();
+        return true;
+    }
+
+    // process-wide pool, created on first use.
+    static ThreadPool &shared(void)
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+  private:
+    struct Queue
+    {
+        std::mutex       mutex_;
+        std::deque<Task> tasks_;
+    };
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread>            workers_;
+    std::mutex                          mutex_;
+    std::condition_variable             cv_;
+    bool                                stop_;
+    std::atomic<size_t>                 pending_;
+    std::atomic<size_t>                 next_;
+
+    // worker index of the calling thread in this pool, size() for foreign threads.
+    size_t index(void) const
+    {
+        const std::pair<const ThreadPool *, size_t> &s = slot();
+        return (s.first == this) ? s.second : queues_.size();
+    }
+    static std::pair<const ThreadPool *, size_t> &slot(void)
+    {
+        static thread_local std::pair<const ThreadPool *, size_t> s(nullptr, 0);
+        return s;
+    }
+    bool take(const size_t self, Task &task)
+    {
+        const size_t n = queues_.size();
+        if (self < n)
+        {
+            Queue &                     q = *queues_[self];
+            std::lock_guard<std::mutex> lock(q.mutex_);
+            if (!q.tasks_.empty())
+            {
+                task = std::move(q.tasks_.back());
+                q.tasks_.pop_back();
+                pending_--;
+                return true;
+            }
+        }
+        for (size_t k = 1; k <= n; k++)
+        {
+            Queue &                     q = *queues_[(self + k) % n];
+            std::lock_guard<std::mutex> lock(q.mutex_);
+            if (!q.tasks_.empty())
+            {
+                task = std::move(q.tasks_.front());
+                q.tasks_.pop_front();
+                pending_--;
+                return true;
+            }
+        }
+        return false;
+    }
+    void run(const size_t i)
+    {
+        slot() = std::make_pair(this, i);
+        for (;;)
+        {
+            Task task;
+            if (take(i, task))
+            {
+                task();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stop_ || pending_ > 0; });
+            if (stop_ && pending_ == 0)
+                return;
+        }
+    }
+};
+
+// calls f(begin, end) over [0, count) in tiles of 'tile' items and returns when all of them are done.
+// the calling thread works on tiles too, so it is safe to call from inside a pool task.
+// tile boundaries depend only on count and tile, never on the number of threads, so the output is the same
+// for any pool as long as f writes disjoint ranges.
+template <typename F>
+static void forEach(ThreadPool &pool, const size_t count, size_t tile, F f)
+{
+    if (count == 0)
+        return;
+    tile               = std::max<size_t>(tile, 1);
+    const size_t tiles = (count + tile - 1) / tile;
+    if (tiles == 1)
+    {
+        f(size_t(0), count);
+        return;
+    }
+    std::atomic<size_t> remaining(tiles);
+    for (size_t t = 1; t < tiles; t++)
+    {
+        pool.submit([&f, &remaining, t, tile, count] {
+            f(t * tile, std::min(count, (t + 1) * tile));
+            remaining--;
+        });
+    }
+    f(size_t(0), tile);
+    remaining--;
+    while (remaining > 0)
+    {
+        if (!pool.runPending())
+            std::this_thread::yield();
+    }
+}
+
+// number of pixels that keeps a tile of 'stride' floats around 64KB.
+static inline size_t tileSize(const size_t stride) { return std::max<size_t>(1, 16384 / std::max<size_t>(stride, 1)); }
+
+// splits interleaved pixels into tiles and calls f(src, dst, n) on each, e.g.
+//   Parallel::pixels(pool, src, dst, count, 4, 4, [&](const float *s, float *d, size_t n) { p.apply(s, d, n, 4, 4); });
+template <typename F>
+static void pixels(ThreadPool &pool, const float *src, float *dst, const size_t count, const size_t srcStride,
+    const size_t dstStride, F f, const size_t tile = 0)
+{
+    forEach(pool, count, tile ? tile : tileSize(std::max(srcStride, dstStride)), [&](size_t begin, size_t end) {
+        f(src + begin * srcStride, dst + begin * dstStride, end - begin);
+    });
+}
+
+// same over the rows of an image, pitches in floats. f(srcRow, dstRow, width) is called once per row.
+template <typename F>
+static void image(ThreadPool &pool, const float *src, float *dst, const size_t width, const size_t height,
+    const size_t srcPitch, const size_t dstPitch, F f)
+{
+    forEach(pool, height, tileSize(std::max(srcPitch, dstPitch)), [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; y++)
+        {
+            f(src + y * srcPitch, dst + y * dstPitch, width);
+        }
+    });
+}
+} // namespace Parallel
+
+class MemoryStream
+{
+  public:
+    typedef size_t Pointer;
+    typedef enum
+    {
+        BUFFERBYTES = 1,
+        BUFFERBITS  = 8,
+    } PARAM;
+    typedef enum
+    {
+        TOP,
+        CURRENT,
+        END
+    } CURSOR;
+    typedef enum
+    {
+        LITTLE,
+        BIG,
+    } ENDIAN;
+
+  public:
+    MemoryStream() { init(); }
+    MemoryStream(const void *data,size_t sz){init(data,sz);}
+    std::vector<uint8_t>  buffer_;
+    std::vector<uint8_t> &buffer() { return buffer_; }
+
+    int     ptr_;
+    ENDIAN  readEndian_;
+    ENDIAN  writeEndian_;
+
+    void init(const void *data = NULL,size_t sz = 0)
+    {
+        if (data)
+        {
+            buffer_.resize(sz);
+            memcpy(&(buffer_.front()), data, sz);
+        }
+        else
+        {
+            buffer_.resize(sz);
+        }
+        ptr_         = 0;
+        readEndian_  = LITTLE;
+        writeEndian_ = LITTLE;
+    }
+
+    size_t  ftell(void) { return (size_t)ptr_; }
+    Pointer mark(void) { return ptr_; }
+    int     fseek(int offs, CURSOR cursor)
+    {
+        int ptr_p = ptr_;
+        switch (cursor)
+        {
+        case TOP:
+        {
+            ptr_ = offs;
+        }
+        break;
+        case CURRENT:
+        {
+            ptr_ += offs;
+        }
+        break;
+        case END:
+        {
+            ptr_ = (int)buffer_.size() - offs - 1;
+        }
+        break;
+        }
+        assert(ptr_ >= 0);
+        assert(ptr_ <= buffer_.size());
+        return ptr_;
+    }
+
+    void seekTo(Pointer p) { fseek((int)p, TOP); }
+
+    void *ptr(void) { return (void *)&(buffer_[ptr_]); }
+    void *ptr(Pointer p) { return (void *)&(buffer_[p]); }
+    bool  feof(void) { return ptr_ >= buffer_.size(); }
+
+    // read absolute.
+    uint8_t get_at(size_t abs)
+    {
+        if (abs < buffer_.size())
+            return buffer_[abs];
+        return 0;
+    }
+    void put_at(size_t abs, uint8_t val)
+    {
+        if (abs < buffer_.size())
+            buffer_.resize(abs);
+        buffer_[abs] = val;
+    }
+    size_t read_at(void *buffer, size_t s, Pointer p)
+    {
+        int r      = (int)buffer_.size() - (int)p;
+        if( r < 0 )
+            return 0;
+        size_t remain = (s < r) ? s : r;
+        memcpy(buffer, ptr(p), remain);
+        return remain;
+    }
+    size_t write_at(const void *buffer, size_t s, Pointer p)
+    {
+        size_t s1 = buffer_.size();
+        size_t s2 = p + s;
+        if (s2 > s1)
+            buffer_.resize(s2);
+        memcpy(ptr(p), buffer, s);
+        return s;
+    }
+    size_t read(void *buffer, size_t size)
+    {
+        size_t sz = read_at(buffer, size, ptr_);
+        ptr_ += (int)sz;
+        return sz;
+    }
+    size_t write(const void *buffer, size_t size)
+    {
+        size_t s = size;
+        write_at(buffer, s, ptr_);
+        ptr_ += (int)s;
+        return s;
+    }
+    uint8_t getUint8(void)
+    {
+        if (ptr_ < buffer_.size())
+        {
+            uint8_t c = buffer_[ptr_];
+            ptr_++;
+            return c;
+        }
+        return 0;
+    }
+    void putUint8(const uint8_t uc)
+    {
+        size_t s = buffer_.size();
+        if (ptr_ < s)
+        {
+            buffer_[ptr_] = uc;
+            return;
+        }
+        else if (ptr_ == s)
+        {
+            buffer_.push_back(uc);
+            ptr_++;
+            return;
+        }
+        assert(false);
+    }
+    void setReadEndian(const ENDIAN e) { readEndian_ = e; }
+    void setWriteEndian(const ENDIAN e) { writeEndian_ = e; }
+    const int8_t getInt8(void)
+    {
+        uint8_t uc = getUint8();
+        return *(int8_t *)&uc;
+    }
+    const uint16_t getUint16(void)
+    {
+        uint8_t a = getUint8();
+        uint8_t b = getUint8();
+        return (readEndian_ == BIG) ? ((a << 8) | b) : ((b << 8) | a);
+    }
+    const int16_t getInt16(void)
+    {
+        uint8_t a = getUint8();
+        uint8_t b = getUint8();
+        return (readEndian_ == BIG) ? ((*(int8_t *)&a << 8) | b) : ((*(int8_t *)&b << 8) | a);
+    }
+    const uint32_t getUint32(void)
+    {
+        uint16_t a = getUint16();
+        uint16_t b = getUint16();
+        return (readEndian_ == BIG) ? ((a << 16) | b) : ((b << 16) | a);
+    }
+    const int32_t getInt32(void)
+    {
+        uint16_t a = getUint16();
+        uint16_t b = getUint16();
+        return (readEndian_ == BIG) ? ((*(int16_t *)&a << 16) | b) : ((*(int16_t *)&b << 16) | a);
+    }
+    const uint64_t getUint64(void)
+    {
+        uint64_t lo, hi;
+        if (readEndian_ == BIG)
+        {
+            hi = getUint32();
+            lo = getUint32();
+        }
+        else
+        {
+            lo = getUint32();
+            hi = getUint32();
+        }
+        return (lo | hi << 32);
+    }
+    const int64_t getInt64(void)
+    {
+        uint64_t lo;
+        int64_t  hi;
+        if (readEndian_ == BIG)
+        {
+            hi = getInt32();
+            lo = getUint32();
+        }
+        else
+        {
+            lo = getUint32();
+            hi = getInt32();
+        }
+        return (lo | hi << 32);
+    }
+    const float getFloat(void)
+    {
+        union
+        {
+            uint32_t ui;
+            float     f;
+        } x;
+        x.ui = getUint32();
+        return x.f;
+    }
+    const double getDouble(void)
+    {
+        union
+        {
+            uint64_t ull;
+            double   f;
+        } x;
+        x.ull = getUint64();
+        return x.f;
+    }
+    const std::string getSubstr(int len)
+    {
+        std::string str;
+        for (int i = 0; i < len - 1; i++)
+        {
+            uint8_t uc = getUint8();
+            str.push_back(uc);
+        }
+        if (len > 0)
+            getUint8();
+        return str;
+    }
+    const std::string get_string(void)
+    {
+        int len = getUint32();
+        if (len > 0)
+            return getSubstr(len);
+        return "";
+    }
+
+    void align(int a)
+    {
+        size_t s = ftell();
+        int m = (a - (s % a)) % a;
+        fseek(m, CURRENT);
+    }
+    Pointer getPointer32(void)
+    {
+        Pointer p = getUint32();
+        return p;
+    }
+    Pointer putPointer32(void)
+    {
+        Pointer p = mark();
+        putUint32(0);
+        return p;
+    }
+    Pointer getPointer64(void)
+    {
+        Pointer p = getUint64();
+        return p;
+    }
+    Pointer putPointer64(void)
+    {
+        Pointer p = mark();
+        putUint64(0);
+        return p;
+    }
+
+    void adjustPointer32(Pointer p)
+    {
+        uint32_t ui  = (uint32_t)buffer_.size();
+        uint8_t  uc0 = ui & 0xFF;
+        ui >>= 8;
+        uint8_t uc1 = ui & 0xFF;
+        ui >>= 8;
+        uint8_t uc2 = ui & 0xFF;
+        ui >>= 8;
+        uint8_t uc3 = ui & 0xFF;
+        if (writeEndian_ == BIG)
+        {
+            buffer_[p]     = uc3;
+            buffer_[p + 1] = uc2;
+            buffer_[p + 2] = uc1;
+            buffer_[p + 3] = uc0;
+        }
+        else
+        {
+            buffer_[p]     = uc0;
+            buffer_[p + 1] = uc1;
+            buffer_[p + 2] = uc2;
+            buffer_[p + 3] = uc3;
+        }
+    }
+    void adjustPointer64(Pointer p)
+    {
+        uint64_t ui  = buffer_.size();
+        uint8_t  uc0 = ui & 0xFF;
+        ui >>= 8;
+        uint8_t uc1 = ui & 0xFF;
+        ui >>= 8;
+        uint8_t uc2 = ui & 0xFF;
+        ui >>= 8;
+        uint8_t uc3 = ui & 0xFF;
+        ui >>= 8;
+        uint8_t uc4 = ui & 0xFF;
+        ui >>= 8;
+        uint8_t uc5 = ui & 0xFF;
+        ui >>= 8;
+        uint8_t uc6 = ui & 0xFF;
+        ui >>= 8;
+        uint8_t uc7 = ui & 0xFF;
+        if (writeEndian_ == BIG)
+        {
+            buffer_[p]     = uc7;
+            buffer_[p + 1] = uc6;
+            buffer_[p + 2] = uc5;
+            buffer_[p + 3] = uc4;
+            buffer_[p + 4] = uc3;
+            buffer_[p + 5] = uc2;
+            buffer_[p + 6] = uc1;
+            buffer_[p + 7] = uc0;
+        }
+        else
+        {
+            buffer_[p]     = uc0;
+            buffer_[p + 1] = uc1;
+            buffer_[p + 2] = uc2;
+            buffer_[p + 3] = uc3;
+            buffer_[p + 4] = uc4;
+            buffer_[p + 5] = uc5;
+            buffer_[p + 6] = uc6;
+            buffer_[p + 7] = uc7;
+        }
+    }
+
+    void putInt8(const int8_t v) { putUint8(*(uint8_t *)&v); }
+    void putUint16(const uint16_t u)
+    {
+        if (writeEndian_ == BIG)
+        {
+            putUint8((u >> 8) & 0xFF);
+            putUint8(u & 0xFF);
+        }
+        else
         {
-            return Tristimulus(sRGB_to_Y(screen[0]), sRGB_to_Y(screen[1]), sRGB_to_Y(screen[2]));
+            // LE
+            putUint8(u & 0xFF);
+            putUint8((u >> 8) & 0xFF);
         }
-        break;
-        case BT709:
+    }
+    void putInt16(const int16_t u)
+    {
+        if (writeEndian_ == BIG)
         {
-            return Tristimulus(BT709_to_Y(screen[0]), BT709_to_Y(screen[1]), BT709_to_Y(screen[2]));
+            putInt8((u >> 8) & 0xFF);
+            putUint8(u & 0xFF);
         }
-        break;
-        case ST2084:
+        else
         {
-            return Tristimulus(ST2084_to_Y(screen[0]), ST2084_to_Y(screen[1]), ST2084_to_Y(screen[2]));
+            // LE
+            putUint8(u & 0xFF);
+            putInt8((u >> 8) & 0xFF);
         }
-        case SLOG2:
+    }
+    void putUint32(const uint32_t u)
+    {
+        if (writeEndian_ == BIG)
         {
-            return Tristimulus(SLog2_to_Y(screen[0]), SLog2_to_Y(screen[1]), SLog2_to_Y(screen[2]));
+            putUint16((u >> 16) & 0xFFFF);
+            putUint16(u & 0xFFFF);
         }
-        case HLG:
+        else
         {
-            return Tristimulus(HLG_to_Y(screen[0]), HLG_to_Y(screen[1]), HLG_to_Y(screen[2]));
+            putUint16(u & 0xFFFF);
+            putUint16((u >> 16) & 0xFFFF);
         }
-        break;
-        case LINEAR:
-        default:
-            return screen;
+    }
+    void putInt32(const int32_t u)
+    {
+        if (writeEndian_ == BIG)
+        {
+            putInt16((u >> 16) & 0xFFFF);
+            putUint16(u & 0xFFFF);
+        }
+        else
+        {
+            putUint16(u & 0xFFFF);
+            putInt16((u >> 16) & 0xFFFF);
+        }
+    }
+
+    void putUint64(const uint64_t v)
+    {
+        if (writeEndian_ == BIG)
+        {
+            putUint32(v >> 32);
+            putUint32(v & 0xFFFFFFFF);
+        }
+        else
+        {
+            putUint32(v & 0xFFFFFFFF);
+            putUint32(v >> 32);
+        }
+    }
+    void putInt64(const int64_t v)
+    {
+        if (writeEndian_ == BIG)
+        {
+            putInt32(v >> 32);
+            putUint32(v & 0xFFFFFFFF);
+        }
+        else
+        {
+            putUint32(v & 0xFFFFFFFF);
+            putInt32(v >> 32);
+        }
+    }
+    void putFloat(const float v) { putUint32(*(uint32_t *)&v); } // endian henkan is done by uint.
+    void putDouble(const double v) { putUint64(*(uint64_t *)&v); }
+    void putSubstr(const std::string &str, size_t len)
+    {
+        for (int i = 0; i < len - 1; i++)
+        {
+            putUint8(str[i]);
         }
+        if (len > 0)
+            putUint8(0);
     }
+    void putString(const std::string &str) { putSubstr(str, str.size()); }
 };
 
-class MemoryStream
+// read-only stream over memory owned by the caller (a file image, an mmap'd file...). nothing is copied, so the
+// memory has to outlive the view. reads past the end give 0 like MemoryStream, array reads say how much they got.
+class MemoryStreamView
 {
   public:
-    typedef size_t Pointer;
-    typedef enum
+    typedef MemoryStream::Pointer Pointer;
+    typedef MemoryStream::CURSOR  CURSOR;
+    typedef MemoryStream::ENDIAN  ENDIAN;
+
+    const uint8_t *data_;
+    size_t         size_;
+    size_t         ptr_;
+    ENDIAN         readEndian_;
+
+    MemoryStreamView(const void *data = NULL, const size_t size = 0)
+        : data_((const uint8_t *)data), size_(data ? size : 0), ptr_(0), readEndian_(MemoryStream::LITTLE)
     {
-        BUFFERBYTES = 1,
-        BUFFERBITS  = 8,
-    } PARAM;
-    typedef enum
+        ;
+    }
+    MemoryStreamView(const MemoryStream &stream)
+        : data_(stream.buffer_.data()), size_(stream.buffer_.size()), ptr_(0), readEndian_(stream.readEndian_)
     {
-        TOP,
-        CURRENT,
-        END
-    } CURSOR;
-    typedef enum
+        ;
+    }
+    // length bytes from offset, clamped to this view. the cursor and endian of the new view start fresh.
+    MemoryStreamView sub(const size_t offset, const size_t length) const
     {
-        LITTLE,
-        BIG,
-    } ENDIAN;
+        const size_t o = (offset < size_) ? offset : size_;
+        const size_t l = (length < size_ - o) ? length : size_ - o;
+        MemoryStreamView v(data_ + o, l);
+        v.readEndian_ = readEndian_;
+        return v;
+    }
 
-  public:
-    MemoryStream() { init(); }
-    MemoryStream(const void *data,size_t sz){init(data,sz);}
-    std::vector<uint8_t>  buffer_;
-    std::vector<uint8_t> &buffer() { return buffer_; }
+    const uint8_t *data(void) const { return data_; }
+    size_t         size(void) const { return size_; }
+    size_t         remain(void) const { return (ptr_ < size_) ? size_ - ptr_ : 0; }
+    size_t         ftell(void) const { return ptr_; }
+    Pointer        mark(void) const { return ptr_; }
+    bool           feof(void) const { return ptr_ >= size_; }
+    void           seekTo(const Pointer p) { ptr_ = p; }
+    size_t         fseek(const long offs, const CURSOR cursor)
+    {
+        switch (cursor)
+        {
+        case MemoryStream::TOP:
+            ptr_ = offs;
+            break;
+        case MemoryStream::CURRENT:
+            ptr_ += offs;
+            break;
+        case MemoryStream::END:
+            ptr_ = size_ - offs - 1;
+            break;
+        }
+        return ptr_;
+    }
+    const void *ptr(void) const { return data_ + ptr_; }
+    void        setReadEndian(const ENDIAN e) { readEndian_ = e; }
 
-    int     ptr_;
-    ENDIAN  readEndian_;
-    ENDIAN  writeEndian_;
+    // single loads. shifts of bytes are what compilers turn into one load plus a byte swap.
+    static uint16_t loadBE16(const uint8_t *p) { return (uint16_t)((p[0] << 8) | p[1]); }
+    static uint16_t loadLE16(const uint8_t *p) { return (uint16_t)((p[1] << 8) | p[0]); }
+    static uint32_t loadBE32(const uint8_t *p)
+    {
+        return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+    }
+    static uint32_t loadLE32(const uint8_t *p)
+    {
+        return ((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16) | ((uint32_t)p[1] << 8) | (uint32_t)p[0];
+    }
 
-    void init(const void *data = NULL,size_t sz = 0)
+    size_t read_at(void *buffer, const size_t s, const Pointer p) const
     {
-        if (data)
+        if (p >= size_)
+            return 0;
+        const size_t n = (s < size_ - p) ? s : size_ - p;
+        memcpy(buffer, data_ + p, n);
+        return n;
+    }
+    size_t read(void *buffer, const size_t s)
+    {
+        const size_t n = read_at(buffer, s, ptr_);
+        ptr_ += n;
+        return n;
+    }
+    uint8_t getUint8(void) { return (ptr_ < size_) ? data_[ptr_++] : (ptr_++, 0); }
+    int8_t  getInt8(void) { return (int8_t)getUint8(); }
+    uint16_t getUint16(void)
+    {
+        uint16_t v = 0;
+        if (remain() >= 2)
+            v = (readEndian_ == MemoryStream::BIG) ? loadBE16(data_ + ptr_) : loadLE16(data_ + ptr_);
+        ptr_ += 2;
+        return v;
+    }
+    int16_t  getInt16(void) { return (int16_t)getUint16(); }
+    uint32_t getUint32(void)
+    {
+        uint32_t v = 0;
+        if (remain() >= 4)
+            v = (readEndian_ == MemoryStream::BIG) ? loadBE32(data_ + ptr_) : loadLE32(data_ + ptr_);
+        ptr_ += 4;
+        return v;
+    }
+    int32_t  getInt32(void) { return (int32_t)getUint32(); }
+    uint64_t getUint64(void)
+    {
+        const uint64_t a = getUint32();
+        const uint64_t b = getUint32();
+        return (readEndian_ == MemoryStream::BIG) ? (a << 32 | b) : (b << 32 | a);
+    }
+    int64_t getInt64(void) { return (int64_t)getUint64(); }
+    float   getFloat(void)
+    {
+        const uint32_t u = getUint32();
+        float          f;
+        memcpy(&f, &u, sizeof(f));
+        return f;
+    }
+    double getDouble(void)
+    {
+        const uint64_t u = getUint64();
+        double         d;
+        memcpy(&d, &u, sizeof(d));
+        return d;
+    }
+    // ICC fixed point, 16.16 signed.
+    float getS15Fixed16(void) { return getInt32() / 65536.f; }
+
+    // bulk reads in the read endian. values past the end are zero filled, the return value is how many were there.
+    size_t getUint16Array(uint16_t *dst, const size_t count)
+    {
+        const size_t   n = std::min(count, remain() / 2);
+        const uint8_t *p = data_ + ptr_;
+        if (readEndian_ == MemoryStream::BIG)
         {
-            buffer_.resize(sz);
-            memcpy(&(buffer_.front()), data, sz);
+            for (size_t i = 0; i < n; i++)
+                dst[i] = loadBE16(p + i * 2);
         }
         else
         {
-            buffer_.resize(sz);
+            for (size_t i = 0; i < n; i++)
+                dst[i] = loadLE16(p + i * 2);
         }
-        ptr_         = 0;
-        readEndian_  = LITTLE;
-        writeEndian_ = LITTLE;
+        std::fill(dst + n, dst + count, (uint16_t)0);
+        ptr_ += count * 2;
+        return n;
+    }
+    size_t getUint32Array(uint32_t *dst, const size_t count)
+    {
+        const size_t   n = std::min(count, remain() / 4);
+        const uint8_t *p = data_ + ptr_;
+        if (readEndian_ == MemoryStream::BIG)
+        {
+            for (size_t i = 0; i < n; i++)
+                dst[i] = loadBE32(p + i * 4);
+        }
+        else
+        {
+            for (size_t i = 0; i < n; i++)
+                dst[i] = loadLE32(p + i * 4);
+        }
+        std::fill(dst + n, dst + count, 0u);
+        ptr_ += count * 4;
+        return n;
+    }
+    size_t getS15Fixed16Array(float *dst, const size_t count)
+    {
+        const size_t   n = std::min(count, remain() / 4);
+        const uint8_t *p = data_ + ptr_;
+        if (readEndian_ == MemoryStream::BIG)
+        {
+            for (size_t i = 0; i < n; i++)
+                dst[i] = (int32_t)loadBE32(p + i * 4) / 65536.f;
+        }
+        else
+        {
+            for (size_t i = 0; i < n; i++)
+                dst[i] = (int32_t)loadLE32(p + i * 4) / 65536.f;
+        }
+        std::fill(dst + n, dst + count, 0.f);
+        ptr_ += count * 4;
+        return n;
+    }
+    // 16bit values scaled to 0-1, the usual form of curve and LUT tables.
+    size_t getUnorm16Array(float *dst, const size_t count)
+    {
+        const size_t   n = std::min(count, remain() / 2);
+        const uint8_t *p = data_ + ptr_;
+        if (readEndian_ == MemoryStream::BIG)
+        {
+            for (size_t i = 0; i < n; i++)
+                dst[i] = loadBE16(p + i * 2) * (1.f / 65535.f);
+        }
+        else
+        {
+            for (size_t i = 0; i < n; i++)
+                dst[i] = loadLE16(p + i * 2) * (1.f / 65535.f);
+        }
+        std::fill(dst + n, dst + count, 0.f);
+        ptr_ += count * 2;
+        return n;
     }
+};
 
-    size_t  ftell(void) { return (size_t)ptr_; }
-    Pointer mark(void) { return ptr_; }
-    int     fseek(int offs, CURSOR cursor)
+// read-only file contents, mmap'd where there is mmap and read into memory elsewhere.
+class MappedFile
+{
+  public:
+    explicit MappedFile(const char *path) : data_(NULL), size_(0), mapped_(false)
     {
-        int ptr_p = ptr_;
-        switch (cursor)
+#if defined(COLORSYSTEM_MMAP)
+        const int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0)
         {
-        case TOP:
+            void *p = ::mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED)
+            {
+                data_   = (const uint8_t *)p;
+                size_   = (size_t)st.st_size;
+                mapped_ = true;
+            }
+        }
+        ::close(fd);
+#else
+        FILE *fp = fopen(path, "rb");
+        if (fp == NULL)
+            return;
+        if (fseek(fp, 0, SEEK_END) == 0)
         {
-            ptr_ = offs;
+            const long s = ::ftell(fp);
+            if (s > 0 && fseek(fp, 0, SEEK_SET) == 0)
+            {
+                copy_.resize((size_t)s);
+                if (fread(copy_.data(), 1, copy_.size(), fp) == copy_.size())
+                {
+                    data_ = copy_.data();
+                    size_ = copy_.size();
+                }
+            }
         }
-        break;
-        case CURRENT:
+        fclose(fp);
+#endif
+    }
+    ~MappedFile()
+    {
+#if defined(COLORSYSTEM_MMAP)
+        if (mapped_)
+            ::munmap((void *)data_, size_);
+#endif
+    }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool             valid(void) const { return data_ != NULL; }
+    bool             mapped(void) const { return mapped_; }
+    const uint8_t *  data(void) const { return data_; }
+    size_t           size(void) const { return size_; }
+    MemoryStreamView view(void) const { return MemoryStreamView(data_, size_); }
+
+  private:
+    const uint8_t *      data_;
+    size_t               size_;
+    bool                 mapped_;
+    std::vector<uint8_t> copy_;
+};
+
+
+class Spectrum
+{
+  public:
+    typedef std::array<float, 400> spectrum; // 380-780, 1nm, fixed.
+    spectrum                       s_;
+
+    constexpr Spectrum() : s_{} { ; }
+    constexpr Spectrum(const spectrum &s) : s_(s) { ; }
+    static constexpr float lerp(const float a, const float b, const float r) { return a * (1 - r) + b * r; }
+    static constexpr float fetch(
+        const float *sample, const int samples, const float &lo, const float &hi, const float &t)
+    {
+        const int   count = samples - 1;
+        const int   index = (int)(count * (t - lo) / (hi - lo));
+        const float l     = index * (hi - lo) / count;
+        const float h     = (index + 1) * (hi - lo) / count;
+        return (index >= count)
+                   ? sample[count]
+                   : (index <= 0) ? sample[0] : lerp(sample[index], sample[index + 1], (t - l - lo) / (h - l));
+    }
+    constexpr float fetch(const float &lambda) const { return fetch(s_.data(), 400, 380.f, 779.f, lambda); }
+
+    Spectrum(const float *sample, const int samples = 400, const float &lo = 380.f, const float &hi = 779.f)
+    {
+        for (int i = 0; i < 400; i++)
+        {
+            s_[i] = fetch(sample, samples, lo, hi, 380.f + i);
+        }
+    }
+    constexpr float operator[](const int i) const { return s_[i]; }
+
+    const spectrum &s(void) const { return s_; }
+
+    static const double planck(const double &T, // temperature (Kelvin)
+        const double &                       l)                        // wavelength (meter)
+    {
+        static const double h    = 6.62606896e-34; // Plank constant         J s
+        static const double c    = 2.99792458e+8;  // Speed of light         m/s
+        static const double k    = 1.38064880e-23; // Boltzmann constant     J/K
+        static const double hc   = 1.984832809e-25;
+        static const double hcc  = 5.950379064e-17;
+        static const double hc_k = 1.438776827e-2;
+        static const double arg1 = 2 * hcc;                                     // J*s*m/s*m/s                 = J*m^2/s
+        static const double arg2 = (h * c) / k;                                 // J*s*m/s / (J/K) = J*m/(J/K) = m * K
+        return (float)(arg1 * pow(l, -5) / (exp(hc_k / (l * T)) - 1.0)) / 1e9f; // in W/m^3 sr
+    }
+
+    static const Spectrum blackbody(const float temp)
+    {
+        spectrum s;
+        for (int i = 0; i < 400; i++)
         {
-            ptr_ += offs;
+            s[i] = (float)planck(temp, (double)(380.f + i) * 1e-9);
         }
-        break;
-        case END:
+        return Spectrum(s);
+    }
+    static const Spectrum E(const float e = 1.f)
+    {
+        spectrum s;
+        for (int i = 0; i < 400; i++)
         {
-            ptr_ = (int)buffer_.size() - offs - 1;
-        }
-        break;
+            s[i] = e;
         }
-        assert(ptr_ >= 0);
-        assert(ptr_ <= buffer_.size());
-        return ptr_;
+        return Spectrum(s);
     }
-
-    void seekTo(Pointer p) { fseek((int)p, TOP); }
-
-    void *ptr(void) { return (void *)&(buffer_[ptr_]); }
-    void *ptr(Pointer p) { return (void *)&(buffer_[p]); }
-    bool  feof(void) { return ptr_ >= buffer_.size(); }
-
-    // read absolute.
-    uint8_t get_at(size_t abs)
+    static const Spectrum mul(const Spectrum &a, const Spectrum &b)
     {
-        if (abs < buffer_.size())
-            return buffer_[abs];
-        return 0;
+        spectrum s;
+        for (int i = 0; i < 400; i++)
+        {
+            s[i] = a[i] * b[i];
+        }
+        return Spectrum(s);
     }
-    void put_at(size_t abs, uint8_t val)
+    static const Spectrum add(const Spectrum &a, const Spectrum &b)
     {
-        if (abs < buffer_.size())
-            buffer_.resize(abs);
-        buffer_[abs] = val;
+        spectrum s;
+        for (int i = 0; i < 400; i++)
+        {
+            s[i] = a[i] + b[i];
+        }
+        return Spectrum(s);
     }
-    size_t read_at(void *buffer, size_t s, Pointer p)
+    const Spectrum         operator*(const Spectrum &b) const { return mul(*this, b); }
+    const Spectrum         operator+(const Spectrum &b) const { return add(*this, b); }
+    static constexpr float sumHelper(const Spectrum &a, const int i)
     {
-        int r      = (int)buffer_.size() - (int)p;
-        if( r < 0 )
-            return 0;
-        size_t remain = (s < r) ? s : r;
-        memcpy(buffer, ptr(p), remain);
-        return remain;
+        return (i > 0) ? sumHelper(a, i - 1) + a[i] : a[0];
     }
-    size_t write_at(const void *buffer, size_t s, Pointer p)
+    static constexpr float sum(const Spectrum &a) { return sumHelper(a, 399); }
+    constexpr float        sum() const { return sum(*this); }
+    static constexpr float dotHelper(const Spectrum &a, const Spectrum &b, const int i)
     {
-        size_t s1 = buffer_.size();
-        size_t s2 = p + s;
-        if (s2 > s1)
-            buffer_.resize(s2);
-        memcpy(ptr(p), buffer, s);
-        return s;
+        return (i > 0) ? a[i] * b[i] + dotHelper(a, b, i - 1) : a[0] * b[0];
     }
-    size_t read(void *buffer, size_t size)
+    static constexpr float dot(const Spectrum &a, const Spectrum &b) { return dotHelper(a, b, 399); }
+    constexpr float        dot(const Spectrum &s) const { return dotHelper(*this, s, 399); }
+    static constexpr float dotHelper3(const Spectrum &a, const Spectrum &b, const Spectrum &c, const int i)
     {
-        size_t sz = read_at(buffer, size, ptr_);
-        ptr_ += (int)sz;
-        return sz;
+        return (i > 0) ? a[i] * b[i] * c[i] + dotHelper3(a, b, c, i - 1) : a[0] * b[0] * c[0];
     }
-    size_t write(const void *buffer, size_t size)
+    static constexpr float dot3(const Spectrum &a, const Spectrum &b, const Spectrum &c)
     {
-        size_t s = size;
-        write_at(buffer, s, ptr_);
-        ptr_ += (int)s;
-        return s;
+        return dotHelper3(a, b, c, 399);
     }
-    uint8_t getUint8(void)
-    {
-        if (ptr_ < buffer_.size())
+};
+
+// standard illuminants
+static constexpr Tristimulus Illuminant_A(1.09850f, 1.f, 0.35585f);
+static constexpr Tristimulus Illuminant_B(1.99072f, 1.f, 0.85223f);
+static constexpr Tristimulus Illuminant_C(0.98074f, 1.0f, 1.18232f);
+static constexpr Tristimulus Illuminant_D50(0.96422f, 1.0f, 0.82521f);
+static constexpr Tristimulus Illuminant_D55(0.95682f, 1.0f, 0.92149f);
+static constexpr Tristimulus Illuminant_D60(0.95265f, 1.0f, 1.00883f); // by ACES TB-2014-004.pdf
+static constexpr Tristimulus Illuminant_D65(0.95047f, 1.0f, 1.08883f);
+static constexpr Tristimulus Illuminant_D75(0.94972f, 1.0f, 1.22638f);
+static constexpr Tristimulus Illuminant_E(1.f, 1.f, 1.f);
+static constexpr Tristimulus Illuminant_F2(0.99186f, 1.f, 0.67393f);
+static constexpr Tristimulus Illuminant_F7(0.95041f, 1.f, 1.08747f);
+static constexpr Tristimulus Illuminant_F11(1.00962f, 1.f, 0.64350f);
+
+// xR,yR,xG,yG,xB,yB,xW,yW
+static constexpr Gamut AdobeRGB("AdobeRGB", 0.64f, 0.33f, 0.21f, 0.71f, 0.15f, 0.06f, 0.3127f, 0.3290f);
+static constexpr Gamut Rec709("Rec.709", 0.64f, 0.33f, 0.30f, 0.60f, 0.15f, 0.06f, 0.3127f, 0.3290f);
+static constexpr Gamut Rec2020("Rec.2020", 0.708f, 0.292f, 0.17f, 0.797f, 0.131f, 0.046f, 0.3127f, 0.3290f);
+static constexpr Gamut DCI_P3("DCI P3", 0.68f, 0.32f, 0.265f, 0.69f, 0.15f, 0.06f, 0.314f, 0.351f);
+static constexpr Gamut S_Gamut("S-Gamut", 0.73f, 0.28f, 0.14f, 0.855f, 0.10f, -0.05f, 0.3127f, 0.3290f);
+static constexpr Gamut S_Gamut3_Cine(
+    "S-Gamut3.Cine", 0.766f, 0.275f, 0.225f, 0.800f, 0.089f, -0.087f, 0.3127f, 0.3290f);
+static constexpr Gamut ACEScg("ACES cg", 0.713f, 0.293f, 0.165f, 0.830f, 0.128f, 0.044f, 0.32168f, 0.33767f);     // AP1
+static constexpr Gamut ACES2065("ACES 2065", 0.73470f, 0.26530f, 0.f, 1.f, 0.0001f, -0.077f, 0.32168f, 0.33767f); // AP0
+static constexpr Gamut LMS("LMS",
+    Matrix3(0.8951f, 0.2664f, -0.1614f, -0.7502f, 1.7135f, 0.0367f, 0.0389f, -0.0685f, 1.0296f)); // fromXYZ matrix.
+static constexpr Gamut XYZ("XYZ", Matrix3(1, 0, 0, 0, 1, 0, 0, 0, 1));
+
+// returns Gamut convert matrix
+static constexpr Matrix3 GamutConvert(const Gamut &src, const Gamut &dst) { return dst.fromXYZ().mul(src.toXYZ()); }
+// converts interleaved pixels from src gamut to dst gamut in one pass.
+static inline void GamutConvert(const Gamut &src, const Gamut &dst, const float *srcPixels, float *dstPixels,
+    const size_t count, const size_t srcStride = 3, const size_t dstStride = 3)
+{
+    GamutConvert(src, dst).apply(srcPixels, dstPixels, count, srcStride, dstStride);
+}
+static inline void GamutConvert(const Gamut &src, const Gamut &dst, const half *srcPixels, half *dstPixels,
+    const size_t count, const size_t srcStride = 3, const size_t dstStride = 3)
+{
+    GamutConvert(src, dst).apply(srcPixels, dstPixels, count, srcStride, dstStride);
+}
+
+// a conversion known at build time: the gamut matrix is folded by the compiler and the curves are picked by type,
+// so the loop has no dispatch left and inlines completely. same units and curves as Pipeline, M is the math backend
+// (Math::Exact or Math::Fast), e.g.
+//   Convert<Rec709, Rec2020, OTF::SRGB, OTF::ST2084>::apply(src, dst, count);
+template <const Gamut &Src, const Gamut &Dst, OTF::TYPE In = OTF::LINEAR, OTF::TYPE Out = OTF::LINEAR,
+    typename M = Math::Fast>
+class Convert
+{
+  public:
+    static constexpr Matrix3 matrix(void) { return GamutConvert(Src, Dst); }
+
+    // one color, or 4 with T = SIMD::float4.
+    template <typename T>
+    static TristimulusT<T> apply(const TristimulusT<T> &t)
+    {
+        constexpr Matrix3     m = matrix();
+        const Matrix3T<T>     mt(m);
+        typedef OTF::Curves<M> C;
+        const TristimulusT<T> linear(C::template toScene<In>(t[0]), C::template toScene<In>(t[1]),
+            C::template toScene<In>(t[2]));
+        const TristimulusT<T> out(linear.apply(mt));
+        return TristimulusT<T>(C::template toScreen<Out>(out[0]), C::template toScreen<Out>(out[1]),
+            C::template toScreen<Out>(out[2]));
+    }
+    // pixels are split into planes 64 at a time so the packs load straight from memory.
+    static void apply(
+        const float *src, float *dst, const size_t count, const size_t srcStride = 3, const size_t dstStride = 3)
+    {
+        alignas(16) float p[3][64];
+        for (size_t i = 0; i < count; i += 64)
         {
-            uint8_t c = buffer_[ptr_];
-            ptr_++;
-            return c;
+            const size_t n = std::min<size_t>(64, count - i);
+            for (size_t j = 0; j < n; j++)
+            {
+                p[0][j] = src[(i + j) * srcStride + 0];
+                p[1][j] = src[(i + j) * srcStride + 1];
+                p[2][j] = src[(i + j) * srcStride + 2];
+            }
+            for (size_t j = n; j % 4; j++)
+            {
+                p[0][j] = p[1][j] = p[2][j] = 0.f;
+            }
+            for (size_t j = 0; j < n; j += 4)
+            {
+                const TristimulusT<SIMD::float4> t = apply(TristimulusT<SIMD::float4>(
+                    SIMD::float4::load(p[0] + j), SIMD::float4::load(p[1] + j), SIMD::float4::load(p[2] + j)));
+                t[0].store(p[0] + j);
+                t[1].store(p[1] + j);
+                t[2].store(p[2] + j);
+            }
+            for (size_t j = 0; j < n; j++)
+            {
+                dst[(i + j) * dstStride + 0] = p[0][j];
+                dst[(i + j) * dstStride + 1] = p[1][j];
+                dst[(i + j) * dstStride + 2] = p[2][j];
+            }
         }
-        return 0;
     }
-    void putUint8(const uint8_t uc)
+};
+
+// von Kries style chromatic adaptation: XYZ goes to the method's cone space, is scaled by the ratio of the two
+// whites there and comes back. D is the degree of adaptation, 1 for full, 0 for none, in between the gain is
+// D * dst / src + 1 - D per cone as in CIECAM02.
+class ChromaticAdaptation
+{
+  public:
+    typedef enum
     {
-        size_t s = buffer_.size();
-        if (ptr_ < s)
-        {
-            buffer_[ptr_] = uc;
-            return;
-        }
-        else if (ptr_ == s)
+        BRADFORD,
+        CAT02,
+        CAT16,
+        VON_KRIES, // Hunt-Pointer-Estevez
+        XYZ_SCALING,
+    } METHOD;
+
+    // XYZ to cone response.
+    static constexpr Matrix3 cone(const METHOD method)
+    {
+        switch (method)
         {
-            buffer_.push_back(uc);
-            ptr_++;
-            return;
+        case BRADFORD:
+            return LMS.fromXYZ();
+        case CAT02:
+            return Matrix3(0.7328f, 0.4296f, -0.1624f, -0.7036f, 1.6975f, 0.0061f, 0.0030f, 0.0136f, 0.9834f);
+        case CAT16:
+            return Matrix3(
+                0.401288f, 0.650173f, -0.051461f, -0.250268f, 1.204414f, 0.045854f, -0.002079f, 0.048952f, 0.953127f);
+        case VON_KRIES:
+            return Matrix3(0.40024f, 0.70760f, -0.08081f, -0.22630f, 1.16532f, 0.04570f, 0.f, 0.f, 0.91822f);
+        case XYZ_SCALING:
+        default:
+            return Matrix3(1, 0, 0, 0, 1, 0, 0, 0, 1);
         }
-        assert(false);
-    }
-    void setReadEndian(const ENDIAN e) { readEndian_ = e; }
-    void setWriteEndian(const ENDIAN e) { writeEndian_ = e; }
-    const int8_t getInt8(void)
-    {
-        uint8_t uc = getUint8();
-        return *(int8_t *)&uc;
-    }
-    const uint16_t getUint16(void)
-    {
-        uint8_t a = getUint8();
-        uint8_t b = getUint8();
-        return (readEndian_ == BIG) ? ((a << 8) | b) : ((b << 8) | a);
     }
-    const int16_t getInt16(void)
+    static constexpr Matrix3 matrix(
+        const METHOD method, const Tristimulus &white_src, const Tristimulus &white_dst, const float D = 1.f)
     {
-        uint8_t a = getUint8();
-        uint8_t b = getUint8();
-        return (readEndian_ == BIG) ? ((*(int8_t *)&a << 8) | b) : ((*(int8_t *)&b << 8) | a);
+        const Matrix3     m(cone(method));
+        const Tristimulus src(m.apply(white_src.vec3()));
+        const Tristimulus dst(m.apply(white_dst.vec3()));
+        const Matrix3     scale(Matrix3::diag(Vector3(D * dst[0] / src[0] + 1.f - D, D * dst[1] / src[1] + 1.f - D,
+            D * dst[2] / src[2] + 1.f - D)));
+        return m.invert().mul(scale).mul(m);
     }
-    const uint32_t getUint32(void)
+
+    // memoized matrices, for per shot adaptation where the same few whites come back all the time.
+    // keys are the exact bits of (method, whites, D). the table is dropped when it reaches 'capacity'.
+    // only cached() goes through it, matrix() and Bradford() stay constexpr and compute on every call.
+    class Cache
     {
-        uint16_t a = getUint16();
-        uint16_t b = getUint16();
-        return (readEndian_ == BIG) ? ((a << 16) | b) : ((b << 16) | a);
-    }
-    const int32_t getInt32(void)
+      public:
+        Cache(const size_t capacity = 256) : capacity_(capacity) { ; }
+        Matrix3 get(
+            const METHOD method, const Tristimulus &white_src, const Tristimulus &white_dst, const float D = 1.f)
+        {
+            const float       k[] = {(float)method, white_src[0], white_src[1], white_src[2], white_dst[0],
+                white_dst[1], white_dst[2], D};
+            const std::string key((const char *)k, sizeof(k));
+            std::lock_guard<std::mutex> lock(mutex_);
+            const auto                  it = matrices_.find(key);
+            if (it != matrices_.end())
+                return it->second;
+            if (matrices_.size() >= capacity_)
+                matrices_.clear();
+            const Matrix3 m(matrix(method, white_src, white_dst, D));
+            matrices_.emplace(key, m);
+            return m;
+        }
+        size_t size(void)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return matrices_.size();
+        }
+        void clear(void)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            matrices_.clear();
+        }
+
+        // process-wide cache, created on first use.
+        static Cache &shared(void)
+        {
+            static Cache cache;
+            return cache;
+        }
+
+      private:
+        size_t                                   capacity_;
+        std::mutex                               mutex_;
+        std::unordered_map<std::string, Matrix3> matrices_;
+    };
+    static Matrix3 cached(
+        const METHOD method, const Tristimulus &white_src, const Tristimulus &white_dst, const float D = 1.f)
     {
-        uint16_t a = getUint16();
-        uint16_t b = getUint16();
-        return (readEndian_ == BIG) ? ((*(int16_t *)&a << 16) | b) : ((*(int16_t *)&b << 16) | a);
+        return Cache::shared().get(method, white_src, white_dst, D);
     }
-    const uint64_t getUint64(void)
-    {
-        uint64_t lo, hi;
-        if (readEndian_ == BIG)
+};
+
+// returns Bradford adaptation matrix, not cached. use ChromaticAdaptation::cached(BRADFORD, ...) at run time.
+static constexpr Matrix3 Bradford(const Tristimulus &white_src, const Tristimulus &white_dst)
+{
+    return ChromaticAdaptation::matrix(ChromaticAdaptation::BRADFORD, white_src, white_dst);
+}
+
+// ICtCp. the PQ step and the ITP matrix are templates over the scalar: floats go through Math::DEFAULT like the OTF
+// functions, doubles through libm, SIMD::float4 through FastMath. LMS is scaled so that 10000 nits maps to 0-100 of
+// OTF::Y_to_ST2084.
+template <typename T>
+static T LMS_to_PQ(const T &lms)
+{
+    const T C  = lms / 100.f;
+    const T L  = C / 100.0f;
+    const T Lm = SIMD::pow(SIMD::max(L, T(0.f)), T(0.1593017578125f));
+    const T N  = SIMD::pow((0.8359375f + 18.8515625f * Lm) / (1.0f + 18.6875f * Lm), T(78.84375f));
+    return SIMD::select(C <= T(0.f), T(0.f), SIMD::select(C >= T(100.f), T(1.f), N));
+}
+// pq is clamped to [0,1] like the forward path clamps its output: past ~1.99 the denominator turns negative.
+template <typename T>
+static T PQ_to_LMS(const T &pq)
+{
+    const T Np = SIMD::pow(SIMD::min(SIMD::max(pq, T(0.f)), T(1.f)), T(1. / 78.84375));
+    const T L  = SIMD::max(Np - 0.8359375f, T(0.f)) / (18.8515625f - 18.6875f * Np);
+    return SIMD::pow(L, T(1. / 0.1593017578125)) * 100.f * 100.f;
+}
+template <typename T>
+static TristimulusT<T> LMS_to_ICtCp(const TristimulusT<T> &lms)
+{
+    const T pq0 = LMS_to_PQ(lms[0]);
+    const T pq1 = LMS_to_PQ(lms[1]);
+    const T pq2 = LMS_to_PQ(lms[2]);
+    return TristimulusT<T>((pq0 + pq1) * 0.5f, (6610.f * pq0 - 13613.f * pq1 + 7003.f * pq2) / 4096.f,
+        (17933.f * pq0 - 17390.f * pq1 + 543.f * pq2) / 4096.f);
+}
+static constexpr Matrix3 PQ_to_ICtCp(0.5f, 0.5f, 0.f, 6610.f / 4096.f, -13613.f / 4096.f, 7003.f / 4096.f,
+    17933.f / 4096.f, -17390.f / 4096.f, 543.f / 4096.f);
+static constexpr Matrix3 ICtCp_to_PQ(PQ_to_ICtCp.invert());
+template <typename T>
+static TristimulusT<T> ICtCp_to_LMS(const TristimulusT<T> &itp, const Matrix3T<T> &toPQ)
+{
+    const TristimulusT<T> pq(itp.apply(toPQ));
+    return TristimulusT<T>(PQ_to_LMS(pq[0]), PQ_to_LMS(pq[1]), PQ_to_LMS(pq[2]));
+}
+
+static inline const Tristimulus XYZ_to_ICtCp(const Tristimulus &xyz) { return LMS_to_ICtCp(LMS.fromXYZ(xyz)); }
+static inline const Tristimulus ICtCp_to_XYZ(const Tristimulus &itp)
+{
+    return LMS.toXYZ(ICtCp_to_LMS(itp, ICtCp_to_PQ));
+}
+// RGB of a gamut to and from ICtCp, the gamut and LMS matrices folded into one. linear RGB is in cd/m^2 like XYZ.
+static inline const Tristimulus RGB_to_ICtCp(const Gamut &gamut, const Tristimulus &rgb)
+{
+    return LMS_to_ICtCp(rgb.apply(LMS.fromXYZ().mul(gamut.toXYZ())));
+}
+static inline const Tristimulus ICtCp_to_RGB(const Gamut &gamut, const Tristimulus &itp)
+{
+    return ICtCp_to_LMS(itp, ICtCp_to_PQ).apply(gamut.fromXYZ().mul(LMS.toXYZ()));
+}
+// bulk versions over interleaved pixels: matrix, PQ and ITP fused. Math::FAST runs 4 pixels at a time on FastMath,
+// I stays within 1e-5 and Ct, Cp within 1e-4 of the per pixel functions. Math::EXACT runs one pixel at a time in
+// double. an OTF other than LINEAR puts the RGB side in code values through the batch curves on the same backend, in
+// OTF scene units (1 = 100 cd/m^2). e.g. ICtCp_to_RGB(Rec2020, OTF::ST2084, ...) writes Rec.2020 PQ.
+static inline void RGB_to_ICtCp(const Gamut &gamut, const OTF::TYPE otf, const float *src, float *dst,
+    const size_t count, const size_t srcStride = 3, const size_t dstStride = 3, const Math::BACKEND math = Math::FAST)
+{
+    const Matrix3                m(LMS.fromXYZ().mul(gamut.toXYZ()));
+    const Matrix3                ms((otf == OTF::LINEAR) ? m : m.mul(Matrix3::diag(Vector3(100.f, 100.f, 100.f))));
+    const Matrix3T<SIMD::float4> mp(ms);
+    const Matrix3T<double>       md(ms);
+    float                        scene[256 * 3];
+    for (size_t i = 0; i < count; i += 256)
+    {
+        const size_t n      = std::min<size_t>(256, count - i);
+        const float *s      = src + i * srcStride;
+        size_t       stride = srcStride;
+        if (otf != OTF::LINEAR)
         {
-            hi = getUint32();
-            lo = getUint32();
+            for (size_t j = 0; j < n; j++)
+            {
+                scene[j * 3 + 0] = s[j * srcStride + 0];
+                scene[j * 3 + 1] = s[j * srcStride + 1];
+                scene[j * 3 + 2] = s[j * srcStride + 2];
+            }
+            OTF::toScene(otf, scene, scene, n * 3, 1.f, math);
+            s      = scene;
+            stride = 3;
+        }
+        if (math == Math::EXACT)
+        {
+            for (size_t j = 0; j < n; j++)
+            {
+                Tristimulus::storeDouble(
+                    LMS_to_ICtCp(Tristimulus::loadDouble(s + j * stride).apply(md)), dst + (i + j) * dstStride);
+            }
         }
         else
         {
-            lo = getUint32();
-            hi = getUint32();
+            for (size_t j = 0; j < n; j += 4)
+            {
+                const size_t k = std::min<size_t>(4, n - j);
+                Tristimulus::store4(LMS_to_ICtCp(Tristimulus::load4(s + j * stride, k, stride).apply(mp)),
+                    dst + (i + j) * dstStride, k, dstStride);
+            }
         }
-        return (lo | hi << 32);
     }
-    const int64_t getInt64(void)
-    {
-        uint64_t lo;
-        int64_t  hi;
-        if (readEndian_ == BIG)
+}
+static inline void ICtCp_to_RGB(const Gamut &gamut, const OTF::TYPE otf, const float *src, float *dst,
+    const size_t count, const size_t srcStride = 3, const size_t dstStride = 3, const Math::BACKEND math = Math::FAST)
+{
+    const Matrix3                m(gamut.fromXYZ().mul(LMS.toXYZ()));
+    const Matrix3                ms((otf == OTF::LINEAR) ? m : Matrix3::diag(Vector3(.01f, .01f, .01f)).mul(m));
+    const Matrix3T<SIMD::float4> mp(ms), toPQ(ICtCp_to_PQ);
+    const Matrix3T<double>       md(ms), toPQd(ICtCp_to_PQ);
+    float                        scene[256 * 3];
+    for (size_t i = 0; i < count; i += 256)
+    {
+        const size_t n      = std::min<size_t>(256, count - i);
+        float *      d      = (otf == OTF::LINEAR) ? dst + i * dstStride : scene;
+        const size_t stride = (otf == OTF::LINEAR) ? dstStride : 3;
+        if (math == Math::EXACT)
         {
-            hi = getInt32();
-            lo = getUint32();
+            for (size_t j = 0; j < n; j++)
+            {
+                const TristimulusT<double> itp(Tristimulus::loadDouble(src + (i + j) * srcStride));
+                Tristimulus::storeDouble(ICtCp_to_LMS(itp, toPQd).apply(md), d + j * stride);
+            }
         }
         else
         {
-            lo = getUint32();
-            hi = getInt32();
+            for (size_t j = 0; j < n; j += 4)
+            {
+                const size_t                     k = std::min<size_t>(4, n - j);
+                const TristimulusT<SIMD::float4> itp(Tristimulus::load4(src + (i + j) * srcStride, k, srcStride));
+                Tristimulus::store4(ICtCp_to_LMS(itp, toPQ).apply(mp), d + j * stride, k, stride);
+            }
+        }
+        if (otf != OTF::LINEAR)
+        {
+            OTF::toScreen(otf, scene, scene, n * 3, 1.f, math);
+            for (size_t j = 0; j < n; j++)
+            {
+                dst[(i + j) * dstStride + 0] = scene[j * 3 + 0];
+                dst[(i + j) * dstStride + 1] = scene[j * 3 + 1];
+                dst[(i + j) * dstStride + 2] = scene[j * 3 + 2];
+            }
         }
-        return (lo | hi << 32);
     }
-    const float getFloat(void)
+}
+static inline void XYZ_to_ICtCp(const float *src, float *dst, const size_t count, const size_t srcStride = 3,
+    const size_t dstStride = 3, const Math::BACKEND math = Math::FAST)
+{
+    RGB_to_ICtCp(XYZ, OTF::LINEAR, src, dst, count, srcStride, dstStride, math);
+}
+static inline void ICtCp_to_XYZ(const float *src, float *dst, const size_t count, const size_t srcStride = 3,
+    const size_t dstStride = 3, const Math::BACKEND math = Math::FAST)
+{
+    ICtCp_to_RGB(XYZ, OTF::LINEAR, src, dst, count, srcStride, dstStride, math);
+}
+// half pixels. XYZ in cd/m^2 does not fit a half above 65504, RGB and ICtCp are fine.
+static inline void RGB_to_ICtCp(const Gamut &gamut, const OTF::TYPE otf, const half *src, half *dst,
+    const size_t count, const size_t srcStride = 3, const size_t dstStride = 3, const Math::BACKEND math = Math::FAST)
+{
+    Half::transform(src, dst, count, srcStride, dstStride, [&](const float *a, float *b, const size_t n) {
+        RGB_to_ICtCp(gamut, otf, a, b, n, srcStride, dstStride, math);
+    });
+}
+static inline void ICtCp_to_RGB(const Gamut &gamut, const OTF::TYPE otf, const half *src, half *dst,
+    const size_t count, const size_t srcStride = 3, const size_t dstStride = 3, const Math::BACKEND math = Math::FAST)
+{
+    Half::transform(src, dst, count, srcStride, dstStride, [&](const float *a, float *b, const size_t n) {
+        ICtCp_to_RGB(gamut, otf, a, b, n, srcStride, dstStride, math);
+    });
+}
+
+// Y'CbCr of gamma encoded R'G'B', Y' in 0-1 and Cb, Cr in -0.5-0.5. BT2020_CL is the constant luminance form: Y' is
+// the encoded linear luminance and Cb, Cr take the piecewise scales of BT.2020 table 4, so it needs the curve.
+// the planar functions fuse the chroma filters, the matrix and the OTF: the RGB side is linear (OTF::toScene units)
+// and interleaved, the Y'CbCr side is three planes. chroma is co-sited horizontally and, for 4:2:0, sits between
+// two rows (MPEG-2 / BT.2020 chroma location type 0). downsampling filters [1 2 1]/4 across and averages the two rows,
+// upsampling interpolates linearly. planes are width wide, chroma planes (width + 1) / 2 when subsampled, and
+// heights follow the same rule for 4:2:0.
+class YCbCr
+{
+  public:
+    typedef enum
     {
-        union
-        {
-            uint32_t ui;
-            float     f;
-        } x;
-        x.ui = getUint32();
-        return x.f;
-    }
-    const double getDouble(void)
+        BT601,
+        BT709,
+        BT2020,
+        BT2020_CL
+    } STANDARD;
+    typedef enum
     {
-        union
-        {
-            uint64_t ull;
-            double   f;
-        } x;
-        x.ull = getUint64();
-        return x.f;
-    }
-    const std::string getSubstr(int len)
+        YUV444,
+        YUV422,
+        YUV420
+    } SUBSAMPLING;
+
+    static constexpr float Kr(const STANDARD s) { return (s == BT601) ? 0.299f : ((s == BT709) ? 0.2126f : 0.2627f); }
+    static constexpr float Kb(const STANDARD s) { return (s == BT601) ? 0.114f : ((s == BT709) ? 0.0722f : 0.0593f); }
+    static constexpr float Kg(const STANDARD s) { return 1.f - Kr(s) - Kb(s); }
+
+    // non constant luminance matrices, R'G'B' -> Y'CbCr and back.
+    static constexpr Matrix3 fromRGB(const STANDARD s)
     {
-        std::string str;
-        for (int i = 0; i < len - 1; i++)
-        {
-            uint8_t uc = getUint8();
-            str.push_back(uc);
-        }
-        if (len > 0)
-            getUint8();
-        return str;
+        return Matrix3(Kr(s), Kg(s), Kb(s), -Kr(s) / (2.f - 2.f * Kb(s)), -Kg(s) / (2.f - 2.f * Kb(s)), 0.5f, 0.5f,
+            -Kg(s) / (2.f - 2.f * Kr(s)), -Kb(s) / (2.f - 2.f * Kr(s)));
     }
-    const std::string get_string(void)
+    static constexpr Matrix3 toRGB(const STANDARD s)
     {
-        int len = getUint32();
-        if (len > 0)
-            return getSubstr(len);
-        return "";
+        return Matrix3(1.f, 0.f, 2.f - 2.f * Kr(s), 1.f, -Kb(s) * (2.f - 2.f * Kb(s)) / Kg(s),
+            -Kr(s) * (2.f - 2.f * Kr(s)) / Kg(s), 1.f, 2.f - 2.f * Kb(s), 0.f);
     }
 
-    void align(int a)
+    // single pixels of R'G'B' signal, exact. otf is the curve BT2020_CL encodes with, the others ignore it.
+    static const Tristimulus fromRGB(const STANDARD s, const Tristimulus &rgb, const OTF::TYPE otf = OTF::BT709)
     {
-        size_t s = ftell();
-        int m = (a - (s % a)) % a;
-        fseek(m, CURRENT);
+        if (s != BT2020_CL)
+            return rgb.apply(fromRGB(s));
+        const Tristimulus lin = OTF::toScene(otf, rgb);
+        const float       y   = OTF::toScreen(otf, Tristimulus(Kr(s) * lin[0] + Kg(s) * lin[1] + Kb(s) * lin[2]))[0];
+        return Tristimulus(y, CL::toCb(rgb[2] - y), CL::toCr(rgb[0] - y));
     }
-    Pointer getPointer32(void)
+    static const Tristimulus toRGB(const STANDARD s, const Tristimulus &ycc, const OTF::TYPE otf = OTF::BT709)
     {
-        Pointer p = getUint32();
-        return p;
+        if (s != BT2020_CL)
+            return ycc.apply(toRGB(s));
+        const float       b = ycc[0] + CL::fromCb(ycc[1]);
+        const float       r = ycc[0] + CL::fromCr(ycc[2]);
+        const Tristimulus lin(OTF::toScene(otf, Tristimulus(ycc[0], r, b)));
+        const float       g = (lin[0] - Kr(s) * lin[1] - Kb(s) * lin[2]) / Kg(s);
+        return Tristimulus(r, OTF::toScreen(otf, Tristimulus(g))[0], b);
     }
-    Pointer putPointer32(void)
+
+    // planes to interleaved linear RGB. float planes hold normalized values, 16 bit planes hold code values of 'bits'
+    // (8-16) in the given range, see PixelFormat::RANGE.
+    static void toRGB(const STANDARD s, const SUBSAMPLING ss, const OTF::TYPE otf, const float *y, const float *cb,
+        const float *cr, const size_t width, const size_t height, float *dst, const size_t dstStride = 3)
     {
-        Pointer p = mark();
-        putUint32(0);
-        return p;
+        decode(s, ss, otf, y, cb, cr, width, height, dst, dstStride, Normalize());
     }
-    Pointer getPointer64(void)
+    static void toRGB(const STANDARD s, const SUBSAMPLING ss, const OTF::TYPE otf, const uint16_t *y,
+        const uint16_t *cb, const uint16_t *cr, const size_t width, const size_t height, float *dst,
+        const size_t dstStride = 3, const int bits = 10, const PixelFormat::RANGE range = PixelFormat::NARROW)
     {
-        Pointer p = getUint64();
-        return p;
+        decode(s, ss, otf, y, cb, cr, width, height, dst, dstStride, Normalize(bits, range));
     }
-    Pointer putPointer64(void)
+    // interleaved linear RGB to planes. 16 bit planes are rounded to the nearest code and clamped.
+    static void fromRGB(const STANDARD s, const SUBSAMPLING ss, const OTF::TYPE otf, const float *src,
+        const size_t width, const size_t height, float *y, float *cb, float *cr, const size_t srcStride = 3)
     {
-        Pointer p = mark();
-        putUint64(0);
-        return p;
+        encode(s, ss, otf, src, width, height, y, cb, cr, srcStride, Normalize());
+    }
+    static void fromRGB(const STANDARD s, const SUBSAMPLING ss, const OTF::TYPE otf, const float *src,
+        const size_t width, const size_t height, uint16_t *y, uint16_t *cb, uint16_t *cr, const size_t srcStride = 3,
+        const int bits = 10, const PixelFormat::RANGE range = PixelFormat::NARROW)
+    {
+        encode(s, ss, otf, src, width, height, y, cb, cr, srcStride, Normalize(bits, range));
     }
 
-    void adjustPointer32(Pointer p)
+    static size_t chromaWidth(const SUBSAMPLING ss, const size_t width)
     {
-        uint32_t ui  = (uint32_t)buffer_.size();
-        uint8_t  uc0 = ui & 0xFF;
-        ui >>= 8;
-        uint8_t uc1 = ui & 0xFF;
-        ui >>= 8;
-        uint8_t uc2 = ui & 0xFF;
-        ui >>= 8;
-        uint8_t uc3 = ui & 0xFF;
-        if (writeEndian_ == BIG)
-        {
-            buffer_[p]     = uc3;
-            buffer_[p + 1] = uc2;
-            buffer_[p + 2] = uc1;
-            buffer_[p + 3] = uc0;
-        }
-        else
-        {
-            buffer_[p]     = uc0;
-            buffer_[p + 1] = uc1;
-            buffer_[p + 2] = uc2;
-            buffer_[p + 3] = uc3;
-        }
+        return (ss == YUV444) ? width : (width + 1) / 2;
     }
-    void adjustPointer64(Pointer p)
+    static size_t chromaHeight(const SUBSAMPLING ss, const size_t height)
     {
-        uint64_t ui  = buffer_.size();
-        uint8_t  uc0 = ui & 0xFF;
-        ui >>= 8;
-        uint8_t uc1 = ui & 0xFF;
-        ui >>= 8;
-        uint8_t uc2 = ui & 0xFF;
-        ui >>= 8;
-        uint8_t uc3 = ui & 0xFF;
-        ui >>= 8;
-        uint8_t uc4 = ui & 0xFF;
-        ui >>= 8;
-        uint8_t uc5 = ui & 0xFF;
-        ui >>= 8;
-        uint8_t uc6 = ui & 0xFF;
-        ui >>= 8;
-        uint8_t uc7 = ui & 0xFF;
-        if (writeEndian_ == BIG)
-        {
-            buffer_[p]     = uc7;
-            buffer_[p + 1] = uc6;
-            buffer_[p + 2] = uc5;
-            buffer_[p + 3] = uc4;
-            buffer_[p + 4] = uc3;
-            buffer_[p + 5] = uc2;
-            buffer_[p + 6] = uc1;
-            buffer_[p + 7] = uc0;
-        }
-        else
-        {
-            buffer_[p]     = uc0;
-            buffer_[p + 1] = uc1;
-            buffer_[p + 2] = uc2;
-            buffer_[p + 3] = uc3;
-            buffer_[p + 4] = uc4;
-            buffer_[p + 5] = uc5;
-            buffer_[p + 6] = uc6;
-            buffer_[p + 7] = uc7;
-        }
+        return (ss == YUV420) ? (height + 1) / 2 : height;
     }
 
-    void putInt8(const int8_t v) { putUint8(*(uint8_t *)&v); }
-    void putUint16(const uint16_t u)
+  private:
+    // BT.2020 constant luminance color difference scales, picked by the sign of B' - Y' and R' - Y'.
+    struct CL
     {
-        if (writeEndian_ == BIG)
+        template <typename T>
+        static T toCb(const T &d)
         {
-            putUint8((u >> 8) & 0xFF);
-            putUint8(u & 0xFF);
+            return d / SIMD::select(d <= T(0.f), T(1.9404f), T(1.5816f));
         }
-        else
+        template <typename T>
+        static T toCr(const T &d)
         {
-            // LE
-            putUint8(u & 0xFF);
-            putUint8((u >> 8) & 0xFF);
+            return d / SIMD::select(d <= T(0.f), T(1.7184f), T(0.9936f));
         }
-    }
-    void putInt16(const int16_t u)
-    {
-        if (writeEndian_ == BIG)
+        template <typename T>
+        static T fromCb(const T &c)
         {
-            putInt8((u >> 8) & 0xFF);
-            putUint8(u & 0xFF);
+            return c * SIMD::select(c <= T(0.f), T(1.9404f), T(1.5816f));
         }
-        else
+        template <typename T>
+        static T fromCr(const T &c)
         {
-            // LE
-            putUint8(u & 0xFF);
-            putInt8((u >> 8) & 0xFF);
+            return c * SIMD::select(c <= T(0.f), T(1.7184f), T(0.9936f));
         }
-    }
-    void putUint32(const uint32_t u)
+    };
+
+    // code value <-> normalized value, one gain and offset for luma and one for chroma. narrow range codes stay in
+    // [1, 254] scaled to the bit depth like PixelFormat, off the SDI timing codes.
+    struct Normalize
     {
-        if (writeEndian_ == BIG)
+        float gain_[2], offset_[2], floor_, limit_;
+        Normalize() : gain_{1.f, 1.f}, offset_{0.f, 0.f}, floor_(0.f), limit_(0.f) { ; }
+        Normalize(const int bits, const PixelFormat::RANGE range)
+            : floor_((range == PixelFormat::FULL) ? 0.f : (float)(1u << (bits - 8))),
+              limit_((float)((range == PixelFormat::FULL) ? (1u << bits) - 1 : (255u << (bits - 8)) - 1))
         {
-            putUint16((u >> 16) & 0xFFFF);
-            putUint16(u & 0xFFFF);
+            const float k    = (float)(1 << (bits - 8));
+            const float full = (float)((1u << bits) - 1);
+            gain_[0]         = (range == PixelFormat::FULL) ? full : 219.f * k;
+            gain_[1]         = (range == PixelFormat::FULL) ? full : 224.f * k;
+            offset_[0]    = (range == PixelFormat::FULL) ? 0.f : 16.f * k;
+            offset_[1]    = (range == PixelFormat::FULL) ? (float)(1 << (bits - 1)) : 128.f * k;
         }
-        else
+        template <typename P>
+        void load(const P *src, float *dst, const size_t n, const int c) const
         {
-            putUint16(u & 0xFFFF);
-            putUint16((u >> 16) & 0xFFFF);
+            const float g = 1.f / gain_[c], o = -offset_[c] / gain_[c];
+            for (size_t i = 0; i < n; i++)
+                dst[i] = (float)src[i] * g + o;
         }
-    }
-    void putInt32(const int32_t u)
-    {
-        if (writeEndian_ == BIG)
+        void load(const float *src, float *dst, const size_t n, const int) const
         {
-            putInt16((u >> 16) & 0xFFFF);
-            putUint16(u & 0xFFFF);
+            memcpy(dst, src, n * sizeof(float));
         }
-        else
+        template <typename P>
+        void store(const float *src, P *dst, const size_t n, const int c) const
         {
-            putUint16(u & 0xFFFF);
-            putInt16((u >> 16) & 0xFFFF);
+            for (size_t i = 0; i < n; i++)
+                dst[i] = (P)(SIMD::min(SIMD::max(src[i] * gain_[c] + offset_[c], floor_), limit_) + 0.5f);
         }
-    }
-
-    void putUint64(const uint64_t v)
-    {
-        if (writeEndian_ == BIG)
+        void store(const float *src, float *dst, const size_t n, const int) const
         {
-            putUint32(v >> 32);
-            putUint32(v & 0xFFFFFFFF);
+            memcpy(dst, src, n * sizeof(float));
         }
-        else
+    };
+
+    // linear between co-sited samples, the last odd pixel repeats the edge.
+    static void upsample(const float *c, const size_t cw, float *out, const size_t width)
+    {
+        for (size_t x = 0; x < width; x++)
         {
-            putUint32(v & 0xFFFFFFFF);
-            putUint32(v >> 32);
+            const size_t j = x / 2;
+            out[x]         = (x & 1) ? 0.5f * (c[j] + c[std::min(j + 1, cw - 1)]) : c[j];
         }
     }
-    void putInt64(const int64_t v)
+    static void downsample(const float *v, const size_t width, float *c, const size_t cw)
     {
-        if (writeEndian_ == BIG)
-        {
-            putInt32(v >> 32);
-            putUint32(v & 0xFFFFFFFF);
-        }
-        else
+        for (size_t j = 0; j < cw; j++)
         {
-            putUint32(v & 0xFFFFFFFF);
-            putInt32(v >> 32);
+            const size_t x = j * 2;
+            c[j] = 0.25f * v[(x > 0) ? x - 1 : 0] + 0.5f * v[x] + 0.25f * v[std::min(x + 1, width - 1)];
         }
     }
-    void putFloat(const float v) { putUint32(*(uint32_t *)&v); } // endian henkan is done by uint.
-    void putDouble(const double v) { putUint64(*(uint64_t *)&v); }
-    void putSubstr(const std::string &str, size_t len)
+
+    template <typename P>
+    static void decode(const STANDARD s, const SUBSAMPLING ss, const OTF::TYPE otf, const P *y, const P *cb,
+        const P *cr, const size_t width, const size_t height, float *dst, const size_t dstStride, const Normalize &n)
     {
-        for (int i = 0; i < len - 1; i++)
+        const size_t       cw = chromaWidth(ss, width), ch = chromaHeight(ss, height);
+        std::vector<float> row(width * 3), c0(cw * 2), c1(cw * 2);
+        float *            ry = row.data(), *rb = ry + width, *rr = rb + width;
+        const Matrix3      m(toRGB(s));
+        for (size_t v = 0; v < height; v++)
         {
-            putUint8(str[i]);
+            n.load(y + v * width, ry, width, 0);
+            // chroma rows at full height, 4:2:0 weighs the nearer row 3/4 and the other 1/4
+            const size_t j = (ss == YUV420) ? v / 2 : v;
+            n.load(cb + j * cw, c0.data(), cw, 1);
+            n.load(cr + j * cw, c0.data() + cw, cw, 1);
+            if (ss == YUV420)
+            {
+                const size_t k = (v & 1) ? std::min(j + 1, ch - 1) : ((j > 0) ? j - 1 : 0);
+                n.load(cb + k * cw, c1.data(), cw, 1);
+                n.load(cr + k * cw, c1.data() + cw, cw, 1);
+                for (size_t i = 0; i < cw * 2; i++)
+                    c0[i] = 0.75f * c0[i] + 0.25f * c1[i];
+            }
+            if (ss == YUV444)
+            {
+                memcpy(rb, c0.data(), width * sizeof(float));
+                memcpy(rr, c0.data() + cw, width * sizeof(float));
+            }
+            else
+            {
+                upsample(c0.data(), cw, rb, width);
+                upsample(c0.data() + cw, cw, rr, width);
+            }
+            float *d = dst + v * width * dstStride;
+            if (s != BT2020_CL)
+            {
+                m.applyPlanar(ry, rb, rr, ry, rb, rr, width); // now R', G', B'
+                OTF::toScene(otf, row.data(), row.data(), width * 3);
+                for (size_t x = 0; x < width; x++)
+                    d[x * dstStride + 0] = ry[x], d[x * dstStride + 1] = rb[x], d[x * dstStride + 2] = rr[x];
+                continue;
+            }
+            // B' and R' from the differences, then luminance, red and blue to light and green from those.
+            SIMD::transform(rb, rb, width, [](const SIMD::float4 &c) { return CL::fromCb(c); });
+            SIMD::transform(rr, rr, width, [](const SIMD::float4 &c) { return CL::fromCr(c); });
+            for (size_t x = 0; x < width; x++)
+                rb[x] += ry[x], rr[x] += ry[x];
+            OTF::toScene(otf, row.data(), row.data(), width * 3);
+            const float kr = Kr(s), kb = Kb(s), kg = 1.f / Kg(s);
+            for (size_t x = 0; x < width; x++)
+            {
+                d[x * dstStride + 0] = rr[x];
+                d[x * dstStride + 1] = (ry[x] - kr * rr[x] - kb * rb[x]) * kg;
+                d[x * dstStride + 2] = rb[x];
+            }
         }
-        if (len > 0)
-            putUint8(0);
     }
-    void putString(const std::string &str) { putSubstr(str, str.size()); }
-};
-
-static Gamut loadGamutFromICCProfileMemory(const void *mem, size_t size) 
-{
-    MemoryStream stream(mem, size);
-    return Gamut("",Matrix3(1,0,0,0,1,0,0,0,1));
-}
-
-
-class Spectrum
-{
-  public:
-    typedef std::array<float, 400> spectrum; // 380-780, 1nm, fixed.
-    spectrum                       s_;
 
-    constexpr Spectrum() : s_{} { ; }
-    constexpr Spectrum(const spectrum &s) : s_(s) { ; }
-    static constexpr float lerp(const float a, const float b, const float r) { return a * (1 - r) + b * r; }
-    static constexpr float fetch(
-        const float *sample, const int samples, const float &lo, const float &hi, const float &t)
+    // rows go through in pairs for 4:2:0, one at a time otherwise.
+    template <typename P>
+    static void encode(const STANDARD s, const SUBSAMPLING ss, const OTF::TYPE otf, const float *src,
+        const size_t width, const size_t height, P *y, P *cb, P *cr, const size_t srcStride, const Normalize &n)
     {
-        const int   count = samples - 1;
-        const int   index = (int)(count * (t - lo) / (hi - lo));
-        const float l     = index * (hi - lo) / count;
-        const float h     = (index + 1) * (hi - lo) / count;
-        return (index >= count)
-                   ? sample[count]
-                   : (index <= 0) ? sample[0] : lerp(sample[index], sample[index + 1], (t - l - lo) / (h - l));
+        const size_t       cw = chromaWidth(ss, width);
+        const size_t       rows = (ss == YUV420) ? 2 : 1;
+        std::vector<float> work(width * 3 * rows), c(cw);
+        const Matrix3      m(fromRGB(s));
+        for (size_t v = 0; v < height; v += rows)
+        {
+            const size_t count = std::min(rows, height - v);
+            for (size_t r = 0; r < rows; r++)
+            {
+                const float *sr = src + std::min(v + r, height - 1) * width * srcStride;
+                float *      ry = work.data() + r * width * 3, *rb = ry + width, *rr = rb + width;
+                // planes as Y, Cb, Cr slots: R' goes to Y', G' to Cb, B' to Cr before the matrix
+                for (size_t x = 0; x < width; x++)
+                    ry[x] = sr[x * srcStride + 0], rb[x] = sr[x * srcStride + 1], rr[x] = sr[x * srcStride + 2];
+                if (s != BT2020_CL)
+                {
+                    OTF::toScreen(otf, ry, ry, width * 3);
+                    m.applyPlanar(ry, rb, rr, ry, rb, rr, width);
+                }
+                else
+                {
+                    const float kr = Kr(s), kg = Kg(s), kb = Kb(s);
+                    for (size_t x = 0; x < width; x++)
+                        rb[x] = kr * ry[x] + kg * rb[x] + kb * rr[x]; // luminance in the green slot
+                    OTF::toScreen(otf, ry, ry, width * 3);           // R', Y', B'
+                    for (size_t x = 0; x < width; x++)
+                    {
+                        const float yl = rb[x];
+                        rb[x]          = rr[x] - yl; // B' - Y'
+                        rr[x]          = ry[x] - yl; // R' - Y'
+                        ry[x]          = yl;
+                    }
+                    SIMD::transform(rb, rb, width, [](const SIMD::float4 &d) { return CL::toCb(d); });
+                    SIMD::transform(rr, rr, width, [](const SIMD::float4 &d) { return CL::toCr(d); });
+                }
+                if (r < count)
+                    n.store(ry, y + (v + r) * width, width, 0);
+            }
+            for (int k = 1; k <= 2; k++)
+            {
+                float *      p0 = work.data() + k * width;
+                const float *p1 = p0 + width * 3;
+                if (ss == YUV420)
+                {
+                    for (size_t x = 0; x < width; x++)
+                        p0[x] = 0.5f * (p0[x] + p1[x]);
+                }
+                P *out = ((k == 1) ? cb : cr) + ((ss == YUV420) ? v / 2 : v) * cw;
+                if (ss == YUV444)
+                {
+                    n.store(p0, out, width, 1);
+                }
+                else
+                {
+                    downsample(p0, width, c.data(), cw);
+                    n.store(c.data(), out, cw, 1);
+                }
+            }
+        }
     }
-    constexpr float fetch(const float &lambda) const { return fetch(s_.data(), 400, 380.f, 779.f, lambda); }
+};
 
-    Spectrum(const float *sample, const int samples = 400, const float &lo = 380.f, const float &hi = 779.f)
+// matrix/TRC ICC profiles (ICC.1 v2 and v4): header, tag table, colorants, white point, chad and the tone curves.
+// no CMM: LUT based, gray, CMYK or Lab PCS profiles are read up to the header and leave valid_ false.
+class ICCProfile
+{
+  public:
+    // one tone reproduction curve, signal to linear.
+    class Curve
     {
-        for (int i = 0; i < 400; i++)
+      public:
+        typedef enum
         {
-            s_[i] = fetch(sample, samples, lo, hi, 380.f + i);
+            IDENTITY,   // curv with no entry
+            GAMMA,      // curv with one u8Fixed8 entry
+            TABLE,      // curv with samples over 0-1
+            PARAMETRIC, // para, function 0-4
+        } TYPE;
+        TYPE               type_;
+        int                function_;
+        float              param_[7]; // g a b c d e f
+        std::vector<float> table_;
+
+        Curve() : type_(IDENTITY), function_(0), param_{1.f, 1.f, 0.f, 0.f, 0.f, 0.f, 0.f} { ; }
+
+        float operator()(const float x) const
+        {
+            const float g = param_[0], a = param_[1], b = param_[2], c = param_[3], d = param_[4], e = param_[5],
+                        f = param_[6];
+            switch (type_)
+            {
+            case IDENTITY:
+                return x;
+            case GAMMA:
+                return (x > 0.f) ? SIMD::pow(x, g) : 0.f;
+            case TABLE:
+            {
+                const float t = ((x < 0.f) ? 0.f : (x > 1.f) ? 1.f : x) * (table_.size() - 1);
+                const size_t i = (size_t)t;
+                if (i + 1 >= table_.size())
+                    return table_.back();
+                return table_[i] + (table_[i + 1] - table_[i]) * (t - i);
+            }
+            case PARAMETRIC:
+                switch (function_)
+                {
+                case 0:
+                    return (x > 0.f) ? SIMD::pow(x, g) : 0.f;
+                case 1:
+                    return (a * x + b > 0.f) ? SIMD::pow(a * x + b, g) : 0.f;
+                case 2:
+                    return (a * x + b > 0.f) ? SIMD::pow(a * x + b, g) + c : c;
+                case 3:
+                    return (x >= d) ? SIMD::pow(a * x + b, g) : c * x;
+                case 4:
+                    return (x >= d) ? SIMD::pow(a * x + b, g) + e : c * x + f;
+                }
+            }
+            return x;
+        }
+        // linear to signal, by bisection for tables and parametric curves. expects a rising curve.
+        float inverse(const float y) const
+        {
+            if (type_ == IDENTITY)
+                return y;
+            if (type_ == GAMMA || (type_ == PARAMETRIC && function_ == 0))
+                return (y > 0.f) ? SIMD::pow(y, 1.f / param_[0]) : 0.f;
+            float lo = 0.f, hi = 1.f;
+            for (int i = 0; i < 24; i++)
+            {
+                const float m = (lo + hi) * 0.5f;
+                if ((*this)(m) < y)
+                    lo = m;
+                else
+                    hi = m;
+            }
+            return (lo + hi) * 0.5f;
         }
+    };
+
+    static constexpr uint32_t signature(const char *s)
+    {
+        return ((uint32_t)(uint8_t)s[0] << 24) | ((uint32_t)(uint8_t)s[1] << 16) | ((uint32_t)(uint8_t)s[2] << 8) |
+               (uint32_t)(uint8_t)s[3];
     }
-    constexpr float operator[](const int i) const { return s_[i]; }
 
-    const spectrum &s(void) const { return s_; }
+    bool        valid_;
+    uint32_t    size_;
+    uint32_t    version_; // 0x04200000 for 4.2
+    uint32_t    deviceClass_;
+    uint32_t    colorSpace_;
+    uint32_t    pcs_;
+    uint32_t    renderingIntent_;
+    uint8_t     id_[16]; // MD5 profile id, zero when the profile has none
+    Tristimulus red_, green_, blue_; // rXYZ, gXYZ, bXYZ: PCS (D50) adapted colorants
+    Tristimulus white_;              // wtpt
+    Matrix3     chad_;
+    bool        hasChad_;
+    Curve       trc_[3];
+    Gamut       gamut_; // built once by parse, identity when the profile is not a valid matrix/TRC one
 
-    static const double planck(const double &T, // temperature (Kelvin)
-        const double &                       l)                        // wavelength (meter)
+    ICCProfile(const void *mem, const size_t size)
+        : valid_(false),
+          size_(0),
+          version_(0),
+          deviceClass_(0),
+          colorSpace_(0),
+          pcs_(0),
+          renderingIntent_(0),
+          id_{},
+          white_(Illuminant_D50),
+          hasChad_(false),
+          gamut_("", Matrix3(1, 0, 0, 0, 1, 0, 0, 0, 1))
     {
-        static const double h    = 6.62606896e-34; // Plank constant         J s
-        static const double c    = 2.99792458e+8;  // Speed of light         m/s
-        static const double k    = 1.38064880e-23; // Boltzmann constant     J/K
-        static const double hc   = 1.984832809e-25;
-        static const double hcc  = 5.950379064e-17;
-        static const double hc_k = 1.438776827e-2;
-        static const double arg1 = 2 * hcc;                                     // J*s*m/s*m/s                 = J*m^2/s
-        static const double arg2 = (h * c) / k;                                 // J*s*m/s / (J/K) = J*m/(J/K) = m * K
-        return (float)(arg1 * pow(l, -5) / (exp(hc_k / (l * T)) - 1.0)) / 1e9f; // in W/m^3 sr
+        parse(mem, size);
     }
 
-    static const Spectrum blackbody(const float temp)
+    // colorants as the PCS sees them.
+    Matrix3 toPCS(void) const
     {
-        spectrum s;
-        for (int i = 0; i < 400; i++)
-        {
-            s[i] = (float)planck(temp, (double)(380.f + i) * 1e-9);
-        }
-        return Spectrum(s);
+        return Matrix3(red_[0], green_[0], blue_[0], red_[1], green_[1], blue_[1], red_[2], green_[2], blue_[2]);
     }
-    static const Spectrum E(const float e = 1.f)
+    // device RGB to XYZ under the device white: chad undone when present, otherwise v2 style media white
+    // adaptation from D50 to wtpt.
+    Matrix3 toXYZ(void) const
     {
-        spectrum s;
-        for (int i = 0; i < 400; i++)
+        if (hasChad_)
+            return chad_.invert().mul(toPCS());
+        return Bradford(Illuminant_D50, white_).mul(toPCS());
+    }
+    const Gamut &gamut(void) const { return gamut_; }
+    Gamut        gamut(const char *name) const
+    {
+        Gamut g = gamut_;
+        g.name_ = name;
+        return g;
+    }
+
+  private:
+    bool parseCurve(MemoryStreamView &s, const uint32_t type, const uint32_t length, Curve &curve)
+    {
+        if (type == signature("curv"))
         {
-            s[i] = e;
+            const uint32_t n = s.getUint32();
+            if (12 + (uint64_t)n * 2 > length)
+                return false;
+            if (n == 0)
+            {
+                curve.type_ = Curve::IDENTITY;
+            }
+            else if (n == 1)
+            {
+                curve.type_     = Curve::GAMMA;
+                curve.param_[0] = s.getUint16() / 256.f;
+            }
+            else
+            {
+                curve.type_ = Curve::TABLE;
+                curve.table_.resize(n);
+                s.getUnorm16Array(curve.table_.data(), n);
+            }
+            return true;
         }
-        return Spectrum(s);
+        if (type == signature("para"))
+        {
+            static const int count[] = {1, 3, 4, 5, 7};
+            const int        f       = s.getUint16();
+            s.getUint16(); // reserved
+            if (f > 4 || 12 + count[f] * 4u > length)
+                return false;
+            curve.type_     = Curve::PARAMETRIC;
+            curve.function_ = f;
+            s.getS15Fixed16Array(curve.param_, count[f]);
+            return true;
+        }
+        return false;
     }
-    static const Spectrum mul(const Spectrum &a, const Spectrum &b)
+
+    void parse(const void *mem, const size_t size)
     {
-        spectrum s;
-        for (int i = 0; i < 400; i++)
+        if (mem == NULL || size < 132)
+            return;
+        MemoryStreamView s(mem, size); // the profile is read in place, never copied
+        s.setReadEndian(MemoryStream::BIG);
+        size_ = s.getUint32();
+        s.seekTo(8);
+        version_     = s.getUint32();
+        deviceClass_ = s.getUint32();
+        colorSpace_  = s.getUint32();
+        pcs_         = s.getUint32();
+        s.seekTo(36);
+        if (s.getUint32() != signature("acsp") || size_ > size || size_ < 132)
+            return;
+        s.seekTo(64);
+        renderingIntent_ = s.getUint32();
+        s.seekTo(84);
+        s.read(id_, 16);
+
+        s.seekTo(128);
+        const uint32_t tags = s.getUint32();
+        if (132 + (uint64_t)tags * 12 > size_)
+            return;
+        int found = 0;
+        for (uint32_t i = 0; i < tags; i++)
         {
-            s[i] = a[i] * b[i];
+            s.seekTo(132 + i * 12);
+            const uint32_t sig    = s.getUint32();
+            const uint32_t offset = s.getUint32();
+            const uint32_t length = s.getUint32();
+            if ((uint64_t)offset + length > size_ || length < 12)
+                continue;
+            s.seekTo(offset);
+            const uint32_t type = s.getUint32();
+            s.getUint32(); // reserved
+            if (sig == signature("rXYZ") || sig == signature("gXYZ") || sig == signature("bXYZ") ||
+                sig == signature("wtpt"))
+            {
+                if (type != signature("XYZ ") || length < 20)
+                    continue;
+                float v[3];
+                s.getS15Fixed16Array(v, 3);
+                const Tristimulus t(v[0], v[1], v[2]);
+                if (sig == signature("rXYZ"))
+                    red_ = t, found |= 1;
+                else if (sig == signature("gXYZ"))
+                    green_ = t, found |= 2;
+                else if (sig == signature("bXYZ"))
+                    blue_ = t, found |= 4;
+                else
+                    white_ = t;
+            }
+            else if (sig == signature("chad"))
+            {
+                if (type != signature("sf32") || length < 44)
+                    continue;
+                float m[9];
+                s.getS15Fixed16Array(m, 9);
+                chad_    = Matrix3(m[0], m[1], m[2], m[3], m[4], m[5], m[6], m[7], m[8]);
+                hasChad_ = true;
+            }
+            else if (sig == signature("rTRC") || sig == signature("gTRC") || sig == signature("bTRC"))
+            {
+                const int c = (sig == signature("rTRC")) ? 0 : (sig == signature("gTRC")) ? 1 : 2;
+                if (parseCurve(s, type, length, trc_[c]))
+                    found |= 8 << c;
+            }
         }
-        return Spectrum(s);
+        valid_ = colorSpace_ == signature("RGB ") && pcs_ == signature("XYZ ") && found == 63;
+        if (valid_)
+            gamut_ = Gamut("ICC", toXYZ().invert());
     }
-    static const Spectrum add(const Spectrum &a, const Spectrum &b)
+};
+
+// gamut of a matrix/TRC profile, identity when the profile can not be read.
+static inline Gamut loadGamutFromICCProfileMemory(const void *mem, size_t size)
+{
+    return ICCProfile(mem, size).gamut();
+}
+
+// parsed profiles shared between all the images that embed them. the key is the profile ID (MD5) from the header,
+// or a hash of the whole content when the ID is zero. broken profiles are cached too, as invalid.
+class ICCProfileCache
+{
+  public:
+    typedef std::shared_ptr<const ICCProfile> Profile;
+
+    Profile load(const void *mem, const size_t size)
     {
-        spectrum s;
-        for (int i = 0; i < 400; i++)
+        const std::string k = key((const uint8_t *)mem, size);
         {
-            s[i] = a[i] + b[i];
+            std::lock_guard<std::mutex> lock(mutex_);
+            const auto                  it = profiles_.find(k);
+            if (it != profiles_.end())
+                return it->second;
         }
-        return Spectrum(s);
+        // parse outside of the lock. when two threads race on a new profile the first one in wins.
+        const Profile               parsed = std::make_shared<const ICCProfile>(mem, size);
+        std::lock_guard<std::mutex> lock(mutex_);
+        return profiles_.emplace(k, parsed).first->second;
     }
-    const Spectrum         operator*(const Spectrum &b) const { return mul(*this, b); }
-    const Spectrum         operator+(const Spectrum &b) const { return add(*this, b); }
-    static constexpr float sumHelper(const Spectrum &a, const int i)
+    // NULL when the file can not be opened.
+    Profile loadFile(const char *path)
     {
-        return (i > 0) ? sumHelper(a, i - 1) + a[i] : a[0];
+        const MappedFile file(path);
+        if (!file.valid())
+            return Profile();
+        return load(file.data(), file.size());
     }
-    static constexpr float sum(const Spectrum &a) { return sumHelper(a, 399); }
-    constexpr float        sum() const { return sum(*this); }
-    static constexpr float dotHelper(const Spectrum &a, const Spectrum &b, const int i)
+
+    size_t size(void)
     {
-        return (i > 0) ? a[i] * b[i] + dotHelper(a, b, i - 1) : a[0] * b[0];
+        std::lock_guard<std::mutex> lock(mutex_);
+        return profiles_.size();
     }
-    static constexpr float dot(const Spectrum &a, const Spectrum &b) { return dotHelper(a, b, 399); }
-    constexpr float        dot(const Spectrum &s) const { return dotHelper(*this, s, 399); }
-    static constexpr float dotHelper3(const Spectrum &a, const Spectrum &b, const Spectrum &c, const int i)
+    void clear(void)
     {
-        return (i > 0) ? a[i] * b[i] * c[i] + dotHelper3(a, b, c, i - 1) : a[0] * b[0] * c[0];
+        std::lock_guard<std::mutex> lock(mutex_);
+        profiles_.clear();
     }
-    static constexpr float dot3(const Spectrum &a, const Spectrum &b, const Spectrum &c)
+
+    // process-wide cache, created on first use.
+    static ICCProfileCache &shared(void)
     {
-        return dotHelper3(a, b, c, 399);
+        static ICCProfileCache cache;
+        return cache;
     }
-};
-
-// standard illuminants
-static constexpr Tristimulus Illuminant_A(1.09850f, 1.f, 0.35585f);
-static constexpr Tristimulus Illuminant_B(1.99072f, 1.f, 0.85223f);
-static constexpr Tristimulus Illuminant_C(0.98074f, 1.0f, 1.18232f);
-static constexpr Tristimulus Illuminant_D50(0.96422f, 1.0f, 0.82521f);
-static constexpr Tristimulus Illuminant_D55(0.95682f, 1.0f, 0.92149f);
-static constexpr Tristimulus Illuminant_D60(0.95265f, 1.0f, 1.00883f); // by ACES TB-2014-004.pdf
-static constexpr Tristimulus Illuminant_D65(0.95047f, 1.0f, 1.08883f);
-static constexpr Tristimulus Illuminant_D75(0.94972f, 1.0f, 1.22638f);
-static constexpr Tristimulus Illuminant_E(1.f, 1.f, 1.f);
-static constexpr Tristimulus Illuminant_F2(0.99186f, 1.f, 0.67393f);
-static constexpr Tristimulus Illuminant_F7(0.95041f, 1.f, 1.08747f);
-static constexpr Tristimulus Illuminant_F11(1.00962f, 1.f, 0.64350f);
-
-// xR,yR,xG,yG,xB,yB,xW,yW
-static constexpr Gamut AdobeRGB("AdobeRGB", 0.64f, 0.33f, 0.21f, 0.71f, 0.15f, 0.06f, 0.3127f, 0.3290f);
-static constexpr Gamut Rec709("Rec.709", 0.64f, 0.33f, 0.30f, 0.60f, 0.15f, 0.06f, 0.3127f, 0.3290f);
-static constexpr Gamut Rec2020("Rec.2020", 0.708f, 0.292f, 0.17f, 0.797f, 0.131f, 0.046f, 0.3127f, 0.3290f);
-static constexpr Gamut DCI_P3("DCI P3", 0.68f, 0.32f, 0.265f, 0.69f, 0.15f, 0.06f, 0.314f, 0.351f);
-static constexpr Gamut S_Gamut("S-Gamut", 0.73f, 0.28f, 0.14f, 0.855f, 0.10f, -0.05f, 0.3127f, 0.3290f);
-static constexpr Gamut S_Gamut3_Cine(
-    "S-Gamut3.Cine", 0.766f, 0.275f, 0.225f, 0.800f, 0.089f, -0.087f, 0.3127f, 0.3290f);
-static constexpr Gamut ACEScg("ACES cg", 0.713f, 0.293f, 0.165f, 0.830f, 0.128f, 0.044f, 0.32168f, 0.33767f);     // AP1
-static constexpr Gamut ACES2065("ACES 2065", 0.73470f, 0.26530f, 0.f, 1.f, 0.0001f, -0.077f, 0.32168f, 0.33767f); // AP0
-static constexpr Gamut LMS("LMS",
-    Matrix3(0.8951f, 0.2664f, -0.1614f, -0.7502f, 1.7135f, 0.0367f, 0.0389f, -0.0685f, 1.0296f)); // fromXYZ matrix.
-static constexpr Gamut XYZ("XYZ", Matrix3(1, 0, 0, 0, 1, 0, 0, 0, 1));
 
-// returns Gamut convert matrix
-static constexpr Matrix3 GamutConvert(const Gamut &src, const Gamut &dst) { return dst.fromXYZ().mul(src.toXYZ()); }
+    // 'I' + profile ID, or 'H' + size + FNV-1a 64 of the bytes. a NULL buffer is keyed as empty whatever its size.
+    static std::string key(const uint8_t *p, const size_t size)
+    {
+        static const uint8_t zero[16] = {};
+        const size_t         n        = (p != NULL) ? size : 0;
+        if (n >= 132 && memcmp(p + 84, zero, 16) != 0)
+            return std::string("I") + std::string((const char *)p + 84, 16);
+        uint64_t h = 14695981039346656037ull;
+        for (size_t i = 0; i < n; i++)
+        {
+            h = (h ^ p[i]) * 1099511628211ull;
+        }
+        const uint64_t s = n;
+        return std::string("H") + std::string((const char *)&s, sizeof(s)) + std::string((const char *)&h, sizeof(h));
+    }
 
-// returns Bradford adaptation matrix
-static constexpr Matrix3 Bradford(const Tristimulus &white_src, const Tristimulus &white_dst)
-{
-    const Tristimulus &lms_src(LMS.fromXYZ(white_src));
-    const Tristimulus &lms_dst(LMS.fromXYZ(white_dst));
-    const Matrix3      scale(
-        Matrix3::diag(Vector3(lms_dst[0] / lms_src[0], lms_dst[1] / lms_src[1], lms_dst[2] / lms_src[2])));
-    return LMS.toXYZ().mul(scale).mul(LMS.fromXYZ());
-}
+  private:
+    std::mutex                               mutex_;
+    std::unordered_map<std::string, Profile> profiles_;
+};
 
-static constexpr Tristimulus XYZ_to_ICtCp(const Tristimulus& xyz)
+// gamut of a profile file, the one the shared cache built when the profile was first parsed. identity when the
+// file is missing or is not a matrix/TRC profile.
+static inline Gamut loadGamutFromICCProfileFile(const char *path)
 {
-    const Tristimulus lms = LMS.fromXYZ(xyz);
-    const Tristimulus pq = Tristimulus(
-        OTF::Y_to_ST2084(lms[0]/100.f),
-        OTF::Y_to_ST2084(lms[1]/100.f),
-        OTF::Y_to_ST2084(lms[2]/100.f)
-    ); // map 10000 nits to 0-100
-    return Tristimulus(
-        (pq[0]+pq[1])*0.5f,
-        (6610.f * pq[0] - 13613.f * pq[1] + 7003.f * pq[2])/4096.f,
-        (17933.f * pq[0] - 17390.f * pq[1] + 543.f * pq[2])/4096.f
-    );
+    const ICCProfileCache::Profile profile = ICCProfileCache::shared().loadFile(path);
+    if (profile)
+        return profile->gamut();
+    return Gamut("", Matrix3(1, 0, 0, 0, 1, 0, 0, 0, 1));
 }
 
 // Color Differences
@@ -1368,53 +6290,90 @@ class Delta
         return sqrtf((a_LAB[0] - b_LAB[0]) * (a_LAB[0] - b_LAB[0]) + (a_LAB[1] - b_LAB[1]) * (a_LAB[1] - b_LAB[1]) +
                      (a_LAB[2] - b_LAB[2]) * (a_LAB[2] - b_LAB[2]));
     }
-    static const float E00(const Tristimulus &lab1, const Tristimulus &lab2, const float &Kl = 1.f,
+    // one formula for floats, doubles and packs through the SIMD:: overloads: floats on Math::DEFAULT, doubles on
+    // libm, SIMD::float4 on FastMath. inexact constants are T from double, so doubles get them in full.
+    template <typename T>
+    static const T E00(const TristimulusT<T> &lab1, const TristimulusT<T> &lab2, const float &Kl = 1.f,
         const float &Kc = 1.f, const float &Kh = 1.f)
     {
-        const float PI      = 3.14159265358979323846264338327950288f;
-        const float L1      = lab1[0];
-        const float a1      = lab1[1];
-        const float b1      = lab1[2];
-        const float L2      = lab2[0];
-        const float a2      = lab2[1];
-        const float b2      = lab2[2];
-        const float Lbar    = (L1 + L2) / 2.f;
-        const float C1      = sqrtf(a1 * a1 + b1 * b1);
-        const float C2      = sqrtf(a2 * a2 + b2 * b2);
-        const float Cbar    = (C1 + C2) / 2.f;
-        const float C7      = powf(Cbar, 7.f);
-        const float pow25_7 = 25.f * 25.f * 25.f * 25.f * 25.f * 25.f * 25.f;
-        const float G       = (1.f - sqrtf(C7 / (C7 + pow25_7))) / 2.f;
-        const float ad1     = a1 * (1.f + G);
-        const float ad2     = a2 * (1.f + G);
-        const float Cd1     = sqrtf(ad1 * ad1 + b1 * b1);
-        const float Cd2     = sqrtf(ad2 * ad2 + b2 * b2);
-        const float CdBar   = (Cd1 + Cd2) / 2.f;
-        const float h1      = fmodf(360.f + atan2f(b1, ad1) * 180.0f / PI, 360.f);
-        const float h2      = fmodf(360.f + atan2f(b2, ad2) * 180.0f / PI, 360.f);
-        const float HdBar   = (fabs(h1 - h2) > 180.f ? (h1 + h2 + 360.f) : (h1 + h2)) / 2.f;
-        const float T1      = 1.f - 0.17f * cosf(PI * (1.f * HdBar - 30.f) / 180.f);
-        const float T2      = 0.24f * cosf(PI * (2.f * HdBar) / 180.f) + 0.32f * cosf(PI * (3.f * HdBar + 6.f) / 180.f);
-        const float T3      = 0.20f * cosf(PI * (4.f * HdBar - 63.f) / 180.f);
-        const float T       = T1 + T2 - T3;
-        const float deltah  = (fabs(h2 - h1) <= 180.f) ? h2 - h1 : ((h2 <= h1) ? h2 - h1 + 360.f : h2 - h1 - 360.f);
-        const float deltaL  = L2 - L1;
-        const float deltaC  = Cd2 - Cd1;
-        const float deltaH  = 2.f * sqrtf(Cd1 * Cd2) * sinf(PI * deltah / (180.f * 2.f));
-        const float Lbar2   = (Lbar - 50.f) * (Lbar - 50.f);
-        const float Sl      = 1.f + 0.015f * Lbar2 / sqrtf(20.f + Lbar2);
-        const float Sc      = 1.f + 0.045f * CdBar;
-        const float Sh      = 1.f + 0.015f * CdBar * T;
-        const float HdBar2  = (HdBar - 275.f) * (HdBar - 275.f) / (25.f * 25.f);
-        const float deltaTheta = 30.f * expf(-HdBar2);
-        const float CdBar7     = powf(CdBar, 7.f);
-        const float Rc         = 2.f * sqrtf(CdBar7 / (CdBar7 + pow25_7));
-        const float Rt         = -Rc * sinf(2.f * deltaTheta * PI / 180.f);
-        const float dl         = deltaL / (Kl * Sl);
-        const float dc         = deltaC / (Kc * Sc);
-        const float dh         = deltaH / (Kh * Sh);
-
-        return sqrtf(dl * dl + dc * dc + dh * dh + Rt * dc * dh);
+        const T     deg        = T(180. / 3.14159265358979323846); // radians to degrees
+        const T     rad        = T(3.14159265358979323846 / 180.);
+        const T     L1         = lab1[0];
+        const T     a1         = lab1[1];
+        const T     b1         = lab1[2];
+        const T     L2         = lab2[0];
+        const T     a2         = lab2[1];
+        const T     b2         = lab2[2];
+        const T     Lbar       = (L1 + L2) / 2.f;
+        const T     C1         = SIMD::sqrt(a1 * a1 + b1 * b1);
+        const T     C2         = SIMD::sqrt(a2 * a2 + b2 * b2);
+        const T     Cbar       = (C1 + C2) / 2.f;
+        const T     C7         = Cbar * Cbar * Cbar * Cbar * Cbar * Cbar * Cbar;
+        const T     pow25_7    = T(25. * 25. * 25. * 25. * 25. * 25. * 25.);
+        const T     G          = (1.f - SIMD::sqrt(C7 / (C7 + pow25_7))) / 2.f;
+        const T     ad1        = a1 * (1.f + G);
+        const T     ad2        = a2 * (1.f + G);
+        const T     Cd1        = SIMD::sqrt(ad1 * ad1 + b1 * b1);
+        const T     Cd2        = SIMD::sqrt(ad2 * ad2 + b2 * b2);
+        const T     CdBar      = (Cd1 + Cd2) / 2.f;
+        const T     h1         = TristimulusT<T>::mod360(360.f + SIMD::atan2(b1, ad1) * deg);
+        const T     h2         = TristimulusT<T>::mod360(360.f + SIMD::atan2(b2, ad2) * deg);
+        const T     HdBar      = SIMD::select(SIMD::abs(h1 - h2) > T(180.f), h1 + h2 + 360.f, h1 + h2) / 2.f;
+        const T     T1         = 1.f - T(0.17) * SIMD::cos(rad * (1.f * HdBar - 30.f));
+        const T     T2 = T(0.24) * SIMD::cos(rad * (2.f * HdBar)) + T(0.32) * SIMD::cos(rad * (3.f * HdBar + 6.f));
+        const T     T3 = T(0.20) * SIMD::cos(rad * (4.f * HdBar - 63.f));
+        const T     Tt         = T1 + T2 - T3;
+        const T     deltah     = SIMD::select(SIMD::abs(h2 - h1) <= T(180.f), h2 - h1,
+            SIMD::select(h2 <= h1, h2 - h1 + 360.f, h2 - h1 - 360.f));
+        const T     deltaL     = L2 - L1;
+        const T     deltaC     = Cd2 - Cd1;
+        const T     deltaH     = 2.f * SIMD::sqrt(Cd1 * Cd2) * SIMD::sin(rad * deltah / 2.f);
+        const T     Lbar2      = (Lbar - 50.f) * (Lbar - 50.f);
+        const T     Sl         = 1.f + T(0.015) * Lbar2 / SIMD::sqrt(20.f + Lbar2);
+        const T     Sc         = 1.f + T(0.045) * CdBar;
+        const T     Sh         = 1.f + T(0.015) * CdBar * Tt;
+        const T     HdBar2     = (HdBar - 275.f) * (HdBar - 275.f) / (25.f * 25.f);
+        const T     deltaTheta = 30.f * SIMD::exp(-HdBar2);
+        const T     CdBar7     = CdBar * CdBar * CdBar * CdBar * CdBar * CdBar * CdBar;
+        const T     Rc         = 2.f * SIMD::sqrt(CdBar7 / (CdBar7 + pow25_7));
+        const T     Rt         = -Rc * SIMD::sin(2.f * deltaTheta * rad);
+        const T     dl         = deltaL / (Kl * Sl);
+        const T     dc         = deltaC / (Kc * Sc);
+        const T     dh         = deltaH / (Kh * Sh);
+
+        return SIMD::sqrt(dl * dl + dc * dc + dh * dh + Rt * dc * dh);
+    }
+    // bulk E00 over interleaved L*a*b* pairs. Math::FAST runs 4 at a time, per pixel results stay within 1e-3 of
+    // the float version, the difference coming from the FastMath trig. Math::EXACT runs one pair at a time in double.
+    static void E00(const float *lab1, const float *lab2, float *de, const size_t count, const size_t stride = 3,
+        const float &Kl = 1.f, const float &Kc = 1.f, const float &Kh = 1.f, const Math::BACKEND math = Math::FAST)
+    {
+        if (math == Math::EXACT)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                de[i] = (float)E00(
+                    Tristimulus::loadDouble(lab1 + i * stride), Tristimulus::loadDouble(lab2 + i * stride), Kl, Kc, Kh);
+            }
+            return;
+        }
+        for (size_t i = 0; i < count; i += 4)
+        {
+            const size_t n = std::min<size_t>(4, count - i);
+            float        r[4];
+            E00(Tristimulus::load4(lab1 + i * stride, n, stride), Tristimulus::load4(lab2 + i * stride, n, stride), Kl,
+                Kc, Kh)
+                .store(r);
+            memcpy(de + i, r, n * sizeof(float));
+        }
+    }
+    static void E00(Parallel::ThreadPool &pool, const float *lab1, const float *lab2, float *de, const size_t count,
+        const size_t stride = 3, const float &Kl = 1.f, const float &Kc = 1.f, const float &Kh = 1.f,
+        const Math::BACKEND math = Math::FAST)
+    {
+        Parallel::forEach(pool, count, Parallel::tileSize(stride * 2), [&](size_t begin, size_t end) {
+            E00(lab1 + begin * stride, lab2 + begin * stride, de + begin, end - begin, stride, Kl, Kc, Kh, math);
+        });
     }
 
     //https://calman.spectracal.com/delta-ictcp-color-difference-metric.html
@@ -1427,6 +6386,319 @@ class Delta
         const float dP = a_itp[2] - b_itp[2];
         return sqrtf(dI*dI + dT*dT*0.25f + dP*dP);
     }
+    // bulk version, both sides go through the fused XYZ_to_ICtCp pass on the given backend.
+    static void ICtCp(const float *a_xyz, const float *b_xyz, float *d, const size_t count, const size_t stride = 3,
+        const Math::BACKEND math = Math::FAST)
+    {
+        if (math == Math::EXACT)
+        {
+            const Matrix3T<double> md(LMS.fromXYZ());
+            for (size_t i = 0; i < count; i++)
+            {
+                const TristimulusT<double> a  = LMS_to_ICtCp(Tristimulus::loadDouble(a_xyz + i * stride).apply(md));
+                const TristimulusT<double> b  = LMS_to_ICtCp(Tristimulus::loadDouble(b_xyz + i * stride).apply(md));
+                const double               dI = a[0] - b[0];
+                const double               dT = a[1] - b[1];
+                const double               dP = a[2] - b[2];
+                d[i]                          = (float)::sqrt(dI * dI + dT * dT * 0.25 + dP * dP);
+            }
+            return;
+        }
+        const Matrix3T<SIMD::float4> m(LMS.fromXYZ());
+        for (size_t i = 0; i < count; i += 4)
+        {
+            const size_t                     n  = std::min<size_t>(4, count - i);
+            const TristimulusT<SIMD::float4> la = Tristimulus::load4(a_xyz + i * stride, n, stride).apply(m);
+            const TristimulusT<SIMD::float4> lb = Tristimulus::load4(b_xyz + i * stride, n, stride).apply(m);
+            const TristimulusT<SIMD::float4> a  = LMS_to_ICtCp(la);
+            const TristimulusT<SIMD::float4> b  = LMS_to_ICtCp(lb);
+            const SIMD::float4               dI = a[0] - b[0];
+            const SIMD::float4               dT = a[1] - b[1];
+            const SIMD::float4               dP = a[2] - b[2];
+            float                            r[4];
+            SIMD::sqrt(dI * dI + dT * dT * 0.25f + dP * dP).store(r);
+            memcpy(d + i, r, n * sizeof(float));
+        }
+    }
+
+    // difference images. inputs follow the per pixel functions: Yuv for UV, L*a*b* for E76 and E00, XYZ for ICtCp.
+    typedef enum
+    {
+        METRIC_UV,
+        METRIC_E76,
+        METRIC_E00,
+        METRIC_ICTCP,
+    } METRIC;
+    static void difference(const METRIC metric, const float *a, const float *b, float *d, const size_t count,
+        const size_t stride = 3, const Math::BACKEND math = Math::FAST)
+    {
+        if (metric == METRIC_E00 || metric == METRIC_ICTCP)
+        {
+            (metric == METRIC_E00) ? E00(a, b, d, count, stride, 1.f, 1.f, 1.f, math)
+                                   : ICtCp(a, b, d, count, stride, math);
+            return;
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            const Tristimulus ta(a[i * stride + 0], a[i * stride + 1], a[i * stride + 2]);
+            const Tristimulus tb(b[i * stride + 0], b[i * stride + 1], b[i * stride + 2]);
+            d[i] = (metric == METRIC_UV) ? UV(ta, tb) : E76(ta, tb);
+        }
+    }
+
+    // DDSketch style quantiles: a value v > 0 is counted in bucket ceil(log_gamma(v)), gamma = (1+alpha)/(1-alpha),
+    // so any quantile comes back within relative error alpha. buckets are added as values arrive; past maxBuckets
+    // the lowest ones are folded together, which bounds memory and only blurs the smallest values.
+    class Sketch
+    {
+      public:
+        double                alpha_;
+        double                scale_; // 1 / log2(gamma)
+        size_t                maxBuckets_;
+        int                   offset_; // key of buckets_[0]
+        std::vector<uint64_t> buckets_;
+        uint64_t              zero_; // values <= minValue, including 0
+        uint64_t              count_;
+
+        Sketch(const double alpha = 0.01, const size_t maxBuckets = 2048)
+            : alpha_(alpha),
+              scale_(1. / ::log2((1. + alpha) / (1. - alpha))),
+              maxBuckets_(std::max<size_t>(maxBuckets, 1)),
+              offset_(0),
+              zero_(0),
+              count_(0)
+        {
+            ;
+        }
+        static float minValue(void) { return 1e-6f; }
+
+        void clear(void)
+        {
+            buckets_.clear();
+            offset_ = 0;
+            zero_   = 0;
+            count_  = 0;
+        }
+        void add(const float v)
+        {
+            count_++;
+            if (v > minValue())
+                insert((int)ceil(::log2((double)v) * scale_), 1);
+            else
+                zero_++;
+        }
+        void merge(const Sketch &s)
+        {
+            assert(s.alpha_ == alpha_);
+            count_ += s.count_;
+            zero_ += s.zero_;
+            for (size_t i = 0; i < s.buckets_.size(); i++)
+            {
+                if (s.buckets_[i])
+                    insert(s.offset_ + (int)i, s.buckets_[i]);
+            }
+        }
+        uint64_t count(void) const { return count_; }
+        // q in [0,1], nearest rank.
+        float quantile(const double q) const
+        {
+            if (count_ == 0)
+                return 0.f;
+            const double rank = std::min(std::max(q, 0.), 1.) * (double)(count_ - 1);
+            uint64_t     seen = zero_;
+            if (rank < (double)seen)
+                return 0.f;
+            for (size_t i = 0; i < buckets_.size(); i++)
+            {
+                seen += buckets_[i];
+                if (rank < (double)seen)
+                    return value(offset_ + (int)i);
+            }
+            return value(offset_ + (int)buckets_.size() - 1);
+        }
+
+      private:
+        // midpoint of (gamma^(k-1), gamma^k] in the relative sense.
+        float value(const int k) const { return (float)(2. * exp2(k / scale_) / (1. + (1. + alpha_) / (1. - alpha_))); }
+        void  insert(int k, const uint64_t n)
+        {
+            if (buckets_.empty())
+            {
+                offset_ = k;
+                buckets_.push_back(0);
+            }
+            else if (k < offset_)
+            {
+                const size_t grow = std::min<size_t>(offset_ - k, maxBuckets_ - buckets_.size());
+                buckets_.insert(buckets_.begin(), grow, 0);
+                offset_ -= (int)grow;
+                k = std::max(k, offset_);
+            }
+            else if (k >= offset_ + (int)buckets_.size())
+            {
+                buckets_.resize(k - offset_ + 1, 0);
+                if (buckets_.size() > maxBuckets_)
+                {
+                    const size_t fold = buckets_.size() - maxBuckets_;
+                    uint64_t     low  = 0;
+                    for (size_t i = 0; i < fold; i++)
+                        low += buckets_[i];
+                    buckets_.erase(buckets_.begin(), buckets_.begin() + fold);
+                    buckets_[0] += low;
+                    offset_ += (int)fold;
+                }
+            }
+            buckets_[k - offset_] += n;
+        }
+    };
+
+    // fixed bins over [lo, hi), values outside land in under/over.
+    class Histogram
+    {
+      public:
+        float                 lo_;
+        float                 hi_;
+        std::vector<uint64_t> bins_;
+        uint64_t              under_;
+        uint64_t              over_;
+
+        Histogram(const size_t bins = 0, const float lo = 0.f, const float hi = 1.f)
+            : lo_(lo), hi_(hi), bins_(bins, 0), under_(0), over_(0)
+        {
+            ;
+        }
+        void clear(void)
+        {
+            std::fill(bins_.begin(), bins_.end(), 0);
+            under_ = over_ = 0;
+        }
+        void add(const float v)
+        {
+            if (bins_.empty())
+                return;
+            if (!(v >= lo_))
+                under_++;
+            else if (v >= hi_)
+                over_++;
+            else
+                bins_[std::min(bins_.size() - 1, (size_t)((v - lo_) / (hi_ - lo_) * bins_.size()))]++;
+        }
+        void merge(const Histogram &h)
+        {
+            assert(h.bins_.size() == bins_.size());
+            for (size_t i = 0; i < bins_.size(); i++)
+                bins_[i] += h.bins_[i];
+            under_ += h.under_;
+            over_ += h.over_;
+        }
+        size_t   size(void) const { return bins_.size(); }
+        uint64_t operator[](const size_t i) const { return bins_[i]; }
+        float    lower(const size_t i) const { return lo_ + (hi_ - lo_) * i / bins_.size(); }
+        uint64_t under(void) const { return under_; }
+        uint64_t over(void) const { return over_; }
+    };
+
+    // running summary of a difference: count, mean, RMS, max, a histogram (off unless given bins) and the
+    // sketch behind percentile(). memory does not depend on how many values went in.
+    class Stats
+    {
+      public:
+        uint64_t  count_;
+        double    sum_;
+        double    sum2_;
+        float     max_;
+        Histogram histogram_;
+        Sketch    sketch_;
+
+        Stats(const Histogram &histogram = Histogram(), const Sketch &sketch = Sketch())
+            : count_(0), sum_(0.), sum2_(0.), max_(0.f), histogram_(histogram), sketch_(sketch)
+        {
+            clear();
+        }
+        void clear(void)
+        {
+            count_ = 0;
+            sum_   = 0.;
+            sum2_  = 0.;
+            max_   = 0.f;
+            histogram_.clear();
+            sketch_.clear();
+        }
+        void add(const float d)
+        {
+            count_++;
+            sum_ += d;
+            sum2_ += (double)d * d;
+            max_ = std::max(max_, d);
+            histogram_.add(d);
+            sketch_.add(d);
+        }
+        void add(const float *d, const size_t count)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                add(d[i]);
+            }
+        }
+        void merge(const Stats &s)
+        {
+            count_ += s.count_;
+            sum_ += s.sum_;
+            sum2_ += s.sum2_;
+            max_ = std::max(max_, s.max_);
+            histogram_.merge(s.histogram_);
+            sketch_.merge(s.sketch_);
+        }
+        uint64_t         count(void) const { return count_; }
+        double           mean(void) const { return count_ ? sum_ / count_ : 0.; }
+        double           rms(void) const { return count_ ? sqrt(sum2_ / count_) : 0.; }
+        float            max(void) const { return max_; }
+        float            percentile(const double p) const { return sketch_.quantile(p / 100.); }
+        const Histogram &histogram(void) const { return histogram_; }
+    };
+
+    // reduces differences into 'into' (a fresh Stats, or the running one of a sequence) without keeping them:
+    // f(begin, n, d) writes n <= 256 values. there are at most 256 tiles, each reducing into its own copy,
+    // merged in order afterwards, so the result does not depend on the thread count.
+    template <typename F>
+    static Stats reduce(Parallel::ThreadPool &pool, const size_t count, const Stats &into, F f)
+    {
+        const size_t tile = std::max<size_t>(4096, (count + 255) / 256);
+        Stats        empty(into);
+        empty.clear();
+        std::vector<Stats> tiles((count + tile - 1) / tile, empty);
+        Parallel::forEach(pool, count, tile, [&](size_t begin, size_t end) {
+            float  d[256];
+            Stats &s = tiles[begin / tile];
+            for (size_t i = begin; i < end; i += 256)
+            {
+                const size_t n = std::min<size_t>(256, end - i);
+                f(i, n, d);
+                s.add(d, n);
+            }
+        });
+        Stats s(into);
+        for (const Stats &t : tiles)
+        {
+            s.merge(t);
+        }
+        return s;
+    }
+    static Stats stats(Parallel::ThreadPool &pool, const METRIC metric, const float *a, const float *b,
+        const size_t count, const size_t stride = 3, const Stats &into = Stats(), const Math::BACKEND math = Math::FAST)
+    {
+        return reduce(pool, count, into, [&](size_t i, size_t n, float *d) {
+            difference(metric, a + i * stride, b + i * stride, d, n, stride, math);
+        });
+    }
+    static Stats E00Stats(Parallel::ThreadPool &pool, const float *lab1, const float *lab2, const size_t count,
+        const size_t stride = 3, const float &Kl = 1.f, const float &Kc = 1.f, const float &Kh = 1.f,
+        const Math::BACKEND math = Math::FAST)
+    {
+        return reduce(pool, count, Stats(), [&](size_t i, size_t n, float *d) {
+            E00(lab1 + i * stride, lab2 + i * stride, d, n, stride, Kl, Kc, Kh, math);
+        });
+    }
 };
 
 
@@ -1454,6 +6726,32 @@ class Observer
     {
         return SpectrumIntegrate(s, X_, Y_, Z_) * normalize_;
     }
+    // batch version: count spectra of 400 samples (380-780nm, 1nm), spectrumStride floats apart.
+    // XYZ is written 3 floats per spectrum, xyzStride floats apart. same sums as fromSpectrum, in another order.
+    void fromSpectrum(const float *spectra, float *xyz, const size_t count, const size_t spectrumStride = 400,
+        const size_t xyzStride = 3) const
+    {
+        SIMD::integrate(X_.s_.data(), Y_.s_.data(), Z_.s_.data(), 400, spectra, count, spectrumStride, xyz, xyzStride);
+        for (size_t i = 0; i < count; i++, xyz += xyzStride)
+        {
+            xyz[0] *= normalize_[0];
+            xyz[1] *= normalize_[1];
+            xyz[2] *= normalize_[2];
+        }
+    }
+    void fromSpectrum(const Spectrum *spectra, float *xyz, const size_t count) const
+    {
+        static_assert(sizeof(Spectrum) == sizeof(float) * 400, "Spectrum must be 400 packed floats");
+        if (count > 0)
+            fromSpectrum(spectra[0].s_.data(), xyz, count);
+    }
+    // threaded, in tiles of 256 spectra. the result does not depend on the pool.
+    void fromSpectrum(Parallel::ThreadPool &pool, const float *spectra, float *xyz, const size_t count,
+        const size_t spectrumStride = 400, const size_t xyzStride = 3) const
+    {
+        Parallel::pixels(pool, spectra, xyz, count, spectrumStride, xyzStride,
+            [&](const float *s, float *d, size_t n) { fromSpectrum(s, d, n, spectrumStride, xyzStride); }, 256);
+    }
     constexpr Tristimulus fromReflectanceAndLight(const Spectrum &r, const Spectrum &l) const // r:reflectance, l:light
     {
         return SpectrumIntegrate3(r, l, X_, Y_, Z_) * normalize_;
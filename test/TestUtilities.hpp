@@ -5,9 +5,21 @@
 #include <catch.hpp>
 #include <iomanip>
 #include <iostream>
+#include <vector>
 
 #include <colorsystem.hpp>
 
+// count pixels of stride floats, scattered deterministically over [0,1).
+inline std::vector<float> makePixels(const size_t count, const size_t stride = 3)
+{
+    std::vector<float> p(count * stride);
+    for (size_t i = 0; i < p.size(); i++)
+    {
+        p[i] = (float)((i * 7919) % 1000) / 1000.f;
+    }
+    return p;
+}
+
 struct putFloat_
 {
     const float v_;
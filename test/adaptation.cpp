@@ -0,0 +1,67 @@
+// "colorsystem"
+// copyright 2017 (c) Hajime UCHIMURA / @nikq
+// all rights reserved
+#include "common.hpp"
+
+#include "TestUtilities.hpp"
+
+#include <colorsystem.hpp>
+
+TEST_CASE("ChromaticAdaptation", "[adaptation]")
+{
+    using ColorSystem::ChromaticAdaptation;
+    const ChromaticAdaptation::METHOD methods[] = {ChromaticAdaptation::BRADFORD, ChromaticAdaptation::CAT02,
+        ChromaticAdaptation::CAT16, ChromaticAdaptation::VON_KRIES, ChromaticAdaptation::XYZ_SCALING};
+    SECTION("white maps to white")
+    {
+        for (const auto method : methods)
+        {
+            const ColorSystem::Matrix3 m =
+                ChromaticAdaptation::matrix(method, ColorSystem::Illuminant_D65, ColorSystem::Illuminant_D50);
+            REQUIRE_THAT(ColorSystem::Illuminant_D65.apply(m), IsApproxEquals(ColorSystem::Illuminant_D50, 1e-5f));
+        }
+    }
+    SECTION("Bradford matches the legacy function")
+    {
+        REQUIRE_THAT(ColorSystem::Bradford(ColorSystem::Illuminant_A, ColorSystem::Illuminant_D65),
+            IsApproxEquals(ChromaticAdaptation::matrix(
+                               ChromaticAdaptation::BRADFORD, ColorSystem::Illuminant_A, ColorSystem::Illuminant_D65),
+                1e-6f));
+    }
+    SECTION("degree of adaptation")
+    {
+        for (const auto method : methods)
+        {
+            const ColorSystem::Matrix3 none = ChromaticAdaptation::matrix(
+                method, ColorSystem::Illuminant_A, ColorSystem::Illuminant_D65, 0.f);
+            REQUIRE_THAT(none, IsApproxEquals(ColorSystem::Matrix3(1, 0, 0, 0, 1, 0, 0, 0, 1), 1e-5f));
+            const ColorSystem::Matrix3 half = ChromaticAdaptation::matrix(
+                method, ColorSystem::Illuminant_A, ColorSystem::Illuminant_D65, 0.5f);
+            const ColorSystem::Matrix3 full =
+                ChromaticAdaptation::matrix(method, ColorSystem::Illuminant_A, ColorSystem::Illuminant_D65);
+            const ColorSystem::Tristimulus w = ColorSystem::Illuminant_A.apply(half);
+            const ColorSystem::Tristimulus f = ColorSystem::Illuminant_A.apply(full);
+            REQUIRE(w[2] > ColorSystem::Illuminant_A[2]);
+            REQUIRE(w[2] < f[2]);
+        }
+    }
+    SECTION("cache")
+    {
+        ChromaticAdaptation::Cache cache(4);
+        const ColorSystem::Matrix3 m =
+            cache.get(ChromaticAdaptation::CAT16, ColorSystem::Illuminant_A, ColorSystem::Illuminant_D65);
+        REQUIRE(cache.size() == 1);
+        REQUIRE_THAT(cache.get(ChromaticAdaptation::CAT16, ColorSystem::Illuminant_A, ColorSystem::Illuminant_D65),
+            IsApproxEquals(m, 0.));
+        REQUIRE(cache.size() == 1);
+        cache.get(ChromaticAdaptation::CAT02, ColorSystem::Illuminant_A, ColorSystem::Illuminant_D65);
+        cache.get(ChromaticAdaptation::CAT16, ColorSystem::Illuminant_A, ColorSystem::Illuminant_D65, 0.5f);
+        cache.get(ChromaticAdaptation::CAT16, ColorSystem::Illuminant_D65, ColorSystem::Illuminant_A);
+        REQUIRE(cache.size() == 4);
+        cache.get(ChromaticAdaptation::BRADFORD, ColorSystem::Illuminant_A, ColorSystem::Illuminant_D65);
+        REQUIRE(cache.size() == 1);
+        REQUIRE_THAT(ChromaticAdaptation::cached(
+                         ChromaticAdaptation::CAT16, ColorSystem::Illuminant_A, ColorSystem::Illuminant_D65),
+            IsApproxEquals(m, 0.));
+    }
+}
@@ -0,0 +1,246 @@
+// "colorsystem"
+// copyright 2017 (c) Hajime UCHIMURA / @nikq
+// all rights reserved
+#include "common.hpp"
+
+#include "TestUtilities.hpp"
+
+#include <chrono>
+#include <colorsystem.hpp>
+
+// throughput numbers, hidden from the default run:
+//   colortest "[bench]"
+namespace
+{
+template <typename F>
+double seconds(F f, const int repeat)
+{
+    f(); // warm up
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeat; i++)
+    {
+        f();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / repeat;
+}
+void report(const char *name, const size_t items, const double sec)
+{
+    printf("%-40s %10.2f M/s\n", name, items / sec * 1e-6);
+}
+} // namespace
+
+TEST_CASE("Observer.fromSpectrum throughput", "[.][bench]")
+{
+    const size_t                       count = 16384;
+    std::vector<ColorSystem::Spectrum> spectra(count, ColorSystem::CIE_D65);
+    std::vector<float>                 xyz(count * 3);
+    const ColorSystem::Observer &      observer = ColorSystem::CIE1931;
+
+    report("fromSpectrum (one by one)", count, seconds([&] {
+        for (size_t i = 0; i < count; i++)
+        {
+            const ColorSystem::Tristimulus t = observer.fromSpectrum(spectra[i]);
+            xyz[i * 3 + 0] = t[0], xyz[i * 3 + 1] = t[1], xyz[i * 3 + 2] = t[2];
+        }
+    }, 5));
+    const ColorSystem::SIMD::ISA saved = ColorSystem::SIMD::isa();
+    const char *                 names[] = {"fromSpectrum batch SCALAR", "fromSpectrum batch SSE4.1",
+        "fromSpectrum batch AVX2", "fromSpectrum batch AVX-512"};
+    for (int level = ColorSystem::SIMD::SCALAR; level <= ColorSystem::SIMD::supported(); level++)
+    {
+        ColorSystem::SIMD::setISA((ColorSystem::SIMD::ISA)level);
+        report(names[level], count, seconds([&] { observer.fromSpectrum(spectra.data(), xyz.data(), count); }, 20));
+    }
+    ColorSystem::SIMD::setISA(saved);
+    ColorSystem::Parallel::ThreadPool &pool = ColorSystem::Parallel::ThreadPool::shared();
+    report("fromSpectrum batch threaded", count, seconds([&] {
+        observer.fromSpectrum(pool, spectra[0].s_.data(), xyz.data(), count);
+    }, 20));
+    REQUIRE(xyz[1] > 0.f);
+}
+
+TEST_CASE("CIELAB throughput", "[.][bench]")
+{
+    const size_t       count = 1 << 18;
+    std::vector<float> xyz(count * 3), lab(count * 3);
+    for (size_t i = 0; i < xyz.size(); i++)
+    {
+        xyz[i] = (float)((i * 7919) % 1000) / 1000.f;
+    }
+    report("toCIELAB (one by one)", count, seconds([&] {
+        for (size_t i = 0; i < count; i++)
+        {
+            const ColorSystem::Tristimulus t =
+                ColorSystem::Tristimulus(xyz[i * 3 + 0], xyz[i * 3 + 1], xyz[i * 3 + 2]).toCIELAB();
+            lab[i * 3 + 0] = t[0], lab[i * 3 + 1] = t[1], lab[i * 3 + 2] = t[2];
+        }
+    }, 5));
+    report("toCIELAB batch", count,
+        seconds([&] { ColorSystem::Tristimulus::toCIELAB(xyz.data(), lab.data(), count); }, 5));
+    report("toCIELAB batch (exact math)", count, seconds([&] {
+        const ColorSystem::Tristimulus d50(0.9642f, 1.f, 0.8249f);
+        ColorSystem::Tristimulus::toCIELAB(xyz.data(), lab.data(), count, d50, 3, 3, ColorSystem::Math::EXACT);
+    }, 5));
+    report("fromCIELAB batch", count,
+        seconds([&] { ColorSystem::Tristimulus::fromCIELAB(lab.data(), xyz.data(), count); }, 5));
+    REQUIRE(lab[0] >= 0.f);
+}
+
+TEST_CASE("Delta E00 throughput", "[.][bench]")
+{
+    const size_t       count = 1 << 18;
+    std::vector<float> lab1(count * 3), lab2(count * 3), de(count);
+    for (size_t i = 0; i < lab1.size(); i++)
+    {
+        lab1[i] = (float)((i * 7919) % 1000) / 10.f - 50.f;
+        lab2[i] = lab1[i] + (float)((i * 31) % 100) / 20.f - 2.5f;
+    }
+    report("E00 (one by one)", count, seconds([&] {
+        for (size_t i = 0; i < count; i++)
+        {
+            const ColorSystem::Tristimulus a(lab1[i * 3 + 0], lab1[i * 3 + 1], lab1[i * 3 + 2]);
+            const ColorSystem::Tristimulus b(lab2[i * 3 + 0], lab2[i * 3 + 1], lab2[i * 3 + 2]);
+            de[i] = ColorSystem::Delta::E00(a, b);
+        }
+    }, 3));
+    const double fast = seconds([&] { ColorSystem::Delta::E00(lab1.data(), lab2.data(), de.data(), count); }, 5);
+    const double exact = seconds([&] {
+        ColorSystem::Delta::E00(lab1.data(), lab2.data(), de.data(), count, 3, 1.f, 1.f, 1.f, ColorSystem::Math::EXACT);
+    }, 3);
+    report("E00 batch", count, fast);
+    report("E00 batch (exact math)", count, exact);
+    REQUIRE(fast < exact); // the default batch path is the SIMD one, not libm per lane
+    ColorSystem::Parallel::ThreadPool &pool = ColorSystem::Parallel::ThreadPool::shared();
+    report("E00 batch threaded", count,
+        seconds([&] { ColorSystem::Delta::E00(pool, lab1.data(), lab2.data(), de.data(), count); }, 5));
+    double mean = 0.;
+    report("E00 stats threaded", count,
+        seconds([&] { mean = ColorSystem::Delta::E00Stats(pool, lab1.data(), lab2.data(), count).mean(); }, 5));
+    REQUIRE(mean > 0.);
+}
+
+TEST_CASE("ICtCp throughput", "[.][bench]")
+{
+    const size_t       count = 1 << 18;
+    std::vector<float> xyz(count * 3), itp(count * 3), other(count * 3), d(count);
+    for (size_t i = 0; i < xyz.size(); i++)
+    {
+        xyz[i]   = (float)((i * 7919) % 1000);
+        other[i] = xyz[i] * 1.01f;
+    }
+    report("XYZ_to_ICtCp (one by one)", count, seconds([&] {
+        for (size_t i = 0; i < count; i++)
+        {
+            const ColorSystem::Tristimulus t =
+                ColorSystem::XYZ_to_ICtCp(ColorSystem::Tristimulus(xyz[i * 3 + 0], xyz[i * 3 + 1], xyz[i * 3 + 2]));
+            itp[i * 3 + 0] = t[0], itp[i * 3 + 1] = t[1], itp[i * 3 + 2] = t[2];
+        }
+    }, 3));
+    report("XYZ_to_ICtCp batch", count, seconds([&] { ColorSystem::XYZ_to_ICtCp(xyz.data(), itp.data(), count); }, 5));
+    report("ICtCp_to_XYZ batch", count, seconds([&] { ColorSystem::ICtCp_to_XYZ(itp.data(), xyz.data(), count); }, 5));
+    report("XYZ_to_ICtCp batch (exact math)", count, seconds([&] {
+        ColorSystem::XYZ_to_ICtCp(xyz.data(), itp.data(), count, 3, 3, ColorSystem::Math::EXACT);
+    }, 5));
+    report("delta ITP batch", count,
+        seconds([&] { ColorSystem::Delta::ICtCp(xyz.data(), other.data(), d.data(), count); }, 5));
+    REQUIRE(d[1] >= 0.f);
+}
+
+TEST_CASE("Convert throughput", "[.][bench]")
+{
+    const size_t       count = 1 << 18;
+    std::vector<float> src(count * 3), dst(count * 3);
+    for (size_t i = 0; i < src.size(); i++)
+    {
+        src[i] = (float)((i * 7919) % 1000) / 1000.f;
+    }
+    const std::vector<ColorSystem::Pipeline::Stage> stages = {ColorSystem::Pipeline::decode(ColorSystem::OTF::SRGB),
+        ColorSystem::Pipeline::matrix(ColorSystem::GamutConvert(ColorSystem::Rec709, ColorSystem::Rec2020)),
+        ColorSystem::Pipeline::encode(ColorSystem::OTF::ST2084)};
+    const ColorSystem::Pipeline p(stages, ColorSystem::Math::FAST);
+    const ColorSystem::Pipeline exact(stages, ColorSystem::Math::EXACT);
+    report("sRGB to PQ Pipeline (fast math)", count, seconds([&] { p.apply(src.data(), dst.data(), count); }, 5));
+    report("sRGB to PQ Pipeline (exact math)", count, seconds([&] { exact.apply(src.data(), dst.data(), count); }, 5));
+    report("sRGB to PQ Convert (fast math)", count, seconds([&] {
+        ColorSystem::Convert<ColorSystem::Rec709, ColorSystem::Rec2020, ColorSystem::OTF::SRGB,
+            ColorSystem::OTF::ST2084, ColorSystem::Math::Fast>::apply(src.data(), dst.data(), count);
+    }, 5));
+    REQUIRE(dst[1] >= 0.f);
+}
+
+TEST_CASE("PixelFormat throughput", "[.][bench]")
+{
+    using ColorSystem::PixelFormat;
+    const size_t         count = 1 << 18;
+    std::vector<uint8_t> rgba8(count * 4), out(count * 8);
+    std::vector<float>   work(count * 4);
+    for (size_t i = 0; i < rgba8.size(); i++)
+    {
+        rgba8[i] = (uint8_t)(i * 31);
+    }
+    const PixelFormat in(PixelFormat::RGBA8), out16(PixelFormat::RGBA16, PixelFormat::NARROW, PixelFormat::DITHER);
+    report("unpack RGBA8", count, seconds([&] { in.unpack(rgba8.data(), work.data(), count, 4); }, 10));
+    report("unpack RGBA8 to RGB stride", count, seconds([&] { in.unpack(rgba8.data(), work.data(), count, 3); }, 10));
+    report("pack RGBA16 dithered", count, seconds([&] { out16.pack(work.data(), out.data(), count, 4); }, 10));
+    const ColorSystem::Pipeline p({ColorSystem::Pipeline::decode(ColorSystem::OTF::SRGB),
+        ColorSystem::Pipeline::matrix(ColorSystem::GamutConvert(ColorSystem::Rec709, ColorSystem::Rec2020)),
+        ColorSystem::Pipeline::encode(ColorSystem::OTF::BT709)});
+    report("RGBA8 sRGB to RGB10A2 BT709 Pipeline", count, seconds([&] {
+        p.apply(in, rgba8.data(), PixelFormat(PixelFormat::RGB10A2), out.data(), count);
+    }, 5));
+    const ColorSystem::Pipeline hdr({ColorSystem::Pipeline::decode(ColorSystem::OTF::ST2084),
+        ColorSystem::Pipeline::encode(ColorSystem::OTF::HLG)});
+    const PixelFormat           rgb10(PixelFormat::RGB10A2);
+    report("RGB10A2 ST2084 to HLG Pipeline", count,
+        seconds([&] { hdr.apply(rgb10, rgba8.data(), rgb10, out.data(), count); }, 5));
+    REQUIRE(work[1] >= 0.f);
+}
+
+TEST_CASE("half throughput", "[.][bench]")
+{
+    const size_t                   count = 1 << 18;
+    std::vector<ColorSystem::half> h(count * 4), hout(count * 4);
+    std::vector<float>             f(count * 4), fout(count * 4);
+    for (size_t i = 0; i < f.size(); i++)
+    {
+        f[i] = (float)((i * 7919) % 1000) / 100.f;
+    }
+    const ColorSystem::SIMD::ISA saved = ColorSystem::SIMD::isa();
+    for (const ColorSystem::SIMD::ISA level : {ColorSystem::SIMD::SCALAR, ColorSystem::SIMD::supported()})
+    {
+        ColorSystem::SIMD::setISA(level);
+        const bool fast = level >= ColorSystem::SIMD::AVX2;
+        report(fast ? "float to half F16C" : "float to half portable", count * 4,
+            seconds([&] { ColorSystem::Half::fromFloat(f.data(), h.data(), f.size()); }, 10));
+        report(fast ? "half to float F16C" : "half to float portable", count * 4,
+            seconds([&] { ColorSystem::Half::toFloat(h.data(), fout.data(), h.size()); }, 10));
+    }
+    ColorSystem::SIMD::setISA(saved);
+    report("GamutConvert RGBA float", count, seconds([&] {
+        ColorSystem::GamutConvert(ColorSystem::Rec709, ColorSystem::Rec2020, f.data(), fout.data(), count, 4, 4);
+    }, 10));
+    report("GamutConvert RGBA half", count, seconds([&] {
+        ColorSystem::GamutConvert(ColorSystem::Rec709, ColorSystem::Rec2020, h.data(), hout.data(), count, 4, 4);
+    }, 10));
+    REQUIRE(fout[1] >= 0.f);
+}
+
+TEST_CASE("FixedPipeline throughput", "[.][bench]")
+{
+    using ColorSystem::OTF;
+    const size_t          count = 1 << 18;
+    std::vector<uint16_t> src(count * 3), dst(count * 3);
+    for (size_t i = 0; i < src.size(); i++)
+    {
+        src[i] = (uint16_t)(64 + (i * 7919) % 877);
+    }
+    const ColorSystem::Matrix3       m = ColorSystem::GamutConvert(ColorSystem::Rec709, ColorSystem::Rec2020);
+    const ColorSystem::FixedPipeline fixed(OTF::BT709, m, OTF::ST2084);
+    const ColorSystem::Pipeline      p({ColorSystem::Pipeline::decode(OTF::BT709), ColorSystem::Pipeline::matrix(m),
+        ColorSystem::Pipeline::encode(OTF::ST2084)});
+    const ColorSystem::PixelFormat   f(ColorSystem::PixelFormat::RGB10, ColorSystem::PixelFormat::NARROW);
+    report("10 bit BT709 to PQ float Pipeline", count,
+        seconds([&] { p.apply(f, src.data(), f, dst.data(), count); }, 5));
+    report("10 bit BT709 to PQ FixedPipeline", count, seconds([&] { fixed.apply(src.data(), dst.data(), count); }, 5));
+    REQUIRE(dst[1] > 0);
+}
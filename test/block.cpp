@@ -0,0 +1,82 @@
+// "colorsystem"
+// copyright 2017 (c) Hajime UCHIMURA / @nikq
+// all rights reserved
+#include "common.hpp"
+
+#include "TestUtilities.hpp"
+
+#include <colorsystem.hpp>
+
+namespace
+{
+// every lane of the block against the scalar operation on the same color.
+template <size_t N, typename B, typename T>
+void checkLanes(const ColorSystem::TristimulusBlock<N> &src, const B &block, const T &scalar, const float eps)
+{
+    const ColorSystem::TristimulusBlock<N> r = block(src);
+    for (size_t i = 0; i < N; i++)
+    {
+        REQUIRE_THAT(r[i], IsApproxEquals(scalar(src[i]), eps));
+    }
+}
+
+template <size_t N>
+void checkBlock(void)
+{
+    typedef ColorSystem::TristimulusBlock<N> Block;
+    typedef ColorSystem::Tristimulus         Tristimulus;
+
+    const std::vector<float> pixels = makePixels(N);
+    const Block              rgb    = Block::load(pixels.data());
+    const Block              xyz    = rgb.apply(ColorSystem::Rec709.toXYZ());
+
+    checkLanes(rgb, [](const Block &b) { return b.apply(ColorSystem::Rec709.toXYZ()); },
+        [](const Tristimulus &t) { return ColorSystem::Rec709.toXYZ(t); }, 1e-6f);
+    checkLanes(xyz, [](const Block &b) { return b.toYxy(); }, [](const Tristimulus &t) { return t.toYxy(); }, 1e-6f);
+    checkLanes(xyz, [](const Block &b) { return b.toYuv(); }, [](const Tristimulus &t) { return t.toYuv(); }, 1e-6f);
+    checkLanes(xyz, [](const Block &b) { return b.toYxy().fromYxy(); }, [](const Tristimulus &t) { return t; }, 1e-5f);
+    checkLanes(xyz, [](const Block &b) { return b.toCIELAB(); }, [](const Tristimulus &t) { return t.toCIELAB(); },
+        2e-4f);
+    checkLanes(xyz, [](const Block &b) { return b.toCIELAB().fromCIELAB(); },
+        [](const Tristimulus &t) { return t.toCIELAB().fromCIELAB(); }, 1e-4f);
+    checkLanes(rgb, [](const Block &b) { return b.toHSV(); }, [](const Tristimulus &t) { return t.toHSV(); }, 1e-4f);
+    checkLanes(rgb, [](const Block &b) { return b.toHSV().fromHSV(); }, [](const Tristimulus &t) { return t; }, 1e-5f);
+    checkLanes(rgb, [](const Block &b) { return (b * 2.f + Block(Tristimulus(-1.f))).clip(0.f, 0.5f); },
+        [](const Tristimulus &t) { return (t * 2.f + Tristimulus(-1.f)).clip(0.f, 0.5f); }, 1e-6f);
+    checkLanes(rgb, [](const Block &b) { return (b + Block(Tristimulus(-0.5f))).positive(); },
+        [](const Tristimulus &t) { return (t + Tristimulus(-0.5f)).positive(); }, 1e-6f);
+    checkLanes(rgb, [&xyz](const Block &b) { return b.min(xyz); },
+        [](const Tristimulus &t) { return t.min(ColorSystem::Rec709.toXYZ(t)); }, 1e-6f);
+    checkLanes(rgb, [&xyz](const Block &b) { return b.max(xyz); },
+        [](const Tristimulus &t) { return t.max(ColorSystem::Rec709.toXYZ(t)); }, 1e-6f);
+}
+} // namespace
+
+TEST_CASE("TristimulusBlock", "[block]")
+{
+    SECTION("8 lanes") { checkBlock<8>(); }
+    SECTION("16 lanes") { checkBlock<16>(); }
+    SECTION("load and store")
+    {
+        typedef ColorSystem::TristimulusBlock<8> Block;
+        const std::vector<float>                 pixels = makePixels(5);
+        const Block                              b      = Block::load(pixels.data(), 5);
+        REQUIRE(b[5][0] == 0.f); // tail is zero filled
+        std::vector<float> out(5 * 4, -1.f);
+        b.store(out.data(), 5, 4);
+        for (size_t i = 0; i < 5; i++)
+        {
+            REQUIRE(out[i * 4 + 0] == pixels[i * 3 + 0]);
+            REQUIRE(out[i * 4 + 1] == pixels[i * 3 + 1]);
+            REQUIRE(out[i * 4 + 2] == pixels[i * 3 + 2]);
+            REQUIRE(out[i * 4 + 3] == -1.f);
+        }
+        float r[8], g[8], bl[8];
+        b.storePlanar(r, g, bl);
+        const Block p = Block::loadPlanar(r, g, bl);
+        for (size_t i = 0; i < 8; i++)
+        {
+            REQUIRE_THAT(p[i], IsApproxEquals(b[i], 0.f));
+        }
+    }
+}
@@ -0,0 +1,164 @@
+// "colorsystem"
+// copyright 2017 (c) Hajime UCHIMURA / @nikq
+// all rights reserved
+#include "common.hpp"
+
+#include "TestUtilities.hpp"
+
+#include <colorsystem.hpp>
+
+namespace
+{
+const float epsilon = 0.000001f;
+} // namespace
+
+TEST_CASE("bulk", "[bulk]")
+{
+    SECTION("Gamut.toXYZ (RGB)")
+    {
+        const size_t       count = 1000;
+        std::vector<float> src   = makePixels(count, 3);
+        std::vector<float> dst(count * 3);
+        ColorSystem::Rec2020.toXYZ(src.data(), dst.data(), count);
+        for (size_t i = 0; i < count; i++)
+        {
+            const ColorSystem::Tristimulus expected =
+                ColorSystem::Rec2020.toXYZ(ColorSystem::Tristimulus(src[i * 3 + 0], src[i * 3 + 1], src[i * 3 + 2]));
+            REQUIRE_THAT(ColorSystem::Tristimulus(dst[i * 3 + 0], dst[i * 3 + 1], dst[i * 3 + 2]),
+                IsApproxEquals(expected, epsilon));
+        }
+    }
+    SECTION("Gamut.fromXYZ (RGBA in place)")
+    {
+        const size_t             count = 1000;
+        std::vector<float>       buf   = makePixels(count, 4);
+        const std::vector<float> src   = buf;
+        ColorSystem::Rec709.fromXYZ(buf.data(), buf.data(), count, 4, 4);
+        for (size_t i = 0; i < count; i++)
+        {
+            const ColorSystem::Tristimulus expected =
+                ColorSystem::Rec709.fromXYZ(ColorSystem::Tristimulus(src[i * 4 + 0], src[i * 4 + 1], src[i * 4 + 2]));
+            REQUIRE_THAT(ColorSystem::Tristimulus(buf[i * 4 + 0], buf[i * 4 + 1], buf[i * 4 + 2]),
+                IsApproxEquals(expected, epsilon));
+            REQUIRE(buf[i * 4 + 3] == src[i * 4 + 3]);
+        }
+    }
+    SECTION("GamutConvert (RGBA to RGB)")
+    {
+        const size_t               count = 100;
+        const std::vector<float>   src   = makePixels(count, 4);
+        std::vector<float>         dst(count * 3);
+        const ColorSystem::Matrix3 m = ColorSystem::GamutConvert(ColorSystem::Rec709, ColorSystem::Rec2020);
+        ColorSystem::GamutConvert(ColorSystem::Rec709, ColorSystem::Rec2020, src.data(), dst.data(), count, 4, 3);
+        for (size_t i = 0; i < count; i++)
+        {
+            const ColorSystem::Tristimulus expected =
+                ColorSystem::Tristimulus(src[i * 4 + 0], src[i * 4 + 1], src[i * 4 + 2]).apply(m);
+            REQUIRE_THAT(ColorSystem::Tristimulus(dst[i * 3 + 0], dst[i * 3 + 1], dst[i * 3 + 2]),
+                IsApproxEquals(expected, epsilon));
+        }
+    }
+    SECTION("Matrix3.applyImage (padded rows)")
+    {
+        const size_t               width = 17, height = 5, pitch = 64;
+        const std::vector<float>   src = makePixels(pitch * height / 3 + 1, 3);
+        std::vector<float>         dst(pitch * height, -1.f);
+        const ColorSystem::Matrix3 m = ColorSystem::Bradford(ColorSystem::Illuminant_D65, ColorSystem::Illuminant_D50);
+        m.applyImage(src.data(), dst.data(), width, height, pitch, pitch);
+        for (size_t y = 0; y < height; y++)
+        {
+            for (size_t x = 0; x < width; x++)
+            {
+                const float *                  s = &src[y * pitch + x * 3];
+                const float *                  d = &dst[y * pitch + x * 3];
+                const ColorSystem::Tristimulus expected(m.apply(ColorSystem::Vector3(s[0], s[1], s[2])));
+                REQUIRE_THAT(ColorSystem::Tristimulus(d[0], d[1], d[2]), IsApproxEquals(expected, epsilon));
+            }
+            REQUIRE(dst[y * pitch + width * 3] == -1.f); // padding is untouched
+        }
+    }
+}
+
+TEST_CASE("simd", "[bulk]")
+{
+    const ColorSystem::SIMD::ISA levels[] = {ColorSystem::SIMD::SCALAR, ColorSystem::SIMD::SSE41,
+        ColorSystem::SIMD::AVX2, ColorSystem::SIMD::AVX512};
+    const ColorSystem::Matrix3   m     = ColorSystem::GamutConvert(ColorSystem::ACES2065, ColorSystem::Rec709);
+    const size_t                 count = 1003; // not a multiple of any vector width
+    const float                  EPS   = 1e-5f;
+    const ColorSystem::SIMD::ISA saved = ColorSystem::SIMD::isa();
+    SECTION("planar")
+    {
+        const std::vector<float> src = makePixels(count, 3);
+        const float *            r = src.data(), *g = r + count, *b = g + count;
+        for (const ColorSystem::SIMD::ISA level : levels)
+        {
+            ColorSystem::SIMD::setISA(level);
+            std::vector<float> dst(count * 3);
+            m.applyPlanar(r, g, b, dst.data(), dst.data() + count, dst.data() + count * 2, count);
+            for (size_t i = 0; i < count; i++)
+            {
+                const ColorSystem::Tristimulus expected(m.apply(ColorSystem::Vector3(r[i], g[i], b[i])));
+                REQUIRE_THAT(ColorSystem::Tristimulus(dst[i], dst[i + count], dst[i + count * 2]),
+                    IsApproxEquals(expected, EPS));
+            }
+        }
+    }
+    SECTION("RGB")
+    {
+        const std::vector<float> src = makePixels(count, 3);
+        for (const ColorSystem::SIMD::ISA level : levels)
+        {
+            ColorSystem::SIMD::setISA(level);
+            std::vector<float> dst(count * 3);
+            m.apply(src.data(), dst.data(), count);
+            for (size_t i = 0; i < count; i++)
+            {
+                const ColorSystem::Tristimulus expected(
+                    m.apply(ColorSystem::Vector3(src[i * 3 + 0], src[i * 3 + 1], src[i * 3 + 2])));
+                REQUIRE_THAT(ColorSystem::Tristimulus(dst[i * 3 + 0], dst[i * 3 + 1], dst[i * 3 + 2]),
+                    IsApproxEquals(expected, EPS));
+            }
+        }
+    }
+    SECTION("RGBA")
+    {
+        const std::vector<float> src = makePixels(count, 4);
+        for (const ColorSystem::SIMD::ISA level : levels)
+        {
+            ColorSystem::SIMD::setISA(level);
+            std::vector<float> dst(count * 4, 0.5f);
+            m.apply(src.data(), dst.data(), count, 4, 4);
+            for (size_t i = 0; i < count; i++)
+            {
+                const ColorSystem::Tristimulus expected(
+                    m.apply(ColorSystem::Vector3(src[i * 4 + 0], src[i * 4 + 1], src[i * 4 + 2])));
+                REQUIRE_THAT(ColorSystem::Tristimulus(dst[i * 4 + 0], dst[i * 4 + 1], dst[i * 4 + 2]),
+                    IsApproxEquals(expected, EPS));
+                REQUIRE(dst[i * 4 + 3] == 0.5f); // alpha is not touched
+            }
+        }
+    }
+    SECTION("RGB to RGBA and back")
+    {
+        const std::vector<float> src = makePixels(count, 3);
+        for (const ColorSystem::SIMD::ISA level : levels)
+        {
+            ColorSystem::SIMD::setISA(level);
+            std::vector<float> rgba(count * 4, 0.5f), rgb(count * 3);
+            m.apply(src.data(), rgba.data(), count, 3, 4);
+            ColorSystem::Matrix3().apply(rgba.data(), rgb.data(), count, 4, 3);
+            for (size_t i = 0; i < count; i++)
+            {
+                const ColorSystem::Tristimulus expected(
+                    m.apply(ColorSystem::Vector3(src[i * 3 + 0], src[i * 3 + 1], src[i * 3 + 2])));
+                REQUIRE_THAT(ColorSystem::Tristimulus(rgba[i * 4 + 0], rgba[i * 4 + 1], rgba[i * 4 + 2]),
+                    IsApproxEquals(expected, EPS));
+                REQUIRE(rgba[i * 4 + 3] == 0.5f);
+                REQUIRE_THAT(ColorSystem::Tristimulus(rgb[i * 3 + 0], rgb[i * 3 + 1], rgb[i * 3 + 2]),
+                    IsApproxEquals(expected, EPS));
+            }
+        }
+    }
+    ColorSystem::SIMD::setISA(saved);
+}
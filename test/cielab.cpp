@@ -35,3 +35,92 @@ TEST_CASE("CIELAB")
     }
 }
 
+TEST_CASE("CIELAB batch")
+{
+    const size_t       count = 1003; // not a multiple of the pack width
+    std::vector<float> xyz(count * 4);
+    for (size_t i = 0; i < count * 4; i++)
+    {
+        xyz[i] = (float)((i * 7919) % 1100) / 1000.f; // a little past the white too
+    }
+    SECTION("cbrt")
+    {
+        for (float x = 1e-6f; x < 1e6f; x *= 1.001f)
+        {
+            REQUIRE(fabs(ColorSystem::FastMath::cbrt(x) - cbrt((double)x)) <= 2.5e-7 * cbrt((double)x));
+            float r[4];
+            ColorSystem::FastMath::cbrt(ColorSystem::SIMD::float4(-x)).store(r);
+            REQUIRE(fabs(r[0] + cbrt((double)x)) <= 2.5e-7 * cbrt((double)x));
+        }
+        REQUIRE(ColorSystem::FastMath::cbrt(0.f) == 0.f);
+    }
+    SECTION("toCIELAB")
+    {
+        std::vector<float> lab(count * 3);
+        ColorSystem::Tristimulus::toCIELAB(xyz.data(), lab.data(), count, ColorSystem::Illuminant_D65, 4, 3);
+        for (size_t i = 0; i < count; i++)
+        {
+            const ColorSystem::Tristimulus t(xyz[i * 4 + 0], xyz[i * 4 + 1], xyz[i * 4 + 2]);
+            REQUIRE_THAT(ColorSystem::Tristimulus(lab[i * 3 + 0], lab[i * 3 + 1], lab[i * 3 + 2]),
+                IsApproxEquals(t.toCIELAB(ColorSystem::Illuminant_D65), 2e-4f));
+        }
+    }
+    SECTION("round trip")
+    {
+        std::vector<float> buf(xyz);
+        ColorSystem::Tristimulus::toCIELAB(buf.data(), buf.data(), count, ColorSystem::Illuminant_D50, 4, 4);
+        ColorSystem::Tristimulus::fromCIELAB(buf.data(), buf.data(), count, ColorSystem::Illuminant_D50, 4, 4);
+        for (size_t i = 0; i < count; i++)
+        {
+            const ColorSystem::Tristimulus t(xyz[i * 4 + 0], xyz[i * 4 + 1], xyz[i * 4 + 2]);
+            REQUIRE_THAT(ColorSystem::Tristimulus(buf[i * 4 + 0], buf[i * 4 + 1], buf[i * 4 + 2]),
+                IsApproxEquals(t.toCIELAB(ColorSystem::Illuminant_D50).fromCIELAB(ColorSystem::Illuminant_D50), 2e-6f));
+            REQUIRE(buf[i * 4 + 3] == xyz[i * 4 + 3]); // stride padding untouched
+        }
+    }
+}
+
+TEST_CASE("Delta E00 batch")
+{
+    const size_t       count = 10007;
+    std::vector<float> lab1(count * 3), lab2(count * 3);
+    for (size_t i = 0; i < count; i++)
+    {
+        // L in [0,100], a b in [-100,100], the second a few units off the first.
+        lab1[i * 3 + 0] = (float)((i * 7919) % 1000) / 10.f;
+        lab1[i * 3 + 1] = (float)((i * 104729) % 2000) / 10.f - 100.f;
+        lab1[i * 3 + 2] = (float)((i * 1299709) % 2000) / 10.f - 100.f;
+        lab2[i * 3 + 0] = lab1[i * 3 + 0] + (float)((i * 31) % 100) / 20.f - 2.5f;
+        lab2[i * 3 + 1] = lab1[i * 3 + 1] + (float)((i * 37) % 100) / 20.f - 2.5f;
+        lab2[i * 3 + 2] = lab1[i * 3 + 2] + (float)((i * 41) % 100) / 20.f - 2.5f;
+    }
+    std::vector<float> de(count);
+    ColorSystem::Delta::E00(lab1.data(), lab2.data(), de.data(), count);
+    SECTION("matches scalar")
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            const float expected = ColorSystem::Delta::E00(
+                ColorSystem::Tristimulus(lab1[i * 3 + 0], lab1[i * 3 + 1], lab1[i * 3 + 2]),
+                ColorSystem::Tristimulus(lab2[i * 3 + 0], lab2[i * 3 + 1], lab2[i * 3 + 2]));
+            REQUIRE(de[i] == Approx(expected).margin(1e-3f));
+        }
+    }
+    SECTION("threaded")
+    {
+        ColorSystem::Parallel::ThreadPool pool(4);
+        std::vector<float>                t(count);
+        ColorSystem::Delta::E00(pool, lab1.data(), lab2.data(), t.data(), count);
+        REQUIRE(t == de);
+
+        const ColorSystem::Delta::Stats stats = ColorSystem::Delta::E00Stats(pool, lab1.data(), lab2.data(), count);
+        ColorSystem::Delta::Stats       expected;
+        expected.add(de.data(), count);
+        REQUIRE(stats.count() == count);
+        REQUIRE(stats.max() == expected.max());
+        REQUIRE(stats.mean() == Approx(expected.mean()).epsilon(1e-12));
+        REQUIRE(stats.rms() == Approx(expected.rms()).epsilon(1e-12));
+        REQUIRE(ColorSystem::Delta::E00Stats(ColorSystem::Parallel::ThreadPool::shared(), lab1.data(), lab2.data(),
+                    count).mean() == stats.mean()); // same tiles, same sum
+    }
+}
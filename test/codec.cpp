@@ -0,0 +1,197 @@
+// "colorsystem"
+// copyright 2017 (c) Hajime UCHIMURA / @nikq
+// all rights reserved
+#include "common.hpp"
+
+#include "TestUtilities.hpp"
+
+#include <colorsystem.hpp>
+
+TEST_CASE("Half", "[codec]")
+{
+    REQUIRE(ColorSystem::Half::fromFloat(1.f) == 0x3c00);
+    REQUIRE(ColorSystem::Half::fromFloat(-2.f) == 0xc000);
+    REQUIRE(ColorSystem::Half::fromFloat(65504.f) == 0x7bff);
+    REQUIRE(ColorSystem::Half::fromFloat(65520.f) == 0x7c00);
+    REQUIRE(ColorSystem::Half::fromFloat(5.9604645e-8f) == 0x0001);
+    REQUIRE(ColorSystem::Half::fromFloat(1.f + 1.f / 2048.f) == 0x3c00); // tie to even
+    REQUIRE(ColorSystem::Half::toFloat(0x3555) == Approx(0.333251953f));
+    for (uint32_t h = 0; h < 0x10000; h++)
+    {
+        if ((h & 0x7c00) == 0x7c00 && (h & 0x3ff))
+            continue; // NaN
+        REQUIRE(ColorSystem::Half::fromFloat(ColorSystem::Half::toFloat((uint16_t)h)) == h);
+    }
+}
+
+TEST_CASE("PixelFormat", "[codec]")
+{
+    using ColorSystem::PixelFormat;
+    const size_t count = 1001;
+    SECTION("round trip")
+    {
+        const PixelFormat::TYPE types[] = {PixelFormat::RGB8, PixelFormat::RGBA8, PixelFormat::RGB10,
+            PixelFormat::RGB12, PixelFormat::RGB16, PixelFormat::RGBA16, PixelFormat::RGB10A2, PixelFormat::RGBA16F};
+        for (const auto type : types)
+        {
+            for (const auto range : {PixelFormat::FULL, PixelFormat::NARROW})
+            {
+                const PixelFormat        f(type, range);
+                const size_t             ch  = f.channels();
+                const std::vector<float> src = makePixels(count, ch);
+                std::vector<uint8_t>     packed(f.bytes(count));
+                std::vector<float>       back(count * ch);
+                f.pack(src.data(), packed.data(), count, ch);
+                f.unpack(packed.data(), back.data(), count, ch);
+                for (size_t i = 0; i < src.size(); i++)
+                {
+                    const float step = (type == PixelFormat::RGBA16F) ? 1e-3f : 0.5f / f.scale(i % ch == 3 ? 3 : 0);
+                    REQUIRE(back[i] == Approx(src[i]).margin(step * 1.001f));
+                }
+                // the strided path agrees with the stream path
+                std::vector<float> wide(count * 4, -1.f);
+                f.unpack(packed.data(), wide.data(), count, 4);
+                for (size_t i = 0; i < count; i++)
+                {
+                    for (size_t k = 0; k < ch; k++)
+                        REQUIRE(wide[i * 4 + k] == back[i * ch + k]);
+                    if (ch == 3)
+                        REQUIRE(wide[i * 4 + 3] == -1.f);
+                }
+                std::vector<uint8_t> repacked(f.bytes(count));
+                f.pack(wide.data(), repacked.data(), count, 4);
+                if (ch == 4)
+                    REQUIRE(repacked == packed);
+            }
+        }
+    }
+    SECTION("code values")
+    {
+        const float    px[] = {0.f, 0.f, 0.f, 1.f, 1.f, 1.f, 2.f, -1.f, 0.5f};
+        uint8_t        c8[9];
+        const uint16_t narrow10[] = {64, 64, 64, 940, 940, 940, 1019, 4, 502}; // 0-3, 1020-1023 are reserved
+        uint16_t       c10[9];
+        PixelFormat(PixelFormat::RGB8).pack(px, c8, 3);
+        REQUIRE(c8[0] == 0);
+        REQUIRE(c8[3] == 255);
+        REQUIRE(c8[6] == 255);
+        REQUIRE(c8[7] == 0);
+        REQUIRE(c8[8] == 128);
+        PixelFormat(PixelFormat::RGB10, PixelFormat::NARROW).pack(px, c10, 3);
+        for (int i = 0; i < 9; i++)
+            REQUIRE(c10[i] == narrow10[i]);
+        uint32_t w;
+        PixelFormat(PixelFormat::RGB10A2).pack(px + 3, &w, 1);
+        REQUIRE(w == 0xffffffffu);
+        PixelFormat(PixelFormat::RGB8, PixelFormat::NARROW).pack(px, c8, 3);
+        REQUIRE(c8[6] == 254);
+        REQUIRE(c8[7] == 1);
+        // the stream path, 16 values at a time, clamps the same way
+        std::vector<float>    over(48, 4.f), under(48, -4.f);
+        std::vector<uint16_t> c12(48);
+        PixelFormat(PixelFormat::RGB12, PixelFormat::NARROW).pack(over.data(), c12.data(), 16);
+        REQUIRE(*std::min_element(c12.begin(), c12.end()) == 4079);
+        PixelFormat(PixelFormat::RGB12, PixelFormat::NARROW).pack(under.data(), c12.data(), 16);
+        REQUIRE(*std::max_element(c12.begin(), c12.end()) == 16);
+    }
+    SECTION("v210")
+    {
+        const PixelFormat  f(PixelFormat::V210, PixelFormat::NARROW);
+        const size_t       n = 9; // one full group and a short one
+        std::vector<float> ycc(n * 3);
+        for (size_t i = 0; i < n; i++)
+        {
+            ycc[i * 3 + 0] = (float)i / (float)n;
+            ycc[i * 3 + 1] = ((i / 2) & 1) ? 0.25f : -0.25f;
+            ycc[i * 3 + 2] = -0.125f;
+        }
+        std::vector<uint32_t> packed(f.bytes(n) / 4);
+        REQUIRE(packed.size() == 8);
+        f.pack(ycc.data(), packed.data(), n);
+        REQUIRE((packed[0] & 0x3ff) == 512 - 224); // Cb0
+        REQUIRE(((packed[0] >> 10) & 0x3ff) == 64);
+        std::vector<float> extreme(n * 3);
+        for (size_t i = 0; i < n * 3; i++)
+            extreme[i] = (i & 1) ? 2.f : -2.f;
+        std::vector<uint32_t> clamped(packed.size());
+        f.pack(extreme.data(), clamped.data(), n);
+        for (const uint32_t word : clamped)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                REQUIRE(((word >> (k * 10)) & 0x3ff) >= 4);
+                REQUIRE(((word >> (k * 10)) & 0x3ff) <= 1019);
+            }
+        }
+        std::vector<float> back(n * 3);
+        f.unpack(packed.data(), back.data(), n);
+        for (size_t i = 0; i < n * 3; i++)
+            REQUIRE(back[i] == Approx(ycc[i]).margin(0.5f / 876.f));
+    }
+    SECTION("dither")
+    {
+        // a flat field between two codes averages back to itself and is the same however it is split.
+        const PixelFormat    f(PixelFormat::RGB8, PixelFormat::FULL, PixelFormat::DITHER);
+        std::vector<float>   flat(count * 3, 100.3f / 255.f);
+        std::vector<uint8_t> whole(count * 3), parts(count * 3);
+        f.pack(flat.data(), whole.data(), count);
+        f.pack(flat.data(), parts.data(), 500);
+        f.pack(flat.data() + 500 * 3, parts.data() + 500 * 3, count - 500, 3, 500);
+        REQUIRE(whole == parts);
+        double sum = 0.;
+        for (const uint8_t c : whole)
+            sum += c;
+        REQUIRE(sum / whole.size() == Approx(100.3).margin(0.05));
+        std::vector<float> wide(count * 4);
+        f.unpack(whole.data(), wide.data(), count, 4);
+        std::vector<uint8_t> strided(count * 3);
+        f.pack(wide.data(), strided.data(), count, 4);
+        REQUIRE(strided != whole); // dithered again on top of the codes
+    }
+    SECTION("pipeline")
+    {
+        using ColorSystem::Pipeline;
+        const Pipeline p({Pipeline::decode(ColorSystem::OTF::SRGB),
+            Pipeline::matrix(ColorSystem::GamutConvert(ColorSystem::Rec709, ColorSystem::Rec2020)),
+            Pipeline::encode(ColorSystem::OTF::BT709)});
+        const PixelFormat    in(PixelFormat::RGBA8), out(PixelFormat::RGB10A2, PixelFormat::NARROW);
+        std::vector<uint8_t> src(count * 4);
+        for (size_t i = 0; i < src.size(); i++)
+            src[i] = (uint8_t)(i * 31);
+        std::vector<uint32_t> dst(count), expected(count);
+        p.apply(in, src.data(), out, dst.data(), count);
+        std::vector<float> work(count * 4);
+        in.unpack(src.data(), work.data(), count, 4);
+        p.apply(work.data(), work.data(), count, 4, 4);
+        out.pack(work.data(), expected.data(), count, 4);
+        REQUIRE(dst == expected);
+        REQUIRE((dst[5] >> 30) == (uint32_t)((src[23] + 42) / 85)); // alpha carried
+
+        // the decode table follows the input format and the first stage; one pipeline across all of them
+        Pipeline q({Pipeline::decode(ColorSystem::OTF::ST2084), Pipeline::encode(ColorSystem::OTF::HLG)});
+        const PixelFormat::TYPE types[] = {PixelFormat::RGB8, PixelFormat::RGBA8, PixelFormat::RGB10A2,
+            PixelFormat::RGB12, PixelFormat::RGBA16};
+        const PixelFormat       wide(PixelFormat::RGBA16F);
+        for (int round = 0; round < 2; round++)
+        {
+            if (round)
+                q.stages_[0] = Pipeline::decode(ColorSystem::OTF::GAMMA, 2.4f);
+            for (const PixelFormat::TYPE type : types)
+                for (const PixelFormat::RANGE range : {PixelFormat::FULL, PixelFormat::NARROW})
+                {
+                    const PixelFormat    f(type, range);
+                    std::vector<uint8_t> codes(f.bytes(count));
+                    for (size_t i = 0; i < work.size(); i++)
+                        work[i] = (float)((i * 37) % 101) / 100.f;
+                    f.pack(work.data(), codes.data(), count, 4);
+                    std::vector<uint16_t> got(count * 4), want(count * 4);
+                    q.apply(f, codes.data(), wide, got.data(), count);
+                    std::fill(work.begin(), work.end(), 1.f); // opaque when the input has no alpha
+                    f.unpack(codes.data(), work.data(), count, 4);
+                    q.apply(work.data(), work.data(), count, 4, 4);
+                    wide.pack(work.data(), want.data(), count, 4);
+                    REQUIRE(got == want);
+                }
+        }
+    }
+}
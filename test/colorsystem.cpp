@@ -24,7 +24,7 @@ TEST_CASE("toXYZ", "[XYZ]")
     SECTION("adobe.toXYZ (white)")
     {
         const ColorSystem::Tristimulus white(1, 1, 1);
-        auto const &                   v3 = ColorSystem::AdobeRGB.toXYZ(white).vec3();
+        const auto                     v3 = ColorSystem::AdobeRGB.toXYZ(white).vec3();
         REQUIRE_THAT(v3, IsApproxEquals(ColorSystem::Vector3{0.950456f, 1.000000f, 1.089058f}, epsilon));
     }
 }
@@ -40,7 +40,7 @@ TEST_CASE("fromXYZ", "[XYZ]")
     SECTION("adobe.fromXYZ (white)")
     {
         ColorSystem::Tristimulus white(1, 1, 1);
-        auto const &             v = ColorSystem::AdobeRGB.fromXYZ(white).vec3();
+        const auto               v = ColorSystem::AdobeRGB.fromXYZ(white).vec3();
         REQUIRE_THAT(v, IsApproxEquals(ColorSystem::Vector3{1.131850f, 0.948279f, 0.910257f}, epsilon));
     }
 }
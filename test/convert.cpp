@@ -0,0 +1,62 @@
+// "colorsystem"
+// copyright 2017 (c) Hajime UCHIMURA / @nikq
+// all rights reserved
+#include "common.hpp"
+
+#include "TestUtilities.hpp"
+
+#include <colorsystem.hpp>
+
+namespace
+{
+// the same conversion through the runtime Pipeline.
+template <typename C>
+void matchesPipeline(const ColorSystem::Pipeline &p, const float eps)
+{
+    const size_t             count = 1003;
+    const std::vector<float> src   = makePixels(count, 4);
+    std::vector<float>       expected(count * 3), dst(count * 3);
+    p.apply(src.data(), expected.data(), count, 4, 3);
+    C::apply(src.data(), dst.data(), count, 4, 3);
+    for (size_t i = 0; i < count; i++)
+    {
+        const ColorSystem::Tristimulus e(expected[i * 3 + 0], expected[i * 3 + 1], expected[i * 3 + 2]);
+        REQUIRE_THAT(ColorSystem::Tristimulus(dst[i * 3 + 0], dst[i * 3 + 1], dst[i * 3 + 2]), IsApproxEquals(e, eps));
+        REQUIRE_THAT(C::apply(ColorSystem::Tristimulus(src[i * 4 + 0], src[i * 4 + 1], src[i * 4 + 2])),
+            IsApproxEquals(e, eps));
+    }
+}
+} // namespace
+
+TEST_CASE("Convert", "[convert]")
+{
+    using ColorSystem::Convert;
+    using ColorSystem::OTF;
+    using ColorSystem::Pipeline;
+    SECTION("matrix is a constant")
+    {
+        constexpr ColorSystem::Matrix3 m = Convert<ColorSystem::ACES2065, ColorSystem::ACEScg>::matrix();
+        REQUIRE_THAT(m, IsApproxEquals(ColorSystem::GamutConvert(ColorSystem::ACES2065, ColorSystem::ACEScg), 0.f));
+    }
+    SECTION("linear")
+    {
+        matchesPipeline<Convert<ColorSystem::Rec709, ColorSystem::XYZ>>(
+            Pipeline({Pipeline::matrix(ColorSystem::Rec709.toXYZ())}), 1e-6f);
+    }
+    SECTION("sRGB to PQ")
+    {
+        matchesPipeline<Convert<ColorSystem::Rec709, ColorSystem::Rec2020, OTF::SRGB, OTF::ST2084>>(
+            Pipeline({Pipeline::decode(OTF::SRGB),
+                Pipeline::matrix(ColorSystem::GamutConvert(ColorSystem::Rec709, ColorSystem::Rec2020)),
+                Pipeline::encode(OTF::ST2084)}),
+            1e-5f);
+    }
+    SECTION("HLG to BT709")
+    {
+        matchesPipeline<Convert<ColorSystem::Rec2020, ColorSystem::Rec709, OTF::HLG, OTF::BT709>>(
+            Pipeline({Pipeline::decode(OTF::HLG),
+                Pipeline::matrix(ColorSystem::GamutConvert(ColorSystem::Rec2020, ColorSystem::Rec709)),
+                Pipeline::encode(OTF::BT709)}),
+            1e-5f);
+    }
+}
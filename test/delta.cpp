@@ -0,0 +1,137 @@
+// "colorsystem"
+// copyright 2017 (c) Hajime UCHIMURA / @nikq
+// all rights reserved
+#include "common.hpp"
+
+#include "TestUtilities.hpp"
+
+#include <algorithm>
+#include <colorsystem.hpp>
+
+namespace
+{
+// exact nearest rank, what the sketch approximates.
+float quantile(std::vector<float> v, const double q)
+{
+    std::sort(v.begin(), v.end());
+    return v[(size_t)(q * (v.size() - 1))];
+}
+} // namespace
+
+TEST_CASE("Delta stats", "[delta]")
+{
+    SECTION("sketch")
+    {
+        std::vector<float>         values;
+        ColorSystem::Delta::Sketch sketch(0.01);
+        for (size_t i = 0; i < 100000; i++)
+        {
+            // spread over 6 decades with some exact zeros.
+            const float v = (i % 97 == 0) ? 0.f : powf(10.f, (float)((i * 7919) % 100000) / 100000.f * 6.f - 3.f);
+            values.push_back(v);
+            sketch.add(v);
+        }
+        REQUIRE(sketch.count() == values.size());
+        for (const double q : {0.0, 0.001, 0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.99, 0.999, 1.0})
+        {
+            const float exact = quantile(values, q);
+            // alpha itself, plus the float rounding of the returned value.
+            REQUIRE(fabs((double)sketch.quantile(q) - exact) <= (0.01 + 1e-6) * exact);
+        }
+    }
+    SECTION("bounded")
+    {
+        ColorSystem::Delta::Sketch sketch(0.01, 64);
+        for (int e = -20; e < 20; e++)
+        {
+            sketch.add(powf(2.f, (float)e));
+        }
+        REQUIRE(sketch.buckets_.size() <= 64);
+        REQUIRE(sketch.quantile(1.0) == Approx(powf(2.f, 19.f)).epsilon(0.01));
+        REQUIRE(sketch.quantile(0.0) < powf(2.f, -5.f)); // the low end is folded
+    }
+    SECTION("histogram")
+    {
+        ColorSystem::Delta::Histogram h(10, 0.f, 5.f);
+        for (const float v : {-1.f, 0.f, 0.49f, 0.5f, 2.5f, 4.99f, 5.f, 100.f})
+        {
+            h.add(v);
+        }
+        REQUIRE(h.under() == 1);
+        REQUIRE(h.over() == 2);
+        REQUIRE(h[0] == 2);
+        REQUIRE(h[1] == 1);
+        REQUIRE(h[5] == 1);
+        REQUIRE(h[9] == 1);
+        REQUIRE(h.lower(5) == 2.5f);
+    }
+    SECTION("metrics")
+    {
+        const size_t       count = 20011;
+        std::vector<float> a(count * 4), b(count * 4);
+        for (size_t i = 0; i < a.size(); i++)
+        {
+            a[i] = (float)((i * 7919) % 1000) / 1000.f;
+            b[i] = a[i] * 0.9f + 0.05f;
+        }
+        ColorSystem::Parallel::ThreadPool pool(3);
+        const ColorSystem::Delta::METRIC  metrics[] = {ColorSystem::Delta::METRIC_UV, ColorSystem::Delta::METRIC_E76,
+            ColorSystem::Delta::METRIC_E00, ColorSystem::Delta::METRIC_ICTCP};
+        for (const ColorSystem::Delta::METRIC metric : metrics)
+        {
+            std::vector<float> d(count);
+            ColorSystem::Delta::difference(metric, a.data(), b.data(), d.data(), count, 4);
+            ColorSystem::Delta::Stats       expected(ColorSystem::Delta::Histogram(16, 0.f, 1.f));
+            const ColorSystem::Delta::Stats empty(expected);
+            expected.add(d.data(), count);
+
+            const ColorSystem::Delta::Stats s =
+                ColorSystem::Delta::stats(pool, metric, a.data(), b.data(), count, 4, empty);
+            REQUIRE(s.count() == count);
+            REQUIRE(s.max() == *std::max_element(d.begin(), d.end()));
+            // tiles are fixed by count, not by the pool, so one thread reduces them to the same bits.
+            ColorSystem::Parallel::ThreadPool one(1);
+            const ColorSystem::Delta::Stats   serial =
+                ColorSystem::Delta::stats(one, metric, a.data(), b.data(), count, 4, empty);
+            REQUIRE(s.mean() == serial.mean());
+            REQUIRE(s.rms() == serial.rms());
+            // one pass over the whole buffer sums in another order, and FMA contraction differs between the inlined
+            // copies of the metric, which moves per pixel values by a float ulp (6e-8): 1e-6 relative covers both.
+            REQUIRE(s.mean() == Approx(expected.mean()).epsilon(1e-6));
+            REQUIRE(s.rms() == Approx(expected.rms()).epsilon(1e-6));
+            for (size_t i = 0; i < 16; i++)
+            {
+                REQUIRE(s.histogram()[i] == expected.histogram()[i]);
+            }
+            REQUIRE(s.histogram().over() == expected.histogram().over());
+            for (const double p : {50., 95., 99.})
+            {
+                const float exact = quantile(d, p / 100.);
+                REQUIRE(fabs(s.percentile(p) - exact) <= 0.0101f * exact + 1e-6f);
+            }
+        }
+    }
+    SECTION("sequence")
+    {
+        // frames reduced one after another into the same Stats, equal to one pass over all of them.
+        const size_t       count = 5000;
+        std::vector<float> a(count * 6), b(count * 6);
+        for (size_t i = 0; i < a.size(); i++)
+        {
+            a[i] = (float)((i * 7919) % 1000) / 10.f - 50.f;
+            b[i] = a[i] + (float)((i * 31) % 100) / 50.f;
+        }
+        ColorSystem::Parallel::ThreadPool &pool = ColorSystem::Parallel::ThreadPool::shared();
+        ColorSystem::Delta::Stats          running;
+        running =
+            ColorSystem::Delta::stats(pool, ColorSystem::Delta::METRIC_E76, a.data(), b.data(), count, 3, running);
+        running = ColorSystem::Delta::stats(pool, ColorSystem::Delta::METRIC_E76, a.data() + count * 3,
+            b.data() + count * 3, count, 3, running);
+        const ColorSystem::Delta::Stats all =
+            ColorSystem::Delta::stats(pool, ColorSystem::Delta::METRIC_E76, a.data(), b.data(), count * 2);
+        REQUIRE(running.count() == all.count());
+        REQUIRE(running.max() == all.max());
+        REQUIRE(running.mean() == Approx(all.mean()).epsilon(1e-12));
+        REQUIRE(running.percentile(90.) == all.percentile(90.));
+    }
+}
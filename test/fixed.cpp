@@ -0,0 +1,196 @@
+// "colorsystem"
+// copyright 2017 (c) Hajime UCHIMURA / @nikq
+// all rights reserved
+#include "common.hpp"
+
+#include "TestUtilities.hpp"
+
+#include <colorsystem.hpp>
+
+namespace
+{
+std::vector<uint16_t> makeCodes(const size_t count, const size_t stride, const int bits)
+{
+    std::vector<uint16_t> p(count * stride);
+    for (size_t i = 0; i < p.size(); i++)
+    {
+        p[i] = (uint16_t)((i * 7919) % (1u << bits));
+    }
+    return p;
+}
+// the same conversion through the exact float curves, narrow range.
+int reference(const ColorSystem::OTF::TYPE in, const ColorSystem::Matrix3 &m, const ColorSystem::OTF::TYPE out,
+    const uint16_t *code, const int channel, const int bits)
+{
+    const float                    k = (float)(1 << (bits - 8));
+    ColorSystem::Tristimulus       s((code[0] - 16.f * k) / (219.f * k), (code[1] - 16.f * k) / (219.f * k),
+        (code[2] - 16.f * k) / (219.f * k));
+    const ColorSystem::Tristimulus l = ColorSystem::OTF::toScene(in, s.clip(0.f, 1.f)).apply(m);
+    const float v = ColorSystem::OTF::toScreen(out, l.clip(0.f, ColorSystem::LUT1D::sceneRange(out)))[channel];
+    return (int)(v * 219.f * k + 16.f * k + 0.5f);
+}
+} // namespace
+
+TEST_CASE("FixedMatrix3", "[fixed]")
+{
+    const ColorSystem::Matrix3      m = ColorSystem::GamutConvert(ColorSystem::Rec709, ColorSystem::Rec2020);
+    const ColorSystem::FixedMatrix3 f(m);
+    REQUIRE(f.shift_ == 15);
+    REQUIRE_THAT(f.toMatrix3(), IsApproxEquals(m, 1.f / 32768.f));
+    for (int row = 0; row < 3; row++)
+        REQUIRE(f.c_[row * 3] + f.c_[row * 3 + 1] + f.c_[row * 3 + 2] == 32768); // white stays white
+
+    // identity passes the full 16 bit range, 65536 * 65535 would not fit in 32 bits
+    const ColorSystem::FixedMatrix3 identity;
+    REQUIRE(identity.shift_ == 15);
+    REQUIRE(identity.c_[0] == 32768);
+
+    // wide matrices give up precision rather than overflow
+    const ColorSystem::FixedMatrix3 w(ColorSystem::GamutConvert(ColorSystem::ACES2065, ColorSystem::Rec709));
+    REQUIRE(w.shift_ < 15);
+    // down to the last shift, with the coefficients of that shift
+    const ColorSystem::Matrix3      huge(10000.f, 0.f, 0.f, 0.f, 10000.f, 0.f, 0.f, 0.f, 10000.f);
+    const ColorSystem::FixedMatrix3 h(huge);
+    REQUIRE(h.shift_ == 1);
+    REQUIRE(h.c_[0] == 20000);
+    REQUIRE_THAT(h.toMatrix3(), IsApproxEquals(huge, 0.f));
+
+    // every kernel gives the same bits
+    const size_t         count = 1003;
+    std::vector<int32_t> r(count), g(count), b(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        r[i] = (int32_t)((i * 7919) % 65536), g[i] = (int32_t)((i * 104729) % 65536), b[i] = (int32_t)((i * 31) % 65536);
+    }
+    const ColorSystem::SIMD::ISA saved = ColorSystem::SIMD::isa();
+    std::vector<int32_t>         expected;
+    for (int level = ColorSystem::SIMD::SCALAR; level <= ColorSystem::SIMD::supported(); level++)
+    {
+        ColorSystem::SIMD::setISA((ColorSystem::SIMD::ISA)level);
+        std::vector<int32_t> x(count), y(count), z(count);
+        w.apply(r.data(), g.data(), b.data(), x.data(), y.data(), z.data(), count);
+        x.insert(x.end(), y.begin(), y.end());
+        x.insert(x.end(), z.begin(), z.end());
+        if (expected.empty())
+            expected = x;
+        REQUIRE(x == expected);
+    }
+    ColorSystem::SIMD::setISA(saved);
+    for (const int32_t v : expected)
+    {
+        REQUIRE(v >= 0);
+        REQUIRE(v <= 65535);
+    }
+    for (int level = ColorSystem::SIMD::SCALAR; level <= ColorSystem::SIMD::supported(); level++)
+    {
+        ColorSystem::SIMD::setISA((ColorSystem::SIMD::ISA)level);
+        std::vector<int32_t> x(count), y(count), z(count);
+        identity.apply(r.data(), g.data(), b.data(), x.data(), y.data(), z.data(), count);
+        REQUIRE(x == r);
+        REQUIRE(y == g);
+        REQUIRE(z == b);
+        const std::vector<int32_t> white(count, 65535);
+        identity.apply(white.data(), white.data(), white.data(), x.data(), y.data(), z.data(), count);
+        REQUIRE(x == white);
+        REQUIRE(y == white);
+        REQUIRE(z == white);
+    }
+    ColorSystem::SIMD::setISA(saved);
+
+    // 30 bit values summed in 64 bits, clamped to the given top
+    const int32_t top = (1 << 30) - 1;
+    for (size_t i = 0; i < count; i++)
+    {
+        r[i] = (int32_t)((i * 7919 * 16411) % (1u << 30)), g[i] = (int32_t)((i * 104729 * 31) % (1u << 30));
+        b[i] = (i % 5 == 0) ? top : (int32_t)((i * 31) % 65536);
+    }
+    expected.clear();
+    for (int level = ColorSystem::SIMD::SCALAR; level <= ColorSystem::SIMD::supported(); level++)
+    {
+        ColorSystem::SIMD::setISA((ColorSystem::SIMD::ISA)level);
+        std::vector<int32_t> x(count), y(count), z(count);
+        identity.applyWide(r.data(), g.data(), b.data(), x.data(), y.data(), z.data(), count, top);
+        REQUIRE(x == r);
+        REQUIRE(z == b);
+        w.applyWide(r.data(), g.data(), b.data(), x.data(), y.data(), z.data(), count, top);
+        x.insert(x.end(), y.begin(), y.end());
+        x.insert(x.end(), z.begin(), z.end());
+        if (expected.empty())
+            expected = x;
+        REQUIRE(x == expected);
+    }
+    ColorSystem::SIMD::setISA(saved);
+    REQUIRE(*std::min_element(expected.begin(), expected.end()) == 0);
+    REQUIRE(*std::max_element(expected.begin(), expected.end()) == top);
+}
+
+TEST_CASE("FixedPipeline", "[fixed]")
+{
+    using ColorSystem::OTF;
+    const size_t               count = 10007;
+    const ColorSystem::Matrix3 m     = ColorSystem::GamutConvert(ColorSystem::Rec709, ColorSystem::Rec2020);
+    SECTION("matches the float curves")
+    {
+        const struct
+        {
+            OTF::TYPE in, out;
+            int       bits, tolerance;
+        } cases[] = {{OTF::BT709, OTF::BT709, 10, 1}, {OTF::SRGB, OTF::ST2084, 10, 1}, {OTF::HLG, OTF::HLG, 10, 1},
+            {OTF::BT709, OTF::BT709, 12, 1}, {OTF::ST2084, OTF::ST2084, 10, 1}};
+        for (const auto &c : cases)
+        {
+            const ColorSystem::FixedPipeline p(c.in, m, c.out, c.bits, c.bits);
+            const std::vector<uint16_t>      src = makeCodes(count, 3, c.bits);
+            std::vector<uint16_t>            dst(count * 3);
+            p.apply(src.data(), dst.data(), count);
+            int worst = 0;
+            for (size_t i = 0; i < count; i++)
+            {
+                for (int k = 0; k < 3; k++)
+                    worst = std::max(worst, std::abs(dst[i * 3 + k] - reference(c.in, m, c.out, &src[i * 3], k, c.bits)));
+            }
+            REQUIRE(worst <= c.tolerance);
+        }
+    }
+    SECTION("gray ramps near black")
+    {
+        // every code of a gray ramp, where the HDR curves are steepest against linear light
+        const struct
+        {
+            OTF::TYPE in, out;
+        } cases[] = {{OTF::ST2084, OTF::ST2084}, {OTF::HLG, OTF::HLG}, {OTF::BT709, OTF::ST2084}};
+        for (const auto &c : cases)
+        {
+            for (const ColorSystem::Matrix3 &g : {ColorSystem::Matrix3(), m})
+            {
+                const ColorSystem::FixedPipeline p(c.in, g, c.out);
+                REQUIRE(*std::min_element(p.encode_.begin(), p.encode_.end()) >= 4); // SDI reserves 0-3
+                REQUIRE(*std::max_element(p.encode_.begin(), p.encode_.end()) <= 1019); // and 1020-1023
+                std::vector<uint16_t> src(1024 * 3), dst(1024 * 3);
+                for (size_t i = 0; i < src.size(); i++)
+                    src[i] = (uint16_t)(i / 3);
+                p.apply(src.data(), dst.data(), 1024);
+                for (size_t i = 0; i < 1024; i++)
+                {
+                    for (int k = 0; k < 3; k++)
+                        REQUIRE(std::abs(dst[i * 3 + k] - reference(c.in, g, c.out, &src[i * 3], k, 10)) <= 1);
+                }
+            }
+        }
+    }
+    SECTION("tables reproduce the output")
+    {
+        const ColorSystem::FixedPipeline p(OTF::BT709, m, OTF::ST2084);
+        const ColorSystem::FixedPipeline q(p.decode_, p.matrix_, p.encode_);
+        const std::vector<uint16_t>      src = makeCodes(count, 4, 10);
+        std::vector<uint16_t>            a(count * 4, 7), b(count * 4, 7);
+        p.apply(src.data(), a.data(), count, 4, 4);
+        q.apply(src.data(), b.data(), count, 4, 4);
+        REQUIRE(a == b);
+        REQUIRE(a[3] == 7); // alpha slot untouched
+        std::vector<uint16_t> inplace(src);
+        p.apply(inplace.data(), inplace.data(), count, 4, 4);
+        for (size_t i = 0; i < count * 4; i++)
+            REQUIRE(inplace[i] == ((i % 4 == 3) ? src[i] : a[i]));
+    }
+}
@@ -0,0 +1,115 @@
+// "colorsystem"
+// copyright 2017 (c) Hajime UCHIMURA / @nikq
+// all rights reserved
+#include "common.hpp"
+
+#include "TestUtilities.hpp"
+
+#include <colorsystem.hpp>
+
+namespace
+{
+std::vector<ColorSystem::half> makeHalves(const size_t count, const size_t stride, const float scale = 1.f)
+{
+    std::vector<ColorSystem::half> p(count * stride);
+    for (size_t i = 0; i < p.size(); i++)
+    {
+        p[i] = ColorSystem::half(scale * (float)((i * 7919) % 1000) / 1000.f);
+    }
+    return p;
+}
+std::vector<float> widen(const std::vector<ColorSystem::half> &h)
+{
+    std::vector<float> f(h.size());
+    ColorSystem::Half::toFloat(h.data(), f.data(), h.size());
+    return f;
+}
+// half keeps 11 significant bits.
+void requireHalfClose(const std::vector<ColorSystem::half> &h, const std::vector<float> &f, const float margin = 0.f,
+    const float epsilon = 1.f / 1024.f)
+{
+    REQUIRE(h.size() == f.size());
+    for (size_t i = 0; i < f.size(); i++)
+    {
+        REQUIRE((float)h[i] == Approx(f[i]).epsilon(epsilon).margin(margin));
+    }
+}
+} // namespace
+
+TEST_CASE("half pixels", "[half]")
+{
+    const size_t count = 1003;
+    SECTION("bulk conversion matches the portable code")
+    {
+        std::vector<uint16_t> bits(0x10000);
+        for (size_t i = 0; i < bits.size(); i++)
+            bits[i] = (uint16_t)i;
+        std::vector<float> floats(1 << 20);
+        for (size_t i = 0; i < floats.size(); i++)
+        {
+            const uint32_t u = (uint32_t)(i * 2654435761u); // all exponents, both signs
+            memcpy(&floats[i], &u, sizeof(u));
+        }
+        const ColorSystem::SIMD::ISA saved = ColorSystem::SIMD::isa();
+        std::vector<float>           wide[2];
+        std::vector<uint16_t>        narrow[2];
+        for (int k = 0; k < 2; k++)
+        {
+            ColorSystem::SIMD::setISA(k ? ColorSystem::SIMD::supported() : ColorSystem::SIMD::SCALAR);
+            wide[k].resize(bits.size());
+            narrow[k].resize(floats.size());
+            ColorSystem::Half::toFloat(bits.data(), wide[k].data(), bits.size());
+            ColorSystem::Half::fromFloat(floats.data(), narrow[k].data(), floats.size());
+        }
+        ColorSystem::SIMD::setISA(saved);
+        REQUIRE(memcmp(wide[0].data(), wide[1].data(), wide[0].size() * sizeof(float)) == 0);
+        for (size_t i = 0; i < floats.size(); i++)
+            REQUIRE(narrow[0][i] == narrow[1][i]);
+    }
+    SECTION("gamut and OTF")
+    {
+        const std::vector<ColorSystem::half> src = makeHalves(count, 4);
+        const std::vector<float>             f   = widen(src);
+        std::vector<ColorSystem::half>       dst(src);
+        std::vector<float>                   expected(f);
+        ColorSystem::GamutConvert(ColorSystem::Rec709, ColorSystem::Rec2020, src.data(), dst.data(), count, 4, 4);
+        ColorSystem::GamutConvert(ColorSystem::Rec709, ColorSystem::Rec2020, f.data(), expected.data(), count, 4, 4);
+        requireHalfClose(dst, expected);
+        for (size_t i = 0; i < count; i++)
+            REQUIRE(dst[i * 4 + 3].bits_ == src[i * 4 + 3].bits_); // alpha untouched
+
+        ColorSystem::OTF::toScreen(ColorSystem::OTF::ST2084, src.data(), dst.data(), src.size());
+        ColorSystem::OTF::toScreen(ColorSystem::OTF::ST2084, f.data(), expected.data(), f.size());
+        requireHalfClose(dst, expected);
+    }
+    SECTION("ICtCp and pipeline")
+    {
+        const std::vector<ColorSystem::half> src = makeHalves(count, 3, 1000.f);
+        const std::vector<float>             f   = widen(src);
+        std::vector<ColorSystem::half>       itp(count * 3);
+        std::vector<float>                   expected(count * 3);
+        ColorSystem::RGB_to_ICtCp(ColorSystem::Rec2020, ColorSystem::OTF::LINEAR, src.data(), itp.data(), count);
+        ColorSystem::RGB_to_ICtCp(ColorSystem::Rec2020, ColorSystem::OTF::LINEAR, f.data(), expected.data(), count);
+        requireHalfClose(itp, expected, 1e-4f);
+        std::vector<ColorSystem::half> back(count * 3);
+        ColorSystem::ICtCp_to_RGB(ColorSystem::Rec2020, ColorSystem::OTF::LINEAR, itp.data(), back.data(), count);
+        // I, Ct, Cp at half precision: the error follows the brightest channel of the pixel
+        for (size_t i = 0; i < count; i++)
+        {
+            const ColorSystem::Tristimulus t(f[i * 3 + 0], f[i * 3 + 1], f[i * 3 + 2]);
+            REQUIRE_THAT(ColorSystem::Tristimulus((float)back[i * 3 + 0], (float)back[i * 3 + 1], (float)back[i * 3 + 2]),
+                IsApproxEquals(t, 5e-3f * (1.f + t.max3())));
+        }
+
+        using ColorSystem::Pipeline;
+        const Pipeline p({Pipeline::decode(ColorSystem::OTF::SRGB),
+            Pipeline::matrix(ColorSystem::GamutConvert(ColorSystem::Rec709, ColorSystem::Rec2020)),
+            Pipeline::encode(ColorSystem::OTF::BT709)});
+        const std::vector<ColorSystem::half> rgb  = makeHalves(count, 3);
+        const std::vector<float>             rgbf = widen(rgb);
+        std::vector<ColorSystem::half>       out(count * 3);
+        p.apply(rgb.data(), out.data(), count);
+        p.apply(rgbf.data(), expected.data(), count);
+        requireHalfClose(out, expected, 1e-3f);
+    }
+}
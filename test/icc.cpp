@@ -0,0 +1,254 @@
+// "colorsystem"
+// copyright 2017 (c) Hajime UCHIMURA / @nikq
+// all rights reserved
+#include "common.hpp"
+
+#include "TestUtilities.hpp"
+
+#include <colorsystem.hpp>
+
+namespace
+{
+using ColorSystem::ICCProfile;
+using ColorSystem::MemoryStream;
+
+void putTag(MemoryStream &s, const char *sig, const uint32_t offset, const uint32_t length)
+{
+    s.putUint32(ICCProfile::signature(sig));
+    s.putUint32(offset);
+    s.putUint32(length);
+}
+void putS15Fixed16(MemoryStream &s, const float v) { s.putInt32((int32_t)lrintf(v * 65536.f)); }
+void putXYZ(MemoryStream &s, const ColorSystem::Tristimulus &t)
+{
+    s.putUint32(ICCProfile::signature("XYZ "));
+    s.putUint32(0);
+    putS15Fixed16(s, t[0]);
+    putS15Fixed16(s, t[1]);
+    putS15Fixed16(s, t[2]);
+}
+
+// matrix/TRC RGB profile for the given gamut. v4 style (D50 wtpt plus chad) or v2 style (media white in wtpt).
+// trc: 0 para sRGB, 1 curv gamma, 2 curv table
+std::vector<uint8_t> makeProfile(const ColorSystem::Gamut &gamut, const ColorSystem::Tristimulus &white,
+    const bool v4, const int trc)
+{
+    const ColorSystem::Matrix3 chad = ColorSystem::Bradford(white, ColorSystem::Illuminant_D50);
+    const ColorSystem::Matrix3 pcs  = chad.mul(gamut.toXYZ());
+    MemoryStream               s;
+    s.setWriteEndian(MemoryStream::BIG);
+    const int      tags     = v4 ? 8 : 7;
+    const uint32_t xyzAt    = 132 + tags * 12;
+    const uint32_t chadAt   = xyzAt + 4 * 20;
+    const uint32_t trcAt    = chadAt + (v4 ? 44 : 0);
+    const uint32_t trcBytes = (trc == 0) ? 12 + 5 * 4 : (trc == 1) ? 14 : 12 + 1024 * 2;
+
+    // header
+    s.putUint32(0); // size, patched below
+    s.putUint32(0);
+    s.putUint32(v4 ? 0x04200000 : 0x02100000);
+    s.putUint32(ICCProfile::signature("mntr"));
+    s.putUint32(ICCProfile::signature("RGB "));
+    s.putUint32(ICCProfile::signature("XYZ "));
+    while (s.ftell() < 36)
+        s.putUint8(0);
+    s.putUint32(ICCProfile::signature("acsp"));
+    while (s.ftell() < 128)
+        s.putUint8(0);
+
+    // tag table. the three TRC tags share one curve.
+    s.putUint32(tags);
+    putTag(s, "rXYZ", xyzAt, 20);
+    putTag(s, "gXYZ", xyzAt + 20, 20);
+    putTag(s, "bXYZ", xyzAt + 40, 20);
+    putTag(s, "wtpt", xyzAt + 60, 20);
+    if (v4)
+        putTag(s, "chad", chadAt, 44);
+    putTag(s, "rTRC", trcAt, trcBytes);
+    putTag(s, "gTRC", trcAt, trcBytes);
+    putTag(s, "bTRC", trcAt, trcBytes);
+
+    putXYZ(s, ColorSystem::Tristimulus(pcs[0], pcs[3], pcs[6]));
+    putXYZ(s, ColorSystem::Tristimulus(pcs[1], pcs[4], pcs[7]));
+    putXYZ(s, ColorSystem::Tristimulus(pcs[2], pcs[5], pcs[8]));
+    putXYZ(s, v4 ? ColorSystem::Illuminant_D50 : white);
+    if (v4)
+    {
+        s.putUint32(ICCProfile::signature("sf32"));
+        s.putUint32(0);
+        for (int i = 0; i < 9; i++)
+            putS15Fixed16(s, chad[i]);
+    }
+    if (trc == 0)
+    {
+        s.putUint32(ICCProfile::signature("para"));
+        s.putUint32(0);
+        s.putUint16(3);
+        s.putUint16(0);
+        putS15Fixed16(s, 2.4f);
+        putS15Fixed16(s, 1.f / 1.055f);
+        putS15Fixed16(s, 0.055f / 1.055f);
+        putS15Fixed16(s, 1.f / 12.92f);
+        putS15Fixed16(s, 0.04045f);
+    }
+    else if (trc == 1)
+    {
+        s.putUint32(ICCProfile::signature("curv"));
+        s.putUint32(0);
+        s.putUint32(1);
+        s.putUint16(563); // 2.2 in u8Fixed8
+    }
+    else
+    {
+        s.putUint32(ICCProfile::signature("curv"));
+        s.putUint32(0);
+        s.putUint32(1024);
+        for (int i = 0; i < 1024; i++)
+            s.putUint16((uint16_t)lrintf(65535.f * powf(i / 1023.f, 1.8f)));
+    }
+    std::vector<uint8_t> profile = s.buffer();
+    const uint32_t       size    = (uint32_t)profile.size();
+    profile[0]                   = size >> 24;
+    profile[1]                   = size >> 16;
+    profile[2]                   = size >> 8;
+    profile[3]                   = size;
+    return profile;
+}
+} // namespace
+
+TEST_CASE("ICC profile", "[icc]")
+{
+    SECTION("v4 sRGB, parametric curve")
+    {
+        const std::vector<uint8_t> data = makeProfile(ColorSystem::Rec709, ColorSystem::Illuminant_D65, true, 0);
+        const ICCProfile           profile(data.data(), data.size());
+        REQUIRE(profile.valid_);
+        REQUIRE(profile.hasChad_);
+        REQUIRE(profile.version_ == 0x04200000);
+        REQUIRE(profile.trc_[0].type_ == ICCProfile::Curve::PARAMETRIC);
+        REQUIRE_THAT(profile.toXYZ(), IsApproxEquals(ColorSystem::Rec709.toXYZ(), 1e-4f));
+        for (int i = 0; i <= 100; i++)
+        {
+            const float x = i / 100.f;
+            REQUIRE(profile.trc_[1](x) == Approx(ColorSystem::OTF::sRGB_to_Y(x)).margin(1e-4f));
+            REQUIRE(profile.trc_[1].inverse(profile.trc_[1](x)) == Approx(x).margin(1e-5f));
+        }
+        const ColorSystem::Gamut gamut = ColorSystem::loadGamutFromICCProfileMemory(data.data(), data.size());
+        REQUIRE_THAT(gamut.fromXYZ(), IsApproxEquals(ColorSystem::Rec709.fromXYZ(), 1e-3f));
+    }
+    SECTION("v2 Rec.2020, gamma curve, media white")
+    {
+        const std::vector<uint8_t> data = makeProfile(ColorSystem::Rec2020, ColorSystem::Illuminant_D65, false, 1);
+        const ICCProfile           profile(data.data(), data.size());
+        REQUIRE(profile.valid_);
+        REQUIRE_FALSE(profile.hasChad_);
+        REQUIRE(profile.trc_[2].type_ == ICCProfile::Curve::GAMMA);
+        REQUIRE(profile.trc_[2].param_[0] == Approx(2.2f).margin(1e-2f));
+        REQUIRE_THAT(profile.toXYZ(), IsApproxEquals(ColorSystem::Rec2020.toXYZ(), 1e-4f));
+    }
+    SECTION("table curve")
+    {
+        const std::vector<uint8_t> data = makeProfile(ColorSystem::AdobeRGB, ColorSystem::Illuminant_D65, true, 2);
+        const ICCProfile           profile(data.data(), data.size());
+        REQUIRE(profile.valid_);
+        REQUIRE(profile.trc_[0].type_ == ICCProfile::Curve::TABLE);
+        REQUIRE(profile.trc_[0].table_.size() == 1024);
+        for (int i = 0; i <= 100; i++)
+        {
+            const float x = i / 100.f;
+            REQUIRE(profile.trc_[0](x) == Approx(powf(x, 1.8f)).margin(1e-4f));
+        }
+        // the tone curve bakes straight into a LUT1D
+        const ColorSystem::LUT1D lut(profile.trc_[0], 256);
+        REQUIRE(lut(0.5f) == Approx(powf(0.5f, 1.8f)).margin(1e-4f));
+    }
+    SECTION("broken input")
+    {
+        std::vector<uint8_t> data = makeProfile(ColorSystem::Rec709, ColorSystem::Illuminant_D65, true, 0);
+        REQUIRE_FALSE(ICCProfile(data.data(), 100).valid_);
+        REQUIRE_FALSE(ICCProfile(data.data(), data.size() - 8).valid_); // size field beyond the data
+        REQUIRE_FALSE(ICCProfile(NULL, 0).valid_);
+        data[36] = 'x';
+        REQUIRE_FALSE(ICCProfile(data.data(), data.size()).valid_);
+        const ColorSystem::Gamut gamut = ColorSystem::loadGamutFromICCProfileMemory(data.data(), data.size());
+        REQUIRE_THAT(gamut.toXYZ(), IsApproxEquals(ColorSystem::Matrix3(), 1e-6f));
+    }
+}
+
+TEST_CASE("ICC profile cache", "[icc]")
+{
+    ColorSystem::ICCProfileCache cache;
+    std::vector<uint8_t>         a = makeProfile(ColorSystem::Rec709, ColorSystem::Illuminant_D65, true, 0);
+    std::vector<uint8_t>         b = makeProfile(ColorSystem::Rec2020, ColorSystem::Illuminant_D65, true, 0);
+
+    SECTION("content hash")
+    {
+        const std::vector<uint8_t>                  copy = a;
+        const ColorSystem::ICCProfileCache::Profile p    = cache.load(a.data(), a.size());
+        REQUIRE(p->valid_);
+        REQUIRE(cache.load(copy.data(), copy.size()) == p);
+        REQUIRE(cache.load(b.data(), b.size()) != p);
+        REQUIRE(cache.size() == 2);
+    }
+    SECTION("profile id")
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            a[84 + i] = (uint8_t)(i + 1);
+            b[84 + i] = (uint8_t)(i + 1);
+        }
+        // same ID, so the second profile is taken for the first one without being read
+        const ColorSystem::ICCProfileCache::Profile p = cache.load(a.data(), a.size());
+        REQUIRE(cache.load(b.data(), b.size()) == p);
+        REQUIRE(cache.size() == 1);
+        REQUIRE(p->id_[15] == 16);
+    }
+    SECTION("broken profiles are cached as invalid")
+    {
+        const ColorSystem::ICCProfileCache::Profile p = cache.load(a.data(), 64);
+        REQUIRE_FALSE(p->valid_);
+        REQUIRE(cache.load(a.data(), 64) == p);
+        REQUIRE_THAT(p->gamut().toXYZ(), IsApproxEquals(ColorSystem::Matrix3(), 1e-6f));
+        // no buffer at all, whatever size comes with it
+        const ColorSystem::ICCProfileCache::Profile none = cache.load(NULL, a.size());
+        REQUIRE_FALSE(none->valid_);
+        REQUIRE(cache.load(NULL, 4096) == none);
+        REQUIRE(ColorSystem::ICCProfileCache::key(NULL, 4096) == ColorSystem::ICCProfileCache::key(NULL, 0));
+    }
+    SECTION("file")
+    {
+        const char *path = "colortest_profile.icc";
+        FILE *      fp   = fopen(path, "wb");
+        REQUIRE(fp != NULL);
+        fwrite(a.data(), 1, a.size(), fp);
+        fclose(fp);
+        {
+            const ColorSystem::MappedFile file(path);
+            REQUIRE(file.valid());
+            REQUIRE(file.size() == a.size());
+            REQUIRE(memcmp(file.data(), a.data(), a.size()) == 0);
+        }
+        const ColorSystem::ICCProfileCache::Profile p = cache.loadFile(path);
+        REQUIRE(p == cache.load(a.data(), a.size()));
+        const ColorSystem::Gamut gamut = ColorSystem::loadGamutFromICCProfileFile(path);
+        REQUIRE_THAT(gamut.toXYZ(), IsApproxEquals(ColorSystem::Rec709.toXYZ(), 1e-4f));
+        // the gamut comes from the cached profile as built by parse, not recomputed
+        REQUIRE(&p->gamut() == &cache.load(a.data(), a.size())->gamut());
+        REQUIRE(memcmp(&p->gamut().toXYZ_, &gamut.toXYZ_, sizeof(gamut.toXYZ_)) == 0);
+        std::remove(path);
+        REQUIRE_FALSE(ColorSystem::MappedFile(path).valid());
+        REQUIRE(cache.loadFile(path) == nullptr);
+    }
+    SECTION("threads")
+    {
+        ColorSystem::Parallel::ThreadPool                  pool(4);
+        std::vector<ColorSystem::ICCProfileCache::Profile> got(64);
+        ColorSystem::Parallel::forEach(pool, got.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                got[i] = (i & 1) ? cache.load(a.data(), a.size()) : cache.load(b.data(), b.size());
+        });
+        REQUIRE(cache.size() == 2);
+        for (size_t i = 2; i < got.size(); i++)
+            REQUIRE(got[i] == got[i & 1]);
+    }
+}
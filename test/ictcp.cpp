@@ -0,0 +1,163 @@
+// "colorsystem"
+// copyright 2017 (c) Hajime UCHIMURA / @nikq
+// all rights reserved
+#include "common.hpp"
+
+#include "TestUtilities.hpp"
+
+#include <colorsystem.hpp>
+
+namespace
+{
+// XYZ of Rec.2020 colors up to 1000 nits, the range HDR QC sees. some have a negative Bradford LMS component,
+// which PQ clips, so those only round trip approximately and are skipped there.
+std::vector<float> makeXYZ(const size_t count)
+{
+    std::vector<float> p(count * 3);
+    for (size_t i = 0; i < count; i++)
+    {
+        const ColorSystem::Tristimulus rgb((float)((i * 7919) % 10000) / 10.f, (float)((i * 104729) % 10000) / 10.f,
+            (float)((i * 31) % 10000) / 10.f);
+        const ColorSystem::Tristimulus xyz = ColorSystem::Rec2020.toXYZ(rgb);
+        p[i * 3 + 0]                       = xyz[0];
+        p[i * 3 + 1]                       = xyz[1];
+        p[i * 3 + 2]                       = xyz[2];
+    }
+    return p;
+}
+bool inRange(const ColorSystem::Tristimulus &xyz)
+{
+    const ColorSystem::Tristimulus lms = ColorSystem::LMS.fromXYZ(xyz);
+    return lms[0] >= 0.f && lms[1] >= 0.f && lms[2] >= 0.f;
+}
+} // namespace
+
+TEST_CASE("ICtCp", "[ictcp]")
+{
+    const size_t             count = 10007;
+    const std::vector<float> xyz   = makeXYZ(count);
+    SECTION("round trip")
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            const ColorSystem::Tristimulus t(xyz[i * 3 + 0], xyz[i * 3 + 1], xyz[i * 3 + 2]);
+            if (inRange(t))
+            {
+                REQUIRE_THAT(ColorSystem::ICtCp_to_XYZ(ColorSystem::XYZ_to_ICtCp(t)),
+                    IsApproxEquals(t, 1e-4f * (1.f + t.max3())));
+            }
+        }
+    }
+    SECTION("batch")
+    {
+        std::vector<float> itp(count * 4), back(count * 3);
+        ColorSystem::XYZ_to_ICtCp(xyz.data(), itp.data(), count, 3, 4);
+        ColorSystem::ICtCp_to_XYZ(itp.data(), back.data(), count, 4, 3);
+        for (size_t i = 0; i < count; i++)
+        {
+            const ColorSystem::Tristimulus t(xyz[i * 3 + 0], xyz[i * 3 + 1], xyz[i * 3 + 2]);
+            const ColorSystem::Tristimulus expected = ColorSystem::XYZ_to_ICtCp(t);
+            REQUIRE(itp[i * 4 + 0] == Approx(expected[0]).margin(1e-5f));
+            REQUIRE(itp[i * 4 + 1] == Approx(expected[1]).margin(1e-4f));
+            REQUIRE(itp[i * 4 + 2] == Approx(expected[2]).margin(1e-4f));
+            if (inRange(t))
+            {
+                REQUIRE_THAT(ColorSystem::Tristimulus(back[i * 3 + 0], back[i * 3 + 1], back[i * 3 + 2]),
+                    IsApproxEquals(t, 2e-4f * (1.f + t.max3())));
+            }
+        }
+    }
+    SECTION("delta ITP")
+    {
+        std::vector<float> other(xyz);
+        for (size_t i = 0; i < other.size(); i++)
+        {
+            other[i] *= 1.02f;
+        }
+        std::vector<float> d(count);
+        ColorSystem::Delta::ICtCp(xyz.data(), other.data(), d.data(), count);
+        double sum = 0.;
+        for (size_t i = 0; i < count; i++)
+        {
+            const ColorSystem::Tristimulus a(xyz[i * 3 + 0], xyz[i * 3 + 1], xyz[i * 3 + 2]);
+            const ColorSystem::Tristimulus b(other[i * 3 + 0], other[i * 3 + 1], other[i * 3 + 2]);
+            REQUIRE(d[i] == Approx(ColorSystem::Delta::ICtCp(a, b)).margin(1e-4f));
+            sum += d[i];
+        }
+        const ColorSystem::Delta::Stats s = ColorSystem::Delta::stats(ColorSystem::Parallel::ThreadPool::shared(),
+            ColorSystem::Delta::METRIC_ICTCP, xyz.data(), other.data(), count);
+        REQUIRE(s.count() == count);
+        REQUIRE(s.mean() == Approx(sum / count).epsilon(1e-9));
+    }
+    SECTION("gamut")
+    {
+        for (size_t i = 0; i < count; i += 7)
+        {
+            const ColorSystem::Tristimulus rgb(ColorSystem::Rec2020.fromXYZ(
+                ColorSystem::Tristimulus(xyz[i * 3 + 0], xyz[i * 3 + 1], xyz[i * 3 + 2])));
+            const ColorSystem::Tristimulus itp = ColorSystem::RGB_to_ICtCp(ColorSystem::Rec2020, rgb);
+            // out of gamut Ct and Cp reach ~3, so the tolerance follows the magnitude
+            const ColorSystem::Tristimulus ref = ColorSystem::XYZ_to_ICtCp(ColorSystem::Rec2020.toXYZ(rgb));
+            REQUIRE_THAT(itp, IsApproxEquals(ref, 5e-5f * (1.f + std::max(fabsf(ref[1]), fabsf(ref[2])))));
+            if (inRange(ColorSystem::Rec2020.toXYZ(rgb)))
+            {
+                REQUIRE_THAT(ColorSystem::ICtCp_to_RGB(ColorSystem::Rec2020, itp),
+                    IsApproxEquals(rgb, 1e-4f * (1.f + rgb.max3())));
+            }
+        }
+    }
+    SECTION("Rec.2020 PQ")
+    {
+        // code values straight from and back to a PQ signal.
+        std::vector<float> pq(count * 3), itp(count * 3), back(count * 3);
+        for (size_t i = 0; i < pq.size(); i++)
+        {
+            pq[i] = (float)((i * 7919) % 1000) / 1000.f * 0.75f; // up to ~1000 nits
+        }
+        ColorSystem::RGB_to_ICtCp(ColorSystem::Rec2020, ColorSystem::OTF::ST2084, pq.data(), itp.data(), count);
+        ColorSystem::ICtCp_to_RGB(ColorSystem::Rec2020, ColorSystem::OTF::ST2084, itp.data(), back.data(), count);
+        for (size_t i = 0; i < count; i++)
+        {
+            const ColorSystem::Tristimulus signal(pq[i * 3 + 0], pq[i * 3 + 1], pq[i * 3 + 2]);
+            const ColorSystem::Tristimulus nits =
+                ColorSystem::OTF::toScene(ColorSystem::OTF::ST2084, signal) * 100.f; // 1 = 100 cd/m^2
+            REQUIRE_THAT(ColorSystem::Tristimulus(itp[i * 3 + 0], itp[i * 3 + 1], itp[i * 3 + 2]),
+                IsApproxEquals(ColorSystem::RGB_to_ICtCp(ColorSystem::Rec2020, nits), 1e-4f));
+            if (inRange(ColorSystem::Rec2020.toXYZ(nits)))
+            {
+                // compared as light, PQ is too steep near black for a fixed code value tolerance.
+                const ColorSystem::Tristimulus out(back[i * 3 + 0], back[i * 3 + 1], back[i * 3 + 2]);
+                REQUIRE_THAT(ColorSystem::OTF::toScene(ColorSystem::OTF::ST2084, out) * 100.f,
+                    IsApproxEquals(nits, 2e-4f * (1.f + nits.max3())));
+            }
+        }
+    }
+    SECTION("out of range input")
+    {
+        // PQ values past 1 clamp to 10000 nits instead of running the EOTF into a negative denominator.
+        const float src[] = {1.5f, 0.f, 0.f, 2.5f, 0.f, 0.f, 0.5f, 3.f, -3.f, -0.5f, 0.f, 0.f};
+        const ColorSystem::Tristimulus peak = ColorSystem::ICtCp_to_XYZ(ColorSystem::Tristimulus(4.f, 0.f, 0.f));
+        REQUIRE_THAT(ColorSystem::ICtCp_to_XYZ(ColorSystem::Tristimulus(2.5f, 0.f, 0.f)), IsApproxEquals(peak, 0.f));
+        REQUIRE(peak[1] == Approx(10000.f).epsilon(1e-3)); // the PQ peak on every LMS channel
+        std::vector<float> fast(12), exact(12);
+        ColorSystem::ICtCp_to_XYZ(src, fast.data(), 4);
+        ColorSystem::ICtCp_to_XYZ(src, exact.data(), 4, 3, 3, ColorSystem::Math::EXACT);
+        for (size_t i = 0; i < 4; i++)
+        {
+            const ColorSystem::Tristimulus t(src[i * 3], src[i * 3 + 1], src[i * 3 + 2]);
+            const ColorSystem::Tristimulus f = ColorSystem::ICtCp_to_XYZ(t);
+            const ColorSystem::TristimulusT<double> d =
+                ColorSystem::ICtCp_to_LMS(ColorSystem::TristimulusT<double>(t),
+                    ColorSystem::Matrix3T<double>(ColorSystem::ICtCp_to_PQ));
+            for (int c = 0; c < 3; c++)
+            {
+                REQUIRE(std::isfinite(f[c]));
+                REQUIRE(std::isfinite(d[c]));
+                REQUIRE(d[c] >= 0.);
+                REQUIRE(d[c] <= 10000.);
+                REQUIRE(std::isfinite(fast[i * 3 + c]));
+                REQUIRE(fast[i * 3 + c] == Approx(exact[i * 3 + c]).epsilon(1e-3).margin(1e-2));
+            }
+        }
+    }
+}
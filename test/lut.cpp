@@ -0,0 +1,146 @@
+// "colorsystem"
+// copyright 2017 (c) Hajime UCHIMURA / @nikq
+// all rights reserved
+#include "common.hpp"
+
+#include "TestUtilities.hpp"
+
+#include <colorsystem.hpp>
+
+TEST_CASE("LUT1D", "[lut]")
+{
+    SECTION("code values are exact")
+    {
+        const ColorSystem::OTF::TYPE types[] = {ColorSystem::OTF::SRGB, ColorSystem::OTF::BT709,
+            ColorSystem::OTF::ST2084, ColorSystem::OTF::HLG};
+        for (const ColorSystem::OTF::TYPE type : types)
+        {
+            const ColorSystem::LUT1D lut = ColorSystem::LUT1D::toScene(type, 1 << 10);
+            std::vector<uint16_t>    codes(1024);
+            std::vector<float>       out(1024);
+            for (uint16_t i = 0; i < 1024; i++)
+                codes[i] = i;
+            lut.apply(codes.data(), out.data(), codes.size());
+            for (size_t i = 0; i < codes.size(); i++)
+            {
+                const float expected = ColorSystem::OTF::toScene(type, ColorSystem::Tristimulus(i / 1023.f))[0];
+                REQUIRE(out[i] == expected);
+            }
+            REQUIRE(lut[5000] == lut[1023]); // out of range codes clamp
+        }
+    }
+    SECTION("8bit sRGB")
+    {
+        const ColorSystem::LUT1D lut = ColorSystem::LUT1D::toScene(ColorSystem::OTF::SRGB, 256);
+        const uint8_t            codes[] = {0, 1, 128, 255};
+        float                    out[4];
+        lut.apply(codes, out, 4);
+        REQUIRE(out[0] == 0.f);
+        REQUIRE(out[2] == Approx(ColorSystem::OTF::sRGB_to_Y(128.f / 255.f)));
+        REQUIRE(out[3] == 1.f);
+    }
+    SECTION("interpolation")
+    {
+        const ColorSystem::LUT1D linear = ColorSystem::LUT1D::toScene(ColorSystem::OTF::SRGB, 1024);
+        const ColorSystem::LUT1D cubic =
+            ColorSystem::LUT1D::toScene(ColorSystem::OTF::SRGB, 1024, 1.f, ColorSystem::LUT1D::CUBIC);
+        float linearError = 0.f, cubicError = 0.f;
+        for (int i = 1000; i <= 10000; i++) // above the linear toe, cubic does not like the kink
+        {
+            const float x = i / 10000.f;
+            const float e = ColorSystem::OTF::sRGB_to_Y(x);
+            linearError   = std::max(linearError, fabsf(linear(x) - e));
+            cubicError    = std::max(cubicError, fabsf(cubic(x) - e));
+        }
+        REQUIRE(linearError < 1e-5f);
+        REQUIRE(cubicError < linearError);
+        REQUIRE(linear(-1.f) == 0.f); // clamped to the range
+        REQUIRE(linear(2.f) == 1.f);
+    }
+    SECTION("encode")
+    {
+        const ColorSystem::LUT1D lut = ColorSystem::LUT1D::toScreen(ColorSystem::OTF::HLG, 4096);
+        REQUIRE(lut.hi() == 12.f);
+        REQUIRE(lut(12.f) == Approx(1.f).margin(1e-5f));
+        std::vector<float> buf = {0.f, 0.5f, 1.f, 6.f};
+        lut.apply(buf.data(), buf.data(), buf.size());
+        REQUIRE(buf[1] == Approx(ColorSystem::OTF::Y_to_HLG(0.5f)).margin(1e-3f));
+        REQUIRE(buf[3] == Approx(ColorSystem::OTF::Y_to_HLG(6.f)).margin(1e-5f));
+    }
+    SECTION("any function")
+    {
+        const ColorSystem::LUT1D lut([](const float x) { return x * x; }, 3, -1.f, 1.f);
+        REQUIRE(lut(0.5f) == Approx(0.5f)); // linear between 0 and 1
+        REQUIRE(lut(-1.f) == 1.f);
+    }
+}
+
+namespace
+{
+// Rec.709 sRGB signal -> Rec.2020 ST2084 signal, 100 nits white.
+ColorSystem::Tristimulus sdrToHdr(const ColorSystem::Tristimulus &rgb)
+{
+    const ColorSystem::Tristimulus linear = ColorSystem::OTF::toScene(ColorSystem::OTF::SRGB, rgb);
+    const ColorSystem::Tristimulus wide =
+        linear.apply(ColorSystem::GamutConvert(ColorSystem::Rec709, ColorSystem::Rec2020));
+    return ColorSystem::OTF::toScreen(ColorSystem::OTF::ST2084, wide.positive());
+}
+} // namespace
+
+TEST_CASE("LUT3D", "[lut]")
+{
+    SECTION("identity")
+    {
+        const ColorSystem::LUT3D lut([](const ColorSystem::Tristimulus &t) { return t; }, 17);
+        const ColorSystem::Tristimulus v(0.123f, 0.456f, 0.789f);
+        REQUIRE_THAT(lut.trilinear(v[0], v[1], v[2]), IsApproxEquals(v, 1e-6f));
+        REQUIRE_THAT(lut.tetrahedral(v[0], v[1], v[2]), IsApproxEquals(v, 1e-6f));
+        REQUIRE_THAT(lut.apply(ColorSystem::Tristimulus(2.f, -1.f, 1.f)),
+            IsApproxEquals(ColorSystem::Tristimulus(1.f, 0.f, 1.f), 1e-6f)); // clamped to the lattice
+    }
+    SECTION("nodes are exact")
+    {
+        const ColorSystem::LUT3D lut(sdrToHdr, 9);
+        const ColorSystem::Tristimulus v(2.f / 8.f, 5.f / 8.f, 1.f);
+        REQUIRE_THAT(lut.apply(v), IsApproxEquals(sdrToHdr(v), 1e-6f));
+        REQUIRE_THAT(lut.node(2, 5, 8), IsApproxEquals(sdrToHdr(v), 1e-6f));
+    }
+    SECTION("pipeline")
+    {
+        const ColorSystem::LUT3D tetra(sdrToHdr, 33);
+        ColorSystem::LUT3D       tri(sdrToHdr, 33, ColorSystem::OTF::LINEAR, ColorSystem::LUT3D::TRILINEAR);
+        const size_t             count = 4096;
+        std::vector<float>       src(count * 3), out(count * 3);
+        for (size_t i = 0; i < src.size(); i++)
+            src[i] = (float)((i * 7919) % 1000) / 999.f;
+        tetra.apply(src.data(), out.data(), count);
+        float worstTetra = 0.f, worstTri = 0.f;
+        for (size_t i = 0; i < count; i++)
+        {
+            const ColorSystem::Tristimulus v(src[i * 3], src[i * 3 + 1], src[i * 3 + 2]);
+            const ColorSystem::Tristimulus e = sdrToHdr(v);
+            const ColorSystem::Tristimulus a(out[i * 3], out[i * 3 + 1], out[i * 3 + 2]);
+            const ColorSystem::Tristimulus b = tri.apply(v);
+            for (int c = 0; c < 3; c++)
+            {
+                worstTetra = std::max(worstTetra, fabsf(a[c] - e[c]));
+                worstTri   = std::max(worstTri, fabsf(b[c] - e[c]));
+            }
+        }
+        // worst cases sit on the clipped gamut edges, a few 10bit code values.
+        REQUIRE(worstTetra < 4e-3f);
+        REQUIRE(worstTri < 4e-3f);
+    }
+    SECTION("ST2084 shaper")
+    {
+        // linear HDR input 0-100 (10000 nits), Rec.2020 to Rec.709 ST2084 signal.
+        const ColorSystem::Matrix3 m = ColorSystem::GamutConvert(ColorSystem::Rec2020, ColorSystem::Rec709);
+        const auto                 f = [&m](const ColorSystem::Tristimulus &t) {
+            return ColorSystem::OTF::toScreen(ColorSystem::OTF::ST2084, t.apply(m).positive());
+        };
+        const ColorSystem::LUT3D       lut(f, 33, ColorSystem::OTF::ST2084);
+        const ColorSystem::Tristimulus dark(0.01f, 0.012f, 0.011f), bright(40.f, 30.f, 20.f);
+        REQUIRE_THAT(lut.apply(dark), IsApproxEquals(f(dark), 4e-3f));
+        REQUIRE_THAT(lut.apply(bright), IsApproxEquals(f(bright), 1e-3f));
+    }
+}
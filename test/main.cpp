@@ -1,3 +1,4 @@
 
+#define CATCH_CONFIG_NO_POSIX_SIGNALS   1
 #define CATCH_CONFIG_MAIN   1
 #include <catch.hpp>
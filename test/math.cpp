@@ -0,0 +1,238 @@
+// "colorsystem"
+// copyright 2017 (c) Hajime UCHIMURA / @nikq
+// all rights reserved
+#include "common.hpp"
+
+#include "TestUtilities.hpp"
+
+#include <colorsystem.hpp>
+
+namespace
+{
+// libm and fast backend on the same inputs, one value and one pack at a time.
+template <typename F, typename G>
+void compareBackends(const F &exact, const G &fast, const float lo, const float hi, const float eps)
+{
+    for (int i = 0; i <= 4000; i++)
+    {
+        const float x = lo + (hi - lo) * (float)i / 4000.f;
+        const float e = exact(x);
+        REQUIRE(fast(x) == Approx(e).epsilon(eps).margin(eps));
+        float lanes[4];
+        exact(ColorSystem::SIMD::float4(x)).store(lanes);
+        REQUIRE(lanes[3] == e);
+    }
+}
+std::vector<float> makeRamp(const size_t count, const float lo, const float hi)
+{
+    std::vector<float> v(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        v[i] = lo + (hi - lo) * (float)i / (float)(count - 1);
+    }
+    return v;
+}
+} // namespace
+
+TEST_CASE("math backends", "[math]")
+{
+    using ColorSystem::SIMD::float4;
+    typedef ColorSystem::Math::Exact E;
+    typedef ColorSystem::Math::Fast  F;
+    SECTION("exact is libm")
+    {
+        REQUIRE(E::pow(0.3f, 2.4f) == powf(0.3f, 2.4f));
+        REQUIRE(E::log10(155.f) == log10f(155.f));
+        REQUIRE(E::pow10(-0.7f) == powf(10.f, -0.7f));
+        REQUIRE(E::atan2(-0.2f, 0.7f) == atan2f(-0.2f, 0.7f));
+        float lanes[4];
+        E::atan2(float4(-0.2f), float4(0.7f)).store(lanes);
+        REQUIRE(lanes[0] == atan2f(-0.2f, 0.7f));
+    }
+    SECTION("fast within 1e-4")
+    {
+        compareBackends([](const auto x) { return E::pow(x, decltype(x)(1.f / 2.4f)); },
+            [](const float x) { return F::pow(x, 1.f / 2.4f); }, 0.f, 1.f, 1e-4f);
+        compareBackends([](const auto x) { return E::log(x); }, [](const float x) { return F::log(x); }, 1e-3f,
+            12.f, 1e-4f);
+        compareBackends([](const auto x) { return E::log10(x); }, [](const float x) { return F::log10(x); }, 1e-3f,
+            12.f, 1e-4f);
+        compareBackends([](const auto x) { return E::exp(x); }, [](const float x) { return F::exp(x); }, -10.f, 10.f,
+            1e-4f);
+        compareBackends([](const auto x) { return E::pow10(x); }, [](const float x) { return F::pow10(x); }, -3.f,
+            3.f, 1e-4f);
+        compareBackends([](const auto x) { return E::cbrt(x); }, [](const float x) { return F::cbrt(x); }, -2.f, 2.f,
+            1e-4f);
+        compareBackends([](const auto x) { return E::sin(x); }, [](const float x) { return F::sin(x); }, -10.f, 10.f,
+            1e-4f);
+        compareBackends([](const auto x) { return E::cos(x); }, [](const float x) { return F::cos(x); }, -10.f, 10.f,
+            1e-4f);
+        compareBackends([](const auto x) { return E::atan2(x, decltype(x)(0.3f)); },
+            [](const float x) { return F::atan2(x, 0.3f); }, -5.f, 5.f, 1e-4f);
+    }
+    SECTION("default backend")
+    {
+#if defined(COLORSYSTEM_FAST_MATH)
+        REQUIRE(ColorSystem::Math::DEFAULT == ColorSystem::Math::FAST);
+        REQUIRE(ColorSystem::SIMD::pow(0.3f, 2.4f) == ColorSystem::FastMath::pow(0.3f, 2.4f));
+#else
+        REQUIRE(ColorSystem::Math::DEFAULT == ColorSystem::Math::EXACT);
+        REQUIRE(ColorSystem::SIMD::pow(0.3f, 2.4f) == powf(0.3f, 2.4f));
+#endif
+        // packs are FastMath whatever the default is, the batch paths rely on it for their speed.
+        const auto same = [](const float4 &p, const float4 &q) {
+            float a[4], b[4];
+            p.store(a);
+            q.store(b);
+            return std::equal(a, a + 4, b);
+        };
+        const float  v[4] = {0.013f, 0.3f, 1.9f, 7.5f};
+        const float4 x    = float4::load(v);
+        REQUIRE(same(ColorSystem::SIMD::pow(x, float4(2.4f)), F::pow(x, float4(2.4f))));
+        REQUIRE(same(ColorSystem::SIMD::cbrt(x), F::cbrt(x)));
+        REQUIRE(same(ColorSystem::SIMD::log10(x), F::log10(x)));
+        REQUIRE(same(ColorSystem::SIMD::exp(-x), F::exp(-x)));
+        REQUIRE(same(ColorSystem::SIMD::cos(x), F::cos(x)));
+        REQUIRE(same(ColorSystem::SIMD::atan2(-x, float4(0.7f)), F::atan2(-x, float4(0.7f))));
+    }
+}
+
+TEST_CASE("batch curves per backend", "[math]")
+{
+    using ColorSystem::OTF;
+    using ColorSystem::Tristimulus;
+    const OTF::TYPE types[] = {OTF::SRGB, OTF::BT709, OTF::ST2084, OTF::SLOG2, OTF::HLG, OTF::GAMMA};
+    for (const OTF::TYPE type : types)
+    {
+        const float range = ColorSystem::LUT1D::sceneRange(type);
+        const auto  scene = makeRamp(999, 0.f, range);
+        const auto  screen = makeRamp(999, 0.f, 1.f);
+        for (const ColorSystem::Math::BACKEND math : {ColorSystem::Math::EXACT, ColorSystem::Math::FAST})
+        {
+            // exact agrees with the per-value curves up to float rounding, fast within 1e-4 of the range.
+            const float eps = (math == ColorSystem::Math::EXACT) ? 2e-6f : 1e-4f;
+            std::vector<float> a(scene.size()), b(screen.size());
+            OTF::toScreen(type, scene.data(), a.data(), a.size(), 2.4f, math);
+            OTF::toScene(type, screen.data(), b.data(), b.size(), 2.4f, math);
+            if (math == ColorSystem::Math::FAST) // the default argument
+            {
+                std::vector<float> c(scene.size()), d(screen.size());
+                OTF::toScreen(type, scene.data(), c.data(), c.size(), 2.4f);
+                OTF::toScene(type, screen.data(), d.data(), d.size(), 2.4f);
+                REQUIRE(c == a);
+                REQUIRE(d == b);
+            }
+            for (size_t i = 0; i < a.size(); i++)
+            {
+                REQUIRE(a[i] == Approx(OTF::toScreen(type, Tristimulus(scene[i]), 2.4f)[0]).margin(eps));
+                REQUIRE(b[i] == Approx(OTF::toScene(type, Tristimulus(screen[i]), 2.4f)[0]).margin(eps * range));
+            }
+        }
+    }
+}
+
+TEST_CASE("pipeline math backend", "[math]")
+{
+    using ColorSystem::OTF;
+    using ColorSystem::Pipeline;
+    const std::vector<Pipeline::Stage> stages = {Pipeline::decode(OTF::SRGB),
+        Pipeline::matrix(ColorSystem::GamutConvert(ColorSystem::Rec709, ColorSystem::Rec2020)),
+        Pipeline::encode(OTF::ST2084)};
+    const Pipeline exact(stages, ColorSystem::Math::EXACT);
+    const Pipeline fast(stages, ColorSystem::Math::FAST);
+    REQUIRE(exact.math() == ColorSystem::Math::EXACT);
+    REQUIRE(fast.math() == ColorSystem::Math::FAST);
+    REQUIRE(Pipeline(stages).math() == ColorSystem::Math::FAST);
+    REQUIRE(Pipeline().math() == ColorSystem::Math::FAST);
+
+    // apply(Tristimulus) runs the pipeline's backend too. the FMA matrix kernels round differently, PQ magnifies that.
+    const float        margin = 1e-5f;
+    const auto         src    = makeRamp(3 * 500, 0.f, 1.f);
+    std::vector<float> a(src.size()), b(src.size());
+    exact.apply(src.data(), a.data(), 500);
+    fast.apply(src.data(), b.data(), 500);
+    for (size_t i = 0; i < 500; i++)
+    {
+        const ColorSystem::Tristimulus t(src[i * 3], src[i * 3 + 1], src[i * 3 + 2]);
+        const ColorSystem::Tristimulus ref = exact.apply(t), approx = fast.apply(t);
+        for (int c = 0; c < 3; c++)
+        {
+            REQUIRE(a[i * 3 + c] == Approx(ref[c]).margin(margin));
+            REQUIRE(b[i * 3 + c] == Approx(approx[c]).margin(margin));
+            REQUIRE(b[i * 3 + c] == Approx(a[i * 3 + c]).margin(1e-4f));
+        }
+    }
+}
+
+TEST_CASE("batch color math per backend", "[math]")
+{
+    using ColorSystem::Math::EXACT;
+    using ColorSystem::Tristimulus;
+    const size_t             count = 1003;
+    const std::vector<float> xyz   = makePixels(count, 3);
+    const Tristimulus        d50(0.9642f, 1.0f, 0.8249f);
+    std::vector<float>       fast(count * 3), exact(count * 3), packs(count * 3);
+    SECTION("CIELAB")
+    {
+        Tristimulus::toCIELAB(xyz.data(), fast.data(), count);
+        Tristimulus::toCIELAB(xyz.data(), exact.data(), count, d50, 3, 3, EXACT);
+        // the default is the SIMD pack path, bit for bit, and not libm per lane
+        for (size_t i = 0; i < count; i += 4)
+        {
+            const size_t n = std::min<size_t>(4, count - i);
+            Tristimulus::store4(Tristimulus::load4(xyz.data() + i * 3, n, 3).toCIELAB(
+                                    ColorSystem::TristimulusT<ColorSystem::SIMD::float4>(d50)),
+                packs.data() + i * 3, n, 3);
+        }
+        REQUIRE(fast == packs);
+        REQUIRE(fast != exact);
+        for (size_t i = 0; i < count; i++)
+        {
+            const Tristimulus t(xyz[i * 3], xyz[i * 3 + 1], xyz[i * 3 + 2]);
+            const Tristimulus e(exact[i * 3], exact[i * 3 + 1], exact[i * 3 + 2]);
+            REQUIRE_THAT(e, IsApproxEquals(t.toCIELAB(d50), 2e-4f)); // the per value one may be FAST too
+        }
+        Tristimulus::fromCIELAB(exact.data(), packs.data(), count, d50, 3, 3, EXACT);
+        for (size_t i = 0; i < count * 3; i++)
+            if (xyz[i] <= d50[i % 3]) // CIELAB clips above the white
+                REQUIRE(packs[i] == Approx(xyz[i]).margin(1e-6f));
+    }
+    SECTION("E00 and ICtCp")
+    {
+        std::vector<float> lab(count * 3), other(count * 3);
+        Tristimulus::toCIELAB(xyz.data(), lab.data(), count);
+        for (size_t i = 0; i < count * 3; i++)
+            other[i] = lab[i] + (float)((i * 31) % 100) / 20.f - 2.5f;
+        ColorSystem::Delta::E00(lab.data(), other.data(), fast.data(), count);
+        ColorSystem::Delta::E00(lab.data(), other.data(), exact.data(), count, 3, 1.f, 1.f, 1.f, EXACT);
+        REQUIRE(fast != exact);
+        for (size_t i = 0; i < count; i++)
+        {
+            const Tristimulus a(lab[i * 3], lab[i * 3 + 1], lab[i * 3 + 2]);
+            const Tristimulus b(other[i * 3], other[i * 3 + 1], other[i * 3 + 2]);
+            REQUIRE(exact[i] == Approx(ColorSystem::Delta::E00(a, b)).margin(1e-4f));
+            REQUIRE(fast[i] == Approx(exact[i]).margin(1e-3f));
+        }
+        std::vector<float> scaled(count * 3); // Rec.2020 gamut in cd/m^2, inside the LMS cone so it round trips
+        for (size_t i = 0; i < count; i++)
+        {
+            const Tristimulus t = ColorSystem::Rec2020.toXYZ(Tristimulus(xyz[i * 3], xyz[i * 3 + 1], xyz[i * 3 + 2]));
+            for (int c = 0; c < 3; c++)
+                scaled[i * 3 + c] = t[c] * 1000.f;
+        }
+        ColorSystem::XYZ_to_ICtCp(scaled.data(), fast.data(), count);
+        ColorSystem::XYZ_to_ICtCp(scaled.data(), exact.data(), count, 3, 3, EXACT);
+        REQUIRE(fast != exact);
+        for (size_t i = 0; i < count; i++)
+        {
+            const Tristimulus t(scaled[i * 3], scaled[i * 3 + 1], scaled[i * 3 + 2]);
+            const Tristimulus e(exact[i * 3], exact[i * 3 + 1], exact[i * 3 + 2]);
+            const Tristimulus f(fast[i * 3], fast[i * 3 + 1], fast[i * 3 + 2]);
+            REQUIRE_THAT(e, IsApproxEquals(ColorSystem::XYZ_to_ICtCp(t), 5e-5f));
+            REQUIRE_THAT(f, IsApproxEquals(e, 1e-4f));
+        }
+        ColorSystem::ICtCp_to_XYZ(exact.data(), packs.data(), count, 3, 3, EXACT);
+        for (size_t i = 0; i < count * 3; i++)
+            REQUIRE(packs[i] == Approx(scaled[i]).epsilon(1e-5).margin(1e-3));
+    }
+}
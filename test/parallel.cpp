@@ -0,0 +1,76 @@
+// "colorsystem"
+// copyright 2017 (c) Hajime UCHIMURA / @nikq
+// all rights reserved
+#include "common.hpp"
+
+#include "TestUtilities.hpp"
+
+#include <colorsystem.hpp>
+
+TEST_CASE("parallel", "[parallel]")
+{
+    using ColorSystem::Parallel::ThreadPool;
+    ThreadPool pool(4);
+    REQUIRE(pool.size() == 4);
+
+    SECTION("forEach covers every item once")
+    {
+        const size_t                  count = 100003;
+        std::vector<std::atomic<int>> hits(count);
+        for (auto &h : hits)
+            h = 0;
+        ColorSystem::Parallel::forEach(pool, count, 1000, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                hits[i]++;
+        });
+        size_t bad = 0;
+        for (auto &h : hits)
+            bad += (h != 1);
+        REQUIRE(bad == 0);
+    }
+    SECTION("nested")
+    {
+        std::atomic<size_t> total(0);
+        ColorSystem::Parallel::forEach(pool, 16, 1, [&](size_t, size_t) {
+            ColorSystem::Parallel::forEach(pool, 1000, 10, [&](size_t begin, size_t end) { total += end - begin; });
+        });
+        REQUIRE(total == 16000);
+    }
+    SECTION("pixels is deterministic")
+    {
+        using ColorSystem::Pipeline;
+        const Pipeline p({Pipeline::decode(ColorSystem::OTF::SRGB),
+            Pipeline::matrix(ColorSystem::GamutConvert(ColorSystem::Rec709, ColorSystem::Rec2020)),
+            Pipeline::encode(ColorSystem::OTF::ST2084)});
+        const size_t             count = 100003;
+        const std::vector<float> src   = makePixels(count, 4);
+        std::vector<float>       serial(count * 4, 0.f), threaded(count * 4, 0.f), single(count * 4, 0.f);
+        ThreadPool               one(1);
+        auto                     f = [&](const float *s, float *d, size_t n) { p.apply(s, d, n, 4, 4); };
+        ColorSystem::Parallel::pixels(one, src.data(), single.data(), count, 4, 4, f);
+        ColorSystem::Parallel::pixels(pool, src.data(), threaded.data(), count, 4, 4, f);
+        p.apply(src.data(), serial.data(), count, 4, 4);
+        REQUIRE(memcmp(single.data(), threaded.data(), count * 4 * sizeof(float)) == 0);
+        REQUIRE(memcmp(serial.data(), threaded.data(), count * 4 * sizeof(float)) == 0);
+    }
+    SECTION("image")
+    {
+        const size_t               width = 333, height = 211, pitch = 1024;
+        const std::vector<float>   src = makePixels(pitch * height / 3 + 1, 3);
+        std::vector<float>         dst(pitch * height, -1.f);
+        const ColorSystem::Matrix3 m = ColorSystem::Rec709.toXYZ();
+        ColorSystem::Parallel::image(pool, src.data(), dst.data(), width, height, pitch, pitch,
+            [&](const float *s, float *d, size_t n) { m.apply(s, d, n); });
+        for (size_t y = 0; y < height; y += 7)
+        {
+            for (size_t x = 0; x < width; x += 5)
+            {
+                const float *                  s = &src[y * pitch + x * 3];
+                const float *                  d = &dst[y * pitch + x * 3];
+                const ColorSystem::Tristimulus expected(m.apply(ColorSystem::Vector3(s[0], s[1], s[2])));
+                REQUIRE_THAT(ColorSystem::Tristimulus(d[0], d[1], d[2]), IsApproxEquals(expected, 1e-5f));
+            }
+            REQUIRE(dst[y * pitch + width * 3] == -1.f);
+        }
+    }
+}
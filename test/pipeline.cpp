@@ -0,0 +1,79 @@
+// "colorsystem"
+// copyright 2017 (c) Hajime UCHIMURA / @nikq
+// all rights reserved
+#include "common.hpp"
+
+#include "TestUtilities.hpp"
+
+#include <colorsystem.hpp>
+
+TEST_CASE("pipeline", "[pipeline]")
+{
+    using ColorSystem::Pipeline;
+    const ColorSystem::Matrix3 toXYZ   = ColorSystem::Rec709.toXYZ();
+    const ColorSystem::Matrix3 adapt   = ColorSystem::Bradford(ColorSystem::Illuminant_D65, ColorSystem::Illuminant_D65);
+    const ColorSystem::Matrix3 fromXYZ = ColorSystem::Rec2020.fromXYZ();
+
+    SECTION("optimize")
+    {
+        const Pipeline p({Pipeline::decode(ColorSystem::OTF::SRGB), Pipeline::matrix(toXYZ), Pipeline::matrix(adapt),
+            Pipeline::decode(ColorSystem::OTF::LINEAR), Pipeline::matrix(fromXYZ), Pipeline::clip(0.f, 2.f),
+            Pipeline::clip(-1.f, 1.f), Pipeline::encode(ColorSystem::OTF::LINEAR)});
+        REQUIRE(p.stages().size() == 3);
+        REQUIRE(p.stages()[0].type_ == Pipeline::DECODE);
+        REQUIRE(p.stages()[1].type_ == Pipeline::MATRIX);
+        REQUIRE(p.stages()[2].type_ == Pipeline::CLIP);
+        REQUIRE(p.stages()[2].lo_ == 0.f);
+        REQUIRE(p.stages()[2].hi_ == 1.f);
+        REQUIRE_THAT(p.stages()[1].matrix_,
+            IsApproxEquals(ColorSystem::GamutConvert(ColorSystem::Rec709, ColorSystem::Rec2020), 1e-6f));
+
+        // a round trip collapses to nothing
+        const Pipeline q({Pipeline::matrix(toXYZ), Pipeline::matrix(ColorSystem::Rec709.fromXYZ())});
+        REQUIRE(q.stages().empty());
+
+        // disjoint clips still compose: everything ends on the edge of the second range
+        const Pipeline c({Pipeline::clip(0.f, 1.f), Pipeline::clip(2.f, 3.f)});
+        REQUIRE(c.stages().size() == 1);
+        REQUIRE(c.apply(ColorSystem::Tristimulus(-5.f, 0.5f, 10.f))[0] == 2.f);
+        REQUIRE(c.apply(ColorSystem::Tristimulus(-5.f, 0.5f, 10.f))[2] == 2.f);
+        const Pipeline d({Pipeline::clip(2.f, 3.f), Pipeline::clip(0.f, 1.f)});
+        REQUIRE(d.apply(ColorSystem::Tristimulus(-5.f, 2.5f, 10.f))[1] == 1.f);
+    }
+    SECTION("buffer matches per pixel")
+    {
+        const Pipeline p({Pipeline::decode(ColorSystem::OTF::BT709), Pipeline::matrix(toXYZ),
+            Pipeline::matrix(fromXYZ), Pipeline::encode(ColorSystem::OTF::ST2084), Pipeline::clip(0.f, 1.f)});
+        const size_t             count = 1003;
+        const std::vector<float> src   = makePixels(count, 4);
+        std::vector<float>       dst(count * 4, 0.5f);
+        p.apply(src.data(), dst.data(), count, 4, 4);
+        for (size_t i = 0; i < count; i++)
+        {
+            const ColorSystem::Tristimulus expected =
+                p(ColorSystem::Tristimulus(src[i * 4 + 0], src[i * 4 + 1], src[i * 4 + 2]));
+            REQUIRE_THAT(ColorSystem::Tristimulus(dst[i * 4 + 0], dst[i * 4 + 1], dst[i * 4 + 2]),
+                IsApproxEquals(expected, 2e-5f));
+            REQUIRE(dst[i * 4 + 3] == 0.5f);
+        }
+    }
+    SECTION("in place, empty")
+    {
+        const Pipeline           p;
+        std::vector<float>       buf = makePixels(100, 3);
+        const std::vector<float> src = buf;
+        p.apply(buf.data(), buf.data(), 100);
+        REQUIRE(buf == src);
+    }
+    SECTION("bake into LUT3D")
+    {
+        const Pipeline p({Pipeline::decode(ColorSystem::OTF::SRGB),
+            Pipeline::matrix(ColorSystem::GamutConvert(ColorSystem::Rec709, ColorSystem::DCI_P3)),
+            Pipeline::encode(ColorSystem::OTF::SRGB), Pipeline::clip(0.f, 1.f)});
+        const ColorSystem::LUT3D lut(p, 33);
+        const ColorSystem::Tristimulus t(0.25f, 0.5f, 0.75f);
+        const ColorSystem::Tristimulus a = lut.apply(t), b = p(t);
+        INFO(a[0] << "," << a[1] << "," << a[2] << " vs " << b[0] << "," << b[1] << "," << b[2]);
+        REQUIRE_THAT(a, IsApproxEquals(b, 2e-3f));
+    }
+}
@@ -0,0 +1,95 @@
+// "colorsystem"
+// copyright 2017 (c) Hajime UCHIMURA / @nikq
+// all rights reserved
+#include "common.hpp"
+
+#include "TestUtilities.hpp"
+
+#include <colorsystem.hpp>
+
+namespace
+{
+typedef ColorSystem::TristimulusT<double>                    TristimulusD;
+typedef ColorSystem::GamutT<double>                          GamutD;
+typedef ColorSystem::TristimulusT<ColorSystem::SIMD::float4> Tristimulus4;
+
+ColorSystem::Tristimulus lane(const Tristimulus4 &t, const int i)
+{
+    return ColorSystem::Tristimulus(t[0][i], t[1][i], t[2][i]);
+}
+} // namespace
+
+TEST_CASE("scalar types", "[scalar]")
+{
+    SECTION("double")
+    {
+        // built from primaries in double, converted gamuts keep float precision.
+        const GamutD       rec709("Rec.709", 0.64, 0.33, 0.30, 0.60, 0.15, 0.06, 0.3127, 0.3290);
+        const GamutD       rec2020("Rec.2020", 0.708, 0.292, 0.17, 0.797, 0.131, 0.046, 0.3127, 0.3290);
+        const TristimulusD rgb(0.25, 0.5, 0.75);
+        const TristimulusD back(rec709.fromXYZ(rec2020.toXYZ(rec2020.fromXYZ(rec709.toXYZ(rgb)))));
+        REQUIRE(fabs(back[0] - rgb[0]) < 1e-12);
+        REQUIRE(fabs(back[1] - rgb[1]) < 1e-12);
+        REQUIRE(fabs(back[2] - rgb[2]) < 1e-12);
+
+        // double results agree with the float path.
+        const ColorSystem::Tristimulus f(ColorSystem::Rec709.toXYZ(ColorSystem::Tristimulus(0.25f, 0.5f, 0.75f)));
+        REQUIRE_THAT(ColorSystem::Tristimulus(rec709.toXYZ(rgb)), IsApproxEquals(f, 1e-6f));
+        REQUIRE_THAT(ColorSystem::Tristimulus(rec709.toXYZ(rgb).toCIELAB()), IsApproxEquals(f.toCIELAB(), 1e-4f));
+
+        // the CIELAB constants are built in double, so both segments round trip at double precision.
+        for (const double y : {1e-4, 0.008, 0.0089, 0.2, 0.9})
+        {
+            const TristimulusD xyz(y * 0.9, y, y * 0.7);
+            const TristimulusD back(xyz.toCIELAB().fromCIELAB());
+            for (int c = 0; c < 3; c++)
+                REQUIRE(fabs(back[c] - xyz[c]) < 1e-15);
+        }
+        REQUIRE(fabs(TristimulusD(0.9642, 1., 0.8249).toCIELAB()[1]) < 1e-12); // D50 white is the default
+        REQUIRE(TristimulusD(0., 0., 0.).toYxy()[1] == 0.3127);
+    }
+    SECTION("float4")
+    {
+        const float src[3][4] = {
+            {0.0f, 0.25f, 0.9f, 0.002f}, {0.0f, 0.5f, 0.1f, 0.003f}, {0.0f, 0.75f, 0.1f, 0.001f}};
+        const Tristimulus4 t(ColorSystem::SIMD::float4::load(src[0]), ColorSystem::SIMD::float4::load(src[1]),
+            ColorSystem::SIMD::float4::load(src[2]));
+        const Tristimulus4 yxy(t.toYxy());
+        const Tristimulus4 lab(t.toCIELAB());
+        const Tristimulus4 hsv(t.toHSV());
+        const Tristimulus4 hsvAtan(t.toHSV_atan());
+        const Tristimulus4 rgb(hsv.fromHSV());
+        const Tristimulus4 xyz(ColorSystem::GamutT<ColorSystem::SIMD::float4>(ColorSystem::Rec709).toXYZ(t));
+        for (int i = 0; i < 4; i++)
+        {
+            const ColorSystem::Tristimulus s(src[0][i], src[1][i], src[2][i]);
+            REQUIRE_THAT(lane(yxy, i), IsApproxEquals(s.toYxy(), 1e-6f));
+            // the pack path takes the cube root through FastMath::cbrt.
+            REQUIRE_THAT(lane(lab, i), IsApproxEquals(s.toCIELAB(), 2e-4f));
+            REQUIRE_THAT(lane(hsv, i), IsApproxEquals(s.toHSV(), 1e-4f));
+            REQUIRE_THAT(lane(hsvAtan, i), IsApproxEquals(s.toHSV_atan(), 1e-4f));
+            REQUIRE_THAT(lane(rgb, i), IsApproxEquals(s, 1e-5f));
+            REQUIRE_THAT(lane(xyz, i), IsApproxEquals(ColorSystem::Rec709.toXYZ(s), 1e-6f));
+        }
+    }
+    SECTION("hsv sectors")
+    {
+        // one hue per sector, scalar and pack must agree on every branch.
+        for (int h = 0; h < 360; h += 30)
+        {
+            const ColorSystem::Tristimulus s((float)h + 15.f, 0.8f, 0.6f);
+            const Tristimulus4             p(s); // broadcast
+            REQUIRE_THAT(lane(p.fromHSV(), 0), IsApproxEquals(s.fromHSV(), 1e-6f));
+            REQUIRE_THAT(s.fromHSV().toHSV(), IsApproxEquals(s, 1e-4f));
+        }
+        // hues just below 0 and at 360 wrap to red, not past the last sector
+        for (const float h : {-1e-6f, -1e-9f, 360.f, 720.f})
+        {
+            const ColorSystem::Tristimulus s(h, 1.f, 1.f), red(1.f, 0.f, 0.f);
+            REQUIRE_THAT(s.fromHSV(), IsApproxEquals(red, 1e-5f));
+            REQUIRE_THAT(lane(Tristimulus4(s).fromHSV(), 0), IsApproxEquals(red, 1e-5f));
+            REQUIRE(ColorSystem::Tristimulus::mod360(h) < 360.f);
+            REQUIRE(TristimulusD::mod360(-1e-17) < 360.);
+        }
+    }
+}
@@ -63,4 +63,72 @@ TEST_CASE("oetf", "")
         REQUIRE_THAT(v1, IsApproxEquals(c1, epsilon));
         REQUIRE_THAT(v2, IsApproxEquals(c2, epsilon));
     }
-}
\ No newline at end of file
+}
+namespace
+{
+// checks the batch curve against the exact one over [lo,hi]. errors are relative above 'floor', absolute below.
+void checkBatch(const ColorSystem::OTF::TYPE type, const bool encode, const float lo, const float hi,
+    const float tolerance, const float floor = 1.f, const float g = 1.f)
+{
+    const size_t       count = 10001;
+    std::vector<float> in(count), out(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        in[i] = lo + (hi - lo) * (float)i / (float)(count - 1);
+    }
+    if (encode)
+        ColorSystem::OTF::toScreen(type, in.data(), out.data(), count, g);
+    else
+        ColorSystem::OTF::toScene(type, in.data(), out.data(), count, g);
+    for (size_t i = 0; i < count; i++)
+    {
+        const ColorSystem::Tristimulus v(in[i]);
+        const float expected = encode ? ColorSystem::OTF::toScreen(type, v, g)[0] : ColorSystem::OTF::toScene(type, v, g)[0];
+        const float scale    = (fabsf(expected) > floor) ? fabsf(expected) : floor;
+        REQUIRE(out[i] == Approx(expected).margin(tolerance * scale));
+    }
+}
+} // namespace
+
+TEST_CASE("oetf batch", "")
+{
+    SECTION("sRGB")
+    {
+        checkBatch(ColorSystem::OTF::SRGB, true, -0.1f, 1.1f, 2e-7f);
+        checkBatch(ColorSystem::OTF::SRGB, false, -0.1f, 1.1f, 2e-7f);
+    }
+    SECTION("BT709")
+    {
+        checkBatch(ColorSystem::OTF::BT709, true, -0.1f, 1.1f, 2e-7f);
+        checkBatch(ColorSystem::OTF::BT709, false, -0.1f, 1.1f, 2e-7f);
+    }
+    SECTION("ST2084")
+    {
+        checkBatch(ColorSystem::OTF::ST2084, true, -1.f, 110.f, 2e-5f);
+        checkBatch(ColorSystem::OTF::ST2084, false, 0.f, 1.f, 1e-4f, 0.f);
+    }
+    SECTION("HLG")
+    {
+        checkBatch(ColorSystem::OTF::HLG, true, -0.1f, 12.f, 2e-7f);
+        checkBatch(ColorSystem::OTF::HLG, false, -0.1f, 1.f, 3e-7f, 0.f);
+    }
+    SECTION("S-Log2")
+    {
+        checkBatch(ColorSystem::OTF::SLOG2, true, -0.1f, 10.f, 2e-7f);
+        checkBatch(ColorSystem::OTF::SLOG2, false, 0.f, 1.f, 4e-6f);
+    }
+    SECTION("gamma")
+    {
+        checkBatch(ColorSystem::OTF::GAMMA, true, 0.f, 1.f, 2e-6f, 0.f, 2.4f);
+        checkBatch(ColorSystem::OTF::GAMMA, false, 0.f, 1.f, 2e-6f, 0.f, 2.4f);
+    }
+    SECTION("in place")
+    {
+        std::vector<float> buf = {0.f, 0.1f, 0.5f, 1.f, 10.f};
+        ColorSystem::OTF::toScreen(ColorSystem::OTF::ST2084, buf.data(), buf.data(), buf.size());
+        ColorSystem::OTF::toScene(ColorSystem::OTF::ST2084, buf.data(), buf.data(), buf.size());
+        REQUIRE(buf[0] == 0.f);
+        REQUIRE(buf[1] == Approx(0.1f).epsilon(1e-4f));
+        REQUIRE(buf[4] == Approx(10.f).epsilon(1e-4f));
+    }
+}
@@ -27,3 +27,40 @@ TEST_CASE("Spectrum")
         REQUIRE(E_Yxy[2] == Approx(ColorSystem::Illuminant_E.toYxy()[2]).margin(1e-5f));
     }
 }
+
+TEST_CASE("Spectrum batch")
+{
+    const ColorSystem::SIMD::ISA levels[] = {ColorSystem::SIMD::SCALAR, ColorSystem::SIMD::SSE41,
+        ColorSystem::SIMD::AVX2, ColorSystem::SIMD::AVX512};
+    const ColorSystem::SIMD::ISA saved = ColorSystem::SIMD::isa();
+    const size_t                 count = 101; // odd, so the pair kernels leave one over
+    std::vector<ColorSystem::Spectrum> spectra;
+    for (size_t i = 0; i < count; i++)
+    {
+        const ColorSystem::Spectrum bb = ColorSystem::Spectrum::blackbody(2000.f + 100.f * i);
+        spectra.push_back(bb * ColorSystem::Spectrum::E(1.f / bb[200]));
+    }
+    for (const ColorSystem::SIMD::ISA level : levels)
+    {
+        ColorSystem::SIMD::setISA(level);
+        std::vector<float> xyz(count * 3);
+        ColorSystem::CIE1931.fromSpectrum(spectra.data(), xyz.data(), count);
+        for (size_t i = 0; i < count; i++)
+        {
+            const ColorSystem::Tristimulus expected = ColorSystem::CIE1931.fromSpectrum(spectra[i]);
+            const ColorSystem::Tristimulus actual(xyz[i * 3 + 0], xyz[i * 3 + 1], xyz[i * 3 + 2]);
+            REQUIRE_THAT(actual, IsApproxEquals(expected, 1e-5f * expected[1]));
+        }
+    }
+    ColorSystem::SIMD::setISA(saved);
+
+    SECTION("threaded")
+    {
+        ColorSystem::Parallel::ThreadPool pool(3);
+        std::vector<float>                serial(count * 4, -1.f), threaded(count * 4, -1.f);
+        ColorSystem::CIE2012.fromSpectrum(spectra[0].s_.data(), serial.data(), count, 400, 4);
+        ColorSystem::CIE2012.fromSpectrum(pool, spectra[0].s_.data(), threaded.data(), count, 400, 4);
+        REQUIRE(serial == threaded);
+        REQUIRE(threaded[3] == -1.f);
+    }
+}
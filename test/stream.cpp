@@ -0,0 +1,93 @@
+// "colorsystem"
+// copyright 2017 (c) Hajime UCHIMURA / @nikq
+// all rights reserved
+#include "common.hpp"
+
+#include "TestUtilities.hpp"
+
+#include <colorsystem.hpp>
+
+TEST_CASE("MemoryStreamView", "[stream]")
+{
+    using ColorSystem::MemoryStream;
+    using ColorSystem::MemoryStreamView;
+
+    MemoryStream w;
+    w.setWriteEndian(MemoryStream::BIG);
+    w.putUint16(0x1234);
+    w.putUint32(0x89abcdef);
+    w.putInt32(-65536 * 3 / 2); // -1.5 in s15Fixed16
+    w.putInt32(65536 / 4);      // 0.25
+    w.putUint16(0xffff);
+    w.putUint16(0x8000);
+    const std::vector<uint8_t> &bytes = w.buffer();
+
+    SECTION("reads in place")
+    {
+        MemoryStreamView v(bytes.data(), bytes.size());
+        REQUIRE(v.data() == bytes.data());
+        v.setReadEndian(MemoryStream::BIG);
+        REQUIRE(v.getUint16() == 0x1234);
+        REQUIRE(v.getUint32() == 0x89abcdefu);
+        REQUIRE(v.getS15Fixed16() == -1.5f);
+        REQUIRE(v.getS15Fixed16() == 0.25f);
+
+        // same answers as the copying stream
+        MemoryStream s(bytes.data(), bytes.size());
+        s.setReadEndian(MemoryStream::BIG);
+        v.seekTo(0);
+        REQUIRE(s.getUint16() == v.getUint16());
+        REQUIRE(s.getUint32() == v.getUint32());
+        REQUIRE(s.getInt32() == v.getInt32());
+    }
+    SECTION("little endian")
+    {
+        MemoryStreamView v(bytes.data(), bytes.size());
+        REQUIRE(v.getUint16() == 0x3412);
+        REQUIRE(v.getUint32() == 0xefcdab89u);
+    }
+    SECTION("arrays")
+    {
+        MemoryStreamView v(w);
+        v.setReadEndian(MemoryStream::BIG);
+        v.seekTo(6);
+        float f[2];
+        REQUIRE(v.getS15Fixed16Array(f, 2) == 2);
+        REQUIRE(f[0] == -1.5f);
+        REQUIRE(f[1] == 0.25f);
+        float u[2];
+        REQUIRE(v.getUnorm16Array(u, 2) == 2);
+        REQUIRE(u[0] == 1.f);
+        REQUIRE(u[1] == Approx(0.5f).margin(1e-4f));
+
+        v.seekTo(0);
+        uint16_t h[3];
+        REQUIRE(v.getUint16Array(h, 3) == 3);
+        REQUIRE(h[0] == 0x1234);
+        REQUIRE(h[1] == 0x89ab);
+        REQUIRE(h[2] == 0xcdef);
+        uint32_t l[2];
+        v.setReadEndian(MemoryStream::LITTLE);
+        REQUIRE(v.getUint32Array(l, 2) == 2);
+        REQUIRE(l[0] == 0x0080feffu); // -1.5 is ff fe 80 00
+    }
+    SECTION("past the end")
+    {
+        MemoryStreamView v(bytes.data(), bytes.size());
+        v.setReadEndian(MemoryStream::BIG);
+        v.seekTo(bytes.size() - 2);
+        uint32_t l[3] = {1, 2, 3};
+        REQUIRE(v.getUint32Array(l, 3) == 0);
+        REQUIRE(l[0] == 0);
+        REQUIRE(v.feof());
+        REQUIRE(v.getUint32() == 0);
+        REQUIRE(v.getUint8() == 0);
+
+        const MemoryStreamView s = v.sub(2, 4);
+        REQUIRE(s.size() == 4);
+        MemoryStreamView t = s;
+        REQUIRE(t.getUint32() == 0x89abcdefu);
+        REQUIRE(t.getUint16() == 0); // the sub view ends there
+        REQUIRE(v.sub(100, 4).size() == 0);
+    }
+}
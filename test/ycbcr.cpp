@@ -0,0 +1,135 @@
+// "colorsystem"
+// copyright 2017 (c) Hajime UCHIMURA / @nikq
+// all rights reserved
+#include "common.hpp"
+
+#include "TestUtilities.hpp"
+
+#include <colorsystem.hpp>
+
+namespace
+{
+// smooth linear RGB image, so subsampled chroma survives a round trip.
+std::vector<float> makeImage(const size_t width, const size_t height)
+{
+    std::vector<float> p(width * height * 3);
+    for (size_t y = 0; y < height; y++)
+    {
+        for (size_t x = 0; x < width; x++)
+        {
+            float *q = &p[(y * width + x) * 3];
+            q[0]     = 0.05f + 0.9f * (float)x / (float)width;
+            q[1]     = 0.05f + 0.9f * (float)y / (float)height;
+            q[2]     = 0.5f + 0.4f * sinf((float)(x + y) * 0.05f);
+        }
+    }
+    return p;
+}
+} // namespace
+
+TEST_CASE("YCbCr", "[ycbcr]")
+{
+    using ColorSystem::YCbCr;
+    const YCbCr::STANDARD standards[] = {YCbCr::BT601, YCbCr::BT709, YCbCr::BT2020, YCbCr::BT2020_CL};
+    SECTION("matrices")
+    {
+        for (const auto s : {YCbCr::BT601, YCbCr::BT709, YCbCr::BT2020})
+        {
+            REQUIRE_THAT(YCbCr::toRGB(s).mul(YCbCr::fromRGB(s)),
+                IsApproxEquals(ColorSystem::Matrix3(1, 0, 0, 0, 1, 0, 0, 0, 1), 1e-6f));
+            REQUIRE_THAT(YCbCr::fromRGB(s, ColorSystem::Tristimulus(1.f, 1.f, 1.f)),
+                IsApproxEquals(ColorSystem::Tristimulus(1.f, 0.f, 0.f), 1e-6f));
+        }
+        REQUIRE_THAT(YCbCr::fromRGB(YCbCr::BT709, ColorSystem::Tristimulus(1.f, 0.f, 0.f)),
+            IsApproxEquals(ColorSystem::Tristimulus(0.2126f, -0.114572f, 0.5f), 1e-5f));
+    }
+    SECTION("constant luminance")
+    {
+        for (int i = 0; i < 1000; i++)
+        {
+            const ColorSystem::Tristimulus rgb((float)((i * 7) % 100) / 99.f, (float)((i * 13) % 100) / 99.f,
+                (float)((i * 31) % 100) / 99.f);
+            const ColorSystem::Tristimulus ycc = YCbCr::fromRGB(YCbCr::BT2020_CL, rgb);
+            REQUIRE(ycc[1] >= -0.5f);
+            REQUIRE(ycc[1] <= 0.5f);
+            REQUIRE(ycc[2] >= -0.5f);
+            REQUIRE(ycc[2] <= 0.5f);
+            REQUIRE_THAT(YCbCr::toRGB(YCbCr::BT2020_CL, ycc), IsApproxEquals(rgb, 1e-4f));
+        }
+        // grays are the same in both forms
+        REQUIRE_THAT(YCbCr::fromRGB(YCbCr::BT2020_CL, ColorSystem::Tristimulus(0.4f)),
+            IsApproxEquals(YCbCr::fromRGB(YCbCr::BT2020, ColorSystem::Tristimulus(0.4f)), 1e-6f));
+    }
+    SECTION("planar 4:4:4 matches per pixel")
+    {
+        const size_t             w = 67, h = 5;
+        const std::vector<float> img = makeImage(w, h);
+        std::vector<float>       y(w * h), cb(w * h), cr(w * h), back(w * h * 4);
+        for (const auto s : standards)
+        {
+            YCbCr::fromRGB(s, YCbCr::YUV444, ColorSystem::OTF::BT709, img.data(), w, h, y.data(), cb.data(), cr.data());
+            for (size_t i = 0; i < w * h; i++)
+            {
+                const ColorSystem::Tristimulus rgb = ColorSystem::OTF::toScreen(ColorSystem::OTF::BT709,
+                    ColorSystem::Tristimulus(img[i * 3 + 0], img[i * 3 + 1], img[i * 3 + 2]));
+                REQUIRE_THAT(ColorSystem::Tristimulus(y[i], cb[i], cr[i]),
+                    IsApproxEquals(YCbCr::fromRGB(s, rgb, ColorSystem::OTF::BT709), 1e-5f));
+            }
+            YCbCr::toRGB(s, YCbCr::YUV444, ColorSystem::OTF::BT709, y.data(), cb.data(), cr.data(), w, h, back.data(), 4);
+            for (size_t i = 0; i < w * h; i++)
+            {
+                REQUIRE_THAT(ColorSystem::Tristimulus(back[i * 4 + 0], back[i * 4 + 1], back[i * 4 + 2]),
+                    IsApproxEquals(ColorSystem::Tristimulus(img[i * 3 + 0], img[i * 3 + 1], img[i * 3 + 2]), 1e-4f));
+            }
+        }
+    }
+    SECTION("subsampled round trip")
+    {
+        const size_t             w = 65, h = 33; // odd sizes keep a half chroma sample at the edges
+        const std::vector<float> img = makeImage(w, h);
+        for (const auto ss : {YCbCr::YUV422, YCbCr::YUV420})
+        {
+            const size_t       cw = YCbCr::chromaWidth(ss, w), ch = YCbCr::chromaHeight(ss, h);
+            std::vector<float> y(w * h), cb(cw * ch), cr(cw * ch), back(w * h * 3);
+            REQUIRE(cw == 33);
+            REQUIRE(ch == ((ss == YCbCr::YUV420) ? 17u : h));
+            YCbCr::fromRGB(YCbCr::BT709, ss, ColorSystem::OTF::SRGB, img.data(), w, h, y.data(), cb.data(), cr.data());
+            YCbCr::toRGB(YCbCr::BT709, ss, ColorSystem::OTF::SRGB, y.data(), cb.data(), cr.data(), w, h, back.data());
+            for (size_t i = 0; i < w * h * 3; i++)
+                REQUIRE(back[i] == Approx(img[i]).margin(0.05f));
+        }
+    }
+    SECTION("code values")
+    {
+        const size_t          w = 8, h = 2;
+        std::vector<float>    white(w * h * 3, 1.f), back(w * h * 3);
+        std::vector<uint16_t> y(w * h), cb(w * h / 4), cr(w * h / 4);
+        YCbCr::fromRGB(YCbCr::BT2020, YCbCr::YUV420, ColorSystem::OTF::ST2084, white.data(), w, h, y.data(), cb.data(),
+            cr.data());
+        REQUIRE(y[0] == 64 + (uint16_t)(876.f * ColorSystem::OTF::Y_to_ST2084(1.f) + 0.5f));
+        REQUIRE(cb[0] == 512);
+        REQUIRE(cr[3] == 512);
+        YCbCr::toRGB(YCbCr::BT2020, YCbCr::YUV420, ColorSystem::OTF::ST2084, y.data(), cb.data(), cr.data(), w, h,
+            back.data());
+        for (const float v : back)
+            REQUIRE(v == Approx(1.f).epsilon(0.01f));
+
+        // narrow range codes stay off the SDI timing codes, 0-3 and 1020-1023 at 10 bits, 0 and 255 at 8
+        std::vector<float> extreme(w * h * 3);
+        for (size_t i = 0; i < extreme.size(); i++)
+            extreme[i] = (i % 7 < 3) ? -4.f : 4.f;
+        for (const int bits : {8, 10})
+        {
+            const uint16_t lo = (uint16_t)(1 << (bits - 8)), hi = (uint16_t)((255 << (bits - 8)) - 1);
+            YCbCr::fromRGB(YCbCr::BT709, YCbCr::YUV420, ColorSystem::OTF::LINEAR, extreme.data(), w, h, y.data(),
+                cb.data(), cr.data(), 3, bits);
+            for (const std::vector<uint16_t> *p : {&y, &cb, &cr})
+            {
+                REQUIRE(*std::min_element(p->begin(), p->end()) >= lo);
+                REQUIRE(*std::max_element(p->begin(), p->end()) <= hi);
+            }
+            REQUIRE(*std::min_element(y.begin(), y.end()) == lo);
+            REQUIRE(*std::max_element(y.begin(), y.end()) == hi);
+        }
+    }
+}